@@ -955,15 +955,17 @@ read_interfile_PDFS_SPECT(istream& input, const string& directory_for_data, cons
       return 0;
     }
 
-  return new ProjDataFromStream(hdr.get_exam_info_sptr(),
-                                hdr.data_info_sptr,
-                                data_in,
-                                hdr.data_offset_each_dataset[0],
-                                segment_sequence,
-                                hdr.storage_order,
-                                hdr.type_of_numbers,
-                                hdr.file_byte_order,
-                                static_cast<float>(hdr.image_scaling_factors[0][0]));
+  auto pdfs_ptr = new ProjDataFromStream(hdr.get_exam_info_sptr(),
+                                         hdr.data_info_sptr,
+                                         data_in,
+                                         hdr.data_offset_each_dataset[0],
+                                         segment_sequence,
+                                         hdr.storage_order,
+                                         hdr.type_of_numbers,
+                                         hdr.file_byte_order,
+                                         static_cast<float>(hdr.image_scaling_factors[0][0]));
+  pdfs_ptr->set_filename_for_concurrent_access(full_data_file_name, open_mode);
+  return pdfs_ptr;
 }
 
 ProjDataFromStream*
@@ -1001,6 +1003,7 @@ read_interfile_PDFS_Siemens(istream& input, const string& directory_for_data, co
                                          hdr.type_of_numbers,
                                          hdr.file_byte_order,
                                          1.);
+  pdfs_ptr->set_filename_for_concurrent_access(full_data_file_name, open_mode);
 
   if (hdr.timing_poss_sequence.size() > 1)
     pdfs_ptr->set_timing_poss_sequence_in_stream(hdr.timing_poss_sequence);
@@ -1078,6 +1081,7 @@ read_interfile_PDFS(istream& input, const string& directory_for_data, const ios:
                                          hdr.type_of_numbers,
                                          hdr.file_byte_order,
                                          static_cast<float>(hdr.image_scaling_factors[0][0]));
+  pdfs_ptr->set_filename_for_concurrent_access(full_data_file_name, open_mode);
 
   if (hdr.timing_poss_sequence.size() > 1)
     pdfs_ptr->set_timing_poss_sequence_in_stream(hdr.timing_poss_sequence);
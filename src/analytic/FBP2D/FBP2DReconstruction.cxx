@@ -300,7 +300,7 @@ FBP2DReconstruction::actual_reconstruct(shared_ptr<DiscretisedDensity<3, float>>
 #ifdef NRFFT
             filter.apply(*viewgram_iter);
 #else
-            std::for_each(viewgram_iter->begin(), viewgram_iter->end(), filter);
+            filter.apply_to_each(*viewgram_iter);
 #endif
           }
 
@@ -9,7 +9,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2012, Hammersmith Imanet Ltd
-    Copyright (C) 2020, University College London
+    Copyright (C) 2020, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -92,6 +92,8 @@
 #include "stir/recon_buildblock/BackProjectorByBinUsingInterpolation.h"
 #include "stir/recon_buildblock/ForwardProjectorByBinUsingRayTracing.h"
 #include "stir/IO/read_from_file.h"
+#include "stir/ViewSegmentNumbers.h"
+#include <boost/format.hpp>
 //#include "stir/mash_views.h"
 
 #include <algorithm>
@@ -99,6 +101,7 @@
 #include <iostream>
 #include <numeric>
 #include <string>
+#include <vector>
 // for asctime()
 #include <ctime>
 
@@ -115,6 +118,16 @@ START_NAMESPACE_STIR
 // should be private member, TODO
 static ofstream full_log;
 
+//! write a line to full_log, which is also used from multiple threads during the 3D processing
+static void
+write_to_full_log(const std::string& line)
+{
+#ifdef STIR_OPENMP
+#  pragma omp critical(FBP3DRP_full_log)
+#endif
+  full_log << line << endl;
+}
+
 // terribly ugly. can be replaced using LORCoordinates stuff (TODO)
 static void
 find_rmin_rmax(int& rmin,
@@ -605,62 +618,71 @@ FBP3DRPReconstruction::do_3D_Reconstruction(VoxelsOnCartesianGrid<float>& image)
 
   for (int seg_num = -max_segment_num_to_process; seg_num <= max_segment_num_to_process; seg_num++)
     {
-
-      // a bool value that will be used to determine if we are starting processing for this segment
-      bool first_view_in_segment = true;
-
-      const int orig_min_axial_pos_num = proj_data_ptr->get_min_axial_pos_num(seg_num);
-      const int orig_max_axial_pos_num = proj_data_ptr->get_max_axial_pos_num(seg_num);
-
+      std::vector<ViewSegmentNumbers> vs_nums_to_process;
       for (int view_num = proj_data_ptr->get_min_view_num(); view_num <= proj_data_ptr->get_max_view_num(); ++view_num)
         {
           const ViewSegmentNumbers vs_num(view_num, seg_num);
-          if (!symmetries_sptr->is_basic(vs_num))
-            continue;
-
-          const int new_min_axial_pos_num = proj_data_info_with_missing_data_sptr->get_min_axial_pos_num(seg_num);
-          const int new_max_axial_pos_num = proj_data_info_with_missing_data_sptr->get_max_axial_pos_num(seg_num);
-
-          if (first_view_in_segment)
-            {
-              full_log << "\n--------------------------------\n";
-              full_log << "PROCESSING SEGMENT  No " << seg_num << endl;
-
-              full_log << "Average delta= " << input_proj_data_info_cyl().get_average_ring_difference(seg_num) << " with span= "
-                       << input_proj_data_info_cyl().get_max_ring_difference(seg_num)
-                              - input_proj_data_info_cyl().get_min_ring_difference(seg_num) + 1
-                       << " and extended axial position numbers: min= " << new_min_axial_pos_num
-                       << " and max= " << new_max_axial_pos_num << endl;
-
-              first_view_in_segment = false;
-            }
+          if (symmetries_sptr->is_basic(vs_num))
+            vs_nums_to_process.push_back(vs_num);
+        }
+      // skip logging etc when this segment does not need any processing
+      // (some segment_nums might not because of the symmetries)
+      if (vs_nums_to_process.empty())
+        continue;
 
-          full_log << "\n*************************************************************";
-          full_log << "\n        Processing view " << vs_num.view_num() << " of segment " << vs_num.segment_num() << endl;
+      const int orig_min_axial_pos_num = proj_data_ptr->get_min_axial_pos_num(seg_num);
+      const int orig_max_axial_pos_num = proj_data_ptr->get_max_axial_pos_num(seg_num);
+      const int new_min_axial_pos_num = proj_data_info_with_missing_data_sptr->get_min_axial_pos_num(seg_num);
+      const int new_max_axial_pos_num = proj_data_info_with_missing_data_sptr->get_max_axial_pos_num(seg_num);
+
+      full_log << "\n--------------------------------\n";
+      full_log << "PROCESSING SEGMENT  No " << seg_num << endl;
+
+      full_log << "Average delta= " << input_proj_data_info_cyl().get_average_ring_difference(seg_num) << " with span= "
+               << input_proj_data_info_cyl().get_max_ring_difference(seg_num)
+                      - input_proj_data_info_cyl().get_min_ring_difference(seg_num) + 1
+               << " and extended axial position numbers: min= " << new_min_axial_pos_num << " and max= " << new_max_axial_pos_num
+               << endl;
+
+      // All views of this segment are processed in parallel. The filtered related viewgrams are
+      // back projected immediately (the back projector accumulates the results of all threads).
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+      // note: older versions of openmp need an int as loop
+      for (int i = 0; i < static_cast<int>(vs_nums_to_process.size()); ++i)
+        {
+          const ViewSegmentNumbers vs_num = vs_nums_to_process[i];
 
-          full_log << "\n  - Getting related viewgrams" << endl;
+          write_to_full_log(boost::str(boost::format("\n*************************************************************"
+                                                     "\n        Processing view %1% of segment %2%\n"
+                                                     "\n  - Getting related viewgrams")
+                                       % vs_num.view_num() % vs_num.segment_num()));
 
+#ifdef STIR_OPENMP
+          RelatedViewgrams<float> viewgrams;
+#  pragma omp critical(FBP3DRP_get_viewgrams)
+          viewgrams = proj_data_ptr->get_related_viewgrams(vs_num, symmetries_sptr);
+#else
           RelatedViewgrams<float> viewgrams = proj_data_ptr->get_related_viewgrams(vs_num, symmetries_sptr);
+#endif
 
           do_process_viewgrams(
               viewgrams, new_min_axial_pos_num, new_max_axial_pos_num, orig_min_axial_pos_num, orig_max_axial_pos_num);
         }
-      // do some logging etc, but only when this segment had any processing
-      // (some segment_nums might not because of the symmetries)
-      if (!first_view_in_segment)
-        {
-          full_log << "\n*************************************************************";
-          full_log << "\nEnd of this segment. Current image values:\n"
-                   << "Min= " << image.find_min() << " Max = " << image.find_max() << " Sum = " << image.sum() << endl;
+
+      // do some logging etc
+      full_log << "\n*************************************************************";
+      full_log << "\nEnd of this segment. Current image values:\n"
+               << "Min= " << image.find_min() << " Max = " << image.find_max() << " Sum = " << image.sum() << endl;
 #ifndef PARALLEL
-          if (save_intermediate_files && !_disable_output)
-            {
-              char* file = new char[output_filename_prefix.size() + 20];
-              sprintf(file, "%s_afterseg%d", output_filename_prefix.c_str(), seg_num);
-              back_projector_sptr->get_output(image);
-              do_save_img(file, image);
-              delete[] file;
-            }
+      if (save_intermediate_files && !_disable_output)
+        {
+          char* file = new char[output_filename_prefix.size() + 20];
+          sprintf(file, "%s_afterseg%d", output_filename_prefix.c_str(), seg_num);
+          back_projector_sptr->get_output(image);
+          do_save_img(file, image);
+          delete[] file;
         }
 #endif
     }
@@ -757,15 +779,16 @@ FBP3DRPReconstruction::do_forward_project_view(RelatedViewgrams<float>& viewgram
   // do not forward project if we don't need to...
   if (new_min_axial_pos_num <= orig_min_axial_pos_num - 1)
     {
-      full_log << "  - Forward projection of missing data first from ring No " << new_min_axial_pos_num << " to "
-               << orig_min_axial_pos_num - 1 << endl;
+      write_to_full_log(boost::str(boost::format("  - Forward projection of missing data first from ring No %1% to %2%")
+                                   % new_min_axial_pos_num % (orig_min_axial_pos_num - 1)));
 
       forward_projector_sptr->forward_project(viewgrams, new_min_axial_pos_num, orig_min_axial_pos_num - 1);
     }
 
   if (orig_max_axial_pos_num + 1 <= new_max_axial_pos_num)
     {
-      full_log << "  - Forward projection from ring No " << orig_max_axial_pos_num + 1 << " to " << new_max_axial_pos_num << endl;
+      write_to_full_log(boost::str(boost::format("  - Forward projection from ring No %1% to %2%") % (orig_max_axial_pos_num + 1)
+                                   % new_max_axial_pos_num));
 
       forward_projector_sptr->forward_project(viewgrams, orig_max_axial_pos_num + 1, new_max_axial_pos_num);
     }
@@ -804,10 +827,15 @@ FBP3DRPReconstruction::do_colsher_filter_view(RelatedViewgrams<float>& viewgrams
 #endif
   const int seg_num = viewgrams.get_basic_segment_num();
 
+  // This function is called from multiple threads, but always for the same segment (see do_3D_Reconstruction()).
+  // The first thread sets up the filter, the others wait until that is finished.
+#ifdef STIR_OPENMP
+#  pragma omp critical(FBP3DRP_colsher_set_up)
+#endif
   if (prev_seg_num != seg_num)
     {
       prev_seg_num = seg_num;
-      full_log << "  - Constructing Colsher filter for this segment\n";
+      write_to_full_log("  - Constructing Colsher filter for this segment");
       const int nrings = viewgrams.get_num_axial_poss();
       const int nprojs = viewgrams.get_num_tangential_poss();
 
@@ -820,8 +848,8 @@ FBP3DRPReconstruction::do_colsher_filter_view(RelatedViewgrams<float>& viewgrams
 
       const float sampling_in_s = viewgrams.get_proj_data_info_sptr()->get_sampling_in_s(Bin(seg_num, 0, 0, 0));
       const float sampling_in_t = viewgrams.get_proj_data_info_sptr()->get_sampling_in_t(Bin(seg_num, 0, 0, 0));
-      full_log << "Colsher filter theta_max = " << theta_max << " theta = " << theta << " d_a = " << sampling_in_s
-               << " d_b = " << sampling_in_t << endl;
+      write_to_full_log(boost::str(boost::format("Colsher filter theta_max = %1% theta = %2% d_a = %3% d_b = %4%") % theta_max
+                                   % theta % sampling_in_s % sampling_in_t));
 
 #ifdef NRFFT
       colsher_filter = ColsherFilter(height,
@@ -840,7 +868,7 @@ FBP3DRPReconstruction::do_colsher_filter_view(RelatedViewgrams<float>& viewgrams
 #endif
     }
 
-  full_log << "  - Apply Colsher filter to complete oblique sinograms" << endl;
+  write_to_full_log("  - Apply Colsher filter to complete oblique sinograms");
 #ifdef NRFFT
 
   assert(viewgrams.get_num_viewgrams() % 2 == 0);
@@ -852,12 +880,9 @@ FBP3DRPReconstruction::do_colsher_filter_view(RelatedViewgrams<float>& viewgrams
 
 #else
 
-    //  do not use std::for_each. at present on gcc it copies the filter for every viewgram
-    //  std::for_each(viewgrams.begin(), viewgrams.end(),
-    //		colsher_filter);
-    RelatedViewgrams<float>::iterator viewgram_iter = viewgrams.begin();
-    for (; viewgram_iter != viewgrams.end(); ++viewgram_iter)
-      colsher_filter(*viewgram_iter);
+    //  do not use std::for_each. at present on gcc it copies the filter for every viewgram.
+    //  apply_to_each reuses the same work arrays for all viewgrams.
+    colsher_filter.apply_to_each(viewgrams.begin(), viewgrams.end());
 
 #endif
   /* If the segment is really an amalgam of different ring differences,
@@ -871,7 +896,7 @@ FBP3DRPReconstruction::do_colsher_filter_view(RelatedViewgrams<float>& viewgrams
   {
     const int num_ring_differences = input_proj_data_info_cyl().get_max_ring_difference(seg_num)
                                      - input_proj_data_info_cyl().get_min_ring_difference(seg_num) + 1;
-    full_log << "  - Multiplying filtered projections by " << num_ring_differences << endl;
+    write_to_full_log("  - Multiplying filtered projections by " + std::to_string(num_ring_differences));
     if (num_ring_differences != 1)
       {
         viewgrams *= static_cast<float>(num_ring_differences);
@@ -888,7 +913,7 @@ FBP3DRPReconstruction::do_3D_backprojection_view(const RelatedViewgrams<float>&
                                                  int new_min_axial_pos_num,
                                                  int new_max_axial_pos_num)
 {
-  full_log << "  - Backproject the filtered Colsher complete sinograms" << endl;
+  write_to_full_log("  - Backproject the filtered Colsher complete sinograms");
 
   back_projector_sptr->back_project(viewgrams, new_min_axial_pos_num, new_max_axial_pos_num);
 }
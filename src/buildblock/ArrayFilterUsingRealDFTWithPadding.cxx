@@ -2,6 +2,7 @@
 //
 /*
     Copyright (C) 2004- 2007, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -123,24 +124,46 @@ ArrayFilterUsingRealDFTWithPadding<num_dimensions, elemT>::do_it(Array<num_dimen
     {
       // convolution using DFT
       {
-        Array<num_dimensions, std::complex<elemT>> tmp = fourier_for_real_data(in_array);
+        Array<num_dimensions, std::complex<elemT>> tmp;
+        fourier_for_real_data(tmp, in_array);
         tmp *= kernel_in_frequency_space;
-        out_array = inverse_fourier_for_real_data_corrupting_input(tmp);
+        inverse_fourier_for_real_data_corrupting_input(out_array, tmp);
       }
     }
   else
     {
-      // copy input into padded_array using wrap-around
-
       Array<num_dimensions, elemT> padded_array(this->padding_range);
-      transform_array_to_periodic_indices(padded_array, in_array);
-      // call do_it with padded_array
-      do_it(padded_array, padded_array);
-      // Now copy result in out_array using wrap-around
-      transform_array_from_periodic_indices(out_array, padded_array);
+      Array<num_dimensions, std::complex<elemT>> tmp;
+      do_it(out_array, in_array, padded_array, tmp);
     }
 }
 
+template <int num_dimensions, typename elemT>
+void
+ArrayFilterUsingRealDFTWithPadding<num_dimensions, elemT>::do_it(Array<num_dimensions, elemT>& out_array,
+                                                                 const Array<num_dimensions, elemT>& in_array,
+                                                                 Array<num_dimensions, elemT>& padded_array,
+                                                                 Array<num_dimensions, std::complex<elemT>>& tmp) const
+{
+  assert(padded_array.get_index_range() == this->padding_range);
+  // copy input into padded_array using wrap-around
+  padded_array.fill(0);
+  transform_array_to_periodic_indices(padded_array, in_array);
+  // convolution using DFT, reusing the memory of the work arrays
+  fourier_for_real_data(tmp, padded_array);
+  tmp *= kernel_in_frequency_space;
+  inverse_fourier_for_real_data_corrupting_input(padded_array, tmp);
+  // Now copy result in out_array using wrap-around
+  transform_array_from_periodic_indices(out_array, padded_array);
+}
+
+template <int num_dimensions, typename elemT>
+void
+ArrayFilterUsingRealDFTWithPadding<num_dimensions, elemT>::apply_to_each(Array<num_dimensions + 1, elemT>& data) const
+{
+  this->apply_to_each(data.begin(), data.end());
+}
+
 template class ArrayFilterUsingRealDFTWithPadding<1, float>;
 template class ArrayFilterUsingRealDFTWithPadding<2, float>;
 template class ArrayFilterUsingRealDFTWithPadding<3, float>;
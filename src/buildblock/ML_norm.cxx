@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2001- 2012, Hammersmith Imanet Ltd
-    Copyright (C) 2016, 2020, 2021, University College London
+    Copyright (C) 2016, 2020, 2021, 2026, University College London
     Copyright (C) 2016-2017, PETsys Electronics
     Copyright (C) 2021, Gefei Chen
     Copyright (C) 2022, National Physical Laboratory
@@ -35,6 +35,7 @@
 #endif
 
 #include <algorithm>
+#include <vector>
 using std::min;
 using std::max;
 
@@ -1164,6 +1165,71 @@ make_fan_data_remove_gaps(FanProjData& fan_data, const ProjData& proj_data)
     }
 }
 
+FanProjDataAccumulator::FanProjDataAccumulator(FanProjData& fan_data, const ProjDataInfo& proj_data_info)
+    : fan_data(fan_data),
+      cylindrical_proj_data_info_ptr(dynamic_cast<const ProjDataInfoCylindricalNoArcCorr*>(&proj_data_info)),
+      blocks_proj_data_info_ptr(dynamic_cast<const ProjDataInfoBlocksOnCylindricalNoArcCorr*>(&proj_data_info))
+{
+  if (proj_data_info.is_tof_data())
+    error("FanProjDataAccumulator: Incompatible with TOF data. Abort.");
+  if (this->cylindrical_proj_data_info_ptr == 0 && this->blocks_proj_data_info_ptr == 0)
+    error("FanProjDataAccumulator: Can only process not arc-corrected data\n");
+
+  int num_rings;
+  int num_detectors_per_ring;
+  int fan_size;
+  int max_delta;
+  get_fan_info(num_rings, num_detectors_per_ring, max_delta, fan_size, proj_data_info);
+
+  const Scanner& scanner = *proj_data_info.get_scanner_sptr();
+  this->num_transaxial_crystals_per_block = scanner.get_num_transaxial_crystals_per_block();
+  this->num_axial_crystals_per_block = scanner.get_num_axial_crystals_per_block();
+  this->num_virtual_transaxial_crystals_per_block = scanner.get_num_virtual_transaxial_crystals_per_block();
+  this->num_virtual_axial_crystals_per_block = scanner.get_num_virtual_axial_crystals_per_block();
+
+  // find sizes as in make_fan_data_remove_gaps_help
+  const int num_transaxial_blocks_in_fansize = fan_size / this->num_transaxial_crystals_per_block;
+  const int new_half_fan_size
+      = (fan_size - num_transaxial_blocks_in_fansize * this->num_virtual_transaxial_crystals_per_block) / 2;
+  const int num_axial_blocks_in_max_delta = max_delta / this->num_axial_crystals_per_block;
+  const int new_max_delta = max_delta - num_axial_blocks_in_max_delta * this->num_virtual_axial_crystals_per_block;
+  const int num_physical_detectors_per_ring
+      = num_detectors_per_ring - scanner.get_num_transaxial_blocks() * this->num_virtual_transaxial_crystals_per_block;
+  const int num_physical_rings = num_rings - (scanner.get_num_axial_blocks() - 1) * this->num_virtual_axial_crystals_per_block;
+  fan_data = FanProjData(num_physical_rings, num_physical_detectors_per_ring, new_max_delta, 2 * new_half_fan_size + 1);
+}
+
+void
+FanProjDataAccumulator::add(const Bin& bin, const float value)
+{
+  int ra = 0, a = 0;
+  int rb = 0, b = 0;
+  if (this->cylindrical_proj_data_info_ptr)
+    this->cylindrical_proj_data_info_ptr->get_det_pair_for_bin(a, ra, b, rb, bin);
+  else
+    this->blocks_proj_data_info_ptr->get_det_pair_for_bin(a, ra, b, rb, bin);
+
+  const int num_physical_transaxial_crystals_per_block
+      = this->num_transaxial_crystals_per_block - this->num_virtual_transaxial_crystals_per_block;
+  const int num_physical_axial_crystals_per_block
+      = this->num_axial_crystals_per_block - this->num_virtual_axial_crystals_per_block;
+  if (a % this->num_transaxial_crystals_per_block >= num_physical_transaxial_crystals_per_block
+      || b % this->num_transaxial_crystals_per_block >= num_physical_transaxial_crystals_per_block
+      || ra % this->num_axial_crystals_per_block >= num_physical_axial_crystals_per_block
+      || rb % this->num_axial_crystals_per_block >= num_physical_axial_crystals_per_block)
+    return;
+
+  const int new_a = a - (a / this->num_transaxial_crystals_per_block) * this->num_virtual_transaxial_crystals_per_block;
+  const int new_b = b - (b / this->num_transaxial_crystals_per_block) * this->num_virtual_transaxial_crystals_per_block;
+  const int new_ra = ra - (ra / this->num_axial_crystals_per_block) * this->num_virtual_axial_crystals_per_block;
+  const int new_rb = rb - (rb / this->num_axial_crystals_per_block) * this->num_virtual_axial_crystals_per_block;
+
+  // make_fan_data_remove_gaps sets both (ra,a,rb,b) and (rb,b,ra,a). These are the same element, except when ra==rb.
+  this->fan_data(new_ra, new_a, new_rb, new_b) += value;
+  if (new_ra == new_rb)
+    this->fan_data(new_rb, new_b, new_ra, new_a) += value;
+}
+
 /// **** This function make proj_data from fan_data while adding the intermodule gaps **** ////
 /// *** fan_data doesn't have gaps, proj_data has gaps *** ///
 template <class TProjDataInfo>
@@ -1282,7 +1348,13 @@ apply_block_norm(FanProjData& fan_data, const BlockData3D& block_data, const boo
   const int num_tangential_crystals_per_block = num_tangential_detectors / num_tangential_blocks;
   assert(num_tangential_blocks * num_tangential_crystals_per_block == num_tangential_detectors);
 
-  for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
+  // Note: all elements with a given ra (and rb>=ra) are stored in fan_data[ra], so we can parallelise over ra
+  const int min_ra = fan_data.get_min_ra();
+  const int max_ra = fan_data.get_max_ra();
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int ra = min_ra; ra <= max_ra; ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       // loop rb from ra to avoid double counting
       for (int rb = max(ra, fan_data.get_min_rb(ra)); rb <= fan_data.get_max_rb(ra); ++rb)
@@ -1349,6 +1421,7 @@ apply_geo_norm(FanProjData& fan_data, const GeoData3D& geo_data, const bool appl
   FanProjData work = fan_data;
   work.fill(0);
 
+  // Note: this loop is not parallelised, as different (ra,a,rb,b) can write to the same element of work
   for (int ra = 0; ra < num_axial_crystals_per_block; ++ra)
     for (int a = 0; a < num_transaxial_crystals_per_block / 2; ++a)
       // loop rb from ra to avoid double counting
@@ -1394,7 +1467,12 @@ apply_geo_norm(FanProjData& fan_data, const GeoData3D& geo_data, const bool appl
               }
           }
 
-  for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
+  const int min_ra = fan_data.get_min_ra();
+  const int max_ra = fan_data.get_max_ra();
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int ra = min_ra; ra <= max_ra; ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       //    for (int rb = fan_data.get_min_ra(); rb <= fan_data.get_max_ra(); ++rb)
       for (int rb = max(ra, fan_data.get_min_rb(ra)); rb <= fan_data.get_max_rb(ra); ++rb)
@@ -1414,7 +1492,12 @@ void
 apply_efficiencies(FanProjData& fan_data, const DetectorEfficiencies& efficiencies, const bool apply)
 {
   const int num_detectors_per_ring = fan_data.get_num_detectors_per_ring();
-  for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
+  const int min_ra = fan_data.get_min_ra();
+  const int max_ra = fan_data.get_max_ra();
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int ra = min_ra; ra <= max_ra; ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       // loop rb from ra to avoid double counting
       for (int rb = max(ra, fan_data.get_min_rb(ra)); rb <= fan_data.get_max_rb(ra); ++rb)
@@ -1432,7 +1515,12 @@ apply_efficiencies(FanProjData& fan_data, const DetectorEfficiencies& efficienci
 void
 make_fan_sum_data(Array<2, float>& data_fan_sums, const FanProjData& fan_data)
 {
-  for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
+  const int min_ra = fan_data.get_min_ra();
+  const int max_ra = fan_data.get_max_ra();
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int ra = min_ra; ra <= max_ra; ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       data_fan_sums[ra][a] = fan_data.sum(ra, a);
 }
@@ -1520,7 +1608,10 @@ make_fan_sum_data(Array<2, float>& data_fan_sums,
   assert(data_fan_sums.get_min_index() == 0);
   const int num_detectors_per_ring = data_fan_sums[0].get_length();
 
-  for (int ra = data_fan_sums.get_min_index(); ra <= data_fan_sums.get_max_index(); ++ra)
+#ifdef STIR_OPENMP
+#  pragma omp parallel for
+#endif
+  for (int ra = 0; ra < num_rings; ++ra)
     for (int a = data_fan_sums[ra].get_min_index(); a <= data_fan_sums[ra].get_max_index(); ++a)
       {
         float fan_sum = 0;
@@ -1547,7 +1638,12 @@ make_geo_data(GeoData3D& geo_data, const FanProjData& fan_data)
   FanProjData work = fan_data;
   work.fill(0);
 
-  for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
+  const int min_ra = fan_data.get_min_ra();
+  const int max_ra = fan_data.get_max_ra();
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int ra = min_ra; ra <= max_ra; ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       // 1// for (int rb = fan_data.get_min_ra(); rb <= fan_data.get_max_ra(); ++rb)
       for (int rb = max(ra, fan_data.get_min_rb(ra)); rb <= fan_data.get_max_rb(ra); ++rb)
@@ -1568,6 +1664,10 @@ make_geo_data(GeoData3D& geo_data, const FanProjData& fan_data)
 
   geo_data.fill(0);
 
+  // Note: geo_data(ra, a, rb, b) is stored in geo_data[ra], so we can parallelise over ra
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = 0; ra < num_axial_crystals_per_block; ++ra)
     //  for (int a = 0; a <= num_transaxial_detectors/2; ++a)
     for (int a = 0; a < num_transaxial_crystals_per_block / 2; ++a)
@@ -1612,18 +1712,26 @@ make_block_data(BlockData3D& block_data, const FanProjData& fan_data)
   assert(num_transaxial_blocks * num_transaxial_crystals_per_block == num_transaxial_detectors);
 
   block_data.fill(0);
-  for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
-    for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
-      // loop rb from ra to avoid double counting
-      for (int rb = max(ra, fan_data.get_min_rb(ra)); rb <= fan_data.get_max_rb(ra); ++rb)
-        for (int b = fan_data.get_min_b(a); b <= fan_data.get_max_b(a); ++b)
-          {
-            block_data(ra / num_axial_crystals_per_block,
-                       a / num_transaxial_crystals_per_block,
-                       rb / num_axial_crystals_per_block,
-                       b / num_transaxial_crystals_per_block)
-                += fan_data(ra, a, rb, b);
-          }
+  // As rb >= ra, all elements for rings in an axial block are added to block_data[axial_block_num].
+  // We can therefore parallelise over axial blocks, while summing in the same order as a serial loop.
+  assert(fan_data.get_min_ra() == 0);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int axial_block_num = 0; axial_block_num < num_axial_blocks; ++axial_block_num)
+    for (int ra = axial_block_num * num_axial_crystals_per_block; ra < (axial_block_num + 1) * num_axial_crystals_per_block;
+         ++ra)
+      for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
+        // loop rb from ra to avoid double counting
+        for (int rb = max(ra, fan_data.get_min_rb(ra)); rb <= fan_data.get_max_rb(ra); ++rb)
+          for (int b = fan_data.get_min_b(a); b <= fan_data.get_max_b(a); ++b)
+            {
+              block_data(axial_block_num,
+                         a / num_transaxial_crystals_per_block,
+                         rb / num_axial_crystals_per_block,
+                         b / num_transaxial_crystals_per_block)
+                  += fan_data(ra, a, rb, b);
+            }
 }
 
 void
@@ -1634,6 +1742,8 @@ iterate_efficiencies(DetectorEfficiencies& efficiencies, const Array<2, float>&
   assert(model.get_max_ra() == data_fan_sums.get_max_index());
   assert(model.get_min_a() == data_fan_sums[data_fan_sums.get_min_index()].get_min_index());
   assert(model.get_max_a() == data_fan_sums[data_fan_sums.get_min_index()].get_max_index());
+  // Note: this loop is not parallelised, as the update uses the efficiencies that were already updated
+  // in this loop (i.e. it is a Gauss-Seidel type of update)
   for (int ra = model.get_min_ra(); ra <= model.get_max_ra(); ++ra)
     for (int a = model.get_min_a(); a <= model.get_max_a(); ++a)
       {
@@ -1745,8 +1855,14 @@ iterate_block_norm(BlockData3D& norm_block_data, const BlockData3D& measured_blo
 double
 KL(const FanProjData& d1, const FanProjData& d2, const double threshold)
 {
-  double sum = 0;
-  for (int ra = d1.get_min_ra(); ra <= d1.get_max_ra(); ++ra)
+  // sum per ra first, and add those in order afterwards, such that the result does not depend on the number of threads
+  const int min_ra = d1.get_min_ra();
+  const int max_ra = d1.get_max_ra();
+  std::vector<double> ra_sums(max_ra - min_ra + 1, 0.);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int ra = min_ra; ra <= max_ra; ++ra)
     {
       double asum = 0;
       for (int a = d1.get_min_a(); a <= d1.get_max_a(); ++a)
@@ -1761,9 +1877,12 @@ KL(const FanProjData& d1, const FanProjData& d2, const double threshold)
             }
           asum += rbsum;
         }
-      sum += asum;
+      ra_sums[ra - min_ra] = asum;
     }
-  return static_cast<double>(sum);
+  double sum = 0;
+  for (const double ra_sum : ra_sums)
+    sum += ra_sum;
+  return sum;
 }
 
 /*double KL(const GeoData3D& d1, const GeoData3D& d2, const double threshold)
@@ -37,9 +37,13 @@
 #include "stir/IO/write_data.h"
 #include "stir/IO/read_data.h"
 #include "stir/is_null_ptr.h"
+#include <algorithm>
 #include <numeric>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
 #include "stir/warning.h"
 #include "stir/error.h"
 
@@ -53,6 +57,44 @@ using std::endl;
 using std::vector;
 
 START_NAMESPACE_STIR
+
+struct ProjDataFromStream::ConcurrentStreams
+{
+  //! protects \c streams (but not the streams themselves, as every thread only uses its own)
+  std::mutex mutex;
+  std::map<std::thread::id, std::unique_ptr<fstream>> streams;
+
+  //! Closes the streams of a thread when it exits
+  /*! Threads are often short-lived (e.g. std::async), so we cannot wait for the
+      ConcurrentStreams object to be deleted, as we would run out of file descriptors.
+  */
+  struct StreamsOfThread
+  {
+    std::vector<std::weak_ptr<ConcurrentStreams>> used;
+
+    ~StreamsOfThread()
+    {
+      const std::thread::id id = std::this_thread::get_id();
+      for (auto& weak_sptr : used)
+        if (auto sptr = weak_sptr.lock())
+          {
+            std::lock_guard<std::mutex> lock(sptr->mutex);
+            sptr->streams.erase(id);
+          }
+    }
+  };
+
+  //! Make sure that the stream of the current thread in \a sptr is closed when the thread exits
+  static void close_stream_at_thread_exit(const shared_ptr<ConcurrentStreams>& sptr)
+  {
+    thread_local StreamsOfThread streams_of_thread;
+    auto& used = streams_of_thread.used;
+    used.erase(std::remove_if(used.begin(), used.end(), [](const std::weak_ptr<ConcurrentStreams>& w) { return w.expired(); }),
+               used.end());
+    used.push_back(sptr);
+  }
+};
+
 //---------------------------------------------------------
 // constructors
 //---------------------------------------------------------
@@ -74,7 +116,8 @@ ProjDataFromStream::ProjDataFromStream(shared_ptr<const ExamInfo> const& exam_in
       storage_order(o),
       on_disk_data_type(data_type),
       on_disk_byte_order(byte_order),
-      scale_factor(scale_factor)
+      scale_factor(scale_factor),
+      open_mode_for_concurrent_access(ios::in | ios::binary)
 {
   assert(storage_order != Unsupported);
   assert(!(data_type == NumericType::UNKNOWN_TYPE));
@@ -97,7 +140,8 @@ ProjDataFromStream::ProjDataFromStream(shared_ptr<const ExamInfo> const& exam_in
       storage_order(o),
       on_disk_data_type(data_type),
       on_disk_byte_order(byte_order),
-      scale_factor(scale_factor)
+      scale_factor(scale_factor),
+      open_mode_for_concurrent_access(ios::in | ios::binary)
 {
   assert(storage_order != Unsupported);
   assert(!(data_type == NumericType::UNKNOWN_TYPE));
@@ -154,6 +198,60 @@ ProjDataFromStream::set_timing_poss_sequence_in_stream(const std::vector<int>& s
   this->timing_poss_sequence = seq;
 }
 
+void
+ProjDataFromStream::set_filename_for_concurrent_access(const std::string& filename, const std::ios::openmode open_mode)
+{
+  this->filename_for_concurrent_access = filename;
+  // close any streams opened for the previous file
+  this->concurrent_streams_sptr = std::make_shared<ConcurrentStreams>();
+  // never truncate the file, but open it for writing if the original stream was
+  this->open_mode_for_concurrent_access = (open_mode & ios::out) ? (ios::in | ios::out | ios::binary) : (ios::in | ios::binary);
+}
+
+std::size_t
+ProjDataFromStream::get_num_streams_for_concurrent_access() const
+{
+  if (!this->concurrent_streams_sptr)
+    return 0;
+  std::lock_guard<std::mutex> lock(this->concurrent_streams_sptr->mutex);
+  return this->concurrent_streams_sptr->streams.size();
+}
+
+template <class FunctionT>
+void
+ProjDataFromStream::do_io(FunctionT f) const
+{
+  if (!this->filename_for_concurrent_access.empty())
+    {
+      // use the stream of this thread, such that no locking is needed for the I/O itself
+      fstream* s_ptr;
+      {
+        std::lock_guard<std::mutex> lock(this->concurrent_streams_sptr->mutex);
+        auto& s_uptr = this->concurrent_streams_sptr->streams[std::this_thread::get_id()];
+        if (!s_uptr)
+          {
+            s_uptr.reset(new fstream);
+            // switch off buffering as we read/write complete rows at once
+            // (also avoids stale buffers if another thread writes to the file)
+            s_uptr->rdbuf()->pubsetbuf(nullptr, 0);
+            s_uptr->open(this->filename_for_concurrent_access, this->open_mode_for_concurrent_access);
+            if (!*s_uptr)
+              error("ProjDataFromStream: error opening file " + this->filename_for_concurrent_access);
+            ConcurrentStreams::close_stream_at_thread_exit(this->concurrent_streams_sptr);
+          }
+        s_ptr = s_uptr.get();
+      }
+      // clear any error state (e.g. eof) left by a previous call
+      s_ptr->clear();
+      f(*s_ptr);
+      return;
+    }
+#ifdef STIR_OPENMP
+#  pragma omp critical(PROJDATAFROMSTREAMIO)
+#endif
+  f(*this->sino_stream);
+}
+
 namespace detail
 {
 // 2 local functions to avoid cluttering code below
@@ -195,44 +293,42 @@ ProjDataFromStream::get_viewgram(const int view_num,
   Succeeded succeeded = Succeeded::yes;
   Bin bin(segment_num, view_num, this->get_min_axial_pos_num(segment_num), this->get_min_tangential_pos_num(), timing_pos);
 
-#ifdef STIR_OPENMP
-#  pragma omp critical(PROJDATAFROMSTREAMIO)
-#endif
-  try
-    {
-      if (get_storage_order() == Segment_AxialPos_View_TangPos || get_storage_order() == Timing_Segment_AxialPos_View_TangPos)
-        {
-          for (bin.axial_pos_num() = get_min_axial_pos_num(segment_num);
-               bin.axial_pos_num() <= get_max_axial_pos_num(segment_num);
-               bin.axial_pos_num()++)
-            {
-              detail::checked_seekg("get_viewgram", *sino_stream, get_offset(bin));
-              if ((succeeded
-                   = read_data(*sino_stream, viewgram[bin.axial_pos_num()], on_disk_data_type, scale, on_disk_byte_order))
-                  == Succeeded::no)
-                break;
-              if (scale != 1)
-                break;
-            }
-        }
-      else if (get_storage_order() == Segment_View_AxialPos_TangPos
-               || get_storage_order() == Timing_Segment_View_AxialPos_TangPos)
-        {
-          // read in one go (skipping the extra seek)
-          detail::checked_seekg("get_viewgram", *sino_stream, get_offset(bin));
-          succeeded = read_data(*sino_stream, viewgram, on_disk_data_type, scale, on_disk_byte_order);
-        }
-      else
-        {
-          warning("ProjDataFromStream::get_viewgram: unsupported storage order");
-          succeeded = Succeeded::no;
-        }
-    }
-  catch (...)
-    {
-      succeeded = Succeeded::no;
-    }
-  // end of critical section
+  this->do_io([&](std::iostream& stream) {
+    try
+      {
+        if (get_storage_order() == Segment_AxialPos_View_TangPos || get_storage_order() == Timing_Segment_AxialPos_View_TangPos)
+          {
+            for (bin.axial_pos_num() = get_min_axial_pos_num(segment_num);
+                 bin.axial_pos_num() <= get_max_axial_pos_num(segment_num);
+                 bin.axial_pos_num()++)
+              {
+                detail::checked_seekg("get_viewgram", stream, get_offset(bin));
+                if ((succeeded
+                     = read_data(stream, viewgram[bin.axial_pos_num()], on_disk_data_type, scale, on_disk_byte_order))
+                    == Succeeded::no)
+                  break;
+                if (scale != 1)
+                  break;
+              }
+          }
+        else if (get_storage_order() == Segment_View_AxialPos_TangPos
+                 || get_storage_order() == Timing_Segment_View_AxialPos_TangPos)
+          {
+            // read in one go (skipping the extra seek)
+            detail::checked_seekg("get_viewgram", stream, get_offset(bin));
+            succeeded = read_data(stream, viewgram, on_disk_data_type, scale, on_disk_byte_order);
+          }
+        else
+          {
+            warning("ProjDataFromStream::get_viewgram: unsupported storage order");
+            succeeded = Succeeded::no;
+          }
+      }
+    catch (...)
+      {
+        succeeded = Succeeded::no;
+      }
+  });
   if (scale != 1)
     error("ProjDataFromStream: error reading data: scale factor returned by read_data should be 1");
   if (succeeded == Succeeded::no)
@@ -266,12 +362,24 @@ ProjDataFromStream::get_bin_value(const Bin& this_bin) const
       error("ProjDataFromStream::get_bin_value: error in stream state before reading\n");
     }
 
-  detail::checked_seekg("get_bin_value", *sino_stream, get_offset(this_bin));
-
+  // find offset first, such that we get a sensible error message when out-of-range
+  const streamoff bin_offset = get_offset(this_bin);
   Array<1, float> value(1);
   float scale = float(1);
+  Succeeded succeeded = Succeeded::yes;
 
-  if (read_data(*sino_stream, value, on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no)
+  this->do_io([&](std::iostream& stream) {
+    try
+      {
+        detail::checked_seekg("get_bin_value", stream, bin_offset);
+        succeeded = read_data(stream, value, on_disk_data_type, scale, on_disk_byte_order);
+      }
+    catch (...)
+      {
+        succeeded = Succeeded::no;
+      }
+  });
+  if (succeeded == Succeeded::no)
     error("ProjDataFromStream: error reading data\n");
   if (scale != 1.f)
     error("ProjDataFromStream: error reading data: scale factor returned by read_data should be 1\n");
@@ -293,13 +401,27 @@ ProjDataFromStream::set_bin_value(const Bin& this_bin)
       error("ProjDataFromStream::set_bin_value: error in stream state before writing");
     }
 
-  detail::checked_seekp("set_bin_value", *sino_stream, get_offset(this_bin));
-
+  const streamoff bin_offset = get_offset(this_bin);
   Array<1, float> value(1);
   value[0] = this_bin.get_bin_value();
   float scale = float(1);
-  // Now the storage order is not more important. Just read.
-  if (write_data(*sino_stream, value, on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no)
+  Succeeded succeeded = Succeeded::yes;
+
+  this->do_io([&](std::iostream& stream) {
+    try
+      {
+        detail::checked_seekp("set_bin_value", stream, bin_offset);
+        // Now the storage order is not more important. Just write.
+        succeeded = write_data(stream, value, on_disk_data_type, scale, on_disk_byte_order);
+        // flush the stream, see the class documentation
+        stream.flush();
+      }
+    catch (...)
+      {
+        succeeded = Succeeded::no;
+      }
+  });
+  if (succeeded == Succeeded::no)
     error("ProjDataFromStream: error writing data\n");
   if (scale != 1.f)
     error("ProjDataFromStream: error writing data: scale factor returned by write_data should be 1\n");
@@ -357,49 +479,47 @@ ProjDataFromStream::set_viewgram(const Viewgram<float>& v)
   float scale = scale_factor;
   Succeeded succeeded = Succeeded::yes;
 
-#ifdef STIR_OPENMP
-#  pragma omp critical(PROJDATAFROMSTREAMIO)
-#endif
-  try
-    {
-      if (get_storage_order() == Segment_AxialPos_View_TangPos || get_storage_order() == Timing_Segment_AxialPos_View_TangPos)
-        {
-          for (bin.axial_pos_num() = get_min_axial_pos_num(segment_num);
-               bin.axial_pos_num() <= get_max_axial_pos_num(segment_num);
-               bin.axial_pos_num()++)
-            {
-              detail::checked_seekp("set_viewgram", *sino_stream, get_offset(bin));
-              if (write_data(*sino_stream, v[bin.axial_pos_num()], on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no
-                  || scale != scale_factor)
-                {
-                  succeeded = Succeeded::no;
-                  break;
-                }
-            }
-        }
-      else if (get_storage_order() == Segment_View_AxialPos_TangPos
-               || get_storage_order() == Timing_Segment_View_AxialPos_TangPos)
-        {
-          // write in one go (skipping the extra seek)
-          detail::checked_seekp("set_viewgram", *sino_stream, get_offset(bin));
-          if (write_data(*sino_stream, v, on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no || scale != scale_factor)
-            {
-              succeeded = Succeeded::no;
-            }
-        }
-      else
-        {
-          warning("ProjDataFromStream::set_viewgram: unsupported storage order");
-          succeeded = Succeeded::no;
-        }
-      // flush the stream, see the class documentation
-      sino_stream->flush();
-    }
-  catch (...)
-    {
-      succeeded = Succeeded::no;
-    }
-  // end of critical section
+  this->do_io([&](std::iostream& stream) {
+    try
+      {
+        if (get_storage_order() == Segment_AxialPos_View_TangPos || get_storage_order() == Timing_Segment_AxialPos_View_TangPos)
+          {
+            for (bin.axial_pos_num() = get_min_axial_pos_num(segment_num);
+                 bin.axial_pos_num() <= get_max_axial_pos_num(segment_num);
+                 bin.axial_pos_num()++)
+              {
+                detail::checked_seekp("set_viewgram", stream, get_offset(bin));
+                if (write_data(stream, v[bin.axial_pos_num()], on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no
+                    || scale != scale_factor)
+                  {
+                    succeeded = Succeeded::no;
+                    break;
+                  }
+              }
+          }
+        else if (get_storage_order() == Segment_View_AxialPos_TangPos
+                 || get_storage_order() == Timing_Segment_View_AxialPos_TangPos)
+          {
+            // write in one go (skipping the extra seek)
+            detail::checked_seekp("set_viewgram", stream, get_offset(bin));
+            if (write_data(stream, v, on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no || scale != scale_factor)
+              {
+                succeeded = Succeeded::no;
+              }
+          }
+        else
+          {
+            warning("ProjDataFromStream::set_viewgram: unsupported storage order");
+            succeeded = Succeeded::no;
+          }
+        // flush the stream, see the class documentation
+        stream.flush();
+      }
+    catch (...)
+      {
+        succeeded = Succeeded::no;
+      }
+  });
   if (succeeded == Succeeded::no)
     error("ProjDataFromStream::set_viewgram: viewgram (view=%d, segment=%d, timing_pos=%d)"
           " corrupted due to problems with writing or the scale factor (out of disk space?)",
@@ -517,40 +637,38 @@ ProjDataFromStream::get_sinogram(const int ax_pos_num,
   Succeeded succeeded = Succeeded::yes;
   Bin bin(segment_num, this->get_min_view_num(), ax_pos_num, this->get_min_tangential_pos_num(), timing_pos);
 
-#ifdef STIR_OPENMP
-#  pragma omp critical(PROJDATAFROMSTREAMIO)
-#endif
-  try
-    {
-      if (get_storage_order() == Segment_AxialPos_View_TangPos || get_storage_order() == Timing_Segment_AxialPos_View_TangPos)
-        {
-          detail::checked_seekg("get_sinogram", *sino_stream, get_offset(bin));
-          succeeded = read_data(*sino_stream, sinogram, on_disk_data_type, scale, on_disk_byte_order);
-        }
-      else if (get_storage_order() == Segment_View_AxialPos_TangPos
-               || get_storage_order() == Timing_Segment_View_AxialPos_TangPos)
-        {
-          for (bin.view_num() = get_min_view_num(); bin.view_num() <= get_max_view_num(); bin.view_num()++)
-            {
-              detail::checked_seekg("get_sinogram", *sino_stream, get_offset(bin));
-              if ((succeeded = read_data(*sino_stream, sinogram[bin.view_num()], on_disk_data_type, scale, on_disk_byte_order))
-                  == Succeeded::no)
-                break;
-              if (scale != 1)
-                break;
-            }
-        }
-      else
-        {
-          warning("ProjDataFromStream::get_sinogram: unsupported storage order");
-          succeeded = Succeeded::no;
-        }
-    }
-  catch (...)
-    {
-      succeeded = Succeeded::no;
-    }
-  // end of critical section
+  this->do_io([&](std::iostream& stream) {
+    try
+      {
+        if (get_storage_order() == Segment_AxialPos_View_TangPos || get_storage_order() == Timing_Segment_AxialPos_View_TangPos)
+          {
+            detail::checked_seekg("get_sinogram", stream, get_offset(bin));
+            succeeded = read_data(stream, sinogram, on_disk_data_type, scale, on_disk_byte_order);
+          }
+        else if (get_storage_order() == Segment_View_AxialPos_TangPos
+                 || get_storage_order() == Timing_Segment_View_AxialPos_TangPos)
+          {
+            for (bin.view_num() = get_min_view_num(); bin.view_num() <= get_max_view_num(); bin.view_num()++)
+              {
+                detail::checked_seekg("get_sinogram", stream, get_offset(bin));
+                if ((succeeded = read_data(stream, sinogram[bin.view_num()], on_disk_data_type, scale, on_disk_byte_order))
+                    == Succeeded::no)
+                  break;
+                if (scale != 1)
+                  break;
+              }
+          }
+        else
+          {
+            warning("ProjDataFromStream::get_sinogram: unsupported storage order");
+            succeeded = Succeeded::no;
+          }
+      }
+    catch (...)
+      {
+        succeeded = Succeeded::no;
+      }
+  });
   if (scale != 1)
     error("ProjDataFromStream: error reading data: scale factor returned by read_data should be 1");
   if (succeeded == Succeeded::no)
@@ -606,54 +724,52 @@ ProjDataFromStream::set_sinogram(const Sinogram<float>& s)
   float scale = scale_factor;
 
   Succeeded succeeded = Succeeded::yes;
-#ifdef STIR_OPENMP
-#  pragma omp critical(PROJDATAFROMSTREAMIO)
-#endif
-  try
-    {
-      if (get_storage_order() == Segment_AxialPos_View_TangPos || get_storage_order() == Timing_Segment_AxialPos_View_TangPos)
-        {
-          detail::checked_seekp("set_sinogram", *sino_stream, get_offset(bin));
-          if (write_data(*sino_stream, s, on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no || scale != scale_factor)
-            {
-              warning("ProjDataFromStream::set_sinogram: sinogram (ax_pos=%d, segment=%d)"
-                      " corrupted due to problems with writing or the scale factor \n",
-                      ax_pos_num,
-                      segment_num);
-              succeeded = Succeeded::no;
-            }
-        }
-      else if (get_storage_order() == Segment_View_AxialPos_TangPos
-               || get_storage_order() == Timing_Segment_View_AxialPos_TangPos)
-        {
-          for (bin.view_num() = get_min_view_num(); bin.view_num() <= get_max_view_num(); bin.view_num()++)
-            {
-              detail::checked_seekp("set_sinogram", *sino_stream, get_offset(bin));
-              if (write_data(*sino_stream, s[bin.view_num()], on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no
-                  || scale != scale_factor)
-                {
-                  warning("ProjDataFromStream::set_sinogram: sinogram (ax_pos=%d, segment=%d)"
-                          " corrupted due to problems with writing or the scale factor \n",
-                          ax_pos_num,
-                          segment_num);
-                  succeeded = Succeeded::no;
-                  break;
-                }
-            }
-        }
-      else
-        {
-          warning("ProjDataFromStream::set_sinogram: unsupported storage order");
-          succeeded = Succeeded::no;
-        }
-      // flush the stream, see the class documentation
-      sino_stream->flush();
-    }
-  catch (...)
-    {
-      succeeded = Succeeded::no;
-    }
-  // end of critical section
+  this->do_io([&](std::iostream& stream) {
+    try
+      {
+        if (get_storage_order() == Segment_AxialPos_View_TangPos || get_storage_order() == Timing_Segment_AxialPos_View_TangPos)
+          {
+            detail::checked_seekp("set_sinogram", stream, get_offset(bin));
+            if (write_data(stream, s, on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no || scale != scale_factor)
+              {
+                warning("ProjDataFromStream::set_sinogram: sinogram (ax_pos=%d, segment=%d)"
+                        " corrupted due to problems with writing or the scale factor \n",
+                        ax_pos_num,
+                        segment_num);
+                succeeded = Succeeded::no;
+              }
+          }
+        else if (get_storage_order() == Segment_View_AxialPos_TangPos
+                 || get_storage_order() == Timing_Segment_View_AxialPos_TangPos)
+          {
+            for (bin.view_num() = get_min_view_num(); bin.view_num() <= get_max_view_num(); bin.view_num()++)
+              {
+                detail::checked_seekp("set_sinogram", stream, get_offset(bin));
+                if (write_data(stream, s[bin.view_num()], on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no
+                    || scale != scale_factor)
+                  {
+                    warning("ProjDataFromStream::set_sinogram: sinogram (ax_pos=%d, segment=%d)"
+                            " corrupted due to problems with writing or the scale factor \n",
+                            ax_pos_num,
+                            segment_num);
+                    succeeded = Succeeded::no;
+                    break;
+                  }
+              }
+          }
+        else
+          {
+            warning("ProjDataFromStream::set_sinogram: unsupported storage order");
+            succeeded = Succeeded::no;
+          }
+        // flush the stream, see the class documentation
+        stream.flush();
+      }
+    catch (...)
+      {
+        succeeded = Succeeded::no;
+      }
+  });
   return succeeded;
 }
 
@@ -679,19 +795,17 @@ ProjDataFromStream::get_segment_by_sinogram(const int segment_num, const int tim
                     this->get_min_axial_pos_num(segment_num),
                     this->get_min_tangential_pos_num(),
                     timing_num);
-#ifdef STIR_OPENMP
-#  pragma omp critical(PROJDATAFROMSTREAMIO)
-#endif
-      try
-        {
-          detail::checked_seekg("get_segment_by_sinogram", *sino_stream, get_offset(bin));
-          succeeded = read_data(*sino_stream, segment, on_disk_data_type, scale, on_disk_byte_order);
-        }
-      catch (...)
-        {
-          succeeded = Succeeded::no;
-        }
-      // end of critical section
+      this->do_io([&](std::iostream& stream) {
+        try
+          {
+            detail::checked_seekg("get_segment_by_sinogram", stream, get_offset(bin));
+            succeeded = read_data(stream, segment, on_disk_data_type, scale, on_disk_byte_order);
+          }
+        catch (...)
+          {
+            succeeded = Succeeded::no;
+          }
+      });
       if (succeeded == Succeeded::no)
         error("ProjDataFromStream: error reading data\n");
       if (scale != 1)
@@ -729,19 +843,17 @@ ProjDataFromStream::get_segment_by_view(const int segment_num, const int timing_
                     this->get_min_axial_pos_num(segment_num),
                     this->get_min_tangential_pos_num(),
                     timing_pos);
-#ifdef STIR_OPENMP
-#  pragma omp critical(PROJDATAFROMSTREAMIO)
-#endif
-      try
-        {
-          detail::checked_seekg("get_segment_by_view", *sino_stream, get_offset(bin));
-          succeeded = read_data(*sino_stream, segment, on_disk_data_type, scale, on_disk_byte_order);
-        }
-      catch (...)
-        {
-          succeeded = Succeeded::no;
-        }
-      // end of critical section
+      this->do_io([&](std::iostream& stream) {
+        try
+          {
+            detail::checked_seekg("get_segment_by_view", stream, get_offset(bin));
+            succeeded = read_data(stream, segment, on_disk_data_type, scale, on_disk_byte_order);
+          }
+        catch (...)
+          {
+            succeeded = Succeeded::no;
+          }
+      });
       if (succeeded == Succeeded::no)
         error("ProjDataFromStream: error reading data");
       if (scale != 1)
@@ -796,29 +908,27 @@ ProjDataFromStream::set_segment(const SegmentBySinogram<float>& segmentbysinogra
         }
       float scale = scale_factor;
       Succeeded succeeded = Succeeded::yes;
-#ifdef STIR_OPENMP
-#  pragma omp critical(PROJDATAFROMSTREAMIO)
-#endif
-      try
-        {
-          detail::checked_seekp("set_segment", *sino_stream, get_offset(bin));
-          if (write_data(*sino_stream, segmentbysinogram_v, on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no
-              || scale != scale_factor)
-            {
-              warning("ProjDataFromStream::set_segment: segment (%d) tof bin (%d)"
-                      " corrupted due to problems with writing or the scale factor \n",
-                      segment_num,
-                      segmentbysinogram_v.get_timing_pos_num());
-              succeeded = Succeeded::no;
-            }
-          // flush the stream, see the class documentation
-          sino_stream->flush();
-        }
-      catch (...)
-        {
-          succeeded = Succeeded::no;
-        }
-      // end of critical section
+      this->do_io([&](std::iostream& stream) {
+        try
+          {
+            detail::checked_seekp("set_segment", stream, get_offset(bin));
+            if (write_data(stream, segmentbysinogram_v, on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no
+                || scale != scale_factor)
+              {
+                warning("ProjDataFromStream::set_segment: segment (%d) tof bin (%d)"
+                        " corrupted due to problems with writing or the scale factor \n",
+                        segment_num,
+                        segmentbysinogram_v.get_timing_pos_num());
+                succeeded = Succeeded::no;
+              }
+            // flush the stream, see the class documentation
+            stream.flush();
+          }
+        catch (...)
+          {
+            succeeded = Succeeded::no;
+          }
+      });
       return succeeded;
     }
   else
@@ -871,29 +981,27 @@ ProjDataFromStream::set_segment(const SegmentByView<float>& segmentbyview_v)
         }
       float scale = scale_factor;
       Succeeded succeeded = Succeeded::yes;
-#ifdef STIR_OPENMP
-#  pragma omp critical(PROJDATAFROMSTREAMIO)
-#endif
-      try
-        {
-          detail::checked_seekp("set_segment", *sino_stream, get_offset(bin));
-          if (write_data(*sino_stream, segmentbyview_v, on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no
-              || scale != scale_factor)
-            {
-              warning("ProjDataFromStream::set_segment: segment (%d) tof bin (%d)"
-                      " corrupted due to problems with writing or the scale factor \n",
-                      segment_num,
-                      segmentbyview_v.get_timing_pos_num());
-              succeeded = Succeeded::no;
-            }
-          // flush the stream, see the class documentation
-          sino_stream->flush();
-        }
-      catch (...)
-        {
-          succeeded = Succeeded::no;
-        }
-      // end of critical section
+      this->do_io([&](std::iostream& stream) {
+        try
+          {
+            detail::checked_seekp("set_segment", stream, get_offset(bin));
+            if (write_data(stream, segmentbyview_v, on_disk_data_type, scale, on_disk_byte_order) == Succeeded::no
+                || scale != scale_factor)
+              {
+                warning("ProjDataFromStream::set_segment: segment (%d) tof bin (%d)"
+                        " corrupted due to problems with writing or the scale factor \n",
+                        segment_num,
+                        segmentbyview_v.get_timing_pos_num());
+                succeeded = Succeeded::no;
+              }
+            // flush the stream, see the class documentation
+            stream.flush();
+          }
+        catch (...)
+          {
+            succeeded = Succeeded::no;
+          }
+      });
       return succeeded;
     }
   else
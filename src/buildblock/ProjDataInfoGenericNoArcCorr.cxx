@@ -2,7 +2,7 @@
     Copyright (C) 2000- 2007-10-08, Hammersmith Imanet Ltd
     Copyright (C) 2011-07-01 - 2011, Kris Thielemans
     Copyright (C) 2017 ETH Zurich, Institute of Particle Physics and Astrophysics
-    Copyright (C) 2018, University College London
+    Copyright (C) 2018, 2026, University College London
     Copyright (C) 2018, University of Leeds
     This file is part of STIR.
 
@@ -29,7 +29,11 @@
 #include "stir/round.h"
 #include "stir/DetectionPosition.h"
 #include "stir/is_null_ptr.h"
+#include "stir/info.h"
 #include "stir/error.h"
+#include <boost/format.hpp>
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 
@@ -41,7 +45,60 @@ using std::endl;
 using std::ends;
 
 START_NAMESPACE_STIR
+
+//! Coordinates of all detectors, and end-points of all LORs (see ProjDataInfoGenericNoArcCorr::set_max_LOR_table_size())
+/*! Coordinates are as returned by ProjDataInfoGenericNoArcCorr::find_cartesian_coordinates_given_scanner_coordinates().
+
+  The LORs are stored for all ring pairs up to the maximum ring difference, and for all views and tangential positions
+  in the projection data when the table was built. The table does therefore not depend on the segments and axial
+  positions, such that it can still be used when these are changed (e.g. by reduce_segment_range()).
+*/
+struct ProjDataInfoGenericNoArcCorr::LORTable
+{
+  int num_rings;
+  int num_detectors_per_ring;
+  //! coordinates of the detectors, index is <tt>ring_num*num_detectors_per_ring + det_num</tt>
+  std::vector<float> det_x, det_y, det_z;
+
+  //! \name ranges of the LORs in the table
+  //@{
+  int max_abs_ring_diff;
+  int num_views;
+  int min_tangential_pos_num;
+  int max_tangential_pos_num;
+  //@}
+  //! end-points of the LORs (empty if the table would be too large), see get_LOR_index()
+  std::vector<float> x1, y1, z1, x2, y2, z2;
+
+  std::size_t get_num_LORs() const
+  {
+    return static_cast<std::size_t>(num_rings) * (2 * max_abs_ring_diff + 1) * num_views
+           * (max_tangential_pos_num - min_tangential_pos_num + 1);
+  }
+
+  std::size_t get_size_in_bytes() const { return (det_x.size() * 3 + x1.size() * 6) * sizeof(float); }
+
+  std::size_t get_det_index(const int ring_num, const int det_num) const
+  {
+    return static_cast<std::size_t>(ring_num) * num_detectors_per_ring + det_num;
+  }
+
+  //! index of the LOR in the end-point arrays, or -1 if it is not in the table
+  std::ptrdiff_t get_LOR_index(const int ring1, const int ring2, const int view_num, const int tang_pos_num) const
+  {
+    if (x1.empty() || std::abs(ring2 - ring1) > max_abs_ring_diff || tang_pos_num < min_tangential_pos_num
+        || tang_pos_num > max_tangential_pos_num)
+      return -1;
+    return ((static_cast<std::ptrdiff_t>(ring1) * (2 * max_abs_ring_diff + 1) + ring2 - ring1 + max_abs_ring_diff) * num_views
+            + view_num)
+               * (max_tangential_pos_num - min_tangential_pos_num + 1)
+           + tang_pos_num - min_tangential_pos_num;
+  }
+};
+
 ProjDataInfoGenericNoArcCorr::ProjDataInfoGenericNoArcCorr()
+    : LOR_table_initialised(false),
+      max_LOR_table_size(std::size_t(1024) * 1024 * 1024)
 {}
 
 ProjDataInfoGenericNoArcCorr::ProjDataInfoGenericNoArcCorr(const shared_ptr<Scanner> scanner_sptr,
@@ -51,7 +108,9 @@ ProjDataInfoGenericNoArcCorr::ProjDataInfoGenericNoArcCorr(const shared_ptr<Scan
                                                            const int num_views,
                                                            const int num_tangential_poss)
     : ProjDataInfoGeneric(
-        scanner_sptr, num_axial_pos_per_segment, min_ring_diff_v, max_ring_diff_v, num_views, num_tangential_poss)
+        scanner_sptr, num_axial_pos_per_segment, min_ring_diff_v, max_ring_diff_v, num_views, num_tangential_poss),
+      LOR_table_initialised(false),
+      max_LOR_table_size(std::size_t(1024) * 1024 * 1024)
 {
   if (!scanner_sptr)
     error("ProjDataInfoGenericNoArcCorr: first argument (scanner_ptr) is zero");
@@ -283,6 +342,126 @@ ProjDataInfoGenericNoArcCorr::initialise_det1det2_to_uncompressed_view_tangpos()
   det1det2_to_uncompressed_view_tangpos_initialised = true;
 }
 
+void
+ProjDataInfoGenericNoArcCorr::set_max_LOR_table_size(const std::size_t size_in_bytes)
+{
+  max_LOR_table_size = size_in_bytes;
+  // rebuild the table when necessary
+  LOR_table_sptr.reset();
+  LOR_table_initialised = false;
+}
+
+std::size_t
+ProjDataInfoGenericNoArcCorr::get_max_LOR_table_size() const
+{
+  return max_LOR_table_size;
+}
+
+std::size_t
+ProjDataInfoGenericNoArcCorr::get_LOR_table_size_in_bytes() const
+{
+  return is_null_ptr(LOR_table_sptr) ? 0 : LOR_table_sptr->get_size_in_bytes();
+}
+
+void
+ProjDataInfoGenericNoArcCorr::initialise_LOR_table() const
+{
+  const Scanner& scanner = *get_scanner_ptr();
+  if (scanner.get_detector_map_sptr()->get_sigma() != 0)
+    {
+      // coordinates are different every time, so we cannot store them
+      LOR_table_sptr.reset();
+    }
+  else
+    {
+      this->initialise_uncompressed_view_tangpos_to_det1det2_if_not_done_yet();
+
+      shared_ptr<LORTable> table_sptr(new LORTable);
+      LORTable& table = *table_sptr;
+      table.num_rings = scanner.get_num_rings();
+      table.num_detectors_per_ring = scanner.get_num_detectors_per_ring();
+      const std::size_t num_detectors = static_cast<std::size_t>(table.num_rings) * table.num_detectors_per_ring;
+      table.det_x.resize(num_detectors);
+      table.det_y.resize(num_detectors);
+      table.det_z.resize(num_detectors);
+      for (int ring_num = 0; ring_num < table.num_rings; ++ring_num)
+        for (int det_num = 0; det_num < table.num_detectors_per_ring; ++det_num)
+          {
+            const CartesianCoordinate3D<float> coord
+                = scanner.get_coordinate_for_det_pos(DetectionPosition<>(det_num, ring_num, 0));
+            const std::size_t det_index = table.get_det_index(ring_num, det_num);
+            table.det_x[det_index] = coord.x();
+            table.det_y[det_index] = coord.y();
+            table.det_z[det_index] = coord.z() - z_shift.z();
+          }
+
+      table.max_abs_ring_diff = 0;
+      for (int segment_num = get_min_segment_num(); segment_num <= get_max_segment_num(); ++segment_num)
+        table.max_abs_ring_diff = std::max(
+            table.max_abs_ring_diff,
+            std::max(std::abs(get_min_ring_difference(segment_num)), std::abs(get_max_ring_difference(segment_num))));
+      table.max_abs_ring_diff = std::min(table.max_abs_ring_diff, table.num_rings - 1);
+      table.num_views = get_num_views();
+      table.min_tangential_pos_num = get_min_tangential_pos_num();
+      table.max_tangential_pos_num = get_max_tangential_pos_num();
+
+      const std::size_t num_LORs = table.get_num_LORs();
+      const std::size_t LORs_size_in_bytes = num_LORs * 6 * sizeof(float);
+      if (get_min_view_num() != 0 || LORs_size_in_bytes > max_LOR_table_size)
+        {
+          info(boost::format("ProjDataInfoGenericNoArcCorr: not storing end-points of LORs as this would need %1% MB "
+                             "(maximum is %2% MB)")
+                   % (LORs_size_in_bytes / (1024 * 1024)) % (max_LOR_table_size / (1024 * 1024)),
+               2);
+        }
+      else
+        {
+          table.x1.resize(num_LORs);
+          table.y1.resize(num_LORs);
+          table.z1.resize(num_LORs);
+          table.x2.resize(num_LORs);
+          table.y2.resize(num_LORs);
+          table.z2.resize(num_LORs);
+          const int num_ring_diffs = 2 * table.max_abs_ring_diff + 1;
+#ifdef STIR_OPENMP
+#  pragma omp parallel for collapse(2) schedule(dynamic)
+#endif
+          for (int ring1 = 0; ring1 < table.num_rings; ++ring1)
+            for (int ring_diff_index = 0; ring_diff_index < num_ring_diffs; ++ring_diff_index)
+              {
+                const int ring2 = ring1 + ring_diff_index - table.max_abs_ring_diff;
+                if (ring2 < 0 || ring2 >= table.num_rings)
+                  continue; // leave at 0, will never be used
+                for (int view_num = 0; view_num < table.num_views; ++view_num)
+                  for (int tang_pos_num = table.min_tangential_pos_num; tang_pos_num <= table.max_tangential_pos_num;
+                       ++tang_pos_num)
+                    {
+                      int det1_num, det2_num;
+                      get_det_num_pair_for_view_tangential_pos_num(det1_num, det2_num, view_num, tang_pos_num);
+                      const std::size_t det1_index = table.get_det_index(ring1, det1_num);
+                      const std::size_t det2_index = table.get_det_index(ring2, det2_num);
+                      const std::size_t index = table.get_LOR_index(ring1, ring2, view_num, tang_pos_num);
+                      table.x1[index] = table.det_x[det1_index];
+                      table.y1[index] = table.det_y[det1_index];
+                      table.z1[index] = table.det_z[det1_index];
+                      table.x2[index] = table.det_x[det2_index];
+                      table.y2[index] = table.det_y[det2_index];
+                      table.z2[index] = table.det_z[det2_index];
+                    }
+              }
+        }
+      info(boost::format("ProjDataInfoGenericNoArcCorr: LOR tables use %1% MB") % (table.get_size_in_bytes() / (1024 * 1024)),
+           2);
+      LOR_table_sptr = table_sptr;
+    }
+    // thanks to yohjp:
+    // http://stackoverflow.com/questions/27975737/how-to-handle-cached-data-structures-with-multi-threading-e-g-openmp
+#if defined(STIR_OPENMP) && _OPENMP >= 201012
+#  pragma omp atomic write
+#endif
+  LOR_table_initialised = true;
+}
+
 unsigned int
 ProjDataInfoGenericNoArcCorr::get_num_det_pos_pairs_for_bin(const Bin& bin) const
 {
@@ -332,7 +511,22 @@ ProjDataInfoGenericNoArcCorr::find_cartesian_coordinates_of_detection(CartesianC
   int det_num_b;
   int ring_a;
   int ring_b;
-  get_det_pair_for_bin(det_num_a, ring_a, det_num_b, ring_b, bin);
+  get_ring_pair_for_segment_axial_pos_num(ring_a, ring_b, bin.segment_num(), bin.axial_pos_num());
+
+  this->initialise_LOR_table_if_not_done_yet();
+  if (!is_null_ptr(LOR_table_sptr))
+    {
+      const LORTable& table = *LOR_table_sptr;
+      const std::ptrdiff_t index = table.get_LOR_index(ring_a, ring_b, bin.view_num(), bin.tangential_pos_num());
+      if (index >= 0)
+        {
+          coord_1 = CartesianCoordinate3D<float>(table.z1[index], table.y1[index], table.x1[index]);
+          coord_2 = CartesianCoordinate3D<float>(table.z2[index], table.y2[index], table.x2[index]);
+          return;
+        }
+    }
+
+  get_det_num_pair_for_view_tangential_pos_num(det_num_a, det_num_b, bin.view_num(), bin.tangential_pos_num());
 
   // find corresponding cartesian coordinates
   find_cartesian_coordinates_given_scanner_coordinates(coord_1, coord_2, ring_a, ring_b, det_num_a, det_num_b);
@@ -352,6 +546,17 @@ ProjDataInfoGenericNoArcCorr::find_cartesian_coordinates_given_scanner_coordinat
   assert(0 <= det2);
   assert(det2 < get_scanner_ptr()->get_num_detectors_per_ring());
 
+  this->initialise_LOR_table_if_not_done_yet();
+  if (!is_null_ptr(LOR_table_sptr))
+    {
+      const LORTable& table = *LOR_table_sptr;
+      const std::size_t det1_index = table.get_det_index(Ring_A, det1);
+      const std::size_t det2_index = table.get_det_index(Ring_B, det2);
+      coord_1 = CartesianCoordinate3D<float>(table.det_z[det1_index], table.det_y[det1_index], table.det_x[det1_index]);
+      coord_2 = CartesianCoordinate3D<float>(table.det_z[det2_index], table.det_y[det2_index], table.det_x[det2_index]);
+      return;
+    }
+
   DetectionPosition<> det_pos1;
   DetectionPosition<> det_pos2;
   det_pos1.tangential_coord() = det1;
@@ -67,6 +67,7 @@ ProjDataInterfile ::create_stream(const string& filename, const ios::openmode op
     {
       error("ProjDataInterfile: error opening output file %s\n", data_name.c_str());
     }
+  this->set_filename_for_concurrent_access(data_name, open_mode);
 #if 0
   delete[] header_name;
   delete[] data_name;
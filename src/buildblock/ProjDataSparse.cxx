@@ -0,0 +1,313 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projdata
+  \brief Implementation of class stir::ProjDataSparse
+*/
+
+#include "stir/ProjDataSparse.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/Viewgram.h"
+#include "stir/Sinogram.h"
+#include "stir/IndexRange2D.h"
+#include "stir/Succeeded.h"
+#include "stir/warning.h"
+#include "stir/error.h"
+#include <algorithm>
+#include <limits>
+
+START_NAMESPACE_STIR
+
+ProjDataSparse::ProjDataSparse(shared_ptr<const ExamInfo> const& exam_info_sptr,
+                               shared_ptr<const ProjDataInfo> const& proj_data_info_sptr)
+    : ProjData(exam_info_sptr, proj_data_info_sptr)
+{
+  this->blocks.resize(static_cast<std::size_t>(this->get_num_tof_poss()) * this->get_num_segments() * this->get_num_views());
+  for (int segment_num = this->get_min_segment_num(); segment_num <= this->get_max_segment_num(); ++segment_num)
+    if (static_cast<double>(this->get_num_axial_poss(segment_num)) * this->get_num_tangential_poss()
+        > std::numeric_limits<std::uint32_t>::max())
+      error("ProjDataSparse: viewgrams are too large");
+}
+
+ProjDataSparse::ProjDataSparse(const ProjData& proj_data)
+    : ProjDataSparse(proj_data.get_exam_info_sptr(), proj_data.get_proj_data_info_sptr()->create_shared_clone())
+{
+  for (int timing_pos_num = this->get_min_tof_pos_num(); timing_pos_num <= this->get_max_tof_pos_num(); ++timing_pos_num)
+    for (int segment_num = this->get_min_segment_num(); segment_num <= this->get_max_segment_num(); ++segment_num)
+      for (int view_num = this->get_min_view_num(); view_num <= this->get_max_view_num(); ++view_num)
+        {
+          Viewgram<float> viewgram = proj_data.get_viewgram(view_num, segment_num, false, timing_pos_num);
+          // make sure that the ProjDataInfo is the same object, such that set_viewgram() does not need to compare them
+          Viewgram<float> copy = this->get_empty_viewgram(view_num, segment_num, false, timing_pos_num);
+          std::copy(viewgram.begin_all_const(), viewgram.end_all_const(), copy.begin_all());
+          if (this->set_viewgram(copy) != Succeeded::yes)
+            error("ProjDataSparse: error copying data");
+        }
+}
+
+void
+ProjDataSparse::check_range(const int view_num, const int segment_num, const int timing_pos_num) const
+{
+  if (segment_num < this->get_min_segment_num() || segment_num > this->get_max_segment_num())
+    error("ProjDataSparse: segment_num out of range : %d", segment_num);
+  if (view_num < this->get_min_view_num() || view_num > this->get_max_view_num())
+    error("ProjDataSparse: view_num out of range : %d", view_num);
+  if (timing_pos_num < this->get_min_tof_pos_num() || timing_pos_num > this->get_max_tof_pos_num())
+    error("ProjDataSparse: timing_pos_num out of range : %d", timing_pos_num);
+}
+
+std::size_t
+ProjDataSparse::get_block_index(const int view_num, const int segment_num, const int timing_pos_num) const
+{
+  return (static_cast<std::size_t>(timing_pos_num - this->get_min_tof_pos_num()) * this->get_num_segments()
+          + static_cast<std::size_t>(segment_num - this->get_min_segment_num()))
+             * this->get_num_views()
+         + static_cast<std::size_t>(view_num - this->get_min_view_num());
+}
+
+Viewgram<float>
+ProjDataSparse::get_viewgram(const int view_num,
+                             const int segment_num,
+                             const bool make_num_tangential_poss_odd,
+                             const int timing_pos) const
+{
+  this->check_range(view_num, segment_num, timing_pos);
+  Viewgram<float> viewgram = this->get_empty_viewgram(view_num, segment_num, false, timing_pos);
+  const Block& block = this->blocks[this->get_block_index(view_num, segment_num, timing_pos)];
+  const int num_tangential_poss = this->get_num_tangential_poss();
+  const int min_axial_pos_num = this->get_min_axial_pos_num(segment_num);
+  const int min_tangential_pos_num = this->get_min_tangential_pos_num();
+  for (std::size_t i = 0; i < block.offsets.size(); ++i)
+    {
+      const int offset = static_cast<int>(block.offsets[i]);
+      viewgram[min_axial_pos_num + offset / num_tangential_poss][min_tangential_pos_num + offset % num_tangential_poss]
+          = block.values[i];
+    }
+
+  if (make_num_tangential_poss_odd && (this->get_num_tangential_poss() % 2 == 0))
+    {
+      viewgram.grow(IndexRange2D(this->get_min_axial_pos_num(segment_num),
+                                 this->get_max_axial_pos_num(segment_num),
+                                 this->get_min_tangential_pos_num(),
+                                 this->get_max_tangential_pos_num() + 1));
+    }
+  return viewgram;
+}
+
+Succeeded
+ProjDataSparse::set_viewgram(const Viewgram<float>& v)
+{
+  if (*this->get_proj_data_info_sptr() != *(v.get_proj_data_info_sptr()))
+    {
+      warning("ProjDataSparse::set_viewgram: viewgram has incompatible ProjDataInfo member\n"
+              "Original ProjDataInfo: %s\n"
+              "ProjDataInfo From viewgram: %s",
+              this->get_proj_data_info_sptr()->parameter_info().c_str(),
+              v.get_proj_data_info_sptr()->parameter_info().c_str());
+      return Succeeded::no;
+    }
+  const int segment_num = v.get_segment_num();
+  this->check_range(v.get_view_num(), segment_num, v.get_timing_pos_num());
+  Block& block = this->blocks[this->get_block_index(v.get_view_num(), segment_num, v.get_timing_pos_num())];
+  block.offsets.clear();
+  block.values.clear();
+  std::uint32_t offset = 0;
+  for (int ax_pos_num = this->get_min_axial_pos_num(segment_num); ax_pos_num <= this->get_max_axial_pos_num(segment_num);
+       ++ax_pos_num)
+    for (int tang_pos_num = this->get_min_tangential_pos_num(); tang_pos_num <= this->get_max_tangential_pos_num();
+         ++tang_pos_num, ++offset)
+      {
+        const float value = v[ax_pos_num][tang_pos_num];
+        if (value != 0)
+          {
+            block.offsets.push_back(offset);
+            block.values.push_back(value);
+          }
+      }
+  block.offsets.shrink_to_fit();
+  block.values.shrink_to_fit();
+  return Succeeded::yes;
+}
+
+Sinogram<float>
+ProjDataSparse::get_sinogram(const int ax_pos_num,
+                             const int segment_num,
+                             const bool make_num_tangential_poss_odd,
+                             const int timing_pos) const
+{
+  this->check_range(this->get_min_view_num(), segment_num, timing_pos);
+  Sinogram<float> sinogram = this->get_empty_sinogram(ax_pos_num, segment_num, false, timing_pos);
+  const int num_tangential_poss = this->get_num_tangential_poss();
+  const int min_tangential_pos_num = this->get_min_tangential_pos_num();
+  // range of offsets for this axial position
+  const std::uint32_t start_offset
+      = static_cast<std::uint32_t>((ax_pos_num - this->get_min_axial_pos_num(segment_num)) * num_tangential_poss);
+  const std::uint32_t end_offset = start_offset + static_cast<std::uint32_t>(num_tangential_poss);
+  for (int view_num = this->get_min_view_num(); view_num <= this->get_max_view_num(); ++view_num)
+    {
+      const Block& block = this->blocks[this->get_block_index(view_num, segment_num, timing_pos)];
+      const auto start = std::lower_bound(block.offsets.begin(), block.offsets.end(), start_offset);
+      for (auto iter = start; iter != block.offsets.end() && *iter < end_offset; ++iter)
+        sinogram[view_num][min_tangential_pos_num + static_cast<int>(*iter - start_offset)]
+            = block.values[iter - block.offsets.begin()];
+    }
+
+  if (make_num_tangential_poss_odd && (this->get_num_tangential_poss() % 2 == 0))
+    {
+      sinogram.grow(IndexRange2D(this->get_min_view_num(),
+                                 this->get_max_view_num(),
+                                 this->get_min_tangential_pos_num(),
+                                 this->get_max_tangential_pos_num() + 1));
+    }
+  return sinogram;
+}
+
+Succeeded
+ProjDataSparse::set_sinogram(const Sinogram<float>& s)
+{
+  if (*this->get_proj_data_info_sptr() != *(s.get_proj_data_info_sptr()))
+    {
+      warning("ProjDataSparse::set_sinogram: Sinogram<float> has incompatible ProjDataInfo member.\n"
+              "Original ProjDataInfo: %s\n"
+              "ProjDataInfo from sinogram: %s",
+              this->get_proj_data_info_sptr()->parameter_info().c_str(),
+              s.get_proj_data_info_sptr()->parameter_info().c_str());
+      return Succeeded::no;
+    }
+  const int segment_num = s.get_segment_num();
+  const int timing_pos = s.get_timing_pos_num();
+  this->check_range(this->get_min_view_num(), segment_num, timing_pos);
+  const int num_tangential_poss = this->get_num_tangential_poss();
+  const std::uint32_t start_offset
+      = static_cast<std::uint32_t>((s.get_axial_pos_num() - this->get_min_axial_pos_num(segment_num)) * num_tangential_poss);
+  const std::uint32_t end_offset = start_offset + static_cast<std::uint32_t>(num_tangential_poss);
+
+  std::vector<std::uint32_t> new_offsets;
+  std::vector<float> new_values;
+  for (int view_num = this->get_min_view_num(); view_num <= this->get_max_view_num(); ++view_num)
+    {
+      new_offsets.clear();
+      new_values.clear();
+      std::uint32_t offset = start_offset;
+      for (int tang_pos_num = this->get_min_tangential_pos_num(); tang_pos_num <= this->get_max_tangential_pos_num();
+           ++tang_pos_num, ++offset)
+        {
+          const float value = s[view_num][tang_pos_num];
+          if (value != 0)
+            {
+              new_offsets.push_back(offset);
+              new_values.push_back(value);
+            }
+        }
+
+      // replace the bins for this axial position
+      Block& block = this->blocks[this->get_block_index(view_num, segment_num, timing_pos)];
+      const auto start = std::lower_bound(block.offsets.begin(), block.offsets.end(), start_offset);
+      const auto end = std::lower_bound(start, block.offsets.end(), end_offset);
+      const auto start_index = start - block.offsets.begin();
+      const auto end_index = end - block.offsets.begin();
+      block.offsets.erase(start, end);
+      block.values.erase(block.values.begin() + start_index, block.values.begin() + end_index);
+      block.offsets.insert(block.offsets.begin() + start_index, new_offsets.begin(), new_offsets.end());
+      block.values.insert(block.values.begin() + start_index, new_values.begin(), new_values.end());
+    }
+  return Succeeded::yes;
+}
+
+void
+ProjDataSparse::fill(const float value)
+{
+  if (value == 0)
+    {
+      for (auto& block : this->blocks)
+        {
+          std::vector<std::uint32_t>().swap(block.offsets);
+          std::vector<float>().swap(block.values);
+        }
+    }
+  else
+    ProjData::fill(value);
+}
+
+float
+ProjDataSparse::get_bin_value(const Bin& bin) const
+{
+  this->check_range(bin.view_num(), bin.segment_num(), bin.timing_pos_num());
+  const Block& block = this->blocks[this->get_block_index(bin.view_num(), bin.segment_num(), bin.timing_pos_num())];
+  const std::uint32_t offset
+      = static_cast<std::uint32_t>((bin.axial_pos_num() - this->get_min_axial_pos_num(bin.segment_num()))
+                                       * this->get_num_tangential_poss()
+                                   + bin.tangential_pos_num() - this->get_min_tangential_pos_num());
+  const auto iter = std::lower_bound(block.offsets.begin(), block.offsets.end(), offset);
+  if (iter == block.offsets.end() || *iter != offset)
+    return 0.F;
+  return block.values[iter - block.offsets.begin()];
+}
+
+std::size_t
+ProjDataSparse::get_num_non_zeros() const
+{
+  std::size_t num_non_zeros = 0;
+  for (const auto& block : this->blocks)
+    num_non_zeros += block.offsets.size();
+  return num_non_zeros;
+}
+
+bool
+ProjDataSparse::is_full() const
+{
+  std::size_t num_bins = 0;
+  for (int segment_num = this->get_min_segment_num(); segment_num <= this->get_max_segment_num(); ++segment_num)
+    num_bins += static_cast<std::size_t>(this->get_num_axial_poss(segment_num)) * this->get_num_views()
+                * this->get_num_tangential_poss();
+  return this->get_num_non_zeros() == num_bins * this->get_num_tof_poss();
+}
+
+float
+ProjDataSparse::sum() const
+{
+  double sum = 0.;
+  for (const auto& block : this->blocks)
+    for (const float value : block.values)
+      sum += value;
+  return static_cast<float>(sum);
+}
+
+float
+ProjDataSparse::find_max() const
+{
+  float max_value = this->is_full() ? -std::numeric_limits<float>::max() : 0.F;
+  for (const auto& block : this->blocks)
+    if (!block.values.empty())
+      max_value = std::max(max_value, *std::max_element(block.values.begin(), block.values.end()));
+  return max_value;
+}
+
+float
+ProjDataSparse::find_min() const
+{
+  float min_value = this->is_full() ? std::numeric_limits<float>::max() : 0.F;
+  for (const auto& block : this->blocks)
+    if (!block.values.empty())
+      min_value = std::min(min_value, *std::min_element(block.values.begin(), block.values.end()));
+  return min_value;
+}
+
+double
+ProjDataSparse::norm_squared() const
+{
+  double norm_squared = 0.;
+  for (const auto& block : this->blocks)
+    for (const float value : block.values)
+      norm_squared += static_cast<double>(value) * value;
+  return norm_squared;
+}
+
+END_NAMESPACE_STIR
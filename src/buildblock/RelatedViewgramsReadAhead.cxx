@@ -0,0 +1,114 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projdata
+  \brief Implementation of class stir::RelatedViewgramsReadAhead
+*/
+
+#include "stir/RelatedViewgramsReadAhead.h"
+#include "stir/ProjData.h"
+#include "stir/DataSymmetriesForViewSegmentNumbers.h"
+#include "stir/error.h"
+#include <algorithm>
+
+START_NAMESPACE_STIR
+
+RelatedViewgramsReadAhead::RelatedViewgramsReadAhead(const shared_ptr<const ProjData>& proj_data_sptr,
+                                                     const shared_ptr<DataSymmetriesForViewSegmentNumbers>& symmetries_sptr,
+                                                     const std::vector<ViewgramIndices>& viewgram_indices_sequence,
+                                                     const std::size_t max_num_in_memory)
+    : proj_data_sptr(proj_data_sptr),
+      symmetries_sptr(symmetries_sptr),
+      viewgram_indices_sequence(viewgram_indices_sequence),
+      max_num_in_memory(std::max(max_num_in_memory, std::size_t(1))),
+      num_read(0),
+      stop(false)
+{
+  for (std::size_t i = 0; i < this->viewgram_indices_sequence.size(); ++i)
+    this->positions[this->viewgram_indices_sequence[i]] = i;
+  this->reader_thread = std::thread(&RelatedViewgramsReadAhead::read_sequence, this);
+}
+
+RelatedViewgramsReadAhead::~RelatedViewgramsReadAhead()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->condition.notify_all();
+  this->reader_thread.join();
+}
+
+void
+RelatedViewgramsReadAhead::read_sequence()
+{
+  for (std::size_t i = 0; i < this->viewgram_indices_sequence.size(); ++i)
+    {
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->condition.wait(lock, [this]() { return this->stop || this->available_viewgrams.size() < this->max_num_in_memory; });
+        if (this->stop)
+          return;
+      }
+      const ViewgramIndices& viewgram_indices = this->viewgram_indices_sequence[i];
+      shared_ptr<RelatedViewgrams<float>> viewgrams_sptr;
+      try
+        {
+          viewgrams_sptr = std::make_shared<RelatedViewgrams<float>>(this->proj_data_sptr->get_related_viewgrams(
+              viewgram_indices, this->symmetries_sptr, false, viewgram_indices.timing_pos_num()));
+        }
+      catch (...)
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->read_exception = std::current_exception();
+          this->num_read = this->viewgram_indices_sequence.size();
+          this->condition.notify_all();
+          return;
+        }
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->available_viewgrams[i] = viewgrams_sptr;
+        this->num_read = i + 1;
+      }
+      this->condition.notify_all();
+    }
+}
+
+RelatedViewgrams<float>
+RelatedViewgramsReadAhead::get_related_viewgrams(const ViewgramIndices& viewgram_indices)
+{
+  const auto position_iter = this->positions.find(viewgram_indices);
+  if (position_iter == this->positions.end())
+    {
+      // not in the sequence, so read it ourselves
+      return this->proj_data_sptr->get_related_viewgrams(
+          viewgram_indices, this->symmetries_sptr, false, viewgram_indices.timing_pos_num());
+    }
+  const std::size_t position = position_iter->second;
+
+  shared_ptr<RelatedViewgrams<float>> viewgrams_sptr;
+  {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->condition.wait(lock, [this, position]() { return this->num_read > position; });
+    if (this->read_exception)
+      std::rethrow_exception(this->read_exception);
+    const auto iter = this->available_viewgrams.find(position);
+    if (iter == this->available_viewgrams.end())
+      error("RelatedViewgramsReadAhead: related viewgrams for view " + std::to_string(viewgram_indices.view_num()) + ", segment "
+            + std::to_string(viewgram_indices.segment_num()) + " requested more than once");
+    viewgrams_sptr = iter->second;
+    this->available_viewgrams.erase(iter);
+  }
+  // there is space for another one now
+  this->condition.notify_all();
+  return *viewgrams_sptr;
+}
+
+END_NAMESPACE_STIR
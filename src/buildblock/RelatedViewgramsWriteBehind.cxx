@@ -0,0 +1,126 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projdata
+  \brief Implementation of class stir::RelatedViewgramsWriteBehind
+*/
+
+#include "stir/RelatedViewgramsWriteBehind.h"
+#include "stir/ProjData.h"
+#include "stir/Succeeded.h"
+#include "stir/error.h"
+#include "stir/warning.h"
+#include <algorithm>
+#include <stdexcept>
+
+START_NAMESPACE_STIR
+
+RelatedViewgramsWriteBehind::RelatedViewgramsWriteBehind(ProjData& proj_data, const std::size_t max_num_in_memory)
+    : proj_data(proj_data),
+      max_num_in_memory(std::max(max_num_in_memory, std::size_t(1))),
+      writing(false),
+      stop(false)
+{
+  this->writer_thread = std::thread(&RelatedViewgramsWriteBehind::write_queue, this);
+}
+
+RelatedViewgramsWriteBehind::~RelatedViewgramsWriteBehind()
+{
+  try
+    {
+      this->flush();
+    }
+  catch (const std::exception& e)
+    {
+      warning(std::string("RelatedViewgramsWriteBehind: writing failed: ") + e.what());
+    }
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->condition.notify_all();
+  this->writer_thread.join();
+}
+
+void
+RelatedViewgramsWriteBehind::check_write_exception()
+{
+  if (!this->write_exception)
+    return;
+  std::exception_ptr e = this->write_exception;
+  this->write_exception = nullptr;
+  try
+    {
+      std::rethrow_exception(e);
+    }
+  catch (const std::exception& ex)
+    {
+      error(std::string("RelatedViewgramsWriteBehind: writing failed: ") + ex.what());
+    }
+}
+
+void
+RelatedViewgramsWriteBehind::write_queue()
+{
+  while (true)
+    {
+      shared_ptr<RelatedViewgrams<float>> viewgrams_sptr;
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->condition.wait(lock, [this]() { return this->stop || !this->queue.empty(); });
+        if (this->queue.empty())
+          return; // stop was set
+        viewgrams_sptr = this->queue.front();
+        this->queue.pop_front();
+        this->writing = true;
+      }
+      // there is space in the queue now
+      this->condition.notify_all();
+      try
+        {
+          if (this->proj_data.set_related_viewgrams(*viewgrams_sptr) != Succeeded::yes)
+            throw std::runtime_error("set_related_viewgrams failed");
+        }
+      catch (...)
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->write_exception = std::current_exception();
+        }
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->writing = false;
+      }
+      this->condition.notify_all();
+    }
+}
+
+void
+RelatedViewgramsWriteBehind::set_related_viewgrams(const RelatedViewgrams<float>& viewgrams)
+{
+  // make the copy outside of the lock
+  auto viewgrams_sptr = std::make_shared<RelatedViewgrams<float>>(viewgrams);
+  {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->condition.wait(lock, [this]() { return this->queue.size() < this->max_num_in_memory; });
+    this->check_write_exception();
+    this->queue.push_back(viewgrams_sptr);
+  }
+  this->condition.notify_all();
+}
+
+void
+RelatedViewgramsWriteBehind::flush()
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->condition.wait(lock, [this]() { return this->queue.empty() && !this->writing; });
+  this->check_write_exception();
+}
+
+END_NAMESPACE_STIR
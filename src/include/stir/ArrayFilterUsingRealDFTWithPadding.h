@@ -96,6 +96,29 @@ public:
     */
   bool is_trivial() const override;
 
+  //! Performs the convolution on every element of \a data
+  /*! For instance, for a 1D filter and a 2D array (such as a Viewgram), every row is filtered.
+      This gives the same result as calling the filter on every element, but is faster as
+      the work arrays are allocated only once.
+  */
+  void apply_to_each(Array<num_dimensions + 1, elemT>& data) const;
+
+  //! Performs the convolution on every array in the range [\a first, \a last)
+  /*! As apply_to_each(Array<num_dimensions + 1, elemT>&), but for any iterator whose
+      value type is an <code>Array\<num_dimensions,elemT\></code>, e.g. to filter all viewgrams
+      in a RelatedViewgrams object with a 2D filter.
+  */
+  template <class IterT>
+  void apply_to_each(IterT first, IterT last) const
+  {
+    if (this->is_trivial())
+      return;
+    Array<num_dimensions, elemT> padded_array(this->padding_range);
+    Array<num_dimensions, std::complex<elemT>> tmp;
+    for (; first != last; ++first)
+      this->do_it(*first, *first, padded_array, tmp);
+  }
+
 protected:
   Array<num_dimensions, std::complex<elemT>> kernel_in_frequency_space;
 
@@ -111,6 +134,14 @@ private:
   IndexRange<num_dimensions> padding_range;
   BasicCoordinate<num_dimensions, int> padded_sizes;
   Succeeded set_padding_range();
+  //! Performs the convolution using the given work arrays
+  /*! \a padded_array has to have \c padding_range. \a tmp will be resized when necessary.
+      \a out_array and \a in_array can be the same array.
+  */
+  void do_it(Array<num_dimensions, elemT>& out_array,
+             const Array<num_dimensions, elemT>& in_array,
+             Array<num_dimensions, elemT>& padded_array,
+             Array<num_dimensions, std::complex<elemT>>& tmp) const;
 };
 
 END_NAMESPACE_STIR
@@ -1,7 +1,7 @@
 /*
         Copyright 2015, 2017 ETH Zurich, Institute of Particle Physics
         Copyright 2020 Positrigo AG, Zurich
-    Copyright (C) 2021 University College London
+    Copyright (C) 2021, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -119,6 +119,9 @@ public:
   unsigned get_num_axial_coords() const { return num_axial_coords; }
   unsigned get_num_radial_coords() const { return num_radial_coords; }
 
+  //! standard deviation (in mm) of the random displacement of the coordinates (0 if none)
+  double get_sigma() const { return sigma; }
+
 protected:
   explicit DetectorCoordinateMap(double sigma = 0.0)
       : sigma(sigma)
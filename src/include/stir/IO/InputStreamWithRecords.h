@@ -10,6 +10,7 @@
 */
 /*
     Copyright (C) 2003- 2011, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -23,6 +24,7 @@
 #include "stir/shared_ptr.h"
 #include "stir/Succeeded.h"
 
+#include <future>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -36,9 +38,16 @@ START_NAMESPACE_STIR
     the function to find out what the size of the record is. In that case, all IO
     handling is completely generic and is implemented in this class.
 
-    Current implementation needs a \c max_size_of_record to allocate enough memory
-    (on the stack) before reading. This is efficient in many cases, but impractical
-    in others.
+    The stream is read in large blocks (see set_buffer_size()). While the records in one
+    block are being handled, the next block is read in a background thread, such that
+    reading a large file is limited by the disk bandwidth, and not by reading every record
+    separately (see set_read_ahead()). Records are passed to \c RecordT directly from these
+    blocks (a record that spans 2 blocks is first copied such that it is contiguous). The current
+    implementation needs a \c max_size_of_record for this.
+
+    Positions returned by save_get_position() are positions in the stream (as if every record
+    were read separately), such that get_saved_get_positions() remains meaningful when
+    reopening the same stream.
 
     \par Requirements
     \c RecordT needs to have the following member functions
@@ -52,8 +61,6 @@ START_NAMESPACE_STIR
                          const std::size_t size_of_record,
                          const OptionsT options);
     \endcode
-
-    \todo Allow choosing between allocation with \c new or on the stack.
 */
 template <class RecordT, class OptionsT>
 class InputStreamWithRecords
@@ -78,7 +85,8 @@ public:
                                 const OptionsT& options,
                                 const std::streampos start_of_data = 0);
 
-  virtual ~InputStreamWithRecords() {}
+  //! Waits for the background thread to finish reading
+  virtual ~InputStreamWithRecords();
 
   inline virtual Succeeded get_next_record(RecordT& record) const;
 
@@ -108,7 +116,28 @@ public:
   */
   inline void set_saved_get_positions(const std::vector<std::streampos>&);
 
-  inline std::istream& get_stream() { return *this->stream_ptr; }
+  //! Set the number of bytes that are read from the stream in one go
+  /*! Defaults to default_buffer_size. Memory for 2 blocks of this size will be allocated. */
+  inline void set_buffer_size(const std::size_t new_buffer_size);
+
+  //! Enable or disable reading the next block in a background thread
+  /*! Defaults to \c true. When disabled, blocks are read by the thread calling get_next_record().
+      This is useful when get_next_record() is itself called from a background thread, avoiding
+      2 nested levels of reading ahead.
+  */
+  inline void set_read_ahead(const bool);
+  inline bool get_read_ahead() const;
+
+  //! Access to the stream
+  /*! Reading in the background will be stopped, and the stream will be positioned after the
+      last record returned by get_next_record().
+      \warning Changing the position of the stream has no effect on get_next_record(). Use
+      reset() or set_get_position() instead.
+  */
+  inline std::istream& get_stream();
+
+  //! default number of bytes that are read from the stream in one go
+  static constexpr std::size_t default_buffer_size = 8 * 1024 * 1024;
 
 private:
   shared_ptr<std::istream> stream_ptr;
@@ -121,6 +150,41 @@ private:
   const std::size_t max_size_of_record;
 
   const OptionsT options;
+
+  std::size_t buffer_size;
+  bool read_ahead;
+  //! 2 blocks of memory, one for the data that is currently used and one for reading the next block
+  /*! The first \c max_size_of_record bytes of every block are reserved for copying the end of the
+      previous block (in case a record spans 2 blocks).
+  */
+  mutable std::vector<char> buffers[2];
+  mutable int current_buffer;
+  //! number of bytes in the current buffer (including the reserved bytes at the start)
+  mutable std::size_t current_buffer_end;
+  //! position of the next record in the current buffer
+  mutable std::size_t position_in_buffer;
+  //! position in the stream that corresponds to the start of the current buffer
+  /*! The next block is read from \c current_buffer_start+current_buffer_end. */
+  mutable std::streampos current_buffer_start;
+  //! result of the background read, i.e. the number of bytes that were read (or -1 in case of an error)
+  mutable std::future<std::streamsize> next_buffer_future;
+  //! set when there is no more data in the stream (or there was an error reading it)
+  mutable bool no_more_data_in_stream;
+  //! set when get_next_record() failed because there was not enough data for a record
+  mutable bool end_of_data_reached;
+
+  //! make the current buffer empty, such that reading restarts at \a position in the stream
+  inline void discard_buffers(const std::streampos position) const;
+  //! wait for the background thread, and position the stream after the last record
+  inline void stop_reading_ahead();
+  //! start reading the next block in the background
+  inline void start_reading_next_buffer() const;
+  //! make the next block the current one, copying the unused data at the end of the current block
+  /*! \return \c false if there is no more data */
+  inline bool switch_to_next_buffer() const;
+  //! find a pointer to \a num_bytes contiguous bytes at the current position
+  /*! \return \c 0 if there is not enough data */
+  inline const char* get_data_ptr(const std::size_t num_bytes) const;
 };
 
 END_NAMESPACE_STIR
@@ -8,6 +8,7 @@
 /*
     Copyright (C) 2003-2011, Hammersmith Imanet Ltd
     Copyright (C) 2012-2013, Kris Thielemans
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -19,9 +20,9 @@
 #include "stir/Succeeded.h"
 #include "stir/is_null_ptr.h"
 #include "stir/shared_ptr.h"
-#include "boost/shared_array.hpp"
 #include "stir/warning.h"
 #include "stir/error.h"
+#include <algorithm>
 #include <fstream>
 
 START_NAMESPACE_STIR
@@ -33,7 +34,14 @@ InputStreamWithRecords<RecordT, OptionsT>::InputStreamWithRecords(const shared_p
     : stream_ptr(stream_ptr),
       size_of_record_signature(size_of_record_signature),
       max_size_of_record(max_size_of_record),
-      options(options)
+      options(options),
+      buffer_size(default_buffer_size),
+      read_ahead(true),
+      current_buffer(0),
+      current_buffer_end(0),
+      position_in_buffer(0),
+      no_more_data_in_stream(false),
+      end_of_data_reached(false)
 {
   assert(size_of_record_signature <= max_size_of_record);
   if (is_null_ptr(stream_ptr))
@@ -41,6 +49,7 @@ InputStreamWithRecords<RecordT, OptionsT>::InputStreamWithRecords(const shared_p
   starting_stream_position = stream_ptr->tellg();
   if (!stream_ptr->good())
     error("InputStreamWithRecords: error in tellg()\n");
+  discard_buffers(starting_stream_position);
 }
 
 template <class RecordT, class OptionsT>
@@ -53,7 +62,14 @@ InputStreamWithRecords<RecordT, OptionsT>::InputStreamWithRecords(const std::str
       starting_stream_position(start_of_data),
       size_of_record_signature(size_of_record_signature),
       max_size_of_record(max_size_of_record),
-      options(options)
+      options(options),
+      buffer_size(default_buffer_size),
+      read_ahead(true),
+      current_buffer(0),
+      current_buffer_end(0),
+      position_in_buffer(0),
+      no_more_data_in_stream(false),
+      end_of_data_reached(false)
 {
   assert(size_of_record_signature <= max_size_of_record);
   std::fstream* s_ptr = new std::fstream;
@@ -63,6 +79,115 @@ InputStreamWithRecords<RecordT, OptionsT>::InputStreamWithRecords(const std::str
     error("InputStreamWithRecords: error in reset() for filename %s\n", filename.c_str());
 }
 
+template <class RecordT, class OptionsT>
+InputStreamWithRecords<RecordT, OptionsT>::~InputStreamWithRecords()
+{
+  if (next_buffer_future.valid())
+    next_buffer_future.wait();
+}
+
+template <class RecordT, class OptionsT>
+void
+InputStreamWithRecords<RecordT, OptionsT>::discard_buffers(const std::streampos position) const
+{
+  assert(!next_buffer_future.valid());
+  current_buffer_start = position;
+  current_buffer_end = 0;
+  position_in_buffer = 0;
+  no_more_data_in_stream = false;
+  end_of_data_reached = false;
+}
+
+template <class RecordT, class OptionsT>
+void
+InputStreamWithRecords<RecordT, OptionsT>::stop_reading_ahead()
+{
+  if (is_null_ptr(stream_ptr))
+    return;
+  if (next_buffer_future.valid())
+    next_buffer_future.wait();
+  next_buffer_future = std::future<std::streamsize>();
+  if (end_of_data_reached)
+    return;
+  const std::streampos position = current_buffer_start + std::streamoff(position_in_buffer);
+  stream_ptr->clear();
+  stream_ptr->seekg(position);
+  discard_buffers(position);
+}
+
+template <class RecordT, class OptionsT>
+void
+InputStreamWithRecords<RecordT, OptionsT>::start_reading_next_buffer() const
+{
+  assert(!next_buffer_future.valid());
+  std::vector<char>& buffer = buffers[1 - current_buffer];
+  if (buffer.size() != this->max_size_of_record + this->buffer_size)
+    buffer.resize(this->max_size_of_record + this->buffer_size);
+  char* const data_ptr = buffer.data() + this->max_size_of_record;
+  const std::streamsize num_bytes = static_cast<std::streamsize>(this->buffer_size);
+  const shared_ptr<std::istream> stream_sptr = this->stream_ptr;
+  // without read-ahead, the block is read by the thread calling get() on the future
+  const std::launch policy = this->read_ahead ? std::launch::async : std::launch::deferred;
+  next_buffer_future = std::async(policy, [stream_sptr, data_ptr, num_bytes]() -> std::streamsize {
+    stream_sptr->read(data_ptr, num_bytes);
+    if (stream_sptr->bad())
+      return -1;
+    return stream_sptr->gcount();
+  });
+}
+
+template <class RecordT, class OptionsT>
+bool
+InputStreamWithRecords<RecordT, OptionsT>::switch_to_next_buffer() const
+{
+  if (!next_buffer_future.valid())
+    {
+      // nothing is being read (at the start, or at the end of the stream)
+      if (no_more_data_in_stream)
+        return false;
+      start_reading_next_buffer();
+    }
+  const std::streamsize num_bytes_read = next_buffer_future.get();
+  if (num_bytes_read <= 0)
+    {
+      if (num_bytes_read < 0)
+        warning("Error after reading from list mode stream in get_next_record");
+      no_more_data_in_stream = true;
+      return false;
+    }
+
+  // copy the data that has not been used yet in front of the new data
+  const int next_buffer = 1 - current_buffer;
+  const std::size_t num_bytes_left = current_buffer_end - position_in_buffer;
+  assert(num_bytes_left <= this->max_size_of_record);
+  std::copy(buffers[current_buffer].data() + position_in_buffer,
+            buffers[current_buffer].data() + current_buffer_end,
+            buffers[next_buffer].data() + this->max_size_of_record - num_bytes_left);
+  current_buffer_start += std::streamoff(current_buffer_end) - std::streamoff(this->max_size_of_record);
+  current_buffer = next_buffer;
+  position_in_buffer = this->max_size_of_record - num_bytes_left;
+  current_buffer_end = this->max_size_of_record + static_cast<std::size_t>(num_bytes_read);
+
+  if (num_bytes_read < static_cast<std::streamsize>(this->buffer_size))
+    no_more_data_in_stream = true;
+  else if (this->read_ahead)
+    start_reading_next_buffer();
+  return true;
+}
+
+template <class RecordT, class OptionsT>
+const char*
+InputStreamWithRecords<RecordT, OptionsT>::get_data_ptr(const std::size_t num_bytes) const
+{
+  assert(num_bytes <= this->max_size_of_record);
+  while (current_buffer_end - position_in_buffer < num_bytes)
+    {
+      if (!switch_to_next_buffer())
+        return 0;
+    }
+  return buffers[current_buffer].data() + position_in_buffer;
+}
+
 template <class RecordT, class OptionsT>
 Succeeded
 InputStreamWithRecords<RecordT, OptionsT>::get_next_record(RecordT& record) const
@@ -76,30 +201,29 @@ InputStreamWithRecords<RecordT, OptionsT>::get_next_record(RecordT& record) cons
 #  pragma omp critical(LISTMODEIO)
 #endif
   {
-    // rely on file caching by the C++ library or the OS
     assert(this->size_of_record_signature <= this->max_size_of_record);
-    boost::shared_array<char> data_sptr(new char[this->max_size_of_record]);
-
-    stream_ptr->read(data_sptr.get(), this->size_of_record_signature);
-    if (stream_ptr->gcount() < static_cast<std::streamsize>(this->size_of_record_signature))
+    const char* data_ptr = get_data_ptr(this->size_of_record_signature);
+    if (is_null_ptr(data_ptr))
       {
         ret = Succeeded::no;
       }
-    const std::size_t size_of_record = record.size_of_record_at_ptr(data_sptr.get(), this->size_of_record_signature, options);
-    assert(size_of_record <= this->max_size_of_record);
-    if (size_of_record > this->size_of_record_signature)
-      stream_ptr->read(data_sptr.get() + this->size_of_record_signature, size_of_record - this->size_of_record_signature);
-    if (stream_ptr->eof())
+    else
       {
-        ret = Succeeded::no;
+        const std::size_t size_of_record = record.size_of_record_at_ptr(data_ptr, this->size_of_record_signature, options);
+        assert(size_of_record <= this->max_size_of_record);
+        if (size_of_record > this->size_of_record_signature)
+          data_ptr = get_data_ptr(size_of_record);
+        if (is_null_ptr(data_ptr))
+          ret = Succeeded::no;
+        else
+          {
+            position_in_buffer += std::max(size_of_record, this->size_of_record_signature);
+            ret = record.init_from_data_ptr(data_ptr, size_of_record, options);
+          }
       }
-    else if (stream_ptr->bad())
-      {
-        warning("Error after reading from list mode stream in get_next_record");
-        ret = Succeeded::no;
-      }
-    if (ret == Succeeded::yes)
-      ret = record.init_from_data_ptr(data_sptr.get(), size_of_record, options);
+    // remember if we ran out of data (as opposed to init_from_data_ptr() failing)
+    if (is_null_ptr(data_ptr))
+      end_of_data_reached = true;
   }
 
   return ret;
@@ -112,14 +236,15 @@ InputStreamWithRecords<RecordT, OptionsT>::reset()
   if (is_null_ptr(stream_ptr))
     return Succeeded::no;
 
+  stop_reading_ahead();
   // Strangely enough, once you read past EOF, even seekg(0) doesn't reset the eof flag
   if (stream_ptr->eof())
     stream_ptr->clear();
   stream_ptr->seekg(starting_stream_position, std::ios::beg);
   if (stream_ptr->bad())
     return Succeeded::no;
-  else
-    return Succeeded::yes;
+  discard_buffers(starting_stream_position);
+  return Succeeded::yes;
 }
 
 template <class RecordT, class OptionsT>
@@ -127,19 +252,15 @@ typename InputStreamWithRecords<RecordT, OptionsT>::SavedPosition
 InputStreamWithRecords<RecordT, OptionsT>::save_get_position()
 {
   assert(!is_null_ptr(stream_ptr));
-  // TODO should somehow check if tellg() worked and return an error if it didn't
   std::streampos pos;
-  if (!stream_ptr->eof())
+  if (!end_of_data_reached)
     {
-      pos = stream_ptr->tellg();
-      if (!stream_ptr->good())
-        error("InputStreamWithRecords<RecordT, OptionsT>::save_get_position\n"
-              "Error after getting position in file");
+      // position after the last record that was returned (not the position of the stream, which has been read ahead)
+      pos = current_buffer_start + std::streamoff(position_in_buffer);
     }
   else
     {
       // use -1 to signify eof
-      // (this is probably the behaviour of tellg anyway, but this way we're sure).
       pos = std::streampos(-1);
     }
   saved_get_positions.push_back(pos);
@@ -155,6 +276,7 @@ InputStreamWithRecords<RecordT, OptionsT>::set_get_position(
     return Succeeded::no;
 
   assert(pos < saved_get_positions.size());
+  stop_reading_ahead();
   stream_ptr->clear();
   if (saved_get_positions[pos] == std::streampos(-1))
     stream_ptr->seekg(0, std::ios::end); // go to eof
@@ -163,8 +285,8 @@ InputStreamWithRecords<RecordT, OptionsT>::set_get_position(
 
   if (!stream_ptr->good())
     return Succeeded::no;
-  else
-    return Succeeded::yes;
+  discard_buffers(stream_ptr->tellg());
+  return Succeeded::yes;
 }
 
 template <class RecordT, class OptionsT>
@@ -181,4 +303,39 @@ InputStreamWithRecords<RecordT, OptionsT>::set_saved_get_positions(const std::ve
   saved_get_positions = poss;
 }
 
+template <class RecordT, class OptionsT>
+void
+InputStreamWithRecords<RecordT, OptionsT>::set_buffer_size(const std::size_t new_buffer_size)
+{
+  if (new_buffer_size == 0)
+    error("InputStreamWithRecords: buffer size has to be positive");
+  stop_reading_ahead();
+  this->buffer_size = new_buffer_size;
+}
+
+template <class RecordT, class OptionsT>
+void
+InputStreamWithRecords<RecordT, OptionsT>::set_read_ahead(const bool new_read_ahead)
+{
+  if (new_read_ahead == this->read_ahead)
+    return;
+  stop_reading_ahead();
+  this->read_ahead = new_read_ahead;
+}
+
+template <class RecordT, class OptionsT>
+bool
+InputStreamWithRecords<RecordT, OptionsT>::get_read_ahead() const
+{
+  return this->read_ahead;
+}
+
+template <class RecordT, class OptionsT>
+std::istream&
+InputStreamWithRecords<RecordT, OptionsT>::get_stream()
+{
+  stop_reading_ahead();
+  return *this->stream_ptr;
+}
+
 END_NAMESPACE_STIR
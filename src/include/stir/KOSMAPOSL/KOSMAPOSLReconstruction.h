@@ -6,6 +6,7 @@
     Copyright (C) 2018-2019 University of Leeds
     Copyright (C) 2019 University College of London
     Copyright (C) 2019-2021 National Physical Laboratory
+    Copyright (C) 2026 University College London
 
     This file is part of STIR.
 
@@ -32,6 +33,7 @@
 #  include "stir/RegisteredParsingObject.h"
 #  include "stir/OSMAPOSL/OSMAPOSLReconstruction.h"
 #  include "stir/CartesianCoordinate3D.h"
+#  include <cstdint>
 
 START_NAMESPACE_STIR
 
@@ -106,10 +108,28 @@ class PoissonLogLikelihoodWithLinearModelForMean;
   element;
 
   only_2D:=0                                 ;=1 if you want to reconstruct 2D images;
+  number of nearest neighbours:=0            ;if larger than 0, only keep this many voxels of the neighbourhood
+                                             ;(the ones with the largest anatomical kernel value)
+  kernel matrix input filename:=             ;if set, read the anatomical kernel matrix from this file
+  kernel matrix output filename:=            ;if set, write the anatomical kernel matrix to this file
 
   ; other OSMAPOSL parameters
   End KOSMAPOSL Parameters :=
   \endverbatim
+
+  \par Kernel matrix
+
+  The part of the kernel that comes from the anatomical images, \f$k_m\f$, does not change over iterations.
+  It is therefore computed once in set_up() and stored as a sparse matrix (with one row per voxel, containing
+  the voxels in its neighbourhood). If <tt>number of nearest neighbours</tt> is larger than zero, only the
+  voxels of the neighbourhood with the largest \f$k_m\f$ are kept (i.e. a k-nearest-neighbour kernel).
+  Applying the kernel is then a (multi-threaded) sparse matrix-image product, where the emission part \f$k_p\f$
+  is multiplied in for the hybrid kernel.
+
+  The kernel matrix can be written to file and read back in a subsequent reconstruction, avoiding its computation.
+  The file stores the image and neighbourhood sizes, which are checked when reading, but not the \f$\sigma\f$ values
+  or the anatomical images. It is up to the user to make sure that these are the same. The file uses the native
+  byte order of the machine.
 */
 
 template <typename TargetT>
@@ -151,6 +171,7 @@ public:
   const bool get_only_2D() const;
   const bool get_hybrid() const;
   const int get_freeze_iterative_kernel_at_subiter_num() const;
+  int get_num_nearest_neighbours() const;
 
   std::vector<shared_ptr<TargetT>> get_anatomical_prior_sptrs();
   //@}
@@ -179,6 +200,9 @@ public:
   void set_only_2D(const bool);
   void set_hybrid(const bool);
   void set_freeze_iterative_kernel_at_subiter_num(const int);
+  void set_num_nearest_neighbours(const int);
+  void set_kernel_matrix_input_filename(const std::string&);
+  void set_kernel_matrix_output_filename(const std::string&);
   //@}
 
   //! prompts the user to enter parameter values manually
@@ -192,12 +216,15 @@ protected:
 
   //! Anatomical image filename
   std::vector<std::string> anatomical_image_filenames;
+  //! Filenames to read/write the anatomical kernel matrix
+  std::string kernel_matrix_input_filename, kernel_matrix_output_filename;
 
   std::vector<shared_ptr<TargetT>> anatomical_prior_sptrs, kmnorm_sptrs;
   shared_ptr<TargetT> kpnorm_sptr;
   // kernel parameters
   int num_neighbours, num_non_zero_feat, num_elem_neighbourhood, num_voxels, dimz, dimy, dimx;
   int freeze_iterative_kernel_at_subiter_num;
+  int num_nearest_neighbours;
   std::vector<double> sigma_m;
   bool only_2D;
   bool hybrid;
@@ -229,6 +256,24 @@ private:
 
   std::vector<double> anatomical_sd;
   mutable Array<3, float> distance;
+
+  //! Element of the anatomical kernel matrix
+  struct KernelMatrixElement
+  {
+    //! ravelled index of the neighbouring voxel
+    std::int32_t voxel_index;
+    float value;
+  };
+  //! Start of the elements of every row in \c kernel_matrix_elements
+  /*! The elements for the voxel with ravelled index \c l are stored from <tt>kernel_matrix_row_starts[l]</tt> up to
+      (but excluding) <tt>kernel_matrix_row_starts[l+1]</tt>, sorted by \c voxel_index. */
+  std::vector<std::uint64_t> kernel_matrix_row_starts;
+  std::vector<KernelMatrixElement> kernel_matrix_elements;
+
+  //! Compute the anatomical part of the kernel for every voxel and its neighbourhood
+  void compute_anatomical_kernel_matrix();
+  void write_kernel_matrix(const std::string& filename) const;
+  void read_kernel_matrix(const std::string& filename);
   /*! Create a matrix containing the norm of the difference between two feature vectors, \f$ \|
    * \boldsymbol{z}^{(n)}_j-\boldsymbol{z}^{(n)}_l \| \f$. */
   /*! This is done for the emission image which keeps changing*/
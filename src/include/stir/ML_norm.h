@@ -4,7 +4,7 @@
  This file is part of STIR.
 
     Copyright (C) 2001- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2020, University College London
+    Copyright (C) 2020, 2026, University College London
     Copyright (C) 2016-2017, PETsys Electronics
     Copyright (C) 2022, National Physical Laboratory
     This file is part of STIR.
@@ -207,6 +207,34 @@ typedef FanProjData BlockData3D;
 
 void make_fan_data_remove_gaps(FanProjData& fan_data, const ProjData& proj_data);
 
+/*!
+  \brief Class to construct a FanProjData one bin at a time, removing gaps
+
+  This can be used to construct fan data directly from list mode events, i.e. without
+  going through a (span 1) sinogram first. The result is the same as make_fan_data_remove_gaps()
+  on the corresponding projection data.
+*/
+class FanProjDataAccumulator
+{
+public:
+  //! Sets \a fan_data to the size corresponding to \a proj_data_info, filled with 0
+  /*! \a fan_data and \a proj_data_info have to stay alive while this object is used. */
+  FanProjDataAccumulator(FanProjData& fan_data, const ProjDataInfo& proj_data_info);
+
+  //! Adds \a value to the detector pair of the bin (does nothing for virtual crystals)
+  /*! \a bin has to be in the range of the \c proj_data_info. Its value is ignored. */
+  void add(const Bin& bin, const float value);
+
+private:
+  FanProjData& fan_data;
+  const ProjDataInfoCylindricalNoArcCorr* cylindrical_proj_data_info_ptr;
+  const ProjDataInfoBlocksOnCylindricalNoArcCorr* blocks_proj_data_info_ptr;
+  int num_transaxial_crystals_per_block;
+  int num_axial_crystals_per_block;
+  int num_virtual_transaxial_crystals_per_block;
+  int num_virtual_axial_crystals_per_block;
+};
+
 void set_fan_data_add_gaps(ProjData& proj_data, const FanProjData& fan_data, const float gap_value = 0.F);
 
 void apply_block_norm(FanProjData& fan_data, const BlockData3D& block_data, const bool apply = true);
@@ -35,6 +35,7 @@
 #include "stir/shared_ptr.h"
 #include "stir/Bin.h"
 #include <iostream>
+#include <string>
 #include <vector>
 
 START_NAMESPACE_STIR
@@ -48,6 +49,16 @@ START_NAMESPACE_STIR
   stream isn't closed yet. This is important in an interactive context, as the object
   owning the stream might not be deleted yet before we try to read the file again.
 
+  \par Concurrent access
+  By default, all reads and writes use the same stream. As a stream has only one position, the
+  get_ and set_ functions for viewgrams, sinograms, segments and bins are then performed in an
+  OpenMP critical section, i.e. only one thread at a time can do I/O (for all objects of this class).
+  If the stream refers to a file, set_filename_for_concurrent_access() can be used to let
+  every thread use its own (unbuffered) stream to the file, such that no locking is needed.
+  These streams are opened on first use by a thread, and kept open until the thread exits or the
+  object is deleted (or set_filename_for_concurrent_access() is called again).
+  This is done automatically when reading Interfile data and by ProjDataInterfile.
+
   \warning Data have to be contiguous.
   \warning The parameter make_num_tangential_poss_odd (used in various
   get_ functions) is temporary and will be removed soon.
@@ -154,6 +165,25 @@ public:
   //! Get the value of bin.
   virtual float get_bin_value(const Bin& this_bin) const;
 
+  //! Use a separate stream to the file with name \a filename for every read or write
+  /*! See the class documentation. \a open_mode should be the mode used to open the stream passed to
+      the constructor. If it contains \c std::ios::out, the file is opened for reading and writing
+      (without truncating it), otherwise only for reading. Pass an empty \a filename to always use
+      the original stream.
+
+      \warning \a filename has to refer to the same file as the original stream.
+      \warning The caller needs to make sure that different threads do not write to the same region
+      (or read a region while it is being written).
+  */
+  void set_filename_for_concurrent_access(const std::string& filename, const std::ios::openmode open_mode);
+  //! Get the filename set by set_filename_for_concurrent_access() (empty if not set)
+  inline const std::string& get_filename_for_concurrent_access() const;
+  //! Get the number of streams that are currently open for concurrent access
+  /*! This is one for every thread that did I/O on this object and that has not exited yet.
+      Mainly useful for testing.
+  */
+  std::size_t get_num_streams_for_concurrent_access() const;
+
   //! Set the value of the bin
   virtual void set_bin_value(const Bin& bin);
 
@@ -189,6 +219,21 @@ private:
   // memory as float, with the scale factor multiplied out
   float scale_factor;
 
+  //! file to open for every read/write, if not empty
+  std::string filename_for_concurrent_access;
+  //! mode to open the file for concurrent access
+  std::ios::openmode open_mode_for_concurrent_access;
+  //! the streams opened for concurrent access, one per thread
+  struct ConcurrentStreams;
+  shared_ptr<ConcurrentStreams> concurrent_streams_sptr;
+
+  //! call \a f with the stream to use for reading or writing
+  /*! If concurrent access is enabled, \a f gets the stream of the calling thread (opened on first use),
+      otherwise \c sino_stream in a critical section.
+  */
+  template <class FunctionT>
+  void do_io(FunctionT f) const;
+
 private:
 #if __cplusplus > 199711L
   ProjDataFromStream& operator=(ProjDataFromStream&&) = delete;
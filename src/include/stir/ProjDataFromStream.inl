@@ -34,6 +34,12 @@ ProjDataFromStream::get_storage_order() const
   return storage_order;
 }
 
+const std::string&
+ProjDataFromStream::get_filename_for_concurrent_access() const
+{
+  return filename_for_concurrent_access;
+}
+
 int
 ProjDataFromStream::find_segment_index_in_sequence(const int segment_num) const
 {
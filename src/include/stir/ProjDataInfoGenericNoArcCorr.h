@@ -2,6 +2,7 @@
     Copyright (C) 2000- 2011-06-24, Hammersmith Imanet Ltd
     Copyright (C) 2011-07-01 - 2011, Kris Thielemans
     Copyright (C) 2017, ETH Zurich, Institute of Particle Physics and Astrophysics
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -66,6 +67,19 @@ class Succeeded;
   - have 2 sinograms of the same size as in 2D, together with the rings
     as 'ordered pair' (i.e. ring_difference can be positive and negative).
   In STIR, we use the second convention.
+
+  \par Table with LOR end-points
+
+  Finding the coordinates of the end-points of the LOR of a bin (as used by get_LOR(), get_s(), etc)
+  needs look-ups in the DetectorCoordinateMap of the scanner, which is relatively slow. Therefore,
+  the first time they are needed, the coordinates of all detectors are stored in a table, together with the
+  end-points of all LORs (in single precision, one array per coordinate). The latter is skipped if its size
+  would be larger than get_max_LOR_table_size(). The tables are shared between copies of this object.
+
+  The tables are not used if the DetectorCoordinateMap randomly displaces the detectors (as the coordinates
+  would then be different for every call).
+
+  \warning The scanner should not be modified after the tables have been built.
   */
 class ProjDataInfoGenericNoArcCorr : public ProjDataInfoGeneric
 {
@@ -182,6 +196,15 @@ public:
   */
   void get_all_det_pos_pairs_for_bin(std::vector<DetectionPositionPair<>>&, const Bin&) const;
 
+  //! \name Functions for the table with LOR end-points (see class documentation)
+  //@{
+  //! Set the maximum amount of memory (in bytes) for the end-points of all LORs (defaults to 1 GB)
+  void set_max_LOR_table_size(const std::size_t size_in_bytes);
+  std::size_t get_max_LOR_table_size() const;
+  //! Get the amount of memory (in bytes) used by the tables (0 if they are not built yet)
+  std::size_t get_LOR_table_size_in_bytes() const;
+  //@}
+
 private:
   // old function, now private. Use get_bin_for_det_pos_pair instead.
   //! This gets Bin coordinates for a particular detector pair
@@ -256,6 +279,16 @@ private:
   //! build look-up table unless already done before
   inline void initialise_det1det2_to_uncompressed_view_tangpos_if_not_done_yet() const;
 
+  // used in find_cartesian_coordinates_of_detection() and find_cartesian_coordinates_given_scanner_coordinates()
+  struct LORTable;
+  mutable shared_ptr<const LORTable> LOR_table_sptr;
+  mutable bool LOR_table_initialised;
+  std::size_t max_LOR_table_size;
+  //! build tables with coordinates of detectors and LOR end-points
+  void initialise_LOR_table() const;
+  //! build tables unless already done before
+  inline void initialise_LOR_table_if_not_done_yet() const;
+
 protected:
   bool blindly_equals(const root_type* const) const override;
 };
@@ -2,6 +2,7 @@
     Copyright (C) 2000- 2005, Hammersmith Imanet Ltd
     Copyright (C) 2017, ETH Zurich, Institute of Particle Physics and Astrophysics
     Copyright (C) 2021, University of Leeds
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -77,6 +78,28 @@ ProjDataInfoGenericNoArcCorr::initialise_det1det2_to_uncompressed_view_tangpos_i
     }
 }
 
+void
+ProjDataInfoGenericNoArcCorr::initialise_LOR_table_if_not_done_yet() const
+{
+  // as above
+#if defined(STIR_OPENMP) && _OPENMP >= 201012
+  bool initialised;
+#  pragma omp atomic read
+  initialised = LOR_table_initialised;
+
+  if (!initialised)
+#endif
+    {
+#if defined(STIR_OPENMP)
+#  pragma omp critical(PROJDATAINFOGENERICNOARCCORR_LOR_TABLE)
+#endif
+      {
+        if (!LOR_table_initialised)
+          initialise_LOR_table();
+      }
+    }
+}
+
 /*! warning In cylindrical s is found from bin: sin(beta) = sin(tang_pos*angular_increment)
         In block it is calculated directly from corresponding lor
 */
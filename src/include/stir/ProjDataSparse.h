@@ -0,0 +1,142 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projdata
+  \brief Declaration of class stir::ProjDataSparse
+*/
+
+#ifndef __stir_ProjDataSparse_H__
+#define __stir_ProjDataSparse_H__
+
+#include "stir/ProjData.h"
+#include "stir/Bin.h"
+#include <cstdint>
+#include <vector>
+
+START_NAMESPACE_STIR
+
+class Succeeded;
+
+/*!
+  \ingroup projdata
+  \brief A class which stores projection data in memory, keeping only the non-zero bins.
+
+  This is useful for low-count data, in particular with TOF, where most bins are zero
+  and ProjDataInMemory would need a lot of memory.
+
+  The data are divided in blocks, one for every viewgram (i.e. every combination of timing position,
+  segment and view). Every block stores the (sorted) offsets of its non-zero bins in the viewgram,
+  together with their values. Therefore, get_viewgram() and set_viewgram() only need
+  to handle the non-zero bins of a single block, while get_sinogram() and set_sinogram() need
+  to do a binary search in the blocks of all views.
+
+  Different viewgrams can be get or set concurrently (e.g. by different threads), but this is not the case
+  for sinograms or segments.
+
+  Writing data with many non-zero bins (e.g. after fill() with a non-zero value) is allowed,
+  but then this class uses more memory than ProjDataInMemory.
+*/
+class ProjDataSparse : public ProjData
+{
+public:
+  //! constructor with only info, all bins will be zero
+  ProjDataSparse(shared_ptr<const ExamInfo> const& exam_info_sptr, shared_ptr<const ProjDataInfo> const& proj_data_info_sptr);
+
+  //! constructor that copies the (non-zero) data from another ProjData
+  explicit ProjDataSparse(const ProjData& proj_data);
+
+  Viewgram<float> get_viewgram(const int view_num,
+                               const int segment_num,
+                               const bool make_num_tangential_poss_odd = false,
+                               const int timing_pos = 0) const override;
+  Succeeded set_viewgram(const Viewgram<float>& v) override;
+
+  Sinogram<float> get_sinogram(const int ax_pos_num,
+                               const int segment_num,
+                               const bool make_num_tangential_poss_odd = false,
+                               const int timing_pos = 0) const override;
+  Succeeded set_sinogram(const Sinogram<float>& s) override;
+
+  //! set all bins to the same value
+  /*! Filling with 0 frees all memory used for the bins. */
+  void fill(const float value) override;
+
+  //! Returns the value of a bin
+  float get_bin_value(const Bin& bin) const;
+
+  //! Returns the number of non-zero bins that are stored
+  std::size_t get_num_non_zeros() const;
+
+  //! Calls \a f for every non-zero bin
+  /*! \a f is called as <code>f(bin)</code>, where <code>bin.get_bin_value()</code> is set.
+    The bins are passed in order of timing position, segment, view, axial and tangential position.
+  */
+  template <class FunctionT>
+  void for_each_non_zero(FunctionT f) const;
+
+  //! @name arithmetic operations
+  ///@{
+  //! return sum of all elements
+  float sum() const override;
+
+  //! return maximum value of all elements
+  float find_max() const override;
+
+  //! return minimum value of all elements
+  float find_min() const override;
+
+  //! return L2-norm squared (sum of squares)
+  double norm_squared() const override;
+  ///@}
+
+private:
+  //! Non-zero bins of a single viewgram
+  struct Block
+  {
+    //! offset of the bin in the viewgram
+    /*! i.e. <tt>(axial_pos_num - min_axial_pos_num)*num_tangential_poss + tangential_pos_num - min_tangential_pos_num</tt> */
+    std::vector<std::uint32_t> offsets;
+    std::vector<float> values;
+  };
+  std::vector<Block> blocks;
+
+  std::size_t get_block_index(const int view_num, const int segment_num, const int timing_pos_num) const;
+  void check_range(const int view_num, const int segment_num, const int timing_pos_num) const;
+  //! true if all blocks have all bins stored (i.e. there are no implicit zeros)
+  bool is_full() const;
+};
+
+template <class FunctionT>
+void
+ProjDataSparse::for_each_non_zero(FunctionT f) const
+{
+  const int num_tangential_poss = this->get_num_tangential_poss();
+  Bin bin;
+  for (bin.timing_pos_num() = this->get_min_tof_pos_num(); bin.timing_pos_num() <= this->get_max_tof_pos_num();
+       ++bin.timing_pos_num())
+    for (bin.segment_num() = this->get_min_segment_num(); bin.segment_num() <= this->get_max_segment_num(); ++bin.segment_num())
+      for (bin.view_num() = this->get_min_view_num(); bin.view_num() <= this->get_max_view_num(); ++bin.view_num())
+        {
+          const Block& block = this->blocks[this->get_block_index(bin.view_num(), bin.segment_num(), bin.timing_pos_num())];
+          const int min_axial_pos_num = this->get_min_axial_pos_num(bin.segment_num());
+          for (std::size_t i = 0; i < block.offsets.size(); ++i)
+            {
+              bin.axial_pos_num() = min_axial_pos_num + static_cast<int>(block.offsets[i]) / num_tangential_poss;
+              bin.tangential_pos_num()
+                  = this->get_min_tangential_pos_num() + static_cast<int>(block.offsets[i]) % num_tangential_poss;
+              bin.set_bin_value(block.values[i]);
+              f(static_cast<const Bin&>(bin));
+            }
+        }
+}
+
+END_NAMESPACE_STIR
+
+#endif
@@ -0,0 +1,98 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projdata
+  \brief Declaration of class stir::RelatedViewgramsReadAhead
+*/
+
+#ifndef __stir_RelatedViewgramsReadAhead_H__
+#define __stir_RelatedViewgramsReadAhead_H__
+
+#include "stir/RelatedViewgrams.h"
+#include "stir/ViewgramIndices.h"
+#include "stir/shared_ptr.h"
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+START_NAMESPACE_STIR
+
+class ProjData;
+class DataSymmetriesForViewSegmentNumbers;
+
+/*!
+  \ingroup projdata
+  \brief Reads related viewgrams from a ProjData object in a background thread
+
+  Loops over projection data (such as in distributable_computation()) typically process related viewgrams
+  in a known order. This class reads them in that order in a separate thread, such that reading from disk
+  overlaps with the computation. At most \c max_num_in_memory related viewgrams are kept in memory.
+
+  get_related_viewgrams() can be called from multiple threads, but every element of the sequence has
+  to be requested exactly once, and (roughly) in order, as is the case when using an OpenMP loop with
+  \c schedule(dynamic) or \c schedule(static,1) over the sequence. Related viewgrams that are not in the
+  sequence are read directly.
+
+  This class is only useful for projection data that are not in memory already (e.g. stir::ProjDataFromStream).
+
+  \warning The ProjData object should not be modified while the read-ahead is active.
+*/
+class RelatedViewgramsReadAhead
+{
+public:
+  //! Constructor, which starts reading in the background
+  /*!
+    \param proj_data_sptr projection data to read from
+    \param symmetries_sptr symmetries to use for constructing the related viewgrams
+    \param viewgram_indices_sequence indices of the basic viewgrams (including timing position) in the order in
+           which they will be requested
+    \param max_num_in_memory maximum number of related viewgrams that have been read but not yet requested
+  */
+  RelatedViewgramsReadAhead(const shared_ptr<const ProjData>& proj_data_sptr,
+                            const shared_ptr<DataSymmetriesForViewSegmentNumbers>& symmetries_sptr,
+                            const std::vector<ViewgramIndices>& viewgram_indices_sequence,
+                            const std::size_t max_num_in_memory);
+
+  //! Stops reading and waits for the background thread
+  ~RelatedViewgramsReadAhead();
+
+  //! Get the related viewgrams, waiting until they have been read if necessary
+  /*! Calls error() if reading failed, or if the related viewgrams have already been requested before. */
+  RelatedViewgrams<float> get_related_viewgrams(const ViewgramIndices& viewgram_indices);
+
+private:
+  shared_ptr<const ProjData> proj_data_sptr;
+  shared_ptr<DataSymmetriesForViewSegmentNumbers> symmetries_sptr;
+  std::vector<ViewgramIndices> viewgram_indices_sequence;
+  //! find the position in viewgram_indices_sequence
+  std::map<ViewgramIndices, std::size_t> positions;
+  const std::size_t max_num_in_memory;
+
+  //! viewgrams that have been read, but not yet requested
+  std::map<std::size_t, shared_ptr<RelatedViewgrams<float>>> available_viewgrams;
+  //! number of elements of the sequence that have been read (or skipped)
+  std::size_t num_read;
+  bool stop;
+  std::exception_ptr read_exception;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::thread reader_thread;
+
+  //! function run by reader_thread
+  void read_sequence();
+};
+
+END_NAMESPACE_STIR
+
+#endif
@@ -0,0 +1,84 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projdata
+  \brief Declaration of class stir::RelatedViewgramsWriteBehind
+*/
+
+#ifndef __stir_RelatedViewgramsWriteBehind_H__
+#define __stir_RelatedViewgramsWriteBehind_H__
+
+#include "stir/RelatedViewgrams.h"
+#include "stir/shared_ptr.h"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+START_NAMESPACE_STIR
+
+class ProjData;
+
+/*!
+  \ingroup projdata
+  \brief Writes related viewgrams to a ProjData object in a background thread
+
+  set_related_viewgrams() queues the related viewgrams and returns immediately (unless
+  \c max_num_in_memory related viewgrams are already waiting to be written), such that
+  writing to disk overlaps with the computation of the next related viewgrams. It can be
+  called from multiple threads.
+
+  Call flush() to wait until all related viewgrams have been written.
+
+  This class is only useful for projection data that are not in memory already (e.g. stir::ProjDataFromStream).
+
+  \warning The ProjData object has to stay alive until flush() has been called or this object is destructed.
+*/
+class RelatedViewgramsWriteBehind
+{
+public:
+  //! Constructor, which starts the background thread
+  RelatedViewgramsWriteBehind(ProjData& proj_data, const std::size_t max_num_in_memory);
+
+  //! Calls flush(), but only writes a warning if that fails
+  ~RelatedViewgramsWriteBehind();
+
+  //! Queue the related viewgrams for writing, waiting if the queue is full
+  /*! Calls error() if a previous write failed. */
+  void set_related_viewgrams(const RelatedViewgrams<float>& viewgrams);
+
+  //! Waits until all queued related viewgrams have been written
+  /*! Calls error() if any write failed. */
+  void flush();
+
+private:
+  ProjData& proj_data;
+  const std::size_t max_num_in_memory;
+
+  std::deque<shared_ptr<RelatedViewgrams<float>>> queue;
+  //! true while the writer thread is writing (after removing the related viewgrams from the queue)
+  bool writing;
+  bool stop;
+  std::exception_ptr write_exception;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::thread writer_thread;
+
+  //! function run by writer_thread
+  void write_queue();
+  //! call error() if a write failed (the mutex has to be locked)
+  void check_write_exception();
+};
+
+END_NAMESPACE_STIR
+
+#endif
@@ -10,6 +10,7 @@
 */
 /*
     Copyright (C) 2003- 2011, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -62,6 +63,23 @@ public:
   */
   inline void get_bin(Bin& bin, const ProjDataInfo& proj_data_info) const override;
 
+  //! Finds the bins for a number of records, see ListModeData::get_bins_for_records()
+  /*! Gives the same result as calling get_bin() for every record that is an event, but without
+    any virtual function calls for every record. This is intended to be used by the ListModeData
+    classes of the scanners.
+
+    \c RecordT has to be the (most derived) type of the records, and \c EventT the type of the
+    object returned by <code>RecordT::event()</code> (which can be \c RecordT itself).
+    \c EventT needs to override get_detection_position().
+
+    Calls error() if \a proj_data_info is not of type \c ProjDataInfoT.
+  */
+  template <class RecordT, class EventT>
+  static inline void get_bins_for_records(Bin* bins,
+                                          const ListRecord* const* records,
+                                          const std::size_t num_records,
+                                          const ProjDataInfo& proj_data_info);
+
   //! This method checks if the template is valid for LmToProjData
   /*! Used before the actual processing of the data (see issue #61), before calling get_bin()
    *  Most scanners have listmode data that correspond to non arc-corrected data and
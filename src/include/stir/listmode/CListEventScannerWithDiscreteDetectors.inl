@@ -13,7 +13,7 @@
     Copyright (C) 2003- 2011, Hammersmith Imanet Ltd
     Copyright (C) 2017, 2022, University College London
     Copyright (C) 2017, University of Leeds
-    Copyright (C) 2023, University College London
+    Copyright (C) 2023, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -103,6 +103,35 @@ CListEventScannerWithDiscreteDetectors<ProjDataInfoT>::get_bin(Bin& bin, const P
     }
 }
 
+template <class ProjDataInfoT>
+template <class RecordT, class EventT>
+void
+CListEventScannerWithDiscreteDetectors<ProjDataInfoT>::get_bins_for_records(Bin* bins,
+                                                                            const ListRecord* const* records,
+                                                                            const std::size_t num_records,
+                                                                            const ProjDataInfo& proj_data_info)
+{
+  auto proj_data_info_ptr = dynamic_cast<ProjDataInfoT const*>(&proj_data_info);
+  if (!proj_data_info_ptr)
+    error("CListEventScannerWithDiscreteDetectors::get_bins_for_records called with wrong type of ProjDataInfo");
+
+  DetectionPositionPair<> det_pos;
+  for (std::size_t i = 0; i < num_records; ++i)
+    {
+      // use qualified names such that the compiler does not need to go via the virtual function table
+      const RecordT& record = static_cast<const RecordT&>(*records[i]);
+      if (!record.RecordT::is_event())
+        continue;
+      const EventT& event = static_cast<const EventT&>(record.RecordT::event());
+      event.EventT::get_detection_position(det_pos);
+      Bin& bin = bins[i];
+      if (proj_data_info_ptr->get_bin_for_det_pos_pair(bin, det_pos) == Succeeded::no)
+        bin.set_bin_value(0);
+      else
+        bin.set_bin_value(1);
+    }
+}
+
 template <class ProjDataInfoT>
 bool
 CListEventScannerWithDiscreteDetectors<ProjDataInfoT>::is_valid_template(const ProjDataInfo& proj_data_info) const
@@ -68,6 +68,8 @@ public:
 
   virtual Succeeded set_get_position(const SavedPosition&);
 
+  virtual void set_read_ahead(const bool);
+
   //! returns \c true, as ECAT listmode data stores delayed events (and prompts)
   /*! \todo this might depend on the acquisition parameters */
   virtual bool has_delayeds() const { return true; }
@@ -76,6 +78,8 @@ private:
   std::string listmode_filename_prefix;
   mutable unsigned int current_lm_file;
   mutable shared_ptr<InputStreamWithRecords<CListRecordT, bool>> current_lm_data_ptr;
+  //! used for every .lm file, see set_read_ahead()
+  bool read_ahead = true;
   //! a vector that stores the saved_get_positions for ever .lm file
   mutable std::vector<std::vector<std::streampos>> saved_get_positions_for_each_lm_data;
   typedef std::pair<unsigned int, SavedPosition> GetPosition;
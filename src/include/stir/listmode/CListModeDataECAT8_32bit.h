@@ -1,5 +1,5 @@
 /*
-    Copyright (C) 2013-2014 University College London
+    Copyright (C) 2013-2014, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -51,12 +51,22 @@ public:
 
   Succeeded get_next_record(CListRecord& record) const override;
 
+  //! Finds the bins for a number of records, without virtual function calls for every record
+  void get_bins_for_records(Bin* bins,
+                            const ListRecord* const* records,
+                            const std::size_t num_records,
+                            const ProjDataInfo& proj_data_info) const override;
+  //! Decoding depends only on the record, so can be done in parallel
+  bool can_decode_records_in_parallel() const override { return true; }
+
   Succeeded reset() override;
 
   SavedPosition save_get_position() override;
 
   Succeeded set_get_position(const SavedPosition&) override;
 
+  void set_read_ahead(const bool v) override { current_lm_data_ptr->set_read_ahead(v); }
+
   //! returns \c true, as ECAT listmode data stores delayed events (and prompts)
   /*! \todo this might depend on the acquisition parameters */
   bool has_delayeds() const override { return true; }
@@ -1,5 +1,5 @@
 /*
-    Copyright (C) 2013-2020 University College London
+    Copyright (C) 2013-2020, 2026 University College London
     Copyright (C) 2017-2019 University of Leeds
 */
 /*!
@@ -50,6 +50,14 @@ public:
 
   Succeeded get_next_record(CListRecord& record) const override;
 
+  //! Finds the bins for a number of records, without virtual function calls for every record
+  void get_bins_for_records(Bin* bins,
+                            const ListRecord* const* records,
+                            const std::size_t num_records,
+                            const ProjDataInfo& proj_data_info) const override;
+  //! Decoding depends only on the record, so can be done in parallel
+  bool can_decode_records_in_parallel() const override { return true; }
+
   Succeeded reset() override;
 
   SavedPosition save_get_position() override;
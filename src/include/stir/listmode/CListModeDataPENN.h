@@ -1,5 +1,6 @@
 /*
     Copyright (C) 2020-2022 University of Pennsylvania
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -36,6 +37,14 @@ public:
 
   virtual Succeeded get_next_record(CListRecord& record) const;
 
+  //! Finds the bins for a number of records, without virtual function calls for every record
+  virtual void get_bins_for_records(Bin* bins,
+                                    const ListRecord* const* records,
+                                    const std::size_t num_records,
+                                    const ProjDataInfo& proj_data_info) const;
+  //! Decoding depends only on the record, so can be done in parallel
+  virtual bool can_decode_records_in_parallel() const { return true; }
+
   virtual Succeeded reset();
 
   virtual SavedPosition save_get_position();
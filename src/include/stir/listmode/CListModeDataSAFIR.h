@@ -5,6 +5,7 @@
 
         Copyright 2015 ETH Zurich, Institute of Particle Physics
         Copyright 2020 Positrigo AG, Zurich
+        Copyright 2026 University College London
 
         Licensed under the Apache License, Version 2.0 (the "License");
         you may not use this file except in compliance with the License.
@@ -74,6 +75,13 @@ public:
   std::string get_name() const override;
   shared_ptr<CListRecord> get_empty_record_sptr() const override;
   Succeeded get_next_record(CListRecord& record_of_general_type) const override;
+  //! Finds the bins for a number of records, without virtual function calls for every record
+  void get_bins_for_records(Bin* bins,
+                            const ListRecord* const* records,
+                            const std::size_t num_records,
+                            const ProjDataInfo& proj_data_info) const override;
+  //! Decoding depends only on the record, so can be done in parallel
+  bool can_decode_records_in_parallel() const override { return true; }
   Succeeded reset() override;
 
   /*!
@@ -84,6 +92,8 @@ public:
   SavedPosition save_get_position() override { return static_cast<SavedPosition>(current_lm_data_ptr->save_get_position()); }
   Succeeded set_get_position(const SavedPosition& pos) override { return current_lm_data_ptr->set_get_position(pos); }
 
+  void set_read_ahead(const bool v) override { current_lm_data_ptr->set_read_ahead(v); }
+
   /*!
   Returns just false in the moment.
   \todo Implement this properly to check for delayed events in LM files.
@@ -195,8 +195,7 @@ private:
 class CListRecordECAT8_32bit : public CListRecord // currently no gating yet
 {
 
-  // public:
-
+public:
   bool is_time() const override { return this->any_data.is_time(); }
   /*
   bool is_gating_input() const
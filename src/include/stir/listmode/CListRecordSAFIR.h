@@ -5,6 +5,7 @@
         Copyright 2015 ETH Zurich, Institute of Particle Physics
         Copyright 2017 ETH Zurich, Institute of Particle Physics and Astrophysics
         Copyright 2020, 2022 Positrigo AG, Zurich
+        Copyright 2026 University College London
 
         Licensed under the Apache License, Version 2.0 (the "License");
         you may not use this file except in compliance with the License.
@@ -83,6 +84,18 @@ public:
   //! Override the default implementation
   inline void get_bin(Bin& bin, const ProjDataInfo& proj_data_info) const override;
 
+  //! Finds the bins for a number of records, see ListModeData::get_bins_for_records()
+  /*! Gives the same result as calling get_bin() for every record that is an event, but finds the type
+    of \a proj_data_info and the detector map only once, and avoids virtual function calls for every record.
+
+    All records have to be of type \c Derived, and have the same map and scanner (as is the case for
+    records created by CListModeDataSAFIR).
+  */
+  static inline void get_bins_for_records(Bin* bins,
+                                          const ListRecord* const* records,
+                                          const std::size_t num_records,
+                                          const ProjDataInfo& proj_data_info);
+
   //! This method checks if the template is valid for LmToProjData
   /*! Used before the actual processing of the data (see issue #61), before calling get_bin()
    *  Most scanners have listmode data that correspond to non arc-corrected data and
@@ -104,6 +117,14 @@ private:
   shared_ptr<const Scanner> scanner_sptr;
 
   const DetectorCoordinateMap& map_to_use() const { return map_sptr ? *map_sptr : *this->scanner_sptr->get_detector_map_sptr(); }
+
+  //! Implementation of get_bins_for_records() when the map is not set
+  template <class ProjDataInfoT>
+  static inline void get_bins_for_records_using_det_pos(Bin* bins,
+                                                        const ListRecord* const* records,
+                                                        const std::size_t num_records,
+                                                        const DetectorCoordinateMap& map,
+                                                        const ProjDataInfoT& proj_data_info);
 };
 
 //! Class for record with coincidence data using SAFIR bitfield definition
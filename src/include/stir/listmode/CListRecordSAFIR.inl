@@ -5,7 +5,7 @@
         Copyright 2015 ETH Zurich, Institute of Particle Physics
         Copyright 2017 ETH Zurich, Institute of Particle Physics and Astrophysics
         Copyright 2020, 2022 Positrigo AG, Zurich
-        Copyright 2021 University College London
+        Copyright 2021, 2026 University College London
 
         Licensed under the Apache License, Version 2.0 (the "License");
         you may not use this file except in compliance with the License.
@@ -117,6 +117,66 @@ CListEventSAFIR<Derived>::get_bin(Bin& bin, const ProjDataInfo& proj_data_info)
     }
 }
 
+template <class Derived>
+void
+CListEventSAFIR<Derived>::get_bins_for_records(Bin* bins,
+                                               const ListRecord* const* records,
+                                               const std::size_t num_records,
+                                               const ProjDataInfo& proj_data_info)
+{
+  if (num_records == 0)
+    return;
+  // all records have the same map and scanner
+  const CListEventSAFIR& first_event = static_cast<const Derived&>(*records[0]);
+  if (first_event.map_sptr)
+    {
+      // uses LORs (with randomisation), so just call get_bin() (without going via the virtual function table)
+      for (std::size_t i = 0; i < num_records; ++i)
+        {
+          const Derived& record = static_cast<const Derived&>(*records[i]);
+          if (record.Derived::is_event())
+            record.CListEventSAFIR::get_bin(bins[i], proj_data_info);
+        }
+    }
+  else if (auto proj_data_info_ptr = dynamic_cast<const ProjDataInfoGenericNoArcCorr*>(&proj_data_info))
+    get_bins_for_records_using_det_pos(bins, records, num_records, first_event.map_to_use(), *proj_data_info_ptr);
+  else if (auto proj_data_info_ptr = dynamic_cast<const ProjDataInfoCylindricalNoArcCorr*>(&proj_data_info))
+    get_bins_for_records_using_det_pos(bins, records, num_records, first_event.map_to_use(), *proj_data_info_ptr);
+  else
+    error("Wrong type of proj-data-info for SAFIR");
+}
+
+template <class Derived>
+template <class ProjDataInfoT>
+void
+CListEventSAFIR<Derived>::get_bins_for_records_using_det_pos(Bin* bins,
+                                                             const ListRecord* const* records,
+                                                             const std::size_t num_records,
+                                                             const DetectorCoordinateMap& map,
+                                                             const ProjDataInfoT& proj_data_info)
+{
+  DetectionPositionPair<> det_pos_pair;
+  for (std::size_t i = 0; i < num_records; ++i)
+    {
+      const Derived& record = static_cast<const Derived&>(*records[i]);
+      if (!record.Derived::is_event())
+        continue;
+      record.get_data().get_detection_position_pair(det_pos_pair);
+      Bin& bin = bins[i];
+
+      // transform det_pos_pair into stir conventions
+      det_pos_pair.pos1() = map.get_det_pos_for_index(det_pos_pair.pos1());
+      det_pos_pair.pos2() = map.get_det_pos_for_index(det_pos_pair.pos2());
+
+      if (det_pos_pair.pos1().tangential_coord() == det_pos_pair.pos2().tangential_coord())
+        bin.set_bin_value(-1);
+      else if (proj_data_info.get_bin_for_det_pos_pair(bin, det_pos_pair) == Succeeded::yes)
+        bin.set_bin_value(1);
+      else
+        bin.set_bin_value(-1);
+    }
+}
+
 void
 CListEventDataSAFIR::get_detection_position_pair(DetectionPositionPair<>& det_pos_pair)
 {
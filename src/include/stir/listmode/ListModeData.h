@@ -2,7 +2,7 @@
     Copyright (C) 2003 - 2011-06-24, Hammersmith Imanet Ltd
     Copyright (C) 2011-07-01 - 2014, Kris Thielemans
     Copyright (C) 2019, National Physical Laboratory
-    Copyright (C) 2019, University College of London
+    Copyright (C) 2019, 2026, University College of London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -37,6 +37,7 @@ using ::time_t;
 
 START_NAMESPACE_STIR
 class ListRecord;
+class Bin;
 class Succeeded;
 class ExamInfo;
 
@@ -183,6 +184,42 @@ public:
     return get_next(event);
   }
 
+  //! Finds the bins for a number of records
+  /*! This is equivalent to
+      \code
+      for (std::size_t i = 0; i < num_records; ++i)
+        if (records[i]->is_event())
+          records[i]->event().get_bin(bins[i], proj_data_info);
+      \endcode
+      i.e. \c bins[i] is not modified if \c records[i] is not an event.
+
+      The default implementation does exactly this. Derived classes know the type of their
+      records, and override it to avoid the virtual function calls (and any checks on
+      \a proj_data_info) for every record.
+
+      \warning All records have to be created by get_empty_record_sptr() of this object.
+  */
+  virtual void get_bins_for_records(Bin* bins,
+                                    const ListRecord* const* records,
+                                    const std::size_t num_records,
+                                    const ProjDataInfo& proj_data_info) const;
+
+  //! Returns true if get_bins_for_records() can be called from multiple threads at the same time
+  /*! This is used to decide if events can be decoded in parallel (with records that are not shared
+      between threads). The default returns \c false, as we do not know if the decoding of a derived
+      class changes any state. Derived classes whose decoding only depends on the record and the
+      \c ProjDataInfo override this to return \c true.
+  */
+  virtual bool can_decode_records_in_parallel() const { return false; }
+
+  //! Enable or disable reading the data ahead in a background thread
+  /*! Some file formats read the next block of data in a background thread while the current
+      records are used. Callers that already call get_next_record() from a background thread
+      can disable this to avoid 2 nested levels of reading ahead. The default implementation
+      does nothing.
+  */
+  virtual void set_read_ahead(const bool) {}
+
   //! Call this function if you want to re-start reading at the beginning.
   virtual Succeeded reset() = 0;
 
@@ -18,7 +18,7 @@
     Copyright (C) 2000- 2009, Hammersmith Imanet Ltd
     Copyright (C) 2017, University of Hull
     Copyright (C) 2019, National Physical Laboratory
-    Copyright (C) 2019, 2021, University College of London
+    Copyright (C) 2019, 2021, 2026, University College of London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -37,6 +37,7 @@
 START_NAMESPACE_STIR
 
 class ListEvent;
+class ListRecord;
 class ListTime;
 
 /*!
@@ -86,6 +87,11 @@ class ListTime;
     store prompts := 1  ;default
     ; what to do if it's a delayed event
     store delayeds := 1  ;default
+    ; also store the prompts and delayeds in separate projection data
+    ; (with filenames output_filename_prefix_prompts_f1g1d0b0 etc), in the same pass
+    ; over the list-mode data. This needs 3 times as much memory for the segments
+    ; in memory (see num_segments_in_memory).
+    store separate prompts and delayeds := 0 ;default
 
 
   ; parameters related to normalisation
@@ -108,7 +114,8 @@ class ListTime;
     List event coordinates := 0
 
     ; if you're short of RAM (i.e. a single projdata does not fit into memory),
-    ; you can use this to process the list mode data in multiple passes.
+    ; you can use this to keep only some segments in memory. Events for the
+    ; other segments are then written to temporary files.
     num_segments_in_memory := -1
     ; same for TOF bins
     num_TOF_bins_in_memory := 1
@@ -145,6 +152,15 @@ class ListTime;
        not subtracted.
   </li>
   </ul>
+  Setting <tt>store separate prompts and delayeds</tt> additionally creates the
+  projection data for prompts only and delayeds only, such that all 3 are found with
+  one pass over the list-mode data. The segments (and TOF bins) that are kept in memory are then
+  needed for all 3 projection data, so memory usage is 3 times as large. Use
+  <tt>num_segments_in_memory</tt> to reduce it if necessary. The extra projection data are only
+  created when writing to file, i.e. not when set_output_projdata_sptr() is used.
+
+  All time frames are processed in a single pass over the list-mode data, and the
+  projection data of every frame are written when the frame ends.
 
   \par Notes for developers
 
@@ -152,6 +168,16 @@ class ListTime;
   virtual functions. If a derived class overloads these, the default behaviour
   might change. For example, get_bin_from_event() might do motion correction.
 
+  The list-mode data are read in blocks of records, and by default the events in
+  a block are decoded in parallel (using OpenMP, if the list-mode format supports it)
+  before the records are handled in order. A derived class whose get_bin_from_event() is not thread-safe, or depends on
+  the order in which it is called (e.g. on process_new_time_event()), has to
+  override can_decode_events_in_parallel().
+
+  The events are decoded via get_bins_from_records(), which calls get_bin_from_event() for
+  every event. Only for an object of this class itself (and without pre-normalisation), it
+  uses ListModeData::get_bins_for_records() to decode many events in one call.
+
   \todo Currently, there is no support for gating or energy windows. This
   could in principle be added by a derived class, but it would be better
   to do it here.
@@ -222,6 +248,12 @@ public:
   bool get_store_prompts() const;
   void set_store_delayeds(bool);
   bool get_store_delayeds() const;
+  //! Also store prompts and delayeds in separate projection data
+  /*! Only used when writing to file, i.e. it is ignored when set_output_projdata_sptr() is used.
+      Memory usage for the segments in memory is 3 times as large when this is enabled.
+  */
+  void set_store_separate_prompts_and_delayeds(bool);
+  bool get_store_separate_prompts_and_delayeds() const;
   //! Returns the last processed timestamp in the listmode file
   /*! This can be used to find the duration (in seconds) of the last time frame processed. */
   double get_last_processed_lm_rel_time() const;
@@ -265,6 +297,31 @@ protected:
     normalisation or angle info for a rotating scanner.*/
   virtual void get_bin_from_event(Bin& bin, const ListEvent&) const;
 
+  //! will be called to get the bins for a number of records
+  /*! This has to be equivalent to calling get_bin_from_event() for every record that is an
+    event, and should not modify the bins of the other records.
+
+    The default implementation calls get_bin_from_event() for every event. However, when
+    get_bin_from_event_is_default() returns \c true and there is no pre-normalisation, it uses
+    ListModeData::get_bins_for_records(), which avoids virtual function calls for every event.
+  */
+  virtual void get_bins_from_records(Bin* bins, const ListRecord* const* records, const std::size_t num_records) const;
+
+  //! Returns true if get_bin_from_event() is the implementation of LmToProjData
+  /*! This is used by get_bins_from_records() to decide if it can decode the events in one go.
+    A derived class that overrides get_bin_from_event() has to override this function to return \c false.
+  */
+  virtual bool get_bin_from_event_is_default() const;
+
+  //! Returns true if get_bin_from_event() can be called for several events in parallel
+  /*! If true, events will be decoded in parallel before the time events in the list-mode
+    data before them have been processed. Otherwise, get_bin_from_event() is called
+    for every event in the order of the list-mode data.
+
+    The default implementation returns ListModeData::can_decode_records_in_parallel().
+  */
+  virtual bool can_decode_events_in_parallel() const;
+
   //! A function that should return the number of uncompressed bins in the current bin
   /*! \todo it is not compatiable with e.g. HiDAC doesn't belong here anyway
       (more ProjDataInfo?)
@@ -295,6 +352,7 @@ protected:
   bool do_pre_normalisation;
   bool store_prompts;
   bool store_delayeds;
+  bool store_separate_prompts_and_delayeds;
 
   int num_segments_in_memory;
   int num_timing_poss_in_memory;
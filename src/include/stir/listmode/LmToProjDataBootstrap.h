@@ -83,6 +83,15 @@ protected:
   void start_new_time_frame(const unsigned int new_frame_num) override;
 
   void get_bin_from_event(Bin& bin, const ListEvent&) const override;
+  bool get_bin_from_event_is_default() const override
+  {
+    return false;
+  }
+  //! Returns false, as get_bin_from_event() uses a (single) random number generator
+  bool can_decode_events_in_parallel() const override
+  {
+    return false;
+  }
 
   // \name parsing variables
   //@{
@@ -21,8 +21,44 @@
 #define __stir_numerics_stir_fourier_h__
 #include "stir/VectorWithOffset.h"
 #include "stir/Array_complex_numbers.h"
+#include "stir/shared_ptr.h"
+#include <complex>
 START_NAMESPACE_STIR
 
+/*! \ingroup DFT
+  \brief Abstract base class for the implementation of the one-dimensional DFT of complex data
+
+  fourier_1d() uses this class for (one-dimensional) arrays of <tt>std::complex\<float\></tt>. As all
+  other DFT functions call fourier_1d() for their innermost dimension, a different FFT library
+  (e.g. FFTW or pocketfft) can be used by deriving from this class and calling set_fourier_backend().
+  The outer dimensions of multi-dimensional arrays are always handled by STIR's own implementation.
+*/
+class FourierBackend
+{
+public:
+  virtual ~FourierBackend() {}
+
+  //! Compute the DFT of the \a length elements starting at \a c in place
+  /*! The convention for \a sign is the same as for fourier_1d(). \a length is a power of 2.
+
+      This function can be called by several threads at the same time.
+  */
+  virtual void fourier_1d(std::complex<float>* c, const int length, const int sign) const = 0;
+};
+
+/*! \ingroup DFT
+  \brief Set the implementation of the DFT used by fourier_1d()
+
+  Passing a null pointer restores the default, i.e. STIR's own implementation.
+  \warning This function should not be called while DFTs are being computed by other threads.
+*/
+void set_fourier_backend(const shared_ptr<const FourierBackend>& backend_sptr);
+
+/*! \ingroup DFT
+  \brief Get the implementation of the DFT used by fourier_1d()
+*/
+const FourierBackend& get_fourier_backend();
+
 /*! \ingroup DFT
   \brief Compute multi-dimensional discrete fourier transform.
 
@@ -76,6 +112,10 @@ inverse_fourier(T& c, const int sign = 1)
   \warning Currently, the array has to be indexed from 0.
   \warning Currently, the length of the array has to be a power of 2.
 
+  One-dimensional arrays of <tt>std::complex\<float\></tt> are handled by get_fourier_backend().
+  In STIR's own implementation, the bit-reversal and complex exponentials needed for the DFT are
+  computed only once for every length and sign, and then reused (by all threads, without locking).
+
   The convention used is as follows.
   For a vector of length \a n, the result is
   \f[
@@ -153,6 +193,17 @@ inverse_fourier_1d(T& c, const int sign = 1)
 template <typename T>
 Array<1, std::complex<T>> fourier_1d_for_real_data(const Array<1, T>& c, const int sign = 1);
 
+/*! \ingroup DFT
+
+  \brief As fourier_1d_for_real_data(), but storing the result in an existing array.
+
+  This avoids allocating memory when \a result is reused for arrays of the same length
+  (e.g. when filtering all rows of a viewgram).
+  \see fourier_1d_for_real_data()
+*/
+template <typename T>
+void fourier_1d_for_real_data(Array<1, std::complex<T>>& result, const Array<1, T>& c, const int sign = 1);
+
 /*! \ingroup DFT
 
   \brief Compute the inverse of the one-dimensional discrete fourier transform of a real array (of even size).
@@ -173,6 +224,16 @@ Array<1, T> inverse_fourier_1d_for_real_data(const Array<1, std::complex<T>>& c,
 template <typename T>
 Array<1, T> inverse_fourier_1d_for_real_data_corrupting_input(Array<1, std::complex<T>>& c, const int sign);
 
+/*! \ingroup DFT
+
+  \brief As inverse_fourier_1d_for_real_data_corrupting_input(), but storing the result in an existing array.
+
+  \warning destroys values in (and resizes) \a c
+  \see inverse_fourier_1d_for_real_data()
+*/
+template <typename T>
+void inverse_fourier_1d_for_real_data_corrupting_input(Array<1, T>& result, Array<1, std::complex<T>>& c, const int sign = 1);
+
 /*! \ingroup DFT
 
   \brief Compute discrete fourier transform of a real array (with the last dimensions of even size).
@@ -200,6 +261,17 @@ Array<1, T> inverse_fourier_1d_for_real_data_corrupting_input(Array<1, std::comp
 template <int num_dimensions, typename T>
 Array<num_dimensions, std::complex<T>> fourier_for_real_data(const Array<num_dimensions, T>& c, const int sign = 1);
 
+/*! \ingroup DFT
+
+  \brief As fourier_for_real_data(), but storing the result in an existing array.
+
+  This avoids allocating memory when \a result is reused for arrays of the same sizes
+  (e.g. when filtering all viewgrams of a segment).
+  \see fourier_for_real_data()
+*/
+template <int num_dimensions, typename T>
+void fourier_for_real_data(Array<num_dimensions, std::complex<T>>& result, const Array<num_dimensions, T>& c, const int sign = 1);
+
 /*! \ingroup DFT
 
   \brief Compute the inverse of the discrete fourier transform of a real array (with the last dimension of even size).
@@ -221,6 +293,18 @@ template <int num_dimensions, typename T>
 Array<num_dimensions, T> inverse_fourier_for_real_data_corrupting_input(Array<num_dimensions, std::complex<T>>& c,
                                                                         const int sign = 1);
 
+/*! \ingroup DFT
+
+  \brief As inverse_fourier_for_real_data_corrupting_input(), but storing the result in an existing array.
+
+  \warning destroys values in (and resizes) \a c
+  \see inverse_fourier_for_real_data()
+*/
+template <int num_dimensions, typename T>
+void inverse_fourier_for_real_data_corrupting_input(Array<num_dimensions, T>& result,
+                                                    Array<num_dimensions, std::complex<T>>& c,
+                                                    const int sign = 1);
+
 /*! \ingroup DFT
   \brief Adds negative frequencies to the last dimension of a complex array by complex conjugation.
 
@@ -15,7 +15,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2018-2019, University College London
+    Copyright (C) 2018-2019, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -30,6 +30,10 @@
 #include "stir/shared_ptr.h"
 #include "stir/Bin.h"
 #include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include <vector>
+#ifdef STIR_OPENMP
+#  include <mutex>
+#endif
 
 START_NAMESPACE_STIR
 
@@ -140,6 +144,20 @@ public:
   /// Set data processor to use after back projection
   void set_post_data_processor(shared_ptr<DataProcessor<DiscretisedDensity<3, float>>> post_data_processor_sptr);
 
+  //! Set the maximum number of images used to accumulate the back projection of different OpenMP threads
+  /*! When there are many threads, using one image per thread can use a lot of memory.
+      Setting a smaller number limits the memory used. A thread then uses any image that is not
+      in use by another thread, and only waits if all images are in use.
+
+      By default (or when set to 0), every thread uses its own image, unless that would take more than
+      a quarter of the physical memory (if that can be determined), in which case fewer images are used.
+
+      This value is used by set_up(), so needs to be set before calling that function.
+      It is ignored when STIR is compiled without OpenMP.
+  */
+  void set_maximum_number_of_local_images(const int max_num_local_images);
+  int get_maximum_number_of_local_images() const;
+
   virtual BackProjectorByBin* clone() const = 0;
 
 protected:
@@ -173,6 +191,22 @@ protected:
                                    const int max_axial_pos_num,
                                    const int min_tangential_pos_num,
                                    const int max_tangential_pos_num);
+
+  //! Returns true if the derived class can back project all TOF bins of a LOR at once
+  /*! If so, back_project(const ProjData&, ...) calls actual_back_project_all_timing_positions() for TOF data.
+      Default returns \c false.
+  */
+  virtual bool can_fuse_timing_positions() const;
+
+  //! Back project the related viewgrams of all timing positions
+  /*! All elements of \a viewgrams_all_timing_positions correspond to the same view/segment numbers,
+      but a different timing position. The default implementation calls the old-style actual_back_project()
+      for every element.
+  */
+  virtual void
+  actual_back_project_all_timing_positions(DiscretisedDensity<3, float>&,
+                                           const std::vector<RelatedViewgrams<float>>& viewgrams_all_timing_positions);
+
   //! check if the argument is the same as what was used for set_up()
   /*! calls error() if anything is wrong.
 
@@ -194,6 +228,8 @@ protected:
   //! Clone of the density sptr set with set_up()
   shared_ptr<DiscretisedDensity<3, float>> _density_sptr;
   shared_ptr<DataProcessor<DiscretisedDensity<3, float>>> _post_data_processor_sptr;
+  //! see set_maximum_number_of_local_images()
+  int _max_num_local_images;
 
   void set_defaults() override;
   void initialise_keymap() override;
@@ -203,9 +239,27 @@ protected:
   shared_ptr<const ProjDataInfo> _proj_data_info_sptr;
 
 private:
+  //! calls check() and verifies that the viewgrams are related by the symmetries used
+  /*! calls error() if anything is wrong. */
+  void check_related_viewgrams(const RelatedViewgrams<float>& viewgrams) const;
+
+  //! checks the viewgrams, selects the image to back project into, and calls actual_back_project_all_timing_positions()
+  void back_project_all_timing_positions(const std::vector<RelatedViewgrams<float>>& viewgrams_all_timing_positions);
+
 #ifdef STIR_OPENMP
-  //! A vector of back projected images that will be used with openMP. There will be as many images as openMP threads
+  //! A vector of back projected images that will be used with openMP.
+  /*! There will be as many images as openMP threads, unless limited by set_maximum_number_of_local_images()
+      or the available memory. See lock_local_output_image().
+  */
   std::vector<shared_ptr<DiscretisedDensity<3, float>>> _local_output_image_sptrs;
+  //! One mutex per image in _local_output_image_sptrs, used when threads share an image
+  shared_ptr<std::vector<std::mutex>> _local_output_image_mutexes_sptr;
+  //! find an image in _local_output_image_sptrs that is not in use, lock its mutex and return its index
+  /*! Thread \c t first tries image \c t%size(), and then any other image. If all images are
+      in use, it waits for image \c t%size(). The image is allocated if necessary.
+      The caller needs to unlock the mutex.
+  */
+  int lock_local_output_image();
 #endif
 };
 
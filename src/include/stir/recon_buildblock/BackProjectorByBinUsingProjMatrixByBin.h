@@ -16,6 +16,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2009, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -79,6 +80,12 @@ protected:
   // currently not exposed, but leaving this ine for the future
   void actual_back_project(DiscretisedDensity<3, float>& image, const Bin& bin);
 
+  //! Returns true when caching is enabled in the projection matrix
+  bool can_fuse_timing_positions() const override;
+  //! Uses ProjMatrixByBin::back_project_all_timing_positions()
+  void actual_back_project_all_timing_positions(
+      DiscretisedDensity<3, float>& image, const std::vector<RelatedViewgrams<float>>& viewgrams_all_timing_positions) override;
+
 private:
   void set_defaults() override;
   void initialise_keymap() override;
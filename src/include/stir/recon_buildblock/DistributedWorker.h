@@ -33,13 +33,14 @@
 START_NAMESPACE_STIR
 
 class ExamInfo;
+class ProjMatrixByBin;
 
 /*!
   \ingroup distributable
   \brief This implements the Worker for the stir::distributable_computation() function.
 
   The start() method is an infinite loop waiting for a task from the master. Very few tasks
-  are implemented at the moment: set_up, compute, stop.
+  are implemented at the moment: set_up, compute, stop, and their list-mode equivalents.
 
   The \c distributable_computation() function does the actual work. It is the slave-part
   of stir::distributable_computation() which runs on the master.  It is a loop receiving the related
@@ -75,6 +76,16 @@ private:
   shared_ptr<ProjData> binwise_correction;
   shared_ptr<ProjData> mult_proj_data_sptr;
 
+  // list-mode variables
+  // these are kept separately from the ones above, such that the master can use
+  // distributable_computation() (e.g. for the sensitivity) in between list-mode computations
+  shared_ptr<ProjMatrixByBin> PM_sptr;
+  shared_ptr<ExamInfo> LM_exam_info_sptr;
+  shared_ptr<const ProjDataInfo> LM_proj_data_info_sptr;
+  shared_ptr<TargetT> LM_target_sptr;
+  int LM_image_buffer_size;
+  std::vector<BinAndCorr> record_cache;
+
   int my_rank; // rank of the worker
 
 public:
@@ -116,6 +127,22 @@ protected:
     \brief this does the actual computation corresponding to distributable_computation()
   */
   void distributable_computation(RPC_process_related_viewgrams_type* RPC_process_related_viewgrams);
+
+  /*!
+    \brief Get information for list-mode computations from the master.
+
+    This receives the target image, ProjDataInfo and projection matrix, see
+    setup_distributable_LM_computation().
+  */
+  void setup_distributable_LM_computation();
+  /*!
+    \brief this does the actual computation corresponding to the list-mode functions
+
+    Receives the current estimate (and other parameters) and batches of events
+    until the master calls end_distributable_LM_computation(), and then adds the result
+    to the master's.
+  */
+  void distributable_LM_computation(const int task_id);
 };
 
 END_NAMESPACE_STIR
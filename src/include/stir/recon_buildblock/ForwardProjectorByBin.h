@@ -19,7 +19,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2018-2019, University College London
+    Copyright (C) 2018-2019, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -33,6 +33,7 @@
 #include "stir/shared_ptr.h"
 #include "stir/Bin.h"
 #include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include <vector>
 
 START_NAMESPACE_STIR
 
@@ -148,6 +149,19 @@ protected:
                                       const int min_tangential_pos_num,
                                       const int max_tangential_pos_num);
 
+  //! Returns true if the derived class can forward project all TOF bins of a LOR at once
+  /*! If so, forward_project(ProjData&, ...) calls actual_forward_project_all_timing_positions() for TOF data.
+      Default returns \c false.
+  */
+  virtual bool can_fuse_timing_positions() const;
+
+  //! Forward project into the related viewgrams of all timing positions
+  /*! All elements of \a viewgrams_all_timing_positions correspond to the same view/segment numbers,
+      but a different timing position. The default implementation calls actual_forward_project() for
+      every element.
+  */
+  virtual void actual_forward_project_all_timing_positions(std::vector<RelatedViewgrams<float>>& viewgrams_all_timing_positions);
+
 #if 0 // disabled as currently not used. needs to be written in the new style anyway
     //! This virtual function has to be implemented by the derived class.
     virtual void actual_forward_project(Bin&,
@@ -182,6 +196,11 @@ protected:
 protected:
   //! ProjDataInfo set by set_up()
   shared_ptr<const ProjDataInfo> _proj_data_info_sptr;
+
+private:
+  //! calls check() and verifies that the viewgrams are related by the symmetries used
+  /*! calls error() if anything is wrong. */
+  void check_related_viewgrams(const RelatedViewgrams<float>& viewgrams) const;
 };
 
 END_NAMESPACE_STIR
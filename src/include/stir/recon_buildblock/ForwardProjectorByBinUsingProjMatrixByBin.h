@@ -19,6 +19,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2009, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -74,6 +75,11 @@ private:
                               const int min_tangential_pos_num,
                               const int max_tangential_pos_num) override;
 
+  //! Returns true when caching is enabled in the projection matrix
+  bool can_fuse_timing_positions() const override;
+  //! Uses ProjMatrixByBin::forward_project_all_timing_positions()
+  void actual_forward_project_all_timing_positions(std::vector<RelatedViewgrams<float>>& viewgrams_all_timing_positions) override;
+
 #if 0 // disabled as currently not used. needs to be written in the new style anyway
   void actual_forward_project(Bin&, const DiscretisedDensity<3,float>&);
 #endif
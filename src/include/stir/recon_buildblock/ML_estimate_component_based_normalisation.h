@@ -1,5 +1,5 @@
 /*
-    Copyright (C) 2022, University College London
+    Copyright (C) 2022, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -18,6 +18,7 @@
 START_NAMESPACE_STIR
 
 class ProjData;
+class ListModeData;
 
 /*!
  \brief Find normalisation factors using a maximum likelihood approach
@@ -35,4 +36,24 @@ void ML_estimate_component_based_normalisation(const std::string& out_filename_p
                                                bool do_KL,
                                                bool do_display);
 
+/*!
+ \brief Find normalisation factors using a maximum likelihood approach, using list mode data as measurement
+
+  \ingroup recon_buildblock
+
+  The fan data of the measurement are constructed directly from the prompts in the list mode data
+  (using FanProjDataAccumulator), i.e. without creating the sinogram first.
+  The list mode data have to correspond to span 1 (without view mashing).
+*/
+void ML_estimate_component_based_normalisation(const std::string& out_filename_prefix,
+                                               ListModeData& measured_data,
+                                               const ProjData& model_data,
+                                               int num_eff_iterations,
+                                               int num_iterations,
+                                               bool do_geo,
+                                               bool do_block,
+                                               bool do_symmetry_per_block,
+                                               bool do_KL,
+                                               bool do_display);
+
 END_NAMESPACE_STIR
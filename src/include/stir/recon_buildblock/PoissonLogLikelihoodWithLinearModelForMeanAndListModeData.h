@@ -103,10 +103,9 @@ public:
 
     Currently, the cached data is written to one or more files (\see get_cache_filename)
     \warning This code is experimental and likely to change in future versions.
-    \warning When re-using an existing cache, there is no check if time-frames etc are
-    the same as what was used when creating the cache. This is therefore quite risky.
-    \warning Cache-files are written in a binary format that likely depends on compiler, endianness etc.
-    \todo It should be possible to read only part of the cache in memory.
+    \warning When re-using an existing cache, only the frame number and number of subsets are checked
+    against what was used when creating the cache. This is therefore quite risky.
+    \warning Cache-files are written in a binary format that depends on endianness.
   */
   //@{
   //! Set the directory where data will be cached
@@ -3,7 +3,7 @@
 /*
     Copyright (C) 2003- 2011, Hammersmith Imanet Ltd
     Copyright (C) 2015, Univ. of Leeds
-    Copyright (C) 2016, 2022, 2024 UCL
+    Copyright (C) 2016, 2022, 2024, 2026 UCL
     Copyright (C) 2021, University of Pennsylvania
     SPDX-License-Identifier: Apache-2.0
 
@@ -33,6 +33,7 @@
 #include "stir/deprecated.h"
 #include "stir/recon_buildblock/distributable.h"
 #include "stir/error.h"
+#include <future>
 START_NAMESPACE_STIR
 
 /*!
@@ -51,6 +52,18 @@ START_NAMESPACE_STIR
   Currently, the subset scheme is the same for the projection data and listmode data, i.e.
   based on views. This is suboptimal for listmode data.
 
+  \par Event-driven TOF projection
+
+  For TOF data, the events are normally assigned to the (possibly mashed) timing positions of the
+  projection data, and the projection matrix caches a row for every timing position. When
+  set_use_event_tof_kernel() is used, the events keep the timing position of the scanner (i.e. without
+  TOF mashing), and the TOF kernel is applied to the cached geometric row for every event.
+  Only the geometric rows are cached, such that the cache is much smaller, while the timing resolution of
+  the events is not reduced by the mashing. As in SSRB(), an unmashed timing position belongs to the mashed
+  TOF bin that contains its centre. The additive term is taken from that (mashed) TOF bin of the additive data,
+  divided by the number of unmashed timing positions that belong to it.
+  The sensitivity is not affected.
+
   \todo implement a subset scheme based on events
 */
 
@@ -74,6 +87,11 @@ public:
 
   PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin();
 
+  //! Destructor
+  /*! Calls end_distributable_computation()
+   */
+  ~PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin() override;
+
   //! Computes the value of the objective function at the \a current_estimate.
   /*!
    \warning If <code>add_sensitivity = false</code> and <code>use_subset_sensitivities = false</code> will return an error
@@ -108,6 +126,23 @@ public:
 
   void set_skip_balanced_subsets(const bool arg);
 
+  //! Set if events in every batch should be sorted
+  /*! If \c true, the events in every batch are sorted on view, segment, axial and tangential position,
+    and timing position, and events in the same bin are merged (with the number of events as bin value).
+    This improves the use of the caches of the CPU and projection matrix, and avoids computing
+    the same LOR several times in one batch.
+
+    Note that the ordering of the summations changes, so results can differ due to rounding.
+  */
+  void set_sort_batches(const bool arg);
+  bool get_sort_batches() const;
+
+  //! Set if the TOF kernel is applied per event at the timing resolution of the scanner
+  /*! See the class documentation. This has no effect for non-TOF data. Needs to be called before set_up().
+   */
+  void set_use_event_tof_kernel(const bool arg);
+  bool get_use_event_tof_kernel() const;
+
 #if STIR_VERSION < 060000
   STIR_DEPRECATED
   void set_max_ring_difference(const int arg);
@@ -138,6 +173,11 @@ protected:
   //! Proj data info to be used for sensitivity calculations
   /*! This is set to non-TOF data if \c use_tofsens == \c false */
   shared_ptr<ProjDataInfo> sens_proj_data_info_sptr;
+  //! Keeps track of setup_distributable_computation() having been called for the sensitivity
+  mutable bool sensitivity_distributable_computation_already_setup;
+  //! Projection data filled with 1, used for the sensitivity computation of all subsets
+  /*! Allocated for the first subset, and released after the last one. */
+  mutable shared_ptr<ProjData> sens_proj_data_sptr;
 
   //! sets any default values
   void set_defaults() override;
@@ -151,41 +191,85 @@ protected:
   //! Scanner geometry, you can skip future checks.
   bool skip_balanced_subsets;
 
+  //! Sort (and merge) the events in every batch, see set_sort_batches()
+  bool sort_batches;
+
+  //! Apply the TOF kernel per event, see set_use_event_tof_kernel()
+  bool use_event_tof_kernel;
+  //! Projection matrix used for the events
+  /*! This is the same as \c PM_sptr, unless the TOF kernel is applied per event. */
+  shared_ptr<ProjMatrixByBin> event_PM_sptr;
+  //! Proj data info used to find the bins of the events
+  /*! This is the same as \c proj_data_info_sptr, unless the TOF kernel is applied per event, in which
+      case it has a TOF mashing factor of 1. */
+  shared_ptr<ProjDataInfo> event_proj_data_info_sptr;
+
 private:
   //! Cache of the current "batch" in the listmode file
   /*! \todo Move this higher-up in the hierarchy as it doesn't depend on ProjMatrixByBin
    */
   mutable std::vector<BinAndCorr> record_cache;
+  //! Cache of the next "batch", which is read in the background while \c record_cache is being used
+  mutable std::vector<BinAndCorr> next_record_cache;
+  //! Result of read_listmode_batch() for the batch that is being read in the background (if any)
+  mutable std::shared_future<bool> next_batch_future;
+  //! Number of the batch that is being read in the background
+  mutable unsigned int next_batch_num;
 
   //! This function loads the next "batch" of data from the listmode file.
   /*!
     This function will either use read_listmode_batch or load_listmode_cache_file.
 
+    When reading from the list-mode data, this function starts reading the next batch in
+    a separate thread before returning, such that reading and decoding the events overlaps
+    with the computations using the current batch. That thread uses a single OpenMP thread, such
+    that it does not compete with the (parallel) computations on the current batch.
+
     \param[in] ibatch the batch number to be read.
+    \param[in] subset_num the subset that will be used. When reading from the cache files, events
+       in other subsets might not be loaded. Use -1 to load all events.
     \return \c true if there are no more events to read after this call, \c false otherwise
     \todo Move this function higher-up in the hierarchy as it doesn't depend on ProjMatrixByBin
    */
-  bool load_listmode_batch(unsigned int ibatch) const;
+  bool load_listmode_batch(unsigned int ibatch, const int subset_num) const;
 
   //! This function reads the next "batch" of data from the listmode file.
   /*!
     This function keeps on reading from the current position in the list-mode data and stores
-    prompts events and additive terms in \c record_cache. It also updates \c end_time_per_batch
+    prompts events and additive terms in \a cache. It also updates \c end_time_per_batch
     such that we know when each batch starts/ends.
 
+    Records are read in blocks. While the events in one block are decoded (i.e. converted to
+    a Bin), the next block is read by another thread. Decoding is done in parallel (when using OpenMP)
+    if ListModeData::can_decode_records_in_parallel() returns \c true.
+
     \param[in] ibatch the batch number to be read.
+    \param[out] cache the events (and additive terms) in the batch.
     \return \c true if there are no more events to read after this call, \c false otherwise
     \todo Move this function higher-up in the hierarchy as it doesn't depend on ProjMatrixByBin
     \warning This function has to be called in sequence.
    */
-  bool read_listmode_batch(unsigned int ibatch) const;
+  bool read_listmode_batch(unsigned int ibatch, std::vector<BinAndCorr>& cache) const;
   //! This function caches the list-mode batches to file. It is run during set_up()
   /*! \todo Move this function higher-up in the hierarchy as it doesn't depend on ProjMatrixByBin
    */
   Succeeded cache_listmode_file();
 
   //! Reads the "batch" of data from the cache
-  bool load_listmode_cache_file(unsigned int file_id) const;
+  /*!
+    The cache file is memory-mapped. As events are sorted on subset in the file, only the events of
+    \a subset_num are loaded when the number of subsets is the same as when the file was written.
+    Files written by older versions of STIR (without header) can still be read.
+  */
+  bool load_listmode_cache_file(unsigned int file_id, const int subset_num) const;
+  //! Writes \c record_cache to file
+  /*!
+    Bin coordinates are packed into as few bytes as possible (typically 5 instead of 24), and events
+    are sorted on subset. The header contains the frame number and number of subsets, which
+    are checked when reading the file.
+    \warning The subsets of the events are determined with the symmetries of the projection matrix.
+    The cache needs to be recomputed when changing the number of subsets or the projection matrix symmetries.
+  */
   Succeeded write_listmode_cache_file(unsigned int file_id) const;
 
   unsigned int num_cache_files;
@@ -395,6 +395,30 @@ private:
 #endif
 };
 
+//! computes the sensitivity for one subset by calling distributable_computation()
+/*! \ingroup distributable
+    The back projection of the multiplicative factors (or of \a proj_dat if there is no normalisation) is
+    stored in \a sensitivity. Also used by the list-mode objective function.
+*/
+void distributable_sensitivity_computation(const shared_ptr<BackProjectorByBin>& back_projector_sptr,
+                                           const shared_ptr<DataSymmetriesForViewSegmentNumbers>& symmetries_sptr,
+                                           DiscretisedDensity<3, float>& sensitivity,
+                                           const DiscretisedDensity<3, float>& input_image,
+                                           const shared_ptr<ProjData>& proj_dat,
+                                           int subset_num,
+                                           int num_subsets,
+                                           int min_segment,
+                                           int max_segment,
+                                           bool zero_seg0_end_planes,
+                                           double* log_likelihood_ptr,
+                                           shared_ptr<ProjData> const& additive_binwise_correction,
+                                           shared_ptr<BinNormalisation> const& normalisation_sptr,
+                                           const double start_time_of_frame,
+                                           const double end_time_of_frame,
+                                           DistributedCachingInformation* caching_info_ptr,
+                                           int min_timing_pos_num,
+                                           int max_timing_pos_num);
+
 #ifdef STIR_MPI
 // made available to be called from DistributedWorker object
 RPC_process_related_viewgrams_type RPC_process_related_viewgrams_gradient;
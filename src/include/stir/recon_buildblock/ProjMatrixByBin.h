@@ -16,7 +16,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000-2009, Hammersmith Imanet Ltd
-    Copyright (C) 2013, 2015, 2022 University College London
+    Copyright (C) 2013, 2015, 2022, 2026 University College London
     Copyright (C) 2016, University of Hull
 
     This file is part of STIR.
@@ -30,14 +30,13 @@
 #include "stir/ParsingObject.h"
 #include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
 #include "stir/recon_buildblock/DataSymmetriesForBins.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinCache.h"
 #include "stir/shared_ptr.h"
 #include "stir/VectorWithOffset.h"
 #include "stir/TimedObject.h"
 #include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/numerics/FastErf.h"
 #include <cstdint>
-//#include <map>
-#include <unordered_map>
 #ifdef STIR_OPENMP
 #  include <omp.h>
 #endif
@@ -60,7 +59,8 @@ class Bin;
   This class provides essentially only 2 public members: a method to get a
   'row' of the matrix, and a method to get information on the symmetries.
 
-  Currently, the class provides for some (basic) caching.
+  Currently, the class provides for some caching, see ProjMatrixElemsForOneBinCache.
+  The cache is thread-safe, allows concurrent lookups, and can be limited in size.
   This functionality will probably be moved to a new class
   ProjMatrixByBinWithCache. (TODO)
 
@@ -70,10 +70,34 @@ class Bin;
   \verbatim
   disable caching := false
   store only basic bins in cache := true
+  maximum cache size in MB := 0
+  TOF kernel cut-off (in sigma) := 5.657
+  store TOF rows in cache := true
   \endverbatim
   The 2nd option allows to cache the whole matrix. This results in the fastest
   behaviour IF your system does not start swapping. The default choice caches
   only the 'basic' bins, and computes symmetry related bins from the 'basic' ones.
+
+  The 3rd option sets an (approximate) upper limit on the memory used by the cache.
+  When it is reached, rows that have not been used recently are removed from the cache.
+  A value of 0 means that the cache size is not limited.
+
+  The 4th option is only used for TOF data. Timing positions for which the TOF kernel is
+  further than this many standard deviations from a voxel are skipped for that voxel.
+  The default (\f$4\sqrt{2}\f$) corresponds to where \c erf is 1 in single precision.
+
+  The last option is only used for TOF data as well, when the TOF kernel is applied to the geometric
+  rows (see below). If set to \c false, only the geometric rows are cached, and the TOF kernel is
+  applied every time get_proj_matrix_elems_for_one_bin() is called.
+  This reduces the memory used by the cache by (up to) the number of timing positions.
+
+  \par TOF
+
+  For TOF data, the row for a bin is the geometric (non-TOF) row multiplied with the TOF kernel.
+  When caching is enabled, the geometric rows of basic bins are cached as well, such that
+  they are computed only once for all timing positions.
+  forward_project_all_timing_positions() and back_project_all_timing_positions() go one step
+  further and handle all timing positions of a LOR in one pass over the geometric row.
 */
 class ProjMatrixByBin : public RegisteredObject<ProjMatrixByBin>, public TimedObject
 {
@@ -109,6 +133,36 @@ public:
   calculate_proj_matrix_elems_for_one_bin.*/
   inline void get_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin&, const Bin&) const;
 
+  //! Get the row of the matrix without TOF kernel, i.e. the geometric part
+  /*! The timing position of the bin is ignored. For non-TOF data, this is the same as
+      get_proj_matrix_elems_for_one_bin(). */
+  void get_proj_matrix_elems_for_one_bin_without_tof(ProjMatrixElemsForOneBin&, const Bin&) const;
+
+  //! \name Projection of all timing positions of a LOR at once
+  /*! These functions get the geometric row only once, and evaluate the TOF kernel for every
+      element of the row for all timing positions within the cut-off (see set_tof_kernel_cut_off()).
+      This is faster than calling get_proj_matrix_elems_for_one_bin() for every timing position.
+
+      The timing position of \a bin is ignored. \a values is indexed by the timing position number,
+      and needs to have the range of the projection data (i.e. 0 to 0 for non-TOF data).
+      \a row is used as work space, such that memory allocations can be avoided.
+  */
+  //@{
+  void forward_project_all_timing_positions(VectorWithOffset<float>& values,
+                                            ProjMatrixElemsForOneBin& row,
+                                            const Bin& bin,
+                                            const DiscretisedDensity<3, float>& density) const;
+  void back_project_all_timing_positions(DiscretisedDensity<3, float>& density,
+                                         ProjMatrixElemsForOneBin& row,
+                                         const Bin& bin,
+                                         const VectorWithOffset<float>& values) const;
+  //@}
+
+  //! Set the range of the TOF kernel, in units of its standard deviation
+  /*! This needs to be called before set_up(). */
+  void set_tof_kernel_cut_off(const float num_sigmas);
+  float get_tof_kernel_cut_off() const;
+
 #if 0
   // TODO
   /*! \brief Facility to write the 'independent' part of the matrix to file.
@@ -125,20 +179,34 @@ public:
   const char * const file_name_without_extension);
   */
 
-  // void set_maximum_cache_size(const unsigned long size){;}
+  //! Set an (approximate) upper limit for the memory used by the cache (0 means no limit)
+  void set_maximum_cache_size(const std::size_t size_in_bytes);
+  std::size_t get_maximum_cache_size() const;
   /* TODO
   void set_subset_usage(const SubsetInfo&, const int num_access_times);
   */
   void enable_cache(const bool v = true);
   void store_only_basic_bins_in_cache(const bool v = true);
+  //! Store rows for TOF bins in the cache, or only the geometric rows (see class documentation)
+  void store_tof_rows_in_cache(const bool v = true);
 
   bool is_cache_enabled() const;
   bool does_cache_store_only_basic_bins() const;
+  bool does_cache_store_tof_rows() const;
 
   // void reserve_num_elements_in_cache(const std::size_t);
   //! Remove all elements from the cache
   void clear_cache() const;
 
+  //! \name Cache statistics
+  /*! Counters are reset by set_up(). */
+  //@{
+  std::size_t get_cache_size_in_bytes() const;
+  std::uint64_t get_num_cache_hits() const;
+  std::uint64_t get_num_cache_misses() const;
+  std::uint64_t get_num_cache_evictions() const;
+  //@}
+
 protected:
   shared_ptr<DataSymmetriesForBins> symmetries_sptr;
 
@@ -173,6 +241,11 @@ protected:
 
   bool cache_disabled;
   bool cache_stores_only_basic_bins;
+  bool cache_stores_tof_rows;
+  //! maximum cache size as set by the parser (0 means no limit)
+  double max_cache_size_in_MB;
+  //! range of the TOF kernel in number of sigmas
+  float tof_kernel_cut_off_in_sigma;
   //! If activated TOF reconstruction will be performed.
   bool tof_enabled;
 
@@ -181,8 +254,11 @@ protected:
    If it succeeds, it overwrites the ProjMatrixElemsForOneBin parameter and
    returns Succeeded::yes, otherwise it does not touch the ProjMatrixElemsForOneBin
    and returns Succeeded::false.
+
+   Use \a update_statistics=false when checking again after a miss, such that it is not counted twice
+   (see get_num_cache_misses()).
   */
-  Succeeded get_cached_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin&) const;
+  Succeeded get_cached_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin&, const bool update_statistics = true) const;
 
   //! We need a local copy of the discretised density in order to find the
   //! cartesian coordinates of each voxel.
@@ -195,7 +271,7 @@ protected:
   void cache_proj_matrix_elems_for_one_bin(const ProjMatrixElemsForOneBin&) const;
 
 private:
-  typedef std::uint64_t CacheKey;
+  typedef ProjMatrixElemsForOneBinCache::Key CacheKey;
   //! \name bit-field sizes for the cache key
   // note: sum needs to be less than  64 - 3  (for the 3 sign bits)
   //@{
@@ -203,16 +279,21 @@ private:
   const CacheKey axial_pos_bits = 28;
   const CacheKey timing_pos_bits = 20;
   //@}
-  //  typedef std::map<CacheKey, ProjMatrixElemsForOneBin>   MapProjMatrixElemsForOneBin;
-  typedef std::unordered_map<CacheKey, ProjMatrixElemsForOneBin> MapProjMatrixElemsForOneBin;
-  typedef MapProjMatrixElemsForOneBin::iterator MapProjMatrixElemsForOneBinIterator;
-  typedef MapProjMatrixElemsForOneBin::const_iterator const_MapProjMatrixElemsForOneBinIterator;
 
-  //! collection of  ProjMatrixElemsForOneBin (internal cache )
-  mutable VectorWithOffset<VectorWithOffset<MapProjMatrixElemsForOneBin>> cache_collection;
-#ifdef STIR_OPENMP
-  mutable VectorWithOffset<VectorWithOffset<omp_lock_t>> cache_locks;
-#endif
+  //! bit set in the cache key for rows without TOF kernel
+  /*! This is the only bit that is not used by the other fields (see cache_key()). */
+  const CacheKey without_tof_key_bit = static_cast<CacheKey>(1) << 63;
+
+  //! collection of  ProjMatrixElemsForOneBin (internal cache), with one shard per view/segment
+  mutable ProjMatrixElemsForOneBinCache cache;
+  //! \name info to find the shard in the cache for a bin
+  //@{
+  int cache_min_view_num;
+  int cache_min_segment_num;
+  int cache_num_segments;
+  //@}
+  //! find the shard in the cache for a bin
+  std::size_t cache_shard_index(const Bin& bin) const;
 
   //! create the key for caching
   // KT 15/05/2002 not static anymore as it uses cache_stores_only_basic_bins
@@ -227,6 +308,31 @@ private:
   float gauss_sigma_in_mm;
   //! 1/(2*sigma_in_mm)
   float r_sqrt2_gauss_sigma;
+  //! tof_kernel_cut_off_in_sigma/sqrt(2), i.e. the cut-off for the arguments of the erf
+  float tof_kernel_cut_off_for_erf;
+
+  //! Get the geometric row for the basic bin set in \a probabilities (from the cache if possible)
+  /*! The bin of \a probabilities (including its timing position) is not modified. */
+  void get_proj_matrix_elems_for_one_basic_bin_without_tof(ProjMatrixElemsForOneBin& probabilities) const;
+
+  //! Find the direction of the LOR and its middle, as used for the TOF kernel
+  void get_tof_geometry(CartesianCoordinate3D<float>& middle,
+                        CartesianCoordinate3D<float>& diff_unit_vector,
+                        const Bin& bin) const;
+  //! Find the range of timing positions within the cut-off for a point at \a d2 mm from the middle of the LOR
+  /*! The range can be empty (i.e. \a min_timing_pos_num > \a max_timing_pos_num). */
+  void get_tof_range(int& min_timing_pos_num, int& max_timing_pos_num, const float d2) const;
+  //! Find the coefficients to compute the distance to the middle of the LOR from the voxel indices
+  /*! The distance (as used for the TOF kernel) is <code>offset + inner_product(steps, indices)</code>.
+      This avoids finding the physical coordinates of every voxel. */
+  void get_tof_distance_coefficients(float& offset, BasicCoordinate<3, float>& steps, const Bin& bin) const;
+  //! Compute the TOF kernel for all timing positions within the cut-off for a point at \a d2 mm
+  /*! This evaluates the error function only once for every TOF bin boundary. Results are stored
+      in \a tof_values, which needs to have the range of all timing positions. */
+  void get_tof_values(VectorWithOffset<float>& tof_values,
+                      int& min_timing_pos_num,
+                      int& max_timing_pos_num,
+                      const float d2) const;
 
   //! The function which actually applies the TOF kernel on the LOR.
   inline void apply_tof_kernel(ProjMatrixElemsForOneBin& probabilities) const;
@@ -18,7 +18,7 @@
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2013, Hammersmith Imanet Ltd
     Copyright (C) 2016, University of Hull
-    Copyright (C) 2022 University College London
+    Copyright (C) 2022, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -52,6 +52,10 @@ ProjMatrixByBin::get_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& pro
   // set to empty
   probabilities.erase();
 
+  // if false, the TOF kernel is applied to the geometric row, and only the latter is cached
+  // (see get_proj_matrix_elems_for_one_basic_bin_without_tof())
+  const bool use_cache_for_row = cache_stores_tof_rows || !(proj_data_info_sptr->is_tof_data() && this->tof_enabled);
+
   if (cache_stores_only_basic_bins)
     {
       // find symmetry operator and basic bin
@@ -60,18 +64,23 @@ ProjMatrixByBin::get_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& pro
 
       probabilities.set_bin(basic_bin);
       // check if basic bin is in cache
-      if (get_cached_proj_matrix_elems_for_one_bin(probabilities) == Succeeded::no)
+      if (!use_cache_for_row || get_cached_proj_matrix_elems_for_one_bin(probabilities) == Succeeded::no)
         {
-          // basic bin is not in cache, compute lor probabilities for the basic bin
-          calculate_proj_matrix_elems_for_one_bin(probabilities);
-#ifndef NDEBUG
-          probabilities.check_state();
-#endif
           if (proj_data_info_sptr->is_tof_data() && this->tof_enabled)
-            { // Apply TOF kernel to basic bin
+            { // Apply TOF kernel to the geometric row of the basic bin
+              get_proj_matrix_elems_for_one_basic_bin_without_tof(probabilities);
               apply_tof_kernel(probabilities);
             }
-          cache_proj_matrix_elems_for_one_bin(probabilities);
+          else
+            {
+              // basic bin is not in cache, compute lor probabilities for the basic bin
+              calculate_proj_matrix_elems_for_one_bin(probabilities);
+#ifndef NDEBUG
+              probabilities.check_state();
+#endif
+            }
+          if (use_cache_for_row)
+            cache_proj_matrix_elems_for_one_bin(probabilities);
         }
 
       // now transform to original bin (inc. TOF)
@@ -81,7 +90,7 @@ ProjMatrixByBin::get_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& pro
     { // !cache_stores_only_basic_bins
       probabilities.set_bin(bin);
       // if bin is in the cache, get the probabilities
-      if (get_cached_proj_matrix_elems_for_one_bin(probabilities) == Succeeded::no)
+      if (!use_cache_for_row || get_cached_proj_matrix_elems_for_one_bin(probabilities) == Succeeded::no)
         {
           // bin probabilities not in the cache, check if basic bins are
           // find basic bin
@@ -90,22 +99,27 @@ ProjMatrixByBin::get_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& pro
           probabilities.set_bin(basic_bin);
 
           // check if basic bin is in cache
-          if (get_cached_proj_matrix_elems_for_one_bin(probabilities) == Succeeded::no)
+          if (!use_cache_for_row || get_cached_proj_matrix_elems_for_one_bin(probabilities) == Succeeded::no)
             {
-              // basic bin is not in cache, compute lor probabilities for the basic bin
-              calculate_proj_matrix_elems_for_one_bin(probabilities);
-#ifndef NDEBUG
-              probabilities.check_state();
-#endif
               if (proj_data_info_sptr->is_tof_data() && this->tof_enabled)
-                { // Apply TOF kernel to basic bin
+                { // Apply TOF kernel to the geometric row of the basic bin
+                  get_proj_matrix_elems_for_one_basic_bin_without_tof(probabilities);
                   apply_tof_kernel(probabilities);
                 }
+              else
+                {
+                  // basic bin is not in cache, compute lor probabilities for the basic bin
+                  calculate_proj_matrix_elems_for_one_bin(probabilities);
+#ifndef NDEBUG
+                  probabilities.check_state();
+#endif
+                }
             }
           // now transform basic bin probabilities into original bin probabilities
           symm_ptr->transform_proj_matrix_elems_for_one_bin(probabilities);
           // cache the probabilities for bin
-          cache_proj_matrix_elems_for_one_bin(probabilities);
+          if (use_cache_for_row)
+            cache_proj_matrix_elems_for_one_bin(probabilities);
         }
     }
   // stop_timers(); TODO, can't do this in a const member
@@ -115,16 +129,9 @@ void
 ProjMatrixByBin::apply_tof_kernel(ProjMatrixElemsForOneBin& probabilities) const
 {
 
-  LORInAxialAndNoArcCorrSinogramCoordinates<float> lor;
-  proj_data_info_sptr->get_LOR(lor, probabilities.get_bin());
-  const LORAs2Points<float> lor2(lor);
-  const CartesianCoordinate3D<float> point1 = lor2.p1();
-  const CartesianCoordinate3D<float> point2 = lor2.p2();
-
-  // The direction can be from 1 -> 2 depending on the bin sign.
-  const CartesianCoordinate3D<float> middle = (point1 + point2) * 0.5f;
-  const CartesianCoordinate3D<float> diff = point2 - middle;
-  const CartesianCoordinate3D<float> diff_unit_vector(diff / static_cast<float>(norm(diff)));
+  CartesianCoordinate3D<float> middle;
+  CartesianCoordinate3D<float> diff_unit_vector;
+  get_tof_geometry(middle, diff_unit_vector, probabilities.get_bin());
 
   for (ProjMatrixElemsForOneBin::iterator element_ptr = probabilities.begin(); element_ptr != probabilities.end(); ++element_ptr)
     {
@@ -146,7 +153,8 @@ ProjMatrixByBin::get_tof_value(const float d1, const float d2) const
   const float d1_n = d1 * r_sqrt2_gauss_sigma;
   const float d2_n = d2 * r_sqrt2_gauss_sigma;
 
-  if ((d1_n >= 4.f && d2_n >= 4.f) || (d1_n <= -4.f && d2_n <= -4.f))
+  if ((d1_n >= tof_kernel_cut_off_for_erf && d2_n >= tof_kernel_cut_off_for_erf)
+      || (d1_n <= -tof_kernel_cut_off_for_erf && d2_n <= -tof_kernel_cut_off_for_erf))
     return 0.F;
   else
     return static_cast<float>(0.5 * (erf_interpolation(d2_n) - erf_interpolation(d1_n)));
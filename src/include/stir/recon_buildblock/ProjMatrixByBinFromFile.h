@@ -26,8 +26,17 @@
 #include "stir/CartesianCoordinate3D.h"
 #include "stir/IndexRange.h"
 #include "stir/shared_ptr.h"
+#include <cstdint>
 #include <iostream>
 
+namespace boost
+{
+namespace interprocess
+{
+class mapped_region;
+}
+} // namespace boost
+
 START_NAMESPACE_STIR
 
 template <int num_dimensions, typename elemT>
@@ -37,10 +46,26 @@ class Bin;
   \ingroup projection
   \brief Reads/writes a projection matrix from/to file
 
-  The only supported file format consists of an Interfile-type header
+  The file format consists of an Interfile-type header
   and a binary file which stores the 'basic' elements in a sparse form,
   i.e. only the elements that cannot by constructed via symmetries.
 
+  Two versions of the binary file are supported:
+  - Version 1.0 stores every element with its voxel coordinates and (float) value.
+    The whole file is read into the cache during set_up(), so caching cannot be disabled.
+  - Version 2.0 is a compressed and indexed format. For every LOR, the voxel coordinates
+    are stored as variable-length differences of linear voxel indices, and the values
+    are quantised to 16 bits (relative to the maximum value in the LOR). An index
+    (sorted on the bin coordinates) is stored at the end of the file. The file is
+    memory-mapped and LORs are only decoded when they are needed. Therefore,
+    set_up() is fast and several processes reading the same file on one machine
+    share the memory (via the page cache of the operating system). You will
+    probably want to set <tt>disable caching:=1</tt>, or limit the cache size, to
+    benefit from this.
+
+  The quantisation in version 2.0 results in a relative error of at most
+  1/131070 of the maximum value in each LOR.
+
   \todo this class currently only works with VoxelsOnCartesianGrid.
   To fix this, we would need a DiscretisedDensityInfo class, and be able
   to have constructed the appropriate symmetries object by parsing the
@@ -78,11 +103,14 @@ public:
   /*! Currently this will write an interfile-type header, a file with the binary data,
       a template image and template sinogram. You will need all 4 to be able to read the
       matrix back in.
+
+      \param format_version has to be "1.0" or "2.0" (compressed format), see the class documentation.
   */
   static Succeeded write_to_file(const std::string& output_filename_prefix,
                                  const ProjMatrixByBin& proj_matrix,
                                  const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
-                                 const DiscretisedDensity<3, float>& template_density);
+                                 const DiscretisedDensity<3, float>& template_density,
+                                 const std::string& format_version = "1.0");
 
   //! Default constructor (calls set_defaults())
   ProjMatrixByBinFromFile();
@@ -116,6 +144,13 @@ private:
 
   shared_ptr<const ProjDataInfo> proj_data_info_ptr;
 
+  //! memory-mapped data for version 2.0
+  shared_ptr<boost::interprocess::mapped_region> mapped_data_sptr;
+  //! number of LORs in the index for version 2.0
+  std::uint64_t num_lors_in_index;
+  //! start of the index in the memory-mapped data for version 2.0
+  const char* index_ptr;
+
   void calculate_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin&) const override;
 
   void set_defaults() override;
@@ -123,6 +158,8 @@ private:
   bool post_processing() override;
 
   Succeeded read_data();
+  //! map and check the data file for version 2.0
+  Succeeded map_compressed_data();
 };
 
 END_NAMESPACE_STIR
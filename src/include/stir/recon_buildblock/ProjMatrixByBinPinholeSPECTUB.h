@@ -264,7 +264,9 @@ private:
       psf_aux; // structure for total psf distribution: mid resolution auxiliar for convolution (bidimensional)
   mutable SPECTUB_mph::psf2d_type kern; // structure for intrinsic psf distribution: mid resolution (bidimensional)
 
-  void compute_one_subset(const int kOS) const;
+  //! compute all rows of a view and store them in the cache
+  /*! If \a lor_ptr is not null, the row for its bin is copied into it as well. */
+  void compute_one_subset(const int kOS, ProjMatrixElemsForOneBin* lor_ptr = nullptr) const;
   void delete_PinholeSPECTUB_arrays();
 };
 
@@ -202,7 +202,9 @@ private:
 
   int maxszb;
 
-  void compute_one_subset(const int kOS, const float* Rrad) const;
+  //! compute all rows of a subset and store them in the cache
+  /*! If \a lor_ptr is not null, the row for its bin is copied into it as well. */
+  void compute_one_subset(const int kOS, const float* Rrad, ProjMatrixElemsForOneBin* lor_ptr = nullptr) const;
   void delete_UB_SPECT_arrays();
   mutable std::vector<bool> subset_already_processed;
 };
@@ -0,0 +1,147 @@
+/*!
+
+  \file
+  \ingroup projection
+  \brief Declaration of class stir::ProjMatrixElemsForOneBinCache
+*/
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+
+#ifndef __stir_recon_buildblock_ProjMatrixElemsForOneBinCache_H__
+#define __stir_recon_buildblock_ProjMatrixElemsForOneBinCache_H__
+
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/Succeeded.h"
+#include "stir/unique_ptr.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup projection
+  \brief A thread-safe, sharded and optionally memory-bounded cache of ProjMatrixElemsForOneBin objects
+
+  This class is used by ProjMatrixByBin to store rows of the matrix. Entries are identified by
+  a shard index and a 64-bit key. ProjMatrixByBin uses one shard per (view,segment) pair.
+
+  Each shard has its own std::shared_mutex. Lookups only take a shared lock, such that
+  many threads can read from the same shard concurrently. Insertions and evictions take
+  an exclusive lock on one shard at a time.
+
+  If a maximum size is set (see set_max_size_in_bytes()), entries are evicted when an insertion
+  would exceed the budget. The eviction policy is a CLOCK (or "second chance") algorithm:
+  every lookup marks the entry as referenced, and eviction skips (and unmarks) referenced
+  entries once before removing them. A shared "clock hand" moves over the shards in round-robin
+  fashion, such that every shard loses entries at a similar rate.
+
+  The memory budget is enforced approximately. Concurrent insertions can exceed it slightly.
+  The size of an entry is estimated from the number of elements in the row plus some
+  book-keeping overhead.
+
+  The class keeps counters for hits, misses and evictions.
+
+  \warning set_up() is not thread-safe.
+*/
+class ProjMatrixElemsForOneBinCache
+{
+public:
+  typedef std::uint64_t Key;
+
+  //! Default constructor creates a cache without shards and without memory limit
+  ProjMatrixElemsForOneBinCache();
+
+  //! Copy constructor copies the settings and all entries (but not the statistics)
+  ProjMatrixElemsForOneBinCache(const ProjMatrixElemsForOneBinCache&);
+  ProjMatrixElemsForOneBinCache& operator=(const ProjMatrixElemsForOneBinCache&);
+
+  ~ProjMatrixElemsForOneBinCache();
+
+  //! Allocates \a num_shards (empty) shards and resets the statistics
+  void set_up(const std::size_t num_shards);
+
+  //! Set the memory budget. 0 means no limit.
+  /*! If the new limit is smaller than the current size, entries will be evicted
+      at the next insertion. */
+  void set_max_size_in_bytes(const std::size_t max_size_in_bytes);
+  std::size_t get_max_size_in_bytes() const;
+
+  //! Get the (estimated) amount of memory used by the entries
+  std::size_t get_size_in_bytes() const;
+  //! Get the number of entries
+  std::size_t get_num_entries() const;
+  std::size_t get_num_shards() const;
+
+  //! Get a copy of the entry if it is present
+  /*! If the entry is not present, \a elems is not modified and Succeeded::no is returned.
+
+      If \a update_statistics is \c false, the lookup is not counted as a hit or miss (and does
+      not mark the entry as referenced). This is useful to check again after a miss.
+  */
+  Succeeded
+  get(ProjMatrixElemsForOneBin& elems, const std::size_t shard_index, const Key key, const bool update_statistics = true) const;
+
+  //! Store a copy of \a elems
+  /*! If the key is already present, nothing happens. If the row is larger than the
+      memory budget, it is not stored. */
+  void insert(const ProjMatrixElemsForOneBin& elems, const std::size_t shard_index, const Key key);
+
+  //! Remove all entries (but keep the shards and statistics)
+  void clear();
+
+  //! \name Statistics
+  //@{
+  std::uint64_t get_num_hits() const;
+  std::uint64_t get_num_misses() const;
+  std::uint64_t get_num_evictions() const;
+  void reset_statistics();
+  //@}
+
+  //! Estimate the amount of memory taken by an entry
+  static std::size_t estimate_size_in_bytes(const ProjMatrixElemsForOneBin&);
+
+private:
+  struct Entry
+  {
+    explicit Entry(const ProjMatrixElemsForOneBin& elems_v);
+    ProjMatrixElemsForOneBin elems;
+    std::size_t size_in_bytes;
+    //! set on lookup, cleared by the eviction "clock"
+    mutable std::atomic<bool> referenced;
+  };
+  struct Shard
+  {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<Key, Entry> entries;
+    //! keys in order of insertion, used as the circular list of the CLOCK algorithm
+    std::deque<Key> clock;
+  };
+
+  std::vector<unique_ptr<Shard>> shards;
+  std::size_t max_size_in_bytes;
+  std::atomic<std::size_t> size_in_bytes;
+  std::atomic<std::size_t> num_entries;
+  std::atomic<std::size_t> clock_hand;
+  mutable std::atomic<std::uint64_t> num_hits;
+  mutable std::atomic<std::uint64_t> num_misses;
+  std::atomic<std::uint64_t> num_evictions;
+
+  //! Try to evict one entry from the shard
+  Succeeded evict_one_entry(Shard& shard);
+  //! Evict entries until \a num_bytes fit in the budget (or nothing can be evicted anymore)
+  void make_room(const std::size_t num_bytes);
+};
+
+END_NAMESPACE_STIR
+
+#endif
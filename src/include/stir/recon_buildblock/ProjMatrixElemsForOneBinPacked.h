@@ -0,0 +1,153 @@
+/*!
+
+  \file
+  \ingroup projection
+
+  \brief Declaration of class stir::ProjMatrixElemsForOneBinPacked
+
+*/
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+
+#ifndef __stir_recon_buildblock_ProjMatrixElemsForOneBinPacked__
+#define __stir_recon_buildblock_ProjMatrixElemsForOneBinPacked__
+
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinValue.h"
+#include "stir/BasicCoordinate.h"
+#include "stir/Bin.h"
+#include <vector>
+
+START_NAMESPACE_STIR
+
+class ProjMatrixElemsForOneBin;
+template <int num_dimensions, typename elemT>
+class DiscretisedDensity;
+
+/*!
+  \ingroup projection
+  \brief A "struct-of-arrays" version of ProjMatrixElemsForOneBin, optimised for projection
+
+  ProjMatrixElemsForOneBin stores an array of (coordinates, value) objects. This class
+  stores the same information as 4 separate arrays (one per coordinate, and one for the values).
+  This has the following advantages:
+  - symmetry operations can be applied to all elements at once (see
+    SymmetryOperation::transform_packed_proj_matrix_elems_for_one_bin()), and
+    the compiler can vectorise the loops.
+  - forward and back projection compute the linear offset of every voxel in the
+    (contiguous) image and use that to access the image data, which the compiler can
+    vectorise into gather/scatter instructions.
+
+  The projection kernels need some information about the image, which is stored in a
+  ProjMatrixElemsForOneBinPacked::DensityInfo object. As computing this info is not
+  free, it is recommended to construct it once for every image, and pass it to
+  forward_project() and back_project().
+
+  The order of the elements is the same as in the ProjMatrixElemsForOneBin object used to
+  construct this object. As for ProjMatrixElemsForOneBin, every voxel should occur only once.
+  (This is relied upon by back_project()).
+*/
+class ProjMatrixElemsForOneBinPacked
+{
+public:
+  typedef ProjMatrixElemsForOneBinValue value_type;
+  typedef std::vector<float>::size_type size_type;
+
+  /*!
+    \brief Information on an image needed for the projection kernels
+
+    If the image is contiguous and has a regular range, the kernels use its data via a
+    pointer. Otherwise, a slower version using the usual indexing is used.
+  */
+  class DensityInfo
+  {
+  public:
+    explicit DensityInfo(const DiscretisedDensity<3, float>& density);
+
+    //! true if the image is contiguous in memory and has a regular range
+    bool is_contiguous_and_regular() const { return contiguous_and_regular; }
+    const BasicCoordinate<3, int>& get_min_indices() const { return min_indices; }
+    const BasicCoordinate<3, int>& get_max_indices() const { return max_indices; }
+
+  private:
+    friend class ProjMatrixElemsForOneBinPacked;
+    bool contiguous_and_regular;
+    BasicCoordinate<3, int> min_indices;
+    BasicCoordinate<3, int> max_indices;
+    //! distance in memory between 2 consecutive planes and rows
+    int stride1, stride2;
+  };
+
+  //! constructor of an empty row
+  explicit ProjMatrixElemsForOneBinPacked(const Bin& bin = Bin());
+
+  //! constructor from a ProjMatrixElemsForOneBin (effectively calls set_from())
+  explicit ProjMatrixElemsForOneBinPacked(const ProjMatrixElemsForOneBin& lor);
+
+  //! copy all elements and the bin from \a lor
+  void set_from(const ProjMatrixElemsForOneBin& lor);
+
+  //! copy all elements and the bin to \a lor (which is overwritten)
+  void get_all(ProjMatrixElemsForOneBin& lor) const;
+
+  //! get the bin coordinates corresponding to this row
+  inline const Bin& get_bin() const;
+  //! and set the bin coordinates
+  inline void set_bin(const Bin&);
+
+  //! number of non-zero elements
+  inline size_type size() const;
+  //! reset to 0 length
+  void erase();
+  //! reserve enough space for \a max_number elements
+  void reserve(size_type max_number);
+  //! add a new element at the end
+  inline void push_back(const value_type&);
+  //! get an element (slow)
+  inline value_type get_element(const size_type i) const;
+
+  //! \name direct access to the data, e.g. for symmetry operations
+  //@{
+  //! get a pointer to the first coordinate (\a dim=1), second (\a dim=2) or third (\a dim=3) coordinate of all elements
+  inline short* get_coords_ptr(const int dim);
+  inline const short* get_coords_ptr(const int dim) const;
+  //! get a pointer to the values of all elements
+  inline float* get_values_ptr();
+  inline const float* get_values_ptr() const;
+  //@}
+
+  //******************** projection operations ********************//
+
+  //! forward project into a single bin (accumulates)
+  /*! Elements outside the axial range of the image are ignored. */
+  void forward_project(Bin&, const DiscretisedDensity<3, float>&, const DensityInfo&) const;
+  //! back project a single bin (accumulates)
+  /*! Elements outside the axial range of the image are ignored. */
+  void back_project(DiscretisedDensity<3, float>&, const Bin&, const DensityInfo&) const;
+
+  //! forward project into a single bin (accumulates), constructing the DensityInfo first
+  void forward_project(Bin&, const DiscretisedDensity<3, float>&) const;
+  //! back project a single bin (accumulates), constructing the DensityInfo first
+  void back_project(DiscretisedDensity<3, float>&, const Bin&) const;
+
+private:
+  Bin bin;
+  std::vector<short> coords1;
+  std::vector<short> coords2;
+  std::vector<short> coords3;
+  std::vector<float> values;
+
+  //! check if all coordinates are within the range of the image
+  bool is_inside(const DensityInfo&) const;
+};
+
+END_NAMESPACE_STIR
+
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinPacked.inl"
+
+#endif
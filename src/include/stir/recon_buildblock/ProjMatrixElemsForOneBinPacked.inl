@@ -0,0 +1,81 @@
+/*!
+
+  \file
+  \ingroup projection
+
+  \brief Inline implementations for class stir::ProjMatrixElemsForOneBinPacked
+
+*/
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+
+#include "stir/Coordinate3D.h"
+
+START_NAMESPACE_STIR
+
+const Bin&
+ProjMatrixElemsForOneBinPacked::get_bin() const
+{
+  return bin;
+}
+
+void
+ProjMatrixElemsForOneBinPacked::set_bin(const Bin& new_bin)
+{
+  bin = new_bin;
+}
+
+ProjMatrixElemsForOneBinPacked::size_type
+ProjMatrixElemsForOneBinPacked::size() const
+{
+  return values.size();
+}
+
+void
+ProjMatrixElemsForOneBinPacked::push_back(const value_type& el)
+{
+  coords1.push_back(static_cast<short>(el.coord1()));
+  coords2.push_back(static_cast<short>(el.coord2()));
+  coords3.push_back(static_cast<short>(el.coord3()));
+  values.push_back(el.get_value());
+}
+
+ProjMatrixElemsForOneBinPacked::value_type
+ProjMatrixElemsForOneBinPacked::get_element(const size_type i) const
+{
+  return value_type(Coordinate3D<int>(coords1[i], coords2[i], coords3[i]), values[i]);
+}
+
+short*
+ProjMatrixElemsForOneBinPacked::get_coords_ptr(const int dim)
+{
+  assert(dim >= 1 && dim <= 3);
+  return dim == 1 ? coords1.data() : dim == 2 ? coords2.data() : coords3.data();
+}
+
+const short*
+ProjMatrixElemsForOneBinPacked::get_coords_ptr(const int dim) const
+{
+  assert(dim >= 1 && dim <= 3);
+  return dim == 1 ? coords1.data() : dim == 2 ? coords2.data() : coords3.data();
+}
+
+float*
+ProjMatrixElemsForOneBinPacked::get_values_ptr()
+{
+  return values.data();
+}
+
+const float*
+ProjMatrixElemsForOneBinPacked::get_values_ptr() const
+{
+  return values.data();
+}
+
+END_NAMESPACE_STIR
@@ -30,6 +30,7 @@ template <int num_dimensions, class coordT>
 class BasicCoordinate;
 class ViewSegmentNumbers;
 class ProjMatrixElemsForOneBin;
+class ProjMatrixElemsForOneBinPacked;
 class ProjMatrixElemsForOneDensel;
 class Bin;
 
@@ -74,6 +75,9 @@ public:
 
   virtual void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const;
 
+  //! Transform all elements of a ProjMatrixElemsForOneBinPacked (and its bin)
+  virtual void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const;
+
   virtual void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const;
 };
 
@@ -90,6 +94,7 @@ public:
   inline void transform_view_segment_indices(ViewSegmentNumbers& n) const override {}
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override {}
   inline void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override {}
+  inline void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override {}
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override {}
 };
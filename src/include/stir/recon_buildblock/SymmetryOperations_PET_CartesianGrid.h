@@ -18,7 +18,8 @@
   implementations will be called.
 
   All these classes have transform_proj_matrix_elems_for_one_bin()
-  members which essentially repeats just the default
+  and transform_packed_proj_matrix_elems_for_one_bin()
+  members which essentially repeat just the default
   implementation. This is for efficiency. See
   recon_buildblock/SymmetryOperations_PET_CartesianGrid.cxx for
   more info.
@@ -61,6 +62,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -87,6 +89,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -120,6 +123,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -151,6 +155,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -178,6 +183,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -204,6 +210,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -230,6 +237,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -256,6 +264,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -283,6 +292,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -314,6 +324,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -345,6 +356,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -372,6 +384,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -398,6 +411,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -425,6 +439,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -452,6 +467,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -482,6 +498,7 @@ public:
   inline void transform_image_coordinates(BasicCoordinate<3, int>& c) const override;
 
   void transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const override;
+  void transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const override;
 
   void transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel&) const override;
 
@@ -55,6 +55,10 @@ const int task_setup_distributable_computation = 200;
 const int task_do_distributable_gradient_computation = 42;
 const int task_do_distributable_loglikelihood_computation = 43;
 const int task_do_distributable_sensitivity_computation = 44;
+const int task_setup_distributable_LM_computation = 100;
+const int task_do_distributable_LM_gradient_computation = 45;
+const int task_do_distributable_LM_loglikelihood_computation = 46;
+const int task_do_distributable_LM_Hessian_computation = 47;
 //!@}
 
 //! set-up parameters before calling distributable_computation()
@@ -204,6 +208,91 @@ void LM_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
                                   double* double_out_ptr,
                                   CallBackT&& call_back);
 
+//! computes the list-mode gradient (without the sensitivity term) for the events in \a record_cache
+/*! \ingroup distributable
+  Calls LM_distributable_computation() with the appropriate call-back.
+*/
+void LM_gradient_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
+                                           const shared_ptr<ProjDataInfo>& proj_data_info_sptr,
+                                           DiscretisedDensity<3, float>* output_image_ptr,
+                                           const DiscretisedDensity<3, float>* input_image_ptr,
+                                           const std::vector<BinAndCorr>& record_cache,
+                                           const int subset_num,
+                                           const int num_subsets,
+                                           const bool has_add,
+                                           const bool accumulate,
+                                           double* value_ptr);
+
+//! accumulates the list-mode log-likelihood (without the sensitivity term) for the events in \a record_cache into \a *value_ptr
+/*! \ingroup distributable
+  Calls LM_distributable_computation() with the appropriate call-back.
+*/
+void LM_value_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
+                                        const shared_ptr<ProjDataInfo>& proj_data_info_sptr,
+                                        const DiscretisedDensity<3, float>* input_image_ptr,
+                                        const std::vector<BinAndCorr>& record_cache,
+                                        const int subset_num,
+                                        const int num_subsets,
+                                        const bool has_add,
+                                        double* value_ptr);
+
+//! accumulates the list-mode Hessian times \a *rhs_ptr for the events in \a record_cache into \a *output_image_ptr
+/*! \ingroup distributable
+  Calls LM_distributable_computation() with the appropriate call-back.
+*/
+void LM_Hessian_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
+                                          const shared_ptr<ProjDataInfo>& proj_data_info_sptr,
+                                          DiscretisedDensity<3, float>* output_image_ptr,
+                                          const DiscretisedDensity<3, float>* input_image_ptr,
+                                          const DiscretisedDensity<3, float>* rhs_ptr,
+                                          const std::vector<BinAndCorr>& record_cache,
+                                          const int subset_num,
+                                          const int num_subsets,
+                                          const bool has_add,
+                                          const bool accumulate);
+
+/*! \name Functions to distribute list-mode computations over MPI processes
+  \ingroup distributable
+
+  These functions are empty unless STIR_MPI is defined. In that case, they send
+  the necessary information to the workers (see stir::DistributedWorker), which then
+  process part of the events of every batch (using OpenMP threads if enabled).
+  The sequence of calls by the master is:
+  - setup_distributable_LM_computation() (once, after the projection matrix has been set-up)
+  - for every computation:
+    - start_distributable_LM_computation()
+    - for every batch of events: distribute_LM_events(), and process the remaining events
+    - end_distributable_LM_computation(), which adds the results of the workers to those of the master.
+*/
+//!@{
+//! send the projection matrix and image and data characteristics to the workers
+void setup_distributable_LM_computation(const shared_ptr<ProjMatrixByBin>& PM_sptr,
+                                        const shared_ptr<const ExamInfo>& exam_info_sptr,
+                                        const shared_ptr<const ProjDataInfo> proj_data_info_sptr,
+                                        const shared_ptr<const DiscretisedDensity<3, float>>& target_sptr);
+
+//! start a computation on the workers
+/*!
+  \param task_id one of the list-mode task-ids
+  \param input_image_ptr current image estimate
+  \param rhs_ptr image to multiply with the Hessian (only used for the Hessian computation)
+*/
+void start_distributable_LM_computation(const int task_id,
+                                        const DiscretisedDensity<3, float>* input_image_ptr,
+                                        const DiscretisedDensity<3, float>* rhs_ptr,
+                                        const int subset_num,
+                                        const int num_subsets,
+                                        const bool has_add);
+
+//! send part of the events to the workers
+/*! The events that are not sent remain in \a record_cache, such that the master can process those. */
+void distribute_LM_events(std::vector<BinAndCorr>& record_cache);
+
+//! finish the computation and add the results of the workers to \a *output_image_ptr and \a *double_out_ptr
+/*! Pointers should be null if the corresponding output is not computed. */
+void end_distributable_LM_computation(DiscretisedDensity<3, float>* output_image_ptr, double* double_out_ptr);
+//!@}
+
 /*! \name Tag-names currently used by stir::distributable_computation and related functions
    \ingroup distributable
 */
@@ -56,8 +56,6 @@ LM_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
   HighResWallClockTimer wall_clock_timer;
   wall_clock_timer.start();
 
-  assert(!record_ptr.empty());
-
   if (output_image_ptr != NULL && !accumulate)
     output_image_ptr->fill(0.F);
 
@@ -77,6 +77,8 @@
 #include "stir/Viewgram.h"
 #include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/ProjDataInfo.h"
+#include "stir/Bin.h"
+#include <vector>
 
 namespace stir
 {
@@ -225,6 +227,21 @@ void send_related_viewgrams(stir::RelatedViewgrams<float>* viewgrams, int destin
  */
 void send_viewgram(const stir::Viewgram<float>& viewgram, int destination);
 
+/*! \brief sends list-mode events
+ * \param events the events to send (can be empty)
+ * \param destination the process id where to send the events
+ *
+ * The number of events is sent first, followed by the events themselves (possibly in several messages).
+ */
+void send_listmode_events(const std::vector<stir::BinAndCorr>& events, int destination);
+
+/*! \brief tells a worker that there are no more list-mode events to process
+ * \param destination the process id where to send the notification
+ *
+ * After this, receive_listmode_events() on \a destination will return \c false.
+ */
+void send_end_of_listmode_events(int destination);
+
 //----------------------Receive operations----------------------------------
 
 /*! \brief receives a single integer value
@@ -336,7 +353,7 @@ MPI_Status receive_image_values_and_fill_image_ptr(stir::shared_ptr<stir::Discre
  * char-array as stream-input to the parse() function of InterfilePDFSHeader.
  */
 void receive_and_construct_exam_and_proj_data_info_ptr(stir::shared_ptr<stir::ExamInfo>& exam_info_sptr,
-                                                       stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_sptr,
+                                                       stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_sptr,
                                                        int source);
 
 /*! \brief receives and constructs a RelatedViewgrams object
@@ -361,7 +378,7 @@ void receive_and_construct_exam_and_proj_data_info_ptr(stir::shared_ptr<stir::Ex
  * a RelatedViewgrams object.
  */
 void receive_and_construct_related_viewgrams(stir::RelatedViewgrams<float>*& viewgrams,
-                                             const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr,
+                                             const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr,
                                              const stir::shared_ptr<stir::DataSymmetriesForViewSegmentNumbers> symmetries_sptr,
                                              int source);
 
@@ -379,11 +396,28 @@ void receive_and_construct_related_viewgrams(stir::RelatedViewgrams<float>*& vie
  * The viewgram is filled by iterating througn it and copying the values of the received values.
  */
 void receive_and_construct_viewgram(stir::Viewgram<float>*& viewgram,
-                                    const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr,
+                                    const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr,
                                     int source);
 
+/*! \brief receives list-mode events sent by send_listmode_events()
+ * \param events will be resized and filled with the received events
+ * \param source the process id from which to receive the events
+ * \returns \c false if send_end_of_listmode_events() was called instead
+ */
+bool receive_listmode_events(std::vector<stir::BinAndCorr>& events, int source);
+
 //-----------------------reduce operations-------------------------------------
 
+/*! \brief adds images and values of all processes
+ * \param image_ptr the image to reduce. At \a destination, it is overwritten with the sum of all images.
+ * \param value_ptr the value to reduce (if not null). At \a destination, it is overwritten with the sum of all values.
+ * \param destination the process id where the sum is stored
+ *
+ * This function has to be called by all processes, with the same type of arguments (i.e.
+ * pointers being null or not). If \a image_ptr is not null, all images have to have the same size.
+ */
+void reduce_image_and_value(stir::DiscretisedDensity<3, float>* image_ptr, double* value_ptr, int destination);
+
 /*! \brief the function called by the master to reduce the output image
  * \param output_image_ptr the image pointer where the reduced image is saved
  * \param destination the process id where the output_image is reduced
@@ -418,6 +452,7 @@ const int VIEWGRAM_COUNT_TAG = 29;
 const int PROJECTION_DATA_INFO_TAG = 30;
 const int PARAMETER_INFO_TAG = 21;
 const int REGISTERED_NAME_TAG = 25;
+const int LISTMODE_EVENTS_TAG = 31;
 //!@}
 } // namespace distributed
 
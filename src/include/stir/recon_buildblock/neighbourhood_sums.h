@@ -0,0 +1,198 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup priors
+  \brief Functions to compute sums over the neighbourhood of every voxel, as used by priors
+
+  The functions in this file implement the loops over voxels and their neighbours needed by
+  priors such as stir::QuadraticPrior, stir::RelativeDifferencePrior and stir::LogcoshPrior.
+  They are parallelised with OpenMP (over planes), and the inner loops are written
+  such that the compiler can vectorise them: for every neighbour offset, the voxels in a row
+  whose neighbour is inside the image form a contiguous range (i.e. the boundary is handled
+  by restricting the range, as opposed to checking every voxel).
+
+  \warning The images (and kappa images) need to have a regular index range.
+*/
+
+#ifndef __stir_recon_buildblock_neighbourhood_sums_H__
+#define __stir_recon_buildblock_neighbourhood_sums_H__
+
+#include "stir/DiscretisedDensity.h"
+#include "stir/Array.h"
+#include <algorithm>
+#include <vector>
+
+START_NAMESPACE_STIR
+
+//! Computes the sum over all voxels and their neighbours of a function of the voxel values
+/*!
+  \ingroup priors
+  Computes
+  \f[ \sum_j \sum_{k \in N_j} w_{jk} \kappa_j \kappa_k f(x_j, x_k) \f]
+  where \f$w\f$ are the \a weights (indexed by the offset of the neighbour, with (0,0,0) the voxel itself),
+  and \f$\kappa\f$ the values in \a *kappa_ptr (or 1 if \a kappa_ptr is null).
+  Neighbours outside the image are ignored.
+
+  \a f is called as <code>f(x_j, x_k)</code> and should return a \c double.
+*/
+template <typename elemT, typename FunctionT>
+double
+sum_over_neighbourhood(const DiscretisedDensity<3, elemT>& image,
+                       const Array<3, float>& weights,
+                       const DiscretisedDensity<3, elemT>* const kappa_ptr,
+                       FunctionT f)
+{
+  const int min_z = image.get_min_index();
+  const int max_z = image.get_max_index();
+  double result = 0.;
+#ifdef STIR_OPENMP
+#  pragma omp parallel for reduction(+ : result) schedule(dynamic)
+#endif
+  for (int z = min_z; z <= max_z; z++)
+    {
+      const int min_dz = std::max(weights.get_min_index(), min_z - z);
+      const int max_dz = std::min(weights.get_max_index(), max_z - z);
+
+      const int min_y = image[z].get_min_index();
+      const int max_y = image[z].get_max_index();
+
+      for (int y = min_y; y <= max_y; y++)
+        {
+          const int min_dy = std::max(weights[0].get_min_index(), min_y - y);
+          const int max_dy = std::min(weights[0].get_max_index(), max_y - y);
+
+          const int num_x = image[z][y].get_length();
+          const elemT* const image_row = image[z][y].begin();
+          const elemT* const kappa_row = kappa_ptr ? (*kappa_ptr)[z][y].begin() : nullptr;
+
+          for (int dz = min_dz; dz <= max_dz; ++dz)
+            for (int dy = min_dy; dy <= max_dy; ++dy)
+              {
+                const elemT* const neighbour_row = image[z + dz][y + dy].begin();
+                const elemT* const neighbour_kappa_row = kappa_ptr ? (*kappa_ptr)[z + dz][y + dy].begin() : nullptr;
+                for (int dx = weights[dz][dy].get_min_index(); dx <= weights[dz][dy].get_max_index(); ++dx)
+                  {
+                    const double weight = weights[dz][dy][dx];
+                    if (weight == 0)
+                      continue;
+                    // range of voxels in this row for which the neighbour is inside the image
+                    const int start = std::max(0, -dx);
+                    const int end = std::min(num_x, num_x - dx);
+                    double row_sum = 0.;
+                    if (kappa_row)
+                      {
+#if defined(STIR_OPENMP) && (_OPENMP >= 201307)
+#  pragma omp simd reduction(+ : row_sum)
+#endif
+                        for (int i = start; i < end; ++i)
+                          row_sum += f(image_row[i], neighbour_row[i + dx]) * kappa_row[i] * neighbour_kappa_row[i + dx];
+                      }
+                    else
+                      {
+#if defined(STIR_OPENMP) && (_OPENMP >= 201307)
+#  pragma omp simd reduction(+ : row_sum)
+#endif
+                        for (int i = start; i < end; ++i)
+                          row_sum += f(image_row[i], neighbour_row[i + dx]);
+                      }
+                    result += weight * row_sum;
+                  }
+              }
+        }
+    }
+  return result;
+}
+
+//! Computes for every voxel a sum over its neighbours of a function of the voxel values
+/*!
+  \ingroup priors
+  Sets
+  \f[ o_j = s \sum_{k \in N_j} w_{jk} \kappa_j \kappa_k f(x_j, x_k) \f]
+  with notations as in sum_over_neighbourhood(), \f$o\f$ the \a output image and \f$s\f$ the \a scale.
+
+  \a output has to have the same index range as \a image.
+*/
+template <typename elemT, typename FunctionT>
+void
+compute_neighbourhood_sums(DiscretisedDensity<3, elemT>& output,
+                           const DiscretisedDensity<3, elemT>& image,
+                           const Array<3, float>& weights,
+                           const DiscretisedDensity<3, elemT>* const kappa_ptr,
+                           FunctionT f,
+                           const double scale)
+{
+  const int min_z = image.get_min_index();
+  const int max_z = image.get_max_index();
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z = min_z; z <= max_z; z++)
+    {
+      const int min_dz = std::max(weights.get_min_index(), min_z - z);
+      const int max_dz = std::min(weights.get_max_index(), max_z - z);
+
+      const int min_y = image[z].get_min_index();
+      const int max_y = image[z].get_max_index();
+
+      std::vector<double> sums;
+      for (int y = min_y; y <= max_y; y++)
+        {
+          const int min_dy = std::max(weights[0].get_min_index(), min_y - y);
+          const int max_dy = std::min(weights[0].get_max_index(), max_y - y);
+
+          const int num_x = image[z][y].get_length();
+          const elemT* const image_row = image[z][y].begin();
+          const elemT* const kappa_row = kappa_ptr ? (*kappa_ptr)[z][y].begin() : nullptr;
+          sums.assign(num_x, 0.);
+          double* const sums_ptr = sums.data();
+
+          for (int dz = min_dz; dz <= max_dz; ++dz)
+            for (int dy = min_dy; dy <= max_dy; ++dy)
+              {
+                const elemT* const neighbour_row = image[z + dz][y + dy].begin();
+                const elemT* const neighbour_kappa_row = kappa_ptr ? (*kappa_ptr)[z + dz][y + dy].begin() : nullptr;
+                for (int dx = weights[dz][dy].get_min_index(); dx <= weights[dz][dy].get_max_index(); ++dx)
+                  {
+                    const double weight = weights[dz][dy][dx];
+                    if (weight == 0)
+                      continue;
+                    // range of voxels in this row for which the neighbour is inside the image
+                    const int start = std::max(0, -dx);
+                    const int end = std::min(num_x, num_x - dx);
+                    if (kappa_row)
+                      {
+#if defined(STIR_OPENMP) && (_OPENMP >= 201307)
+#  pragma omp simd
+#endif
+                        for (int i = start; i < end; ++i)
+                          sums_ptr[i]
+                              += weight * f(image_row[i], neighbour_row[i + dx]) * kappa_row[i] * neighbour_kappa_row[i + dx];
+                      }
+                    else
+                      {
+#if defined(STIR_OPENMP) && (_OPENMP >= 201307)
+#  pragma omp simd
+#endif
+                        for (int i = start; i < end; ++i)
+                          sums_ptr[i] += weight * f(image_row[i], neighbour_row[i + dx]);
+                      }
+                  }
+              }
+
+          elemT* const output_row = output[z][y].begin();
+          for (int i = 0; i < num_x; ++i)
+            output_row[i] = static_cast<elemT>(sums_ptr[i] * scale);
+        }
+    }
+}
+
+END_NAMESPACE_STIR
+
+#endif
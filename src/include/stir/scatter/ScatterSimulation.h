@@ -30,6 +30,7 @@
 #include "stir/ProjDataInfoBlocksOnCylindricalNoArcCorr.h"
 #include "stir/ProjDataInfoCylindricalNoArcCorr.h"
 #include "stir/ProjDataInfoGenericNoArcCorr.h"
+#include <map>
 
 START_NAMESPACE_STIR
 
@@ -299,15 +300,22 @@ protected:
 
   virtual void find_detectors(unsigned& det_num_A, unsigned& det_num_B, const Bin& bin) const;
 
+  //! find the index of a detection point in detection_points_vector
+  /*! Calls error() if the point is not found, i.e. it has not been added by initialise_detection_points() */
   unsigned find_in_detection_points_vector(const CartesianCoordinate3D<float>& coord) const;
 
+  //! fill detection_points_vector with all detection points used by the bins of the template projection data
+  /*! This is called by set_up(), such that find_detectors() only needs a (thread-safe) look-up.
+      Nothing is done if the detection points have already been initialised.
+  */
+  void initialise_detection_points();
+
   CartesianCoordinate3D<float> shift_detector_coordinates_to_origin;
 
   //! average detection efficiency of unscattered counts
   double detection_efficiency_no_scatter(const unsigned det_num_A, const unsigned det_num_B) const;
 
-  // next needs to be mutable because find_in_detection_points_vector is const
-  mutable std::vector<CartesianCoordinate3D<float>> detection_points_vector;
+  std::vector<CartesianCoordinate3D<float>> detection_points_vector;
 
   //!@}
 
@@ -359,6 +367,15 @@ protected:
       call remove_cache_for_scattpoint_det_integrals_over_activity() first.
   */
   void initialise_cache_for_scattpoint_det_integrals_over_activity();
+  //! compute all integrals that are not cached yet
+  /*! This fills the caches for the activity and attenuation integrals for all scatter points and
+      detection points, parallelising over scatter points. Integrals that are still cached (e.g. the
+      attenuation integrals when only the activity image has changed) are not recomputed.
+      Afterwards, scatter_estimate() only needs to read from the caches.
+
+      Does nothing if use_cache is \c false.
+  */
+  void precompute_cache_for_scattpoint_det_integrals();
 
   //! Output proj_data fileanme prefix
   std::string output_proj_data_filename;
@@ -398,6 +415,13 @@ private:
 
   Array<2, float> cached_activity_integral_scattpoint_det;
   Array<2, float> cached_attenuation_integral_scattpoint_det;
+  //! map from detection point to its index in detection_points_vector
+  std::map<CartesianCoordinate3D<float>, unsigned> detection_points_map;
+
+  //! find the coordinates of the detectors of a bin (not shifted to the origin)
+  void find_cartesian_coordinates_of_detection(CartesianCoordinate3D<float>& coord_A,
+                                               CartesianCoordinate3D<float>& coord_B,
+                                               const Bin& bin) const;
   shared_ptr<DiscretisedDensity<3, float>> density_image_for_scatter_points_sptr;
 
   // numbers that we don't want to recompute all the time
@@ -37,6 +37,10 @@ public:
   LmToProjDataWithMC(const char* const par_filename);
 
   virtual void get_bin_from_event(Bin& bin, const CListEvent&) const;
+  bool get_bin_from_event_is_default() const override
+  {
+    return false;
+  }
   void process_new_time_event(const ListTime& time_event) override;
   Succeeded set_up() override;
 
@@ -49,6 +53,11 @@ protected:
   shared_ptr<AbsTimeInterval> _reference_abs_time_sptr;
 
   void start_new_time_frame(const unsigned int new_frame_num) override;
+  //! Returns false, as the motion correction depends on the current time
+  bool can_decode_events_in_parallel() const override
+  {
+    return false;
+  }
 
   void set_defaults() override;
   void initialise_keymap() override;
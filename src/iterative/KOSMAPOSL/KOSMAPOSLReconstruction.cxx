@@ -5,6 +5,7 @@
     Copyright (C) 2018-2019 University of Leeds
     Copyright (C) 2019 University College of London
     Copyright (C) 2019-2021 National Physical Laboratory
+    Copyright (C) 2026 University College London
 
     This file is part of STIR.
 
@@ -53,6 +54,9 @@
 
 #include <memory>
 #include <iostream>
+#include <fstream>
+#include <numeric>
+#include <cstring>
 
 #ifdef STIR_OPENMP
 #  include <omp.h>
@@ -86,6 +90,19 @@ ravel_index(int x, int y, int z, int min_x, int min_y, int min_z, int max_x, int
   return ravelled_index;
 }
 
+//! inverse of ravel_index, returning offsets w.r.t. the minimum indices
+inline void
+unravel_index(int& z_offset, int& y_offset, int& x_offset, int ravelled_index, int dimy, int dimx)
+{
+  z_offset = ravelled_index / (dimx * dimy);
+  ravelled_index -= z_offset * dimx * dimy;
+  y_offset = ravelled_index / dimx;
+  x_offset = ravelled_index - y_offset * dimx;
+}
+
+const char* const kernel_matrix_file_signature = "STIR KOSMAPOSL kernel matrix v1";
+const std::uint32_t kernel_matrix_file_byte_order_check = 0x01020304;
+
 inline double
 gaussian_kernel_already_sq(double distance_sq)
 {
@@ -157,6 +174,9 @@ KOSMAPOSLReconstruction<TargetT>::set_defaults()
   this->kernelised_output_filename_prefix = "";
   this->hybrid = 0;
   this->freeze_iterative_kernel_at_subiter_num = -1;
+  this->num_nearest_neighbours = 0;
+  this->kernel_matrix_input_filename = "";
+  this->kernel_matrix_output_filename = "";
 }
 
 template <typename TargetT>
@@ -179,6 +199,9 @@ KOSMAPOSLReconstruction<TargetT>::initialise_keymap()
   this->parser.add_key("anatomical image filenames", &anatomical_image_filenames);
   this->parser.add_key("kernelised output filename prefix", &this->kernelised_output_filename_prefix);
   this->parser.add_key("freeze iterative kernel at subiteration number", &this->freeze_iterative_kernel_at_subiter_num);
+  this->parser.add_key("number of nearest neighbours", &this->num_nearest_neighbours);
+  this->parser.add_key("kernel matrix input filename", &this->kernel_matrix_input_filename);
+  this->parser.add_key("kernel matrix output filename", &this->kernel_matrix_output_filename);
 }
 
 template <typename TargetT>
@@ -200,6 +223,11 @@ KOSMAPOSLReconstruction<TargetT>::post_processing()
       error("The number of sigma_m parameters must be the same as the number of anatomical image filenames");
       return false;
     }
+  if (this->num_nearest_neighbours < 0)
+    {
+      error("The number of nearest neighbours cannot be negative");
+      return false;
+    }
   for (unsigned int i = 0; i < this->anatomical_image_filenames.size(); i++)
     {
       info(boost::format("Reading anatomical data '%1%'") % anatomical_image_filenames[i]);
@@ -237,7 +265,7 @@ KOSMAPOSLReconstruction<TargetT>::set_up(shared_ptr<TargetT> const& target_image
   if (base_type::set_up(target_image_sptr) == Succeeded::no)
     error("KOSMAPOSL::set_up(): Error setting-up underlying OSMAPOSLReconstruction object");
 
-  if ((this->anatomical_prior_sptrs.size() == 0) && (this->hybrid == 0))
+  if ((this->anatomical_prior_sptrs.size() == 0) && (this->hybrid == 0) && this->kernel_matrix_input_filename.empty())
     error("KOSMAPOSL::set_up(): anatomical image has not been set");
 
   if (this->freeze_iterative_kernel_at_subiter_num == 0)
@@ -296,23 +324,42 @@ KOSMAPOSLReconstruction<TargetT>::set_up(shared_ptr<TargetT> const& target_image
 
   if (num_non_zero_feat > 1)
     {
-      this->kmnorm_sptrs.resize(anatomical_sd.size());
-      for (unsigned int i = 0; i < this->anatomical_prior_sptrs.size(); i++)
-        {
-          this->kmnorm_sptrs[i].reset(target_image_sptr->get_empty_copy());
-          this->kmnorm_sptrs[i]->resize(IndexRange3D(0, 0, 0, this->num_voxels - 1, 0, this->num_elem_neighbourhood - 1));
-        }
-
       this->kpnorm_sptr = shared_ptr<TargetT>(target_image_sptr->get_empty_copy());
       this->kpnorm_sptr->resize(IndexRange3D(0, 0, 0, this->num_voxels - 1, 0, this->num_elem_neighbourhood - 1));
+    }
 
-      int dimf_col = this->num_non_zero_feat - 1;
-      int dimf_row = this->num_voxels;
-
-      if (this->anatomical_prior_sptrs.size() != 0)
+  if (!this->kernel_matrix_input_filename.empty())
+    {
+      info(boost::format("Reading kernel matrix from '%1%'") % this->kernel_matrix_input_filename);
+      read_kernel_matrix(this->kernel_matrix_input_filename);
+    }
+  else
+    {
+      if (num_non_zero_feat > 1)
         {
-          calculate_norm_const_matrix(this->kmnorm_sptrs, dimf_row, dimf_col);
+          this->kmnorm_sptrs.resize(anatomical_sd.size());
+          for (unsigned int i = 0; i < this->anatomical_prior_sptrs.size(); i++)
+            {
+              this->kmnorm_sptrs[i].reset(target_image_sptr->get_empty_copy());
+              this->kmnorm_sptrs[i]->resize(IndexRange3D(0, 0, 0, this->num_voxels - 1, 0, this->num_elem_neighbourhood - 1));
+            }
+
+          int dimf_col = this->num_non_zero_feat - 1;
+          int dimf_row = this->num_voxels;
+
+          if (this->anatomical_prior_sptrs.size() != 0)
+            {
+              calculate_norm_const_matrix(this->kmnorm_sptrs, dimf_row, dimf_col);
+            }
         }
+
+      compute_anatomical_kernel_matrix();
+      // the norm matrices are only used to compute the kernel matrix, so we can free the memory
+      this->kmnorm_sptrs.clear();
+      info(boost::format("Kernel matrix computed with %1% non-zero elements") % this->kernel_matrix_elements.size());
+
+      if (!this->kernel_matrix_output_filename.empty())
+        write_kernel_matrix(this->kernel_matrix_output_filename);
     }
 
   this->_already_set_up = true;
@@ -409,6 +456,13 @@ KOSMAPOSLReconstruction<TargetT>::get_freeze_iterative_kernel_at_subiter_num() c
   return this->freeze_iterative_kernel_at_subiter_num;
 }
 
+template <typename TargetT>
+int
+KOSMAPOSLReconstruction<TargetT>::get_num_nearest_neighbours() const
+{
+  return this->num_nearest_neighbours;
+}
+
 /***************************************************************
   set_ functions
 ***************************************************************/
@@ -539,6 +593,30 @@ KOSMAPOSLReconstruction<TargetT>::set_freeze_iterative_kernel_at_subiter_num(con
   this->freeze_iterative_kernel_at_subiter_num = arg;
 }
 
+template <typename TargetT>
+void
+KOSMAPOSLReconstruction<TargetT>::set_num_nearest_neighbours(const int arg)
+{
+  this->_already_set_up = false;
+  this->num_nearest_neighbours = arg;
+}
+
+template <typename TargetT>
+void
+KOSMAPOSLReconstruction<TargetT>::set_kernel_matrix_input_filename(const std::string& arg)
+{
+  this->_already_set_up = false;
+  this->kernel_matrix_input_filename = arg;
+}
+
+template <typename TargetT>
+void
+KOSMAPOSLReconstruction<TargetT>::set_kernel_matrix_output_filename(const std::string& arg)
+{
+  this->_already_set_up = false;
+  this->kernel_matrix_output_filename = arg;
+}
+
 /***************************************************************/
 // Here start the definition of few functions that calculate the SD of the anatomical image, a norm matrix and
 // finally the Kernelised image
@@ -743,45 +821,35 @@ KOSMAPOSLReconstruction<TargetT>::estimate_stand_dev_for_anatomical_image(std::v
 
 template <typename TargetT>
 void
-KOSMAPOSLReconstruction<TargetT>::compute_kernelised_image(TargetT& kernelised_image_out,
-                                                           const TargetT& image_to_kernelise,
-                                                           const TargetT& current_alpha_estimate)
+KOSMAPOSLReconstruction<TargetT>::compute_anatomical_kernel_matrix()
 {
+  const bool use_compact_implementation = this->num_non_zero_feat == 1;
 
-  for (unsigned int i = 0; i < this->anatomical_prior_sptrs.size(); i++)
-    {
-      if (!current_alpha_estimate.has_same_characteristics(*this->anatomical_prior_sptrs[i]))
-        error("anatomical and emission image have different sizes! Make sure they are the same");
-    }
-
-  bool use_compact_implementation = this->num_non_zero_feat == 1;
-
-  // Something very weird happens here if I do not get_empty_copy()
-  // KImage elements will be all nan
-
-  unique_ptr<TargetT> kImage_uptr(current_alpha_estimate.get_empty_copy());
-
-  if (!use_compact_implementation && this->get_hybrid())
-    {
-      // Going to need the full emission regional normalised differences
-      int dimf_row = this->num_voxels;
-      int dimf_col = this->num_non_zero_feat - 1;
-
-      if (still_updating_iterative_kernel())
-        calculate_norm_matrix(*this->kpnorm_sptr, dimf_row, dimf_col, current_alpha_estimate);
-    }
-
-  //     calculate kernelised image
-  int min_z, max_z, min_y, max_y, min_x, max_x;
-
-  min_z = current_alpha_estimate.get_min_index();
-  max_z = current_alpha_estimate.get_max_index();
-  min_y = current_alpha_estimate[min_z].get_min_index();
-  max_y = current_alpha_estimate[min_z].get_max_index();
-  min_x = current_alpha_estimate[min_z][min_y].get_min_index();
-  max_x = current_alpha_estimate[min_z][min_y].get_max_index();
+  const int min_z = min_ind[1];
+  const int max_z = max_ind[1];
+  const int min_y = min_ind[2];
+  const int max_y = max_ind[2];
+  const int min_x = min_ind[3];
+  const int max_x = max_ind[3];
 
-  // Iterate over the image
+  // first find the number of elements in every row, which only depends on the geometry
+  this->kernel_matrix_row_starts.assign(this->num_voxels + 1, 0);
+  for (int z = min_z; z <= max_z; z++)
+    for (int y = min_y; y <= max_y; y++)
+      for (int x = min_x; x <= max_x; x++)
+        {
+          const int num_dz = min(distance.get_max_index(), max_z - z) - max(distance.get_min_index(), min_z - z) + 1;
+          const int num_dy = min(distance[0].get_max_index(), max_y - y) - max(distance[0].get_min_index(), min_y - y) + 1;
+          const int num_dx
+              = min(distance[0][0].get_max_index(), max_x - x) - max(distance[0][0].get_min_index(), min_x - x) + 1;
+          int num_elements = num_dz * num_dy * num_dx;
+          if (this->num_nearest_neighbours > 0)
+            num_elements = min(num_elements, this->num_nearest_neighbours);
+          this->kernel_matrix_row_starts[ravel_index(x, y, z, min_x, min_y, min_z, max_x, max_y, max_z) + 1] = num_elements;
+        }
+  std::partial_sum(
+      this->kernel_matrix_row_starts.begin(), this->kernel_matrix_row_starts.end(), this->kernel_matrix_row_starts.begin());
+  this->kernel_matrix_elements.resize(this->kernel_matrix_row_starts.back());
 
 #ifdef STIR_OPENMP
 #  if _OPENMP < 201107
@@ -803,73 +871,226 @@ KOSMAPOSLReconstruction<TargetT>::compute_kernelised_image(TargetT& kernelised_i
               const int min_dx = max(distance[0][0].get_min_index(), min_x - x);
               const int max_dx = min(distance[0][0].get_max_index(), max_x - x);
 
-              // Iterate over the kernel patch, centered at the current voxel
-
-              double kernel_sum = 0;
+              const int current_ravelled_idx = ravel_index(x, y, z, min_x, min_y, min_z, max_x, max_y, max_z);
+              std::vector<KernelMatrixElement> row;
+              row.reserve(this->num_elem_neighbourhood);
 
               for (int dz = min_dz; dz <= max_dz; ++dz)
-                {
-                  for (int dy = min_dy; dy <= max_dy; ++dy)
+                for (int dy = min_dy; dy <= max_dy; ++dy)
+                  for (int dx = min_dx; dx <= max_dx; ++dx)
                     {
-                      for (int dx = min_dx; dx <= max_dx; ++dx)
-                        {
+                      const int delta_ravelled_idx = ravel_index(dx, dy, dz, min_dx, min_dy, min_dz, max_dx, max_dy, max_dz);
+                      double anatomical_kernel = 1;
 
-                          const int current_ravelled_idx = ravel_index(x, y, z, min_x, min_y, min_z, max_x, max_y, max_z);
-                          const int delta_ravelled_idx = ravel_index(dx, dy, dz, min_dx, min_dy, min_dz, max_dx, max_dy, max_dz);
-
-                          //                     std::cout << "d " <<z<<" "<<y<<" "<<x<< std::endl;
-                          // Calculate the emission kernel
-                          double emission_kernel;
-                          if (get_hybrid())
-                            {
-                              if (current_alpha_estimate[z][y][x] == 0)
-                                {
-                                  continue;
-                                }
-
-                              emission_kernel = calc_emission_kernel(current_alpha_estimate[z][y][x],
-                                                                     current_alpha_estimate[z + dz][y + dy][x + dx],
-                                                                     distance[dz][dy][dx],
-                                                                     use_compact_implementation,
-                                                                     current_ravelled_idx,
-                                                                     delta_ravelled_idx);
-                            }
-                          else
-                            {
-                              emission_kernel = 1;
-                            }
-                          // Calculate the anatomical kernel
-                          double anatomical_kernel = 1;
-
-                          for (unsigned int i = 0; i < this->anatomical_prior_sptrs.size(); i++)
-                            {
-                              anatomical_kernel = anatomical_kernel
-                                                  * calc_anatomical_kernel((*anatomical_prior_sptrs[i])[z][y][x],
-                                                                           (*anatomical_prior_sptrs[i])[z + dz][y + dy][x + dx],
-                                                                           distance[dz][dy][dx],
-                                                                           use_compact_implementation,
-                                                                           current_ravelled_idx,
-                                                                           delta_ravelled_idx,
-                                                                           i);
-                            }
-
-                          const double kernel = anatomical_kernel * emission_kernel;
-
-                          kernelised_image_out[z][y][x] += kernel * image_to_kernelise[z + dz][y + dy][x + dx];
-                          kernel_sum += kernel;
+                      for (unsigned int i = 0; i < this->anatomical_prior_sptrs.size(); i++)
+                        {
+                          anatomical_kernel = anatomical_kernel
+                                              * calc_anatomical_kernel((*anatomical_prior_sptrs[i])[z][y][x],
+                                                                       (*anatomical_prior_sptrs[i])[z + dz][y + dy][x + dx],
+                                                                       distance[dz][dy][dx],
+                                                                       use_compact_implementation,
+                                                                       current_ravelled_idx,
+                                                                       delta_ravelled_idx,
+                                                                       i);
                         }
+                      KernelMatrixElement element;
+                      element.voxel_index = static_cast<std::int32_t>(
+                          ravel_index(x + dx, y + dy, z + dz, min_x, min_y, min_z, max_x, max_y, max_z));
+                      element.value = static_cast<float>(anatomical_kernel);
+                      row.push_back(element);
                     }
-                }
 
-              if (current_alpha_estimate[z][y][x] == 0)
+              const std::size_t num_elements = this->kernel_matrix_row_starts[current_ravelled_idx + 1]
+                                               - this->kernel_matrix_row_starts[current_ravelled_idx];
+              if (num_elements < row.size())
                 {
-                  continue;
+                  // keep the nearest neighbours in feature space (i.e. the largest values), sorted by voxel
+                  std::partial_sort(row.begin(),
+                                    row.begin() + num_elements,
+                                    row.end(),
+                                    [](const KernelMatrixElement& a, const KernelMatrixElement& b) {
+                                      return a.value > b.value || (a.value == b.value && a.voxel_index < b.voxel_index);
+                                    });
+                  row.resize(num_elements);
+                  std::sort(row.begin(), row.end(), [](const KernelMatrixElement& a, const KernelMatrixElement& b) {
+                    return a.voxel_index < b.voxel_index;
+                  });
                 }
+              std::copy(row.begin(),
+                        row.end(),
+                        this->kernel_matrix_elements.begin() + this->kernel_matrix_row_starts[current_ravelled_idx]);
+            }
+        }
+    }
+}
+
+template <typename TargetT>
+void
+KOSMAPOSLReconstruction<TargetT>::write_kernel_matrix(const std::string& filename) const
+{
+  std::ofstream s(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!s)
+    error("KOSMAPOSL: cannot open kernel matrix file '" + filename + "' for writing");
+
+  const std::int32_t sizes[6] = { this->dimz,           this->dimy,    this->dimx,
+                                  this->num_neighbours, this->only_2D, this->num_nearest_neighbours };
+  const std::uint64_t num_elements = this->kernel_matrix_elements.size();
+  s.write(kernel_matrix_file_signature, std::strlen(kernel_matrix_file_signature) + 1);
+  s.write(reinterpret_cast<const char*>(&kernel_matrix_file_byte_order_check), sizeof(kernel_matrix_file_byte_order_check));
+  s.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+  s.write(reinterpret_cast<const char*>(&num_elements), sizeof(num_elements));
+  s.write(reinterpret_cast<const char*>(this->kernel_matrix_row_starts.data()),
+          this->kernel_matrix_row_starts.size() * sizeof(std::uint64_t));
+  s.write(reinterpret_cast<const char*>(this->kernel_matrix_elements.data()),
+          this->kernel_matrix_elements.size() * sizeof(KernelMatrixElement));
+  if (!s)
+    error("KOSMAPOSL: error writing kernel matrix file '" + filename + "'");
+}
+
+template <typename TargetT>
+void
+KOSMAPOSLReconstruction<TargetT>::read_kernel_matrix(const std::string& filename)
+{
+  std::ifstream s(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!s)
+    error("KOSMAPOSL: cannot open kernel matrix file '" + filename + "'");
+
+  std::vector<char> signature(std::strlen(kernel_matrix_file_signature) + 1);
+  std::uint32_t byte_order_check;
+  std::int32_t sizes[6];
+  std::uint64_t num_elements;
+  s.read(signature.data(), signature.size());
+  s.read(reinterpret_cast<char*>(&byte_order_check), sizeof(byte_order_check));
+  s.read(reinterpret_cast<char*>(sizes), sizeof(sizes));
+  s.read(reinterpret_cast<char*>(&num_elements), sizeof(num_elements));
+  if (!s || std::strcmp(signature.data(), kernel_matrix_file_signature) != 0)
+    error("KOSMAPOSL: '" + filename + "' is not a kernel matrix file");
+  if (byte_order_check != kernel_matrix_file_byte_order_check)
+    error("KOSMAPOSL: kernel matrix file '" + filename + "' was written with a different byte order");
+  if (sizes[0] != this->dimz || sizes[1] != this->dimy || sizes[2] != this->dimx)
+    error(boost::format("KOSMAPOSL: kernel matrix file '%1%' is for an image of size %2%x%3%x%4%, but the image is %5%x%6%x%7%")
+          % filename % sizes[0] % sizes[1] % sizes[2] % this->dimz % this->dimy % this->dimx);
+  if (sizes[3] != this->num_neighbours || sizes[4] != this->only_2D || sizes[5] != this->num_nearest_neighbours)
+    error(boost::format("KOSMAPOSL: kernel matrix file '%1%' has different 'number of neighbours', 'only_2D' or "
+                        "'number of nearest neighbours' (%2%, %3%, %4%)")
+          % filename % sizes[3] % sizes[4] % sizes[5]);
+
+  this->kernel_matrix_row_starts.resize(this->num_voxels + 1);
+  this->kernel_matrix_elements.resize(num_elements);
+  s.read(reinterpret_cast<char*>(this->kernel_matrix_row_starts.data()),
+         this->kernel_matrix_row_starts.size() * sizeof(std::uint64_t));
+  s.read(reinterpret_cast<char*>(this->kernel_matrix_elements.data()), num_elements * sizeof(KernelMatrixElement));
+  if (!s)
+    error("KOSMAPOSL: error reading kernel matrix file '" + filename + "'");
+
+  // check the indices, such that corrupt files cannot lead to out-of-range access
+  if (this->kernel_matrix_row_starts.front() != 0 || this->kernel_matrix_row_starts.back() != num_elements
+      || !std::is_sorted(this->kernel_matrix_row_starts.begin(), this->kernel_matrix_row_starts.end()))
+    error("KOSMAPOSL: kernel matrix file '" + filename + "' has inconsistent row sizes");
+  for (const auto& element : this->kernel_matrix_elements)
+    if (element.voxel_index < 0 || element.voxel_index >= this->num_voxels)
+      error("KOSMAPOSL: kernel matrix file '" + filename + "' has out-of-range voxel indices");
+}
+
+template <typename TargetT>
+void
+KOSMAPOSLReconstruction<TargetT>::compute_kernelised_image(TargetT& kernelised_image_out,
+                                                           const TargetT& image_to_kernelise,
+                                                           const TargetT& current_alpha_estimate)
+{
+
+  for (unsigned int i = 0; i < this->anatomical_prior_sptrs.size(); i++)
+    {
+      if (!current_alpha_estimate.has_same_characteristics(*this->anatomical_prior_sptrs[i]))
+        error("anatomical and emission image have different sizes! Make sure they are the same");
+    }
+
+  bool use_compact_implementation = this->num_non_zero_feat == 1;
+
+  if (!use_compact_implementation && this->get_hybrid())
+    {
+      // Going to need the full emission regional normalised differences
+      int dimf_row = this->num_voxels;
+      int dimf_col = this->num_non_zero_feat - 1;
+
+      if (still_updating_iterative_kernel())
+        calculate_norm_matrix(*this->kpnorm_sptr, dimf_row, dimf_col, current_alpha_estimate);
+    }
+
+  // work with ravelled images, such that we can index with the voxel indices of the kernel matrix
+  std::vector<float> image_values(this->num_voxels);
+  std::vector<float> alpha_values(this->num_voxels);
+  std::vector<float> kernelised_values(this->num_voxels);
+  std::copy(image_to_kernelise.begin_all_const(), image_to_kernelise.end_all_const(), image_values.begin());
+  std::copy(current_alpha_estimate.begin_all_const(), current_alpha_estimate.end_all_const(), alpha_values.begin());
+
+  // Iterate over the image, multiplying with the kernel matrix
 
-              kernelised_image_out[z][y][x] /= kernel_sum;
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic, 256)
+#endif
+  for (int l = 0; l < this->num_voxels; l++)
+    {
+      const KernelMatrixElement* const row_begin = this->kernel_matrix_elements.data() + this->kernel_matrix_row_starts[l];
+      const KernelMatrixElement* const row_end = this->kernel_matrix_elements.data() + this->kernel_matrix_row_starts[l + 1];
+
+      double kernelised_value = 0;
+      double kernel_sum = 0;
+
+      if (get_hybrid())
+        {
+          if (alpha_values[l] == 0)
+            {
+              kernelised_values[l] = 0;
+              continue;
+            }
+
+          int z, y, x;
+          unravel_index(z, y, x, l, this->dimy, this->dimx);
+          // patch ranges, needed for the indexing of the precalculated norms
+          const int min_dz = max(distance.get_min_index(), -z);
+          const int max_dz = min(distance.get_max_index(), this->dimz - 1 - z);
+          const int min_dy = max(distance[0].get_min_index(), -y);
+          const int max_dy = min(distance[0].get_max_index(), this->dimy - 1 - y);
+          const int min_dx = max(distance[0][0].get_min_index(), -x);
+          const int max_dx = min(distance[0][0].get_max_index(), this->dimx - 1 - x);
+
+          for (const KernelMatrixElement* element = row_begin; element != row_end; ++element)
+            {
+              int dz, dy, dx;
+              unravel_index(dz, dy, dx, element->voxel_index, this->dimy, this->dimx);
+              dz -= z;
+              dy -= y;
+              dx -= x;
+              const int delta_ravelled_idx = ravel_index(dx, dy, dz, min_dx, min_dy, min_dz, max_dx, max_dy, max_dz);
+
+              const double emission_kernel = calc_emission_kernel(alpha_values[l],
+                                                                  alpha_values[element->voxel_index],
+                                                                  distance[dz][dy][dx],
+                                                                  use_compact_implementation,
+                                                                  l,
+                                                                  delta_ravelled_idx);
+              const double kernel = element->value * emission_kernel;
+              kernelised_value += kernel * image_values[element->voxel_index];
+              kernel_sum += kernel;
             }
         }
+      else
+        {
+          for (const KernelMatrixElement* element = row_begin; element != row_end; ++element)
+            {
+              kernelised_value += element->value * image_values[element->voxel_index];
+              kernel_sum += element->value;
+            }
+        }
+
+      if (alpha_values[l] == 0)
+        kernelised_values[l] = static_cast<float>(kernelised_value);
+      else
+        kernelised_values[l] = static_cast<float>(kernelised_value / kernel_sum);
     }
+
+  std::copy(kernelised_values.begin(), kernelised_values.end(), kernelised_image_out.begin_all());
 }
 
 template <typename TargetT>
@@ -190,6 +190,7 @@ CListModeDataECAT<CListRecordT>::open_lm_file(unsigned int new_lm_file) const
                                                          sizeof(CListTimeDataECAT966),
                                                          sizeof(CListTimeDataECAT966),
                                                          ByteOrder::big_endian != ByteOrder::get_native_order()));
+      current_lm_data_ptr->set_read_ahead(read_ahead);
       current_lm_file = new_lm_file;
 
       // now restore saved_get_positions for this file
@@ -262,6 +263,16 @@ CListModeDataECAT<CListRecordT>::set_get_position(const typename CListModeDataEC
 
   return current_lm_data_ptr->set_get_position(saved_get_positions[pos].second);
 }
+
+template <class CListRecordT>
+void
+CListModeDataECAT<CListRecordT>::set_read_ahead(const bool v)
+{
+  read_ahead = v;
+  if (!is_null_ptr(current_lm_data_ptr))
+    current_lm_data_ptr->set_read_ahead(v);
+}
+
 #if 0
 template <class CListRecordT>
 SavedPosition
@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2003-2012 Hammersmith Imanet Ltd
-    Copyright (C) 2013-2014 University College London
+    Copyright (C) 2013-2014, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -91,6 +91,16 @@ CListModeDataECAT8_32bit::get_next_record(CListRecord& record_of_general_type) c
   return current_lm_data_ptr->get_next_record(record);
 }
 
+void
+CListModeDataECAT8_32bit::get_bins_for_records(Bin* bins,
+                                               const ListRecord* const* records,
+                                               const std::size_t num_records,
+                                               const ProjDataInfo& proj_data_info) const
+{
+  CListEventCylindricalScannerWithDiscreteDetectors::get_bins_for_records<CListRecordT, CListEventECAT8_32bit>(
+      bins, records, num_records, proj_data_info);
+}
+
 Succeeded
 CListModeDataECAT8_32bit::reset()
 {
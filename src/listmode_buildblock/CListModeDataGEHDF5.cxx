@@ -1,5 +1,5 @@
 /*
-    Copyright (C) 2013-2020 University College London
+    Copyright (C) 2013-2020, 2026 University College London
     Copyright (C) 2017-2018 University of Hull
     Copyright (C) 2017-2019 University of Leeds
 
@@ -102,6 +102,17 @@ CListModeDataGEHDF5::get_next_record(CListRecord& record_of_general_type) const
   return current_lm_data_ptr->get_next_record(record);
 }
 
+void
+CListModeDataGEHDF5::get_bins_for_records(Bin* bins,
+                                          const ListRecord* const* records,
+                                          const std::size_t num_records,
+                                          const ProjDataInfo& proj_data_info) const
+{
+  // the record is also the event
+  CListEventCylindricalScannerWithDiscreteDetectors::get_bins_for_records<CListRecordT, CListRecordT>(
+      bins, records, num_records, proj_data_info);
+}
+
 Succeeded
 CListModeDataGEHDF5::reset()
 {
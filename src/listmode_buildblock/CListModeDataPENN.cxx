@@ -1,5 +1,6 @@
 /*
     Copyright (C) 2020-2022 University of Pennsylvania
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -86,6 +87,16 @@ CListModeDataPENN::get_next_record(CListRecord& record_of_general_type) const
   return lm_data_sptr->get_next_record(record);
 }
 
+void
+CListModeDataPENN::get_bins_for_records(Bin* bins,
+                                        const ListRecord* const* records,
+                                        const std::size_t num_records,
+                                        const ProjDataInfo& proj_data_info) const
+{
+  CListEventCylindricalScannerWithDiscreteDetectors::get_bins_for_records<CListRecordT, CListEventPENN>(
+      bins, records, num_records, proj_data_info);
+}
+
 Succeeded
 CListModeDataPENN::reset()
 {
@@ -1,7 +1,7 @@
 /*
     Copyright (C) 2015, 2016 University of Leeds
     Copyright (C) 2017, 2018 University of Hull
-    Copyright (C) 2016, 2017, 2020, 2023, 2024 University College London
+    Copyright (C) 2016, 2017, 2020, 2023, 2024, 2026 University College London
     Copyright (C) 2018 University of Hull
     This file is part of STIR.
 
@@ -234,6 +234,16 @@ CListModeDataROOT::get_next_record(CListRecord& record_of_general_type) const
   return root_file_sptr->get_next_record(record);
 }
 
+void
+CListModeDataROOT::get_bins_for_records(Bin* bins,
+                                        const ListRecord* const* records,
+                                        const std::size_t num_records,
+                                        const ProjDataInfo& proj_data_info) const
+{
+  CListEventCylindricalScannerWithDiscreteDetectors::get_bins_for_records<CListRecordROOT, CListEventROOT>(
+      bins, records, num_records, proj_data_info);
+}
+
 Succeeded
 CListModeDataROOT::reset()
 {
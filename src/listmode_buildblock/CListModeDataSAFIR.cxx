@@ -4,7 +4,7 @@ Coincidence LM Data Class for SAFIR: Implementation
 
         Copyright 2015 ETH Zurich, Institute of Particle Physics
         Copyright 2020 Positrigo AG, Zurich
-    Copyright 2021 University College London
+    Copyright 2021, 2026 University College London
 
         Licensed under the Apache License, Version 2.0 (the "License");
         you may not use this file except in compliance with the License.
@@ -122,6 +122,16 @@ CListModeDataSAFIR<CListRecordT>::get_next_record(CListRecord& record_of_general
   return status;
 }
 
+template <class CListRecordT>
+void
+CListModeDataSAFIR<CListRecordT>::get_bins_for_records(Bin* bins,
+                                                       const ListRecord* const* records,
+                                                       const std::size_t num_records,
+                                                       const ProjDataInfo& proj_data_info) const
+{
+  CListRecordT::get_bins_for_records(bins, records, num_records, proj_data_info);
+}
+
 template <class CListRecordT>
 Succeeded
 CListModeDataSAFIR<CListRecordT>::reset()
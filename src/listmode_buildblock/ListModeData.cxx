@@ -8,7 +8,7 @@
 */
 /*
     Copyright (C) 2003, Hammersmith Imanet Ltd
-    Copyright (C) 2014, University College London
+    Copyright (C) 2014, 2026, University College London
     Copyright (C) 2019, National Physical Laboratory
     This file is part of STIR.
 
@@ -18,6 +18,8 @@
 */
 
 #include "stir/listmode/ListModeData.h"
+#include "stir/listmode/ListRecord.h"
+#include "stir/Bin.h"
 #include "stir/ExamInfo.h"
 #include "stir/is_null_ptr.h"
 #include "stir/error.h"
@@ -53,6 +55,17 @@ ListModeData::get_proj_data_info_sptr() const
   return proj_data_info_sptr;
 }
 
+void
+ListModeData::get_bins_for_records(Bin* bins,
+                                   const ListRecord* const* records,
+                                   const std::size_t num_records,
+                                   const ProjDataInfo& proj_data_info) const
+{
+  for (std::size_t i = 0; i < num_records; ++i)
+    if (records[i]->is_event())
+      records[i]->event().get_bin(bins[i], proj_data_info);
+}
+
 #if 0
 std::time_t
 ListModeData::
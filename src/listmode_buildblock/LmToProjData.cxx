@@ -11,7 +11,7 @@
 /*
     Copyright (C) 2000 - 2011-12-31, Hammersmith Imanet Ltd
     Copyright (C) 2017, University of Hull
-    Copyright (C) 2013, 2021, 2023, 2024 University College London
+    Copyright (C) 2013, 2021, 2023, 2024, 2026 University College London
     Copright (C) 2019, National Physical Laboratory
     This file is part of STIR.
 
@@ -82,6 +82,9 @@ typedef short elem_type;
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include <future>
+#include <cstdio>
+#include <cstdint>
 
 using std::string;
 using std::fstream;
@@ -228,6 +231,18 @@ LmToProjData::get_store_delayeds() const
   return store_delayeds;
 }
 
+void
+LmToProjData::set_store_separate_prompts_and_delayeds(bool v)
+{
+  this->store_separate_prompts_and_delayeds = v;
+}
+
+bool
+LmToProjData::get_store_separate_prompts_and_delayeds() const
+{
+  return store_separate_prompts_and_delayeds;
+}
+
 void
 LmToProjData::set_num_segments_in_memory(int v)
 {
@@ -274,6 +289,7 @@ LmToProjData::set_defaults()
   max_segment_num_to_process = -1;
   store_prompts = true;
   store_delayeds = true;
+  store_separate_prompts_and_delayeds = false;
   interactive = false;
   num_segments_in_memory = -1;
   num_timing_poss_in_memory = -1;
@@ -306,6 +322,7 @@ LmToProjData::initialise_keymap()
   {
     parser.add_key("Store prompts", &store_prompts);
     parser.add_key("Store delayeds", &store_delayeds);
+    parser.add_key("Store separate prompts and delayeds", &store_separate_prompts_and_delayeds);
     // parser.add_key("increment to use for 'delayeds'",&delayed_increment);
   }
   parser.add_key("List event coordinates", &interactive);
@@ -552,6 +569,30 @@ LmToProjData::get_bin_from_event(Bin& bin, const ListEvent& event) const
     }
 }
 
+void
+LmToProjData::get_bins_from_records(Bin* bins, const ListRecord* const* records, const std::size_t num_records) const
+{
+  // A derived class might have overridden get_bin_from_event(), so we can only use
+  // ListModeData::get_bins_for_records() if it tells us it did not.
+  if (!do_pre_normalisation && get_bin_from_event_is_default())
+    {
+      // equivalent to calling get_bin_from_event(), but faster
+      lm_data_ptr->get_bins_for_records(bins, records, num_records, *template_proj_data_info_ptr);
+    }
+  else
+    {
+      for (std::size_t i = 0; i < num_records; ++i)
+        if (records[i]->is_event())
+          get_bin_from_event(bins[i], records[i]->event());
+    }
+}
+
+bool
+LmToProjData::get_bin_from_event_is_default() const
+{
+  return true;
+}
+
 /**************************************************************
  Here follows the post_normalisation related stuff.
 ***************************************************************/
@@ -619,8 +660,217 @@ LmToProjData::start_new_time_frame(const unsigned int)
  Here follows the actual rebinning code (finally).
 
  It's essentially simple, but is in fact complicated because of the facility
- to store only part of the segments in memory.
+ to store only part of the segments in memory, and because events are decoded
+ in parallel.
+
+ The list-mode data are read in blocks of records (while the events in one block
+ are decoded, the next block is read in the background). The events in a block
+ are decoded in parallel (if can_decode_events_in_parallel() returns true) in chunks
+ of records (see get_bins_from_records()), after
+ which the records are handled in the order in which they occur in the list-mode
+ data, such that the time frames and num_events_to_store work as before.
+
+ If not all segments (or TOF bins) fit in memory, the events for the other ones
+ are written to temporary files, and added after the list-mode data for the
+ time frame has been processed. The list-mode data are therefore only read once.
 ***************************************************************/
+
+namespace
+{
+//! Number of list-mode records that are read and decoded in one go in LmToProjData::process_data()
+const std::size_t lm_to_projdata_block_size = 65536;
+//! Number of records passed to LmToProjData::get_bins_from_records() in one go when decoding in parallel
+const std::size_t lm_to_projdata_decoding_chunk_size = 1024;
+
+//! Reads list-mode records in blocks, reading the next block in the background
+/*! As the records are read in a background thread, reading ahead by \a lm_data itself is
+    disabled while this object exists.
+*/
+class ListRecordBlockReader
+{
+public:
+  explicit ListRecordBlockReader(ListModeData& lm_data)
+      : position(0),
+        lm_data(lm_data),
+        num_records(0),
+        end_of_data(false)
+  {
+    lm_data.set_read_ahead(false);
+    for (int b = 0; b < 2; ++b)
+      {
+        blocks[b].resize(lm_to_projdata_block_size);
+        for (auto& record_sptr : blocks[b])
+          {
+            record_sptr = lm_data.get_empty_record_sptr();
+            record_ptrs[b].push_back(record_sptr.get());
+          }
+      }
+  }
+
+  ~ListRecordBlockReader()
+  {
+    // make sure the background thread does not use the blocks anymore
+    if (next_block_future.valid())
+      next_block_future.wait();
+    lm_data.set_read_ahead(true);
+  }
+
+  //! Makes the next block current, returning false if there are no more records
+  bool read_next_block()
+  {
+    if (next_block_future.valid())
+      {
+        num_records = next_block_future.get();
+        current_block = 1 - current_block;
+      }
+    else if (!end_of_data)
+      num_records = read_block(lm_data, blocks[current_block]);
+    else
+      num_records = 0;
+    position = 0;
+    end_of_data = num_records < lm_to_projdata_block_size;
+    if (!end_of_data)
+      next_block_future = std::async(std::launch::async, read_block, std::cref(lm_data), std::ref(blocks[1 - current_block]));
+    return num_records > 0;
+  }
+
+  //! Number of records in the current block
+  std::size_t size() const
+  {
+    return num_records;
+  }
+
+  const ListRecord& operator[](const std::size_t i) const
+  {
+    return *blocks[current_block][i];
+  }
+
+  //! Pointers to the records in the current block
+  const ListRecord* const* get_records() const
+  {
+    return record_ptrs[current_block].data();
+  }
+
+  //! Index of the next record in the current block that still needs to be handled
+  std::size_t position;
+
+private:
+  ListModeData& lm_data;
+  std::vector<shared_ptr<ListRecord>> blocks[2];
+  std::vector<const ListRecord*> record_ptrs[2];
+  int current_block = 0;
+  std::size_t num_records;
+  bool end_of_data;
+  std::future<std::size_t> next_block_future;
+
+  static std::size_t read_block(const ListModeData& lm_data, std::vector<shared_ptr<ListRecord>>& block)
+  {
+    std::size_t num_records = 0;
+    while (num_records < block.size() && lm_data.get_next_record(*block[num_records]) == Succeeded::yes)
+      ++num_records;
+    return num_records;
+  }
+};
+
+//! An event for segments that are not in memory, stored in a temporary file
+/*! We use 16-bit indices to keep the temporary files small. */
+struct SpilledEvent
+{
+  std::int16_t timing_pos_num;
+  std::int16_t segment_num;
+  std::int16_t view_num;
+  std::int16_t axial_pos_num;
+  std::int16_t tangential_pos_num;
+  elem_type value;
+};
+
+//! Stores SpilledEvent objects in a temporary file (which is deleted when closed)
+/*! The file is only created once the buffer is full, so no file is needed when there are only a few events. */
+class SpilledEvents
+{
+public:
+  SpilledEvents()
+      : file(nullptr)
+  {}
+
+  ~SpilledEvents()
+  {
+    if (file)
+      std::fclose(file);
+  }
+
+  void push_back(const SpilledEvent& event)
+  {
+    buffer.push_back(event);
+    if (buffer.size() == max_buffer_size)
+      flush();
+  }
+
+  //! Calls \a f for every stored event, in the order in which they were stored
+  template <class FunctionT>
+  void for_each(FunctionT f)
+  {
+    if (!file)
+      {
+        // everything is still in the buffer
+        for (const auto& event : buffer)
+          f(event);
+        buffer.clear();
+        return;
+      }
+    flush();
+    std::rewind(file);
+    buffer.resize(max_buffer_size);
+    std::size_t num_read;
+    while ((num_read = std::fread(buffer.data(), sizeof(SpilledEvent), max_buffer_size, file)) > 0)
+      for (std::size_t i = 0; i < num_read; ++i)
+        f(buffer[i]);
+    if (std::ferror(file))
+      error("LmToProjData: error reading temporary file with events of segments that were not in memory");
+    buffer.clear();
+  }
+
+private:
+  static const std::size_t max_buffer_size = 65536;
+  std::FILE* file;
+  std::vector<SpilledEvent> buffer;
+
+  void flush()
+  {
+    if (buffer.empty())
+      return;
+    if (!file)
+      {
+        file = std::tmpfile();
+        if (!file)
+          error("LmToProjData: cannot open temporary file for storing events of segments that are not in memory");
+      }
+    if (std::fwrite(buffer.data(), sizeof(SpilledEvent), buffer.size(), file) != buffer.size())
+      error("LmToProjData: error writing temporary file for events of segments that are not in memory (disk full?)");
+    buffer.clear();
+  }
+};
+//! Projection data filled by LmToProjData::process_data(), with the increments to use for prompts and delayeds
+struct HistogramOutput
+{
+  shared_ptr<ProjData> proj_data_sptr;
+  //! only used when not using SegmentByView
+  shared_ptr<iostream> stream;
+  int prompt_increment;
+  int delayed_increment;
+  //! segments in memory (indexed by timing position and segment number)
+  VectorWithOffset<VectorWithOffset<segment_type*>> segments;
+  //! events for the groups of segments that are not in memory (the first element is not used)
+  std::vector<shared_ptr<SpilledEvents>> spilled_events;
+};
+} // namespace
+
+bool
+LmToProjData::can_decode_events_in_parallel() const
+{
+  return lm_data_ptr->can_decode_records_in_parallel();
+}
+
 void
 LmToProjData::process_data()
 {
@@ -666,15 +916,18 @@ LmToProjData::process_data()
 
   double time_of_last_stored_event = 0;
   long num_stored_events = 0;
-  VectorWithOffset<segment_type*> segments(template_proj_data_info_ptr->get_min_segment_num(),
-                                           template_proj_data_info_ptr->get_max_segment_num());
 
-  VectorWithOffset<ListModeData::SavedPosition> frame_start_positions(1, static_cast<int>(frame_defs.get_num_frames()));
-  shared_ptr<ListRecord> record_sptr = lm_data_ptr->get_empty_record_sptr();
-  ListRecord& record = *record_sptr;
+  {
+    shared_ptr<ListRecord> record_sptr = lm_data_ptr->get_empty_record_sptr();
+    if (!record_sptr->event().is_valid_template(*template_proj_data_info_ptr))
+      error("The scanner template is not valid for LmToProjData. This might be because of unsupported arc correction.");
+  }
 
-  if (!record.event().is_valid_template(*template_proj_data_info_ptr))
-    error("The scanner template is not valid for LmToProjData. This might be because of unsupported arc correction.");
+  const bool decode_in_parallel = can_decode_events_in_parallel();
+  ListRecordBlockReader records(*lm_data_ptr);
+  // decoded bins for the records in the current block, and if they are in the range of the output
+  std::vector<Bin> bins(lm_to_projdata_block_size);
+  std::vector<char> bin_is_in_range(lm_to_projdata_block_size);
 
   /* Here starts the main loop which will store the listmode data. */
   for (current_frame_num = 1; current_frame_num <= frame_defs.get_num_frames(); ++current_frame_num)
@@ -688,8 +941,8 @@ LmToProjData::process_data()
         this_frame_exam_info.set_time_frame_definitions(this_time_frame_defs);
       }
 
-      // *********** open output file
-      shared_ptr<iostream> output;
+      // *********** open output files
+      std::vector<HistogramOutput> outputs(1);
       if (!output_proj_data_sptr)
         {
           writing_to_file = true;
@@ -697,8 +950,29 @@ LmToProjData::process_data()
           sprintf(rest, "_f%dg1d0b0", current_frame_num);
           const string output_filename = output_filename_prefix + rest;
 
-          output_proj_data_sptr = construct_proj_data(output, output_filename, this_frame_exam_info, template_proj_data_info_ptr);
+          output_proj_data_sptr
+              = construct_proj_data(outputs[0].stream, output_filename, this_frame_exam_info, template_proj_data_info_ptr);
         }
+      outputs[0].proj_data_sptr = output_proj_data_sptr;
+      outputs[0].prompt_increment = store_prompts ? 1 : 0;
+      outputs[0].delayed_increment = delayed_increment;
+      // extra outputs are only written to file (see the documentation of set_store_separate_prompts_and_delayeds())
+      if (store_separate_prompts_and_delayeds && writing_to_file && !interactive)
+        {
+          for (const bool prompts : { true, false })
+            {
+              HistogramOutput extra_output;
+              char rest[50];
+              sprintf(rest, "_%s_f%dg1d0b0", prompts ? "prompts" : "delayeds", current_frame_num);
+              const string output_filename = output_filename_prefix + rest;
+              extra_output.proj_data_sptr
+                  = construct_proj_data(extra_output.stream, output_filename, this_frame_exam_info, template_proj_data_info_ptr);
+              extra_output.prompt_increment = prompts ? 1 : 0;
+              extra_output.delayed_increment = prompts ? 0 : 1;
+              outputs.push_back(extra_output);
+            }
+        }
+      const ProjData& output_proj_data = *output_proj_data_sptr;
 
       long num_prompts_in_frame = 0;
       long num_delayeds_in_frame = 0;
@@ -706,200 +980,303 @@ LmToProjData::process_data()
       const double start_time = frame_defs.get_start_time(current_frame_num);
       const double end_time = frame_defs.get_end_time(current_frame_num);
 
-      VectorWithOffset<VectorWithOffset<segment_type*>> segments(template_proj_data_info_ptr->get_min_tof_pos_num(),
-                                                                 template_proj_data_info_ptr->get_max_tof_pos_num());
-      for (int timing_pos_num = segments.get_min_index(); timing_pos_num <= segments.get_max_index(); ++timing_pos_num)
+      for (auto& output : outputs)
         {
-          segments[timing_pos_num].resize(template_proj_data_info_ptr->get_min_segment_num(),
-                                          template_proj_data_info_ptr->get_max_segment_num());
+          output.segments.resize(template_proj_data_info_ptr->get_min_tof_pos_num(),
+                                 template_proj_data_info_ptr->get_max_tof_pos_num());
+          for (int timing_pos_num = output.segments.get_min_index(); timing_pos_num <= output.segments.get_max_index();
+               ++timing_pos_num)
+            {
+              output.segments[timing_pos_num].resize(template_proj_data_info_ptr->get_min_segment_num(),
+                                                     template_proj_data_info_ptr->get_max_segment_num());
+            }
         }
-      for (int start_timing_pos_index = output_proj_data_sptr->get_min_tof_pos_num();
-           start_timing_pos_index <= output_proj_data_sptr->get_max_tof_pos_num();
-           start_timing_pos_index += num_timing_poss_in_memory)
+
+      /*
+        The segments (and TOF bins) are divided in groups of num_segments_in_memory
+        (and num_timing_poss_in_memory). The first group is kept in memory while reading
+        the list-mode data, the events for the other groups are stored in temporary files.
+      */
+      const int min_timing_pos_num = output_proj_data.get_min_tof_pos_num();
+      const int min_segment_num = output_proj_data.get_min_segment_num();
+      const int num_segment_groups
+          = (output_proj_data.get_num_segments() + num_segments_in_memory - 1) / num_segments_in_memory;
+      const int num_timing_pos_groups
+          = (output_proj_data.get_num_tof_poss() + num_timing_poss_in_memory - 1) / num_timing_poss_in_memory;
+      const auto get_group_num = [&](const Bin& bin) {
+        return ((bin.timing_pos_num() - min_timing_pos_num) / num_timing_poss_in_memory) * num_segment_groups
+               + (bin.segment_num() - min_segment_num) / num_segments_in_memory;
+      };
+      const auto get_start_timing_pos_index = [&](const int group_num) {
+        return min_timing_pos_num + (group_num / num_segment_groups) * num_timing_poss_in_memory;
+      };
+      const auto get_end_timing_pos_index = [&](const int group_num) {
+        return min(output_proj_data.get_max_tof_pos_num(), get_start_timing_pos_index(group_num) + num_timing_poss_in_memory - 1);
+      };
+      const auto get_start_segment_index = [&](const int group_num) {
+        return min_segment_num + (group_num % num_segment_groups) * num_segments_in_memory;
+      };
+      const auto get_end_segment_index = [&](const int group_num) {
+        return min(output_proj_data.get_max_segment_num(), get_start_segment_index(group_num) + num_segments_in_memory - 1);
+      };
+      const int num_groups = num_segment_groups * num_timing_pos_groups;
+      // (events are not stored in interactive mode)
+      if (!interactive)
+        for (auto& output : outputs)
+          {
+            output.spilled_events.resize(num_groups);
+            for (int group_num = 1; group_num < num_groups; ++group_num)
+              output.spilled_events[group_num] = std::make_shared<SpilledEvents>();
+          }
+
+      if (!interactive)
+        for (auto& output : outputs)
+          allocate_segments(output.segments,
+                            get_start_timing_pos_index(0),
+                            get_end_timing_pos_index(0),
+                            get_start_segment_index(0),
+                            get_end_segment_index(0),
+                            output_proj_data.get_proj_data_info_sptr());
+      const auto delete_segments = [&](const int group_num) {
+        for (auto& output : outputs)
+          for (int timing_pos_num = get_start_timing_pos_index(group_num); timing_pos_num <= get_end_timing_pos_index(group_num);
+               timing_pos_num++)
+            for (int seg = get_start_segment_index(group_num); seg <= get_end_segment_index(group_num); seg++)
+              delete output.segments[timing_pos_num][seg];
+      };
+
+      // decode the events in records first_record,...,end_record-1 of the current block
+      const auto decode_events = [&](const std::size_t first_record, const std::size_t end_record) -> bool {
+        for (std::size_t i = first_record; i < end_record; ++i)
+          {
+            // set value in case the event decoder doesn't touch it
+            // otherwise it would be 0 and all events will be ignored
+            bins[i].set_bin_value(1.f);
+            bins[i].time_frame_num() = current_frame_num;
+          }
+        try
+          {
+            get_bins_from_records(&bins[first_record], records.get_records() + first_record, end_record - first_record);
+          }
+        catch (...)
+          {
+            return false;
+          }
+        for (std::size_t i = first_record; i < end_record; ++i)
+          {
+            if (!records[i].is_event())
+              continue;
+            Bin& bin = bins[i];
+            // check if it's inside the range we want to store
+            bin_is_in_range[i] = bin.get_bin_value() > 0
+                                 && bin.tangential_pos_num() >= output_proj_data.get_min_tangential_pos_num()
+                                 && bin.tangential_pos_num() <= output_proj_data.get_max_tangential_pos_num()
+                                 && bin.axial_pos_num() >= output_proj_data.get_min_axial_pos_num(bin.segment_num())
+                                 && bin.axial_pos_num() <= output_proj_data.get_max_axial_pos_num(bin.segment_num())
+                                 && bin.timing_pos_num() >= output_proj_data.get_min_tof_pos_num()
+                                 && bin.timing_pos_num() <= output_proj_data.get_max_tof_pos_num();
+            if (bin_is_in_range[i])
+              do_post_normalisation(bin);
+          }
+        return true;
+      };
+
+      cerr << "\nProcessing time frame " << current_frame_num << '\n';
+
+      // the next variable is used to see if there are more events to store
+      // num_events_to_store-more_events will be the number of allowed coincidence events currently seen in the file
+      // ('allowed' independent on the fact of we have its segment in memory or not)
+      // When do_time_frame=true, the number of events is irrelevant, so we
+      // just set more_events to 1, and never change it
+      unsigned long int more_events = do_time_frame ? 1 : num_events_to_store;
+      bool end_of_frame = false;
+
+      // loop over all events in the listmode file
+      while (more_events && !end_of_frame)
         {
-          const int end_timing_pos_index
-              = min(output_proj_data_sptr->get_max_tof_pos_num() + 1, start_timing_pos_index + num_timing_poss_in_memory) - 1;
-
-          /*
-            For each start_segment_index, we check which events occur in the
-            segments between start_segment_index and
-            start_segment_index+num_segments_in_memory.
-          */
-          for (int start_segment_index = output_proj_data_sptr->get_min_segment_num();
-               start_segment_index <= output_proj_data_sptr->get_max_segment_num();
-               start_segment_index += num_segments_in_memory)
+          if (records.position == records.size())
             {
-
-              const int end_segment_index
-                  = min(output_proj_data_sptr->get_max_segment_num() + 1, start_segment_index + num_segments_in_memory) - 1;
-
-              if (!interactive)
-                allocate_segments(segments,
-                                  start_timing_pos_index,
-                                  end_timing_pos_index,
-                                  start_segment_index,
-                                  end_segment_index,
-                                  output_proj_data_sptr->get_proj_data_info_sptr());
-
-              // the next variable is used to see if there are more events to store for the current segments
-              // num_events_to_store-more_events will be the number of allowed coincidence events currently seen in the file
-              // ('allowed' independent on the fact of we have its segment in memory or not)
-              // When do_time_frame=true, the number of events is irrelevant, so we
-              // just set more_events to 1, and never change it
-              unsigned long int more_events = do_time_frame ? 1 : num_events_to_store;
-
-              if (start_segment_index != output_proj_data_sptr->get_min_segment_num()
-                  || start_timing_pos_index > output_proj_data_sptr->get_min_tof_pos_num())
+              if (!records.read_next_block())
                 {
-                  // we're going once more through the data (for the next batch of segments)
-                  cerr << "\nProcessing next batch of segments for start TOF bin " << start_timing_pos_index << "\n";
-                  // go to the beginning of the listmode data for this frame
-                  lm_data_ptr->set_get_position(frame_start_positions[current_frame_num]);
-                  current_time = start_time;
+                  // no more events in file for some reason
+                  break; // get out of while loop
                 }
-              else
+            }
+          const std::size_t first_record = records.position;
+          const std::size_t num_records = records.size();
+          if (decode_in_parallel)
+            {
+              bool all_decoded = true;
+              const long int num_chunks = static_cast<long int>(
+                  (num_records - first_record + lm_to_projdata_decoding_chunk_size - 1) / lm_to_projdata_decoding_chunk_size);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(static) reduction(&& : all_decoded)
+#endif
+              for (long int chunk_num = 0; chunk_num < num_chunks; ++chunk_num)
+                {
+                  const std::size_t first_record_in_chunk = first_record + chunk_num * lm_to_projdata_decoding_chunk_size;
+                  const std::size_t end_record_in_chunk
+                      = min(first_record_in_chunk + lm_to_projdata_decoding_chunk_size, num_records);
+                  all_decoded = decode_events(first_record_in_chunk, end_record_in_chunk) && all_decoded;
+                }
+              if (!all_decoded)
                 {
-                  cerr << "\nProcessing time frame " << current_frame_num << '\n';
+                  if (!interactive)
+                    delete_segments(0);
+                  error("Something wrong with geometry.");
+                }
+            }
 
+          // handle the records in the order in which they occur in the list-mode data
+          for (std::size_t i = first_record; i < num_records && more_events; ++i)
+            {
+              records.position = i + 1;
+              const ListRecord& record = records[i];
+              if (current_time < start_time)
+                {
                   // Note: we already have current_time from previous frame, so don't
                   // need to set it. In fact, setting it to start_time would be wrong
                   // as we first might have to skip some events before we get to start_time.
-                  // So, let's do that now.
-                  while (current_time < start_time && lm_data_ptr->get_next_record(record) == Succeeded::yes)
+                  if (record.is_time())
+                    current_time = record.time().get_time_in_secs();
+                  continue;
+                }
+              if (record.is_time() && end_time > 0.01) // Direct comparison within doubles is unsafe.
+                {
+                  current_time = record.time().get_time_in_secs();
+                  if (do_time_frame && current_time >= end_time)
                     {
-                      if (record.is_time())
-                        current_time = record.time().get_time_in_secs();
+                      end_of_frame = true;
+                      break; // get out of for loop
                     }
-                  // now save position such that we can go back
-                  frame_start_positions[current_frame_num] = lm_data_ptr->save_get_position();
+                  assert(current_time >= start_time);
+                  process_new_time_event(record.time());
                 }
-              {
-                // loop over all events in the listmode file
-                while (more_events)
-                  {
-                    if (lm_data_ptr->get_next_record(record) == Succeeded::no)
-                      {
-                        // no more events in file for some reason
-                        break; // get out of while loop
-                      }
-                    if (record.is_time() && end_time > 0.01) // Direct comparison within doubles is unsafe.
-                      {
-                        current_time = record.time().get_time_in_secs();
-                        if (do_time_frame && current_time >= end_time)
-                          break; // get out of while loop
-                        assert(current_time >= start_time);
-                        process_new_time_event(record.time());
-                      }
-                    // note: could do "else if" here if we would be sure that
-                    // a record can never be both timing and coincidence event
-                    // and there might be a scanner around that has them both combined.
-                    if (record.is_event())
-                      {
-                        assert(start_time <= current_time);
-                        Bin bin;
-                        // set value in case the event decoder doesn't touch it
-                        // otherwise it would be 0 and all events will be ignored
-                        bin.set_bin_value(1.f);
-                        bin.time_frame_num() = current_frame_num;
-
-                        try
-                          {
-                            get_bin_from_event(bin, record.event());
-                          }
-                        catch (...)
-                          {
-                            for (int timing_pos_num = start_timing_pos_index; timing_pos_num <= end_timing_pos_index;
-                                 timing_pos_num++)
-                              for (int seg = start_segment_index; seg <= end_segment_index; seg++)
-                                delete segments[timing_pos_num][seg];
-                            error("Something wrong with geometry.");
-                          }
-
-                        // check if it's inside the range we want to store
-                        if (bin.get_bin_value() > 0
-                            && bin.tangential_pos_num() >= output_proj_data_sptr->get_min_tangential_pos_num()
-                            && bin.tangential_pos_num() <= output_proj_data_sptr->get_max_tangential_pos_num()
-                            && bin.axial_pos_num() >= output_proj_data_sptr->get_min_axial_pos_num(bin.segment_num())
-                            && bin.axial_pos_num() <= output_proj_data_sptr->get_max_axial_pos_num(bin.segment_num())
-                            && bin.timing_pos_num() >= output_proj_data_sptr->get_min_tof_pos_num()
-                            && bin.timing_pos_num() <= output_proj_data_sptr->get_max_tof_pos_num())
-                          {
-                            assert(bin.view_num() >= output_proj_data_sptr->get_min_view_num());
-                            assert(bin.view_num() <= output_proj_data_sptr->get_max_view_num());
-
-                            // see if we increment or decrement the value in the sinogram
-                            const int event_increment = record.event().is_prompt()
-                                                            ? (store_prompts ? 1 : 0) // it's a prompt
+              // note: could do "else if" here if we would be sure that
+              // a record can never be both timing and coincidence event
+              // and there might be a scanner around that has them both combined.
+              if (record.is_event())
+                {
+                  assert(start_time <= current_time);
+                  if (!decode_in_parallel && !decode_events(i, i + 1))
+                    {
+                      if (!interactive)
+                        delete_segments(0);
+                      error("Something wrong with geometry.");
+                    }
+                  const Bin& bin = bins[i];
+
+                  if (bin_is_in_range[i])
+                    {
+                      assert(bin.view_num() >= output_proj_data.get_min_view_num());
+                      assert(bin.view_num() <= output_proj_data.get_max_view_num());
+
+                      const bool is_prompt = record.event().is_prompt();
+                      // see if we increment or decrement the value in the (main) sinogram
+                      const int event_increment = is_prompt ? (store_prompts ? 1 : 0) // it's a prompt
                                                             : delayed_increment;      // it is a delayed-coincidence event
 
-                            if (event_increment == 0)
-                              continue;
-
-                            if (!do_time_frame)
-                              more_events -= event_increment;
-
-                            // Check if the timing position of the bin is in the range
-                            if (bin.timing_pos_num() >= start_timing_pos_index && bin.timing_pos_num() <= end_timing_pos_index)
-                              {
-                                // now check if we have its segment in memory
-                                if (bin.segment_num() >= start_segment_index && bin.segment_num() <= end_segment_index)
-                                  {
-                                    do_post_normalisation(bin);
-
-                                    num_stored_events += event_increment;
-                                    if (record.event().is_prompt())
-                                      ++num_prompts_in_frame;
-                                    else
-                                      ++num_delayeds_in_frame;
-
-                                    if (num_stored_events % 500000L == 0)
-                                      cout << "\r" << num_stored_events << " events stored" << flush;
-
-                                    if (interactive)
-                                      printf(
-                                          "TOFbin %4d Seg %4d view %4d ax_pos %4d tang_pos %4d time %8g stored with incr %d \n",
-                                          bin.timing_pos_num(),
-                                          bin.segment_num(),
-                                          bin.view_num(),
-                                          bin.axial_pos_num(),
-                                          bin.tangential_pos_num(),
-                                          current_time,
-                                          event_increment);
-                                    else
-                                      (*segments[bin.timing_pos_num()][bin.segment_num()])[bin.view_num()][bin.axial_pos_num()]
-                                                                                          [bin.tangential_pos_num()]
-                                          += bin.get_bin_value() * event_increment;
-                                  }
-                              }
-                          }
-                        else // event is rejected for some reason
-                          {
-                            if (interactive)
-                              printf("TOFbin %4d Seg %4d view %4d ax_pos %4d tang_pos %4d time %8g ignored\n",
-                                     bin.timing_pos_num(),
-                                     bin.segment_num(),
-                                     bin.view_num(),
-                                     bin.axial_pos_num(),
-                                     bin.tangential_pos_num(),
-                                     current_time);
-                          }
-                      } // end of spatial event processing
-                  }     // end of while loop over all events
-
-                time_of_last_stored_event = max(time_of_last_stored_event, current_time);
-              }
-
-              if (!interactive)
-                save_and_delete_segments(output,
-                                         segments,
-                                         start_timing_pos_index,
-                                         end_timing_pos_index,
-                                         start_segment_index,
-                                         end_segment_index,
-                                         *output_proj_data_sptr);
-            } // end of for loop for segment range
-
-        } // end of for loop for timing positions
+                      if (event_increment != 0)
+                        {
+                          if (!do_time_frame)
+                            more_events -= event_increment;
+
+                          num_stored_events += event_increment;
+                          if (is_prompt)
+                            ++num_prompts_in_frame;
+                          else
+                            ++num_delayeds_in_frame;
+
+                          if (num_stored_events % 500000L == 0)
+                            cout << "\r" << num_stored_events << " events stored" << flush;
+
+                          if (interactive)
+                            printf("TOFbin %4d Seg %4d view %4d ax_pos %4d tang_pos %4d time %8g stored with incr %d \n",
+                                   bin.timing_pos_num(),
+                                   bin.segment_num(),
+                                   bin.view_num(),
+                                   bin.axial_pos_num(),
+                                   bin.tangential_pos_num(),
+                                   current_time,
+                                   event_increment);
+                        }
+
+                      if (!interactive)
+                        {
+                          const int group_num = get_group_num(bin);
+                          for (auto& output : outputs)
+                            {
+                              const int increment = is_prompt ? output.prompt_increment : output.delayed_increment;
+                              if (increment == 0)
+                                continue;
+                              if (group_num == 0)
+                                (*output.segments[bin.timing_pos_num()][bin.segment_num()])[bin.view_num()][bin.axial_pos_num()]
+                                                                                           [bin.tangential_pos_num()]
+                                    += bin.get_bin_value() * increment;
+                              else
+                                output.spilled_events[group_num]->push_back(
+                                    SpilledEvent{ static_cast<std::int16_t>(bin.timing_pos_num()),
+                                                  static_cast<std::int16_t>(bin.segment_num()),
+                                                  static_cast<std::int16_t>(bin.view_num()),
+                                                  static_cast<std::int16_t>(bin.axial_pos_num()),
+                                                  static_cast<std::int16_t>(bin.tangential_pos_num()),
+                                                  bin.get_bin_value() * increment });
+                            }
+                        }
+                    }
+                  else // event is rejected for some reason
+                    {
+                      if (interactive)
+                        printf("TOFbin %4d Seg %4d view %4d ax_pos %4d tang_pos %4d time %8g ignored\n",
+                               bin.timing_pos_num(),
+                               bin.segment_num(),
+                               bin.view_num(),
+                               bin.axial_pos_num(),
+                               bin.tangential_pos_num(),
+                               current_time);
+                    }
+                } // end of spatial event processing
+            }     // end of for loop over records in block
+        }         // end of while loop over all events
+
+      time_of_last_stored_event = max(time_of_last_stored_event, current_time);
+
+      if (!interactive)
+        {
+          for (int group_num = 0; group_num < num_groups; ++group_num)
+            {
+              if (group_num > 0)
+                cerr << "\nAdding stored events for TOF bins " << get_start_timing_pos_index(group_num) << " to "
+                     << get_end_timing_pos_index(group_num) << " and segments " << get_start_segment_index(group_num) << " to "
+                     << get_end_segment_index(group_num) << "\n";
+              // handle one output at a time, such that only the first group of all outputs is in memory at the same time
+              for (auto& output : outputs)
+                {
+                  if (group_num > 0)
+                    {
+                      allocate_segments(output.segments,
+                                        get_start_timing_pos_index(group_num),
+                                        get_end_timing_pos_index(group_num),
+                                        get_start_segment_index(group_num),
+                                        get_end_segment_index(group_num),
+                                        output_proj_data.get_proj_data_info_sptr());
+                      output.spilled_events[group_num]->for_each([&](const SpilledEvent& event) {
+                        (*output.segments[event.timing_pos_num][event.segment_num])[event.view_num][event.axial_pos_num]
+                                                                                   [event.tangential_pos_num]
+                            += event.value;
+                      });
+                      output.spilled_events[group_num].reset();
+                    }
+                  save_and_delete_segments(output.stream,
+                                           output.segments,
+                                           get_start_timing_pos_index(group_num),
+                                           get_end_timing_pos_index(group_num),
+                                           get_start_segment_index(group_num),
+                                           get_end_segment_index(group_num),
+                                           *output.proj_data_sptr);
+                }
+            }
+        }
       cerr << "\nNumber of prompts stored in this time period : " << num_prompts_in_frame
            << "\nNumber of delayeds stored in this time period: " << num_delayeds_in_frame << '\n';
 
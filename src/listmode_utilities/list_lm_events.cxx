@@ -1,7 +1,7 @@
 /*
     Copyright (C) 2003-2011 Hammersmith Imanet Ltd
     Copyright (C) 2019, National Physical Laboratory
-    Copyright (C) 2019, 2021, University College of London
+    Copyright (C) 2019, 2021, 2026, University College of London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -126,20 +126,41 @@ main(int argc, char* argv[])
 
   unsigned long num_listed_events = 0;
   {
-    // loop over all events in the listmode file
-    shared_ptr<ListRecord> record_sptr = lm_data_ptr->get_empty_record_sptr();
-    ListRecord& record = *record_sptr;
+    // records are read in blocks, such that their bins can be found in one go
+    const std::size_t block_size = 1024;
+    vector<shared_ptr<ListRecord>> records(block_size);
+    vector<const ListRecord*> record_ptrs(block_size);
+    for (std::size_t i = 0; i < block_size; ++i)
+      {
+        records[i] = lm_data_ptr->get_empty_record_sptr();
+        record_ptrs[i] = records[i].get();
+      }
+    vector<Bin> bins(block_size);
+    std::size_t num_records_in_block = 0;
+    std::size_t record_num = 0;
 
+    // loop over all events in the listmode file
     while (num_events_to_list == 0 || num_events_to_list != num_listed_events)
       {
         bool recognised = false;
         bool listed = false;
-        //      std::cout<<"ciao"<<std::endl;
-        if (lm_data_ptr->get_next_record(record) == Succeeded::no)
+        if (record_num == num_records_in_block)
           {
-            // no more events in file for some reason
-            break; // get out of while loop
+            num_records_in_block = 0;
+            while (num_records_in_block < block_size
+                   && lm_data_ptr->get_next_record(*records[num_records_in_block]) == Succeeded::yes)
+              ++num_records_in_block;
+            if (num_records_in_block == 0)
+              {
+                // no more events in file for some reason
+                break; // get out of while loop
+              }
+            lm_data_ptr->get_bins_for_records(bins.data(), record_ptrs.data(), num_records_in_block, *proj_data_info_sptr);
+            record_num = 0;
           }
+        ListRecord& record = *records[record_num];
+        const Bin& bin = bins[record_num];
+        ++record_num;
         if (record.is_time())
           {
             recognised = true;
@@ -164,8 +185,6 @@ main(int argc, char* argv[])
         if (record.is_event())
           {
             recognised = true;
-            Bin bin;
-            record.event().get_bin(bin, *proj_data_info_sptr);
 
             if (list_coincidence)
               {
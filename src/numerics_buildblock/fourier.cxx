@@ -7,7 +7,7 @@
 */
 /*
     Copyright (C) 2003 - 2005-01-17, Hammersmith Imanet Ltd
-    Copyright (C) 2023, University College London
+    Copyright (C) 2023, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -19,40 +19,84 @@
 #include "stir/modulo.h"
 #include "stir/array_index_functions.h"
 #include "stir/error.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
 START_NAMESPACE_STIR
 
-template <typename T>
-static void
-bitreversal(VectorWithOffset<T>& data)
+namespace detail
 {
-  const int n = data.get_length();
-  int j = 1;
-  for (int i = 0; i < n; ++i)
-    {
-      if (j / 2 > i)
-        {
-          std::swap(data[j / 2], data[i]);
-        }
-      int m = n;
-      while (m >= 2 && j > m)
-        {
-          j -= m;
-          m >>= 1;
-        }
-      j += m;
-    }
+
+/* Information needed to compute a DFT of a particular length and sign.
+
+   This is computed only once for every length and sign (see get_fourier_plan()), as
+   computing the complex exponentials takes about as long as the DFT itself.
+*/
+struct FourierPlan
+{
+  FourierPlan(const int length, const int sign);
+
+  //! pairs of indices that have to be swapped for the bit-reversal
+  std::vector<std::pair<int, int>> bitreversal_swaps;
+  //! twiddle factors for every stage, with <tt>exp(sign*i*_PI/pow2k)</tt> stored at index <tt>pow2k-1+i</tt>
+  std::vector<std::complex<float>> twiddles;
+  //! factors <tt>exp(i*(sign*i*_PI/length - _PI/2))</tt> used by the DFT of a real array of size <tt>2*length</tt>
+  std::vector<std::complex<float>> real_data_twiddles;
+};
+
+FourierPlan::FourierPlan(const int length, const int sign)
+{
+  {
+    int j = 1;
+    for (int i = 0; i < length; ++i)
+      {
+        if (j / 2 > i)
+          bitreversal_swaps.push_back(std::make_pair(j / 2, i));
+        int m = length;
+        while (m >= 2 && j > m)
+          {
+            j -= m;
+            m >>= 1;
+          }
+        j += m;
+      }
+  }
+  twiddles.reserve(length > 0 ? length - 1 : 0);
+  for (int pow2k = 1; pow2k < length; pow2k *= 2)
+    for (int i = 0; i < pow2k; ++i)
+      twiddles.push_back(std::complex<float>(std::polar(1., (sign * i * _PI) / pow2k)));
+  for (int i = 0; i <= length / 2; ++i)
+    real_data_twiddles.push_back(std::complex<float>(std::polar(1., (sign * i * _PI) / length - _PI / 2)));
 }
 
-// internal function to create vector of size pow2k with exparray[i] = exp(sign*i*_PI/pow2k)
-static VectorWithOffset<std::complex<float>>
-get_exparray(const int pow2k, const int sign)
+// returns the plan for this length and sign, constructing it if it does not exist yet.
+// There are only a few lengths (powers of 2), so we never remove any plans.
+static const FourierPlan&
+get_fourier_plan(const int length, const int sign)
 {
-  VectorWithOffset<std::complex<float>> a(pow2k);
-  for (int i = 0; i < pow2k; ++i)
-    a[i] = std::exp(std::complex<float>(0, static_cast<float>((sign * i * _PI) / pow2k)));
-  return a;
+  // every thread remembers the plans it has used, such that the mutex is only
+  // locked the first time a thread needs a particular plan
+  thread_local std::map<std::pair<int, int>, const FourierPlan*> plans_of_thread;
+  const FourierPlan*& plan_of_thread_ptr = plans_of_thread[std::make_pair(length, sign)];
+  if (plan_of_thread_ptr)
+    return *plan_of_thread_ptr;
+
+  static std::map<std::pair<int, int>, std::unique_ptr<const FourierPlan>> plans;
+  static std::mutex plans_mutex;
+
+  std::lock_guard<std::mutex> lock(plans_mutex);
+  auto& plan_ptr = plans[std::make_pair(length, sign)];
+  if (!plan_ptr)
+    plan_ptr.reset(new FourierPlan(length, sign));
+  plan_of_thread_ptr = plan_ptr.get();
+  return *plan_ptr;
 }
 
+} // end of namespace detail
+
 /* First we define 1D fourier transforms of vectors with almost arbitrary
    element types.
    This is almost a straightforward 1D FFT implementation. The only tricky bit
@@ -60,33 +104,35 @@ get_exparray(const int pow2k, const int sign)
    (and efficient) in the case that the element type is a vector again.
 */
 
-template <typename T>
-void
-fourier_1d(T& c, const int sign)
+static void
+check_length_is_power_of_2(const int length)
 {
-  if (c.size() == 0)
-    return;
-  assert(c.get_min_index() == 0);
-  assert(sign == 1 || sign == -1);
-  bitreversal(c);
   // find 'nn' which is such that length==2^nn
-  const int nn = round(log(static_cast<double>(c.size())) / log(2.));
-  if (c.get_length() != round(pow(2., nn)))
-    error("fourier_1d called with array length %d which is not 2^%d\n", c.size(), nn);
-
-  int k = 0;
-  int pow2k = 1;                     // will be updated to be round(pow(2,k))
-  const int pow2nn = c.get_length(); // ==round(pow(2,nn));
-  for (; k < nn; ++k, pow2k *= 2)
+  const int nn = round(log(static_cast<double>(length)) / log(2.));
+  if (length != round(pow(2., nn)))
+    error("fourier_1d called with array length %d which is not 2^%d\n", length, nn);
+}
+
+// T can be a vector (with elements that are vectors again), or a pointer to contiguous data
+template <typename T>
+static void
+fourier_1d_using_plan(T& c, const int pow2nn, const detail::FourierPlan& plan)
+{
+  for (const auto& swap_indices : plan.bitreversal_swaps)
+    std::swap(c[swap_indices.first], c[swap_indices.second]);
+
+  // declared outside the loop, such that memory is reused in the multi-dimensional case
+  typename std::decay<decltype(c[0])>::type t1;
+  for (int pow2k = 1; pow2k < pow2nn; pow2k *= 2)
     {
-      const auto cur_exparray = get_exparray(pow2k, sign);
+      const std::complex<float>* const cur_exparray = &plan.twiddles[pow2k - 1];
       for (int j = 0; j < pow2nn; j += pow2k * 2)
         for (int i = 0; i < pow2k; ++i)
           {
-            typename T::reference c1 = c[i + j];
-            typename T::reference c2 = c[i + j + pow2k];
+            auto& c1 = c[i + j];
+            auto& c2 = c[i + j + pow2k];
 
-            typename T::value_type const t1 = c1;
+            t1 = c1;
             /* here is what we have to do:
                 typename T::value_type const t2 =
                   c2*cur_exparray[i];
@@ -110,6 +156,63 @@ fourier_1d(T& c, const int sign)
 namespace detail
 {
 
+// STIR's own implementation, used as default backend
+class FourierBackendUsingPlans : public FourierBackend
+{
+public:
+  void fourier_1d(std::complex<float>* c, const int length, const int sign) const override
+  {
+    fourier_1d_using_plan(c, length, get_fourier_plan(length, sign));
+  }
+};
+
+static shared_ptr<const FourierBackend>&
+fourier_backend_sptr()
+{
+  static shared_ptr<const FourierBackend> backend_sptr(new FourierBackendUsingPlans);
+  return backend_sptr;
+}
+
+} // end of namespace detail
+
+void
+set_fourier_backend(const shared_ptr<const FourierBackend>& backend_sptr)
+{
+  if (backend_sptr)
+    detail::fourier_backend_sptr() = backend_sptr;
+  else
+    detail::fourier_backend_sptr().reset(new detail::FourierBackendUsingPlans);
+}
+
+const FourierBackend&
+get_fourier_backend()
+{
+  return *detail::fourier_backend_sptr();
+}
+
+template <typename T>
+void
+fourier_1d(T& c, const int sign)
+{
+  if (c.size() == 0)
+    return;
+  assert(c.get_min_index() == 0);
+  assert(sign == 1 || sign == -1);
+  const int length = c.get_length();
+  check_length_is_power_of_2(length);
+  if constexpr (std::is_same<typename T::value_type, std::complex<float>>::value)
+    {
+      // contiguous data, so we can pass it to the backend
+      get_fourier_backend().fourier_1d(c.get_data_ptr(), length, sign);
+      c.release_data_ptr();
+    }
+  else
+    fourier_1d_using_plan(c, length, detail::get_fourier_plan(length, sign));
+}
+
+namespace detail
+{
+
 /* A class that does the recursion for multi-dimensional arrays.
 
    This is done with a class because partial template specialisation is
@@ -152,21 +255,20 @@ fourier(T& c, const int sign)
 // specialisation for the one-dimensional case
 
 template <typename T>
-Array<1, std::complex<T>>
-fourier_1d_for_real_data(const Array<1, T>& v, const int sign)
-// Array<1,std::complex<typename T::value_type> >
-// fourier_1d_for_real_data(const T& v, const int sign)
+void
+fourier_1d_for_real_data(Array<1, std::complex<T>>& c, const Array<1, T>& v, const int sign)
 {
-  // typedef std::complex<typename T::value_type> complex_t;
   typedef std::complex<T> complex_t;
   if (v.size() == 0)
-    return Array<1, complex_t>();
+    {
+      c.resize(0);
+      return;
+    }
   assert(v.get_min_index() == 0);
   assert(sign == 1 || sign == -1);
   if (v.size() % 2 != 0)
     error("fourier_1d_of_real can only handle arrays of even length.\n");
 
-  Array<1, complex_t> c;
   const unsigned int n = static_cast<unsigned int>(v.size() / 2);
   // we reserve a range of 0,n here, such that
   // resize(n) later doesn't reallocate and copy
@@ -179,16 +281,16 @@ fourier_1d_for_real_data(const Array<1, T>& v, const int sign)
     c[i] = complex_t(v[2 * i] / 2, v[2 * i + 1] / 2);
 
   fourier_1d(c, sign);
+  const detail::FourierPlan& plan = detail::get_fourier_plan(c.get_length(), sign);
 
   // cout << "C: " << c;
   c.resize(n + 1);
   for (unsigned int i = 1; i <= n / 2; ++i)
     {
       const complex_t t1 = (c[i] + std::conj(c[n - i]));
-      // TODO could get exp() from static exparray
       // the nice thing about this code that it works even when the length is not a power of 2
       // (but of course, the call to fourier_1d would currently abort in that case)
-      const complex_t t2 = std::exp(complex_t(0, static_cast<T>(sign * (i * _PI) / n - _PI / 2))) * (c[i] - std::conj(c[n - i]));
+      const complex_t t2 = complex_t(plan.real_data_twiddles[i]) * (c[i] - std::conj(c[n - i]));
 
       c[i] = (t1 + t2);
       c[n - i] = std::conj(t1 - t2);
@@ -198,16 +300,27 @@ fourier_1d_for_real_data(const Array<1, T>& v, const int sign)
     c[0] = (c0_copy.real() + c0_copy.imag()) * 2;
     c[n] = (c0_copy.real() - c0_copy.imag()) * 2;
   }
+}
+
+template <typename T>
+Array<1, std::complex<T>>
+fourier_1d_for_real_data(const Array<1, T>& v, const int sign)
+{
+  Array<1, std::complex<T>> c;
+  fourier_1d_for_real_data(c, v, sign);
   return c;
 }
 
 template <typename T>
-Array<1, T>
-inverse_fourier_1d_for_real_data_corrupting_input(Array<1, std::complex<T>>& c, const int sign)
+void
+inverse_fourier_1d_for_real_data_corrupting_input(Array<1, T>& v, Array<1, std::complex<T>>& c, const int sign)
 {
   typedef std::complex<T> complex_t;
   if (c.size() == 0)
-    return Array<1, T>();
+    {
+      v.resize(0);
+      return;
+    }
   assert(c.get_min_index() == 0);
   assert(sign == 1 || sign == -1);
   const int n = c.get_length() - 1;
@@ -225,11 +338,12 @@ inverse_fourier_1d_for_real_data_corrupting_input(Array<1, std::complex<T>>& c,
   */
   // assert(fabs(c[0].imag())<=.001*norm(c.begin_all(),c.end_all())/sqrt(n+1.)); // note divide by n+1 to avoid division by 0
   // assert(fabs(c[n].imag())<=.001*norm(c.begin_all(),c.end_all())/sqrt(n+1.));
+  const detail::FourierPlan& plan = detail::get_fourier_plan(n, sign);
   for (int i = 1; i <= n / 2; ++i)
     {
       const complex_t t1 = (c[i] + std::conj(c[n - i]));
-      // TODO could get exp() from static exparray
-      const complex_t t2 = std::exp(complex_t(0, static_cast<T>(-sign * (i * _PI) / n + _PI / 2))) * (c[i] - std::conj(c[n - i]));
+      // note: exp(i*(-sign*i*_PI/n + _PI/2)) is the complex conjugate of the factor used for the forward DFT
+      const complex_t t2 = std::conj(complex_t(plan.real_data_twiddles[i])) * (c[i] - std::conj(c[n - i]));
 
       c[i] = (t1 + t2);
       c[n - i] = std::conj(t1 - t2);
@@ -243,12 +357,20 @@ inverse_fourier_1d_for_real_data_corrupting_input(Array<1, std::complex<T>>& c,
   // cout << "\nC: " << c/4;
   inverse_fourier(c, sign);
   // extract real numbers.
-  Array<1, T> v(2 * n);
+  v.resize(2 * n);
   for (int i = 0; i < n; ++i)
     {
       v[2 * i] = c[i].real() / 2;
       v[2 * i + 1] = c[i].imag() / 2;
     }
+}
+
+template <typename T>
+Array<1, T>
+inverse_fourier_1d_for_real_data_corrupting_input(Array<1, std::complex<T>>& c, const int sign)
+{
+  Array<1, T> v;
+  inverse_fourier_1d_for_real_data_corrupting_input(v, c, sign);
   return v;
 }
 
@@ -275,37 +397,48 @@ struct fourier_for_real_data_auxiliary
   static Array<num_dimensions, std::complex<elemT>> do_fourier_for_real_data(const Array<num_dimensions, elemT>& c,
                                                                              const int sign)
   {
-    // complicated business to get index range which is as follows:
-    // outer_dimension = outer_dimension of c
-    // all other dimensions are as small as possible (to avoid reallocations)
-    BasicCoordinate<num_dimensions, int> min_index, max_index;
-    for (int d = 2; d <= num_dimensions; ++d)
-      min_index[d] = max_index[d] = 0;
-    min_index[1] = c.get_min_index();
-    max_index[1] = c.get_max_index();
-    Array<num_dimensions, std::complex<elemT>> array(IndexRange<num_dimensions>(min_index, max_index));
-    for (int i = c.get_min_index(); i <= c.get_max_index(); ++i)
-      array[i] = fourier_for_real_data(c[i], sign);
-    fourier_1d(array, sign);
+    Array<num_dimensions, std::complex<elemT>> array;
+    do_fourier_for_real_data(array, c, sign);
     return array;
   }
   static Array<num_dimensions, elemT>
   do_inverse_fourier_for_real_data_corrupting_input(Array<num_dimensions, std::complex<elemT>>& c, const int sign)
   {
-    inverse_fourier_1d(c, sign);
-    // complicated business to get index range which is as follows:
-    // outer_dimension = outer_dimension of c
-    // all other dimensions are as small as possible (to avoid reallocations)
+    Array<num_dimensions, elemT> array;
+    do_inverse_fourier_for_real_data_corrupting_input(array, c, sign);
+    return array;
+  }
+  // make sure that the outer dimension of result is the same as the one of c.
+  // If result has to be reallocated, all other dimensions are as small as possible (to avoid reallocations later)
+  template <class ArrayT1, class ArrayT2>
+  static void set_outer_range(ArrayT1& result, const ArrayT2& c)
+  {
+    if (result.get_min_index() == c.get_min_index() && result.get_max_index() == c.get_max_index())
+      return;
     BasicCoordinate<num_dimensions, int> min_index, max_index;
     for (int d = 2; d <= num_dimensions; ++d)
       min_index[d] = max_index[d] = 0;
     min_index[1] = c.get_min_index();
     max_index[1] = c.get_max_index();
-    Array<num_dimensions, elemT> array(IndexRange<num_dimensions>(min_index, max_index));
-
+    result = ArrayT1(IndexRange<num_dimensions>(min_index, max_index));
+  }
+  // versions that write in an existing array, reusing the memory of its elements
+  static void
+  do_fourier_for_real_data(Array<num_dimensions, std::complex<elemT>>& result, const Array<num_dimensions, elemT>& c, const int sign)
+  {
+    set_outer_range(result, c);
     for (int i = c.get_min_index(); i <= c.get_max_index(); ++i)
-      array[i] = inverse_fourier_for_real_data_corrupting_input(c[i], sign);
-    return array;
+      fourier_for_real_data(result[i], c[i], sign);
+    fourier_1d(result, sign);
+  }
+  static void do_inverse_fourier_for_real_data_corrupting_input(Array<num_dimensions, elemT>& result,
+                                                                Array<num_dimensions, std::complex<elemT>>& c,
+                                                                const int sign)
+  {
+    inverse_fourier_1d(c, sign);
+    set_outer_range(result, c);
+    for (int i = c.get_min_index(); i <= c.get_max_index(); ++i)
+      inverse_fourier_for_real_data_corrupting_input(result[i], c[i], sign);
   }
 };
 
@@ -320,6 +453,15 @@ struct fourier_for_real_data_auxiliary<1, elemT>
   {
     return inverse_fourier_1d_for_real_data_corrupting_input(c, sign);
   }
+  static void do_fourier_for_real_data(Array<1, std::complex<elemT>>& result, const Array<1, elemT>& c, const int sign)
+  {
+    fourier_1d_for_real_data(result, c, sign);
+  }
+  static void
+  do_inverse_fourier_for_real_data_corrupting_input(Array<1, elemT>& result, Array<1, std::complex<elemT>>& c, const int sign)
+  {
+    inverse_fourier_1d_for_real_data_corrupting_input(result, c, sign);
+  }
 };
 
 } // end of namespace detail
@@ -339,6 +481,23 @@ inverse_fourier_for_real_data_corrupting_input(Array<num_dimensions, std::comple
   return detail::fourier_for_real_data_auxiliary<num_dimensions, T>::do_inverse_fourier_for_real_data_corrupting_input(c, sign);
 }
 
+template <int num_dimensions, typename T>
+void
+fourier_for_real_data(Array<num_dimensions, std::complex<T>>& result, const Array<num_dimensions, T>& c, const int sign)
+{
+  detail::fourier_for_real_data_auxiliary<num_dimensions, T>::do_fourier_for_real_data(result, c, sign);
+}
+
+template <int num_dimensions, typename T>
+void
+inverse_fourier_for_real_data_corrupting_input(Array<num_dimensions, T>& result,
+                                               Array<num_dimensions, std::complex<T>>& c,
+                                               const int sign)
+{
+  detail::fourier_for_real_data_auxiliary<num_dimensions, T>::do_inverse_fourier_for_real_data_corrupting_input(
+      result, c, sign);
+}
+
 template <int num_dimensions, typename T>
 Array<num_dimensions, T>
 inverse_fourier_for_real_data(const Array<num_dimensions, std::complex<T>>& c, const int sign)
@@ -390,11 +549,21 @@ template void fourier<>(VectorWithOffset<std::complex<float>>& c, const int sign
   template Array<d, std::complex<type>> fourier_for_real_data<>(const Array<d, type>& v, const int sign);                        \
   template Array<d, type> inverse_fourier_for_real_data_corrupting_input<>(Array<d, std::complex<type>> & c, const int sign);    \
   template Array<d, type> inverse_fourier_for_real_data<>(const Array<d, std::complex<type>>& c, const int sign);                \
-  template Array<d, std::complex<type>> pos_frequencies_to_all<>(const Array<d, std::complex<type>>& c);
+  template Array<d, std::complex<type>> pos_frequencies_to_all<>(const Array<d, std::complex<type>>& c);                       \
+  template void fourier_for_real_data<>(Array<d, std::complex<type>> & result, const Array<d, type>& v, const int sign);        \
+  template void inverse_fourier_for_real_data_corrupting_input<>(                                                              \
+      Array<d, type> & result, Array<d, std::complex<type>> & c, const int sign);
 
 INSTANTIATE(1, float);
 INSTANTIATE(2, float);
 INSTANTIATE(3, float);
 #undef INSTANTIATE
 
+template Array<1, std::complex<float>> fourier_1d_for_real_data<>(const Array<1, float>& v, const int sign);
+template void fourier_1d_for_real_data<>(Array<1, std::complex<float>>& c, const Array<1, float>& v, const int sign);
+template Array<1, float> inverse_fourier_1d_for_real_data<>(const Array<1, std::complex<float>>& c, const int sign);
+template Array<1, float> inverse_fourier_1d_for_real_data_corrupting_input<>(Array<1, std::complex<float>>& c, const int sign);
+template void
+inverse_fourier_1d_for_real_data_corrupting_input<>(Array<1, float>& v, Array<1, std::complex<float>>& c, const int sign);
+
 END_NAMESPACE_STIR
@@ -14,7 +14,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2015, 2018-2019, University College London
+    Copyright (C) 2015, 2018-2019, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -32,17 +32,37 @@
 #include "stir/is_null_ptr.h"
 #include "stir/DataProcessor.h"
 #include <vector>
+#include <algorithm>
 #ifdef STIR_OPENMP
 #  include "stir/is_null_ptr.h"
 #  include "stir/DiscretisedDensity.h"
 #  include <omp.h>
+#  if defined(__unix__) || defined(__APPLE__)
+#    include <unistd.h>
+#  endif
 #endif
 #include <boost/format.hpp>
 
 START_NAMESPACE_STIR
 
+#ifdef STIR_OPENMP
+// local function to find the amount of physical memory (in bytes), or 0 if unknown
+static double
+get_physical_memory_size()
+{
+#  if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+  const long num_pages = sysconf(_SC_PHYS_PAGES);
+  const long page_size = sysconf(_SC_PAGESIZE);
+  if (num_pages > 0 && page_size > 0)
+    return static_cast<double>(num_pages) * page_size;
+#  endif
+  return 0.;
+}
+#endif
+
 BackProjectorByBin::BackProjectorByBin()
-    : _already_set_up(false)
+    : _already_set_up(false),
+      _max_num_local_images(0)
 {
   set_defaults();
 }
@@ -54,6 +74,7 @@ void
 BackProjectorByBin::set_defaults()
 {
   _post_data_processor_sptr.reset();
+  _max_num_local_images = 0;
 }
 
 void
@@ -62,6 +83,7 @@ BackProjectorByBin::initialise_keymap()
   parser.add_start_key("Back Projector Parameters");
   parser.add_stop_key("End Back Projector Parameters");
   parser.add_parsing_key("post data processor", &_post_data_processor_sptr);
+  parser.add_key("maximum number of local images", &_max_num_local_images);
 }
 
 void
@@ -72,12 +94,33 @@ BackProjectorByBin::set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_
   _proj_data_info_sptr = proj_data_info_sptr->create_shared_clone();
   _density_sptr.reset(density_info_sptr->clone());
 
+  if (_max_num_local_images < 0)
+    error("BackProjectorByBin: maximum number of local images should be non-negative");
 #ifdef STIR_OPENMP
+  int num_threads = 1;
 #  pragma omp parallel
   {
 #  pragma omp single
-    _local_output_image_sptrs.resize(omp_get_num_threads(), shared_ptr<DiscretisedDensity<3, float>>());
+    num_threads = omp_get_num_threads();
   }
+  int num_local_images = num_threads;
+  if (_max_num_local_images > 0)
+    num_local_images = std::min(num_threads, _max_num_local_images);
+  else
+    {
+      // use at most a quarter of the physical memory for the local images
+      const double image_size = static_cast<double>(density_info_sptr->size_all()) * sizeof(float);
+      const double memory_size = get_physical_memory_size();
+      if (memory_size > 0 && image_size > 0)
+        num_local_images = std::max(1, static_cast<int>(std::min(double(num_threads), memory_size / 4 / image_size)));
+      if (num_local_images < num_threads)
+        info(boost::format("BackProjectorByBin: using %1% images to accumulate the back projection of %2% threads "
+                           "(limited by available memory)")
+                 % num_local_images % num_threads,
+             2);
+    }
+  _local_output_image_sptrs.resize(num_local_images, shared_ptr<DiscretisedDensity<3, float>>());
+  _local_output_image_mutexes_sptr.reset(new std::vector<std::mutex>(num_local_images));
   for (int i = 0; i < static_cast<int>(_local_output_image_sptrs.size()); ++i)
     if (!is_null_ptr(_local_output_image_sptrs[i])) // already created in previous run
       if (!_local_output_image_sptrs[i]->has_same_characteristics(*density_info_sptr))
@@ -197,6 +240,28 @@ BackProjectorByBin::back_project(const ProjData& proj_data, int subset_num, int
                                              subset_num,
                                              num_subsets);
 
+  if (proj_data.get_proj_data_info_sptr()->is_tof_data() && this->can_fuse_timing_positions())
+    {
+      // handle all TOF bins of a view/segment at once, such that the geometric part can be shared
+#ifdef STIR_OPENMP
+#  pragma omp parallel for shared(proj_data, symmetries_sptr) schedule(dynamic)
+#endif
+      for (int i = 0; i < static_cast<int>(vs_nums_to_process.size()); ++i)
+        {
+          const ViewSegmentNumbers vs = vs_nums_to_process[i];
+          std::vector<RelatedViewgrams<float>> viewgrams_all_timing_positions;
+#ifdef STIR_OPENMP
+#  pragma omp critical(BACKPROJECTORBYBIN_GETVIEWGRAMS)
+#endif
+          for (int k = proj_data.get_min_tof_pos_num(); k <= proj_data.get_max_tof_pos_num(); ++k)
+            viewgrams_all_timing_positions.push_back(proj_data.get_related_viewgrams(vs, symmetries_sptr, false, k));
+          info(boost::format("Processing view %1% of segment %2% for all TOF bins") % vs.view_num() % vs.segment_num(), 3);
+
+          back_project_all_timing_positions(viewgrams_all_timing_positions);
+        }
+      return;
+    }
+
 #ifdef STIR_OPENMP
 #  if _OPENMP < 201107
 #    pragma omp parallel for shared(proj_data, symmetries_sptr) schedule(dynamic)
@@ -263,13 +328,15 @@ BackProjectorByBin::back_project(const RelatedViewgrams<float>& viewgrams,
   if (!_density_sptr)
     error("You need to call start_accumulating_in_new_target() before back_project()");
 
-  check(*viewgrams.get_proj_data_info_sptr());
+  check_related_viewgrams(viewgrams);
 
-#ifdef STIR_OPENMP
-  const int thread_num = omp_get_thread_num();
-  if (is_null_ptr(_local_output_image_sptrs[thread_num]))
-    _local_output_image_sptrs[thread_num].reset(_density_sptr->get_empty_copy());
-#endif
+  actual_back_project(viewgrams, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num);
+}
+
+void
+BackProjectorByBin::check_related_viewgrams(const RelatedViewgrams<float>& viewgrams) const
+{
+  check(*viewgrams.get_proj_data_info_sptr());
 
   // first check symmetries
   {
@@ -288,8 +355,6 @@ BackProjectorByBin::back_project(const RelatedViewgrams<float>& viewgrams,
           error("BackProjectorByBin::back_project called with incorrect related_viewgrams. Problem with symmetries!\n");
       }
   }
-
-  actual_back_project(viewgrams, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num);
 }
 
 void
@@ -306,8 +371,15 @@ BackProjectorByBin::start_accumulating_in_new_target()
       {
         if (!_local_output_image_sptrs.at(i)->has_same_characteristics(*_density_sptr))
           error("BackProjectorByBin implementation error: local images for openmp have wrong size");
-        _local_output_image_sptrs.at(i)->fill(0.F);
       }
+  // fill with zeroes in parallel over planes
+#  pragma omp parallel for schedule(static)
+  for (int z = _density_sptr->get_min_index(); z <= _density_sptr->get_max_index(); ++z)
+    {
+      for (int i = 0; i < static_cast<int>(_local_output_image_sptrs.size()); ++i)
+        if (!is_null_ptr(_local_output_image_sptrs[i]))
+          (*_local_output_image_sptrs[i])[z].fill(0.F);
+    }
 
 #endif
   _density_sptr->fill(0.);
@@ -323,15 +395,19 @@ BackProjectorByBin::get_output(DiscretisedDensity<3, float>& density) const
   if (omp_get_num_threads() != 1)
     error("BackProjectorByBin::get_output() cannot be called inside a thread");
 
-  // "reduce" data constructed by threads
-  {
-    density.fill(0.F);
-    for (int i = 0; i < static_cast<int>(_local_output_image_sptrs.size()); ++i)
-      {
-        if (!is_null_ptr(_local_output_image_sptrs[i])) // only accumulate if a thread filled something in
-          density += *(_local_output_image_sptrs[i]);
-      }
-  }
+  // "reduce" data constructed by threads, in parallel over planes.
+  // Every voxel is summed in the same order as in a serial loop over the images,
+  // so the result does not depend on the number of threads used here.
+#  pragma omp parallel for schedule(static)
+  for (int z = density.get_min_index(); z <= density.get_max_index(); ++z)
+    {
+      density[z].fill(0.F);
+      for (int i = 0; i < static_cast<int>(_local_output_image_sptrs.size()); ++i)
+        {
+          if (!is_null_ptr(_local_output_image_sptrs[i])) // only accumulate if a thread filled something in
+            density[z] += (*_local_output_image_sptrs[i])[z];
+        }
+    }
 #else
   std::copy(_density_sptr->begin_all(), _density_sptr->end_all(), density.begin_all());
 #endif
@@ -351,6 +427,18 @@ BackProjectorByBin::set_post_data_processor(shared_ptr<DataProcessor<Discretised
   _post_data_processor_sptr = post_data_processor_sptr;
 }
 
+void
+BackProjectorByBin::set_maximum_number_of_local_images(const int max_num_local_images)
+{
+  _max_num_local_images = max_num_local_images;
+}
+
+int
+BackProjectorByBin::get_maximum_number_of_local_images() const
+{
+  return _max_num_local_images;
+}
+
 void
 BackProjectorByBin::actual_back_project(
     DiscretisedDensity<3, float>&, const RelatedViewgrams<float>&, const int, const int, const int, const int)
@@ -365,13 +453,83 @@ BackProjectorByBin::actual_back_project(const RelatedViewgrams<float>& viewgrams
                                         const int min_tangential_pos_num,
                                         const int max_tangential_pos_num)
 {
-  shared_ptr<DiscretisedDensity<3, float>> density_sptr = _density_sptr;
 #ifdef STIR_OPENMP
-  const int thread_num = omp_get_thread_num();
-  density_sptr = _local_output_image_sptrs[thread_num];
+  // find an image that is not used by another thread, and lock it
+  const int image_num = lock_local_output_image();
+  std::lock_guard<std::mutex> lock((*_local_output_image_mutexes_sptr)[image_num], std::adopt_lock);
+  shared_ptr<DiscretisedDensity<3, float>> density_sptr = _local_output_image_sptrs[image_num];
+#else
+  shared_ptr<DiscretisedDensity<3, float>> density_sptr = _density_sptr;
 #endif
   actual_back_project(
       *density_sptr, viewgrams, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num);
 }
 
+bool
+BackProjectorByBin::can_fuse_timing_positions() const
+{
+  return false;
+}
+
+void
+BackProjectorByBin::actual_back_project_all_timing_positions(
+    DiscretisedDensity<3, float>& density, const std::vector<RelatedViewgrams<float>>& viewgrams_all_timing_positions)
+{
+  for (const auto& viewgrams : viewgrams_all_timing_positions)
+    actual_back_project(density,
+                        viewgrams,
+                        viewgrams.get_min_axial_pos_num(),
+                        viewgrams.get_max_axial_pos_num(),
+                        viewgrams.get_min_tangential_pos_num(),
+                        viewgrams.get_max_tangential_pos_num());
+}
+
+#ifdef STIR_OPENMP
+int
+BackProjectorByBin::lock_local_output_image()
+{
+  auto& mutexes = *_local_output_image_mutexes_sptr;
+  const int num_images = static_cast<int>(mutexes.size());
+  // start with the image corresponding to this thread, such that threads normally keep using the same image,
+  // but take any other image that is currently free.
+  const int first_image_num = omp_get_thread_num() % num_images;
+  int image_num = -1;
+  for (int i = 0; i < num_images; ++i)
+    {
+      const int n = (first_image_num + i) % num_images;
+      if (mutexes[n].try_lock())
+        {
+          image_num = n;
+          break;
+        }
+    }
+  if (image_num < 0)
+    {
+      // all images are in use, so wait
+      image_num = first_image_num;
+      mutexes[image_num].lock();
+    }
+  if (is_null_ptr(_local_output_image_sptrs[image_num]))
+    _local_output_image_sptrs[image_num].reset(_density_sptr->get_empty_copy());
+  return image_num;
+}
+#endif
+
+void
+BackProjectorByBin::back_project_all_timing_positions(const std::vector<RelatedViewgrams<float>>& viewgrams_all_timing_positions)
+{
+  for (const auto& viewgrams : viewgrams_all_timing_positions)
+    check_related_viewgrams(viewgrams);
+
+#ifdef STIR_OPENMP
+  // find an image that is not used by another thread, and lock it
+  const int image_num = lock_local_output_image();
+  std::lock_guard<std::mutex> lock((*_local_output_image_mutexes_sptr)[image_num], std::adopt_lock);
+  shared_ptr<DiscretisedDensity<3, float>> density_sptr = _local_output_image_sptrs[image_num];
+#else
+  shared_ptr<DiscretisedDensity<3, float>> density_sptr = _density_sptr;
+#endif
+  actual_back_project_all_timing_positions(*density_sptr, viewgrams_all_timing_positions);
+}
+
 END_NAMESPACE_STIR
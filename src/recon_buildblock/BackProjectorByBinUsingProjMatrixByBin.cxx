@@ -16,7 +16,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2018, University College London
+    Copyright (C) 2018, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -32,8 +32,11 @@
      from ForwardProjectorByBinUsingProjMatrixByBin
 */
 #include "stir/recon_buildblock/BackProjectorByBinUsingProjMatrixByBin.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinPacked.h"
 #include "stir/Viewgram.h"
 #include "stir/RelatedViewgrams.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/VectorWithOffset.h"
 #include "stir/is_null_ptr.h"
 #include "stir/warning.h"
 #include "stir/error.h"
@@ -146,7 +149,10 @@ BackProjectorByBinUsingProjMatrixByBin::actual_back_project(DiscretisedDensity<3
       // complicated version which handles the symmetries explicitly
       // faster when no caching is performed, about just as fast when there is caching
       ProjMatrixElemsForOneBin proj_matrix_row;
-      ProjMatrixElemsForOneBin proj_matrix_row_copy;
+      // use the "packed" version of the row, such that symmetries and projection can be vectorised
+      ProjMatrixElemsForOneBinPacked packed_proj_matrix_row;
+      ProjMatrixElemsForOneBinPacked packed_proj_matrix_row_copy;
+      const ProjMatrixElemsForOneBinPacked::DensityInfo density_info(image);
       const DataSymmetriesForBins* symmetries = proj_matrix_ptr->get_symmetries_ptr();
 
       Array<2, int> already_processed(
@@ -167,6 +173,7 @@ BackProjectorByBinUsingProjMatrixByBin::actual_back_project(DiscretisedDensity<3
             symmetries->find_basic_bin(basic_bin);
 
             proj_matrix_ptr->get_proj_matrix_elems_for_one_bin(proj_matrix_row, basic_bin);
+            packed_proj_matrix_row.set_from(proj_matrix_row);
 
             related_ax_tang_poss.resize(0);
             symmetries->get_related_bins_factorised(related_ax_tang_poss,
@@ -195,7 +202,7 @@ BackProjectorByBinUsingProjMatrixByBin::actual_back_project(DiscretisedDensity<3
                     // KT 21/02/2002 added check on 0
                     if ((*viewgram_iter)[axial_pos_tmp][tang_pos_tmp] == 0)
                       continue;
-                    proj_matrix_row_copy = proj_matrix_row;
+                    packed_proj_matrix_row_copy = packed_proj_matrix_row;
                     Bin bin(viewgram_iter->get_segment_num(),
                             viewgram_iter->get_view_num(),
                             axial_pos_tmp,
@@ -211,8 +218,8 @@ BackProjectorByBinUsingProjMatrixByBin::actual_back_project(DiscretisedDensity<3
                     assert(bin.tangential_pos_num() == basic_bin.tangential_pos_num());
                     assert(bin.timing_pos_num() == basic_bin.timing_pos_num());
 
-                    symm_op_ptr->transform_proj_matrix_elems_for_one_bin(proj_matrix_row_copy);
-                    proj_matrix_row_copy.back_project(image, bin);
+                    symm_op_ptr->transform_packed_proj_matrix_elems_for_one_bin(packed_proj_matrix_row_copy);
+                    packed_proj_matrix_row_copy.back_project(image, bin, density_info);
                   }
               }
           }
@@ -229,6 +236,44 @@ BackProjectorByBinUsingProjMatrixByBin::actual_back_project(DiscretisedDensity<3
   proj_matrix_row.back_project(image, bin);
 }
 
+bool
+BackProjectorByBinUsingProjMatrixByBin::can_fuse_timing_positions() const
+{
+  // as for the "straightforward" version in actual_back_project(), we rely on ProjMatrixByBin
+  // to sort out all symmetries
+  return proj_matrix_ptr->is_cache_enabled();
+}
+
+void
+BackProjectorByBinUsingProjMatrixByBin::actual_back_project_all_timing_positions(
+    DiscretisedDensity<3, float>& image, const std::vector<RelatedViewgrams<float>>& viewgrams_all_timing_positions)
+{
+  if (viewgrams_all_timing_positions.empty())
+    return;
+
+  const RelatedViewgrams<float>& first_viewgrams = viewgrams_all_timing_positions.front();
+  ProjMatrixElemsForOneBin proj_matrix_row;
+  VectorWithOffset<float> values(_proj_data_info_sptr->get_min_tof_pos_num(), _proj_data_info_sptr->get_max_tof_pos_num());
+
+  for (int v = 0; v < first_viewgrams.get_num_viewgrams(); ++v)
+    {
+      const Viewgram<float>& first_viewgram = *(first_viewgrams.begin() + v);
+      for (int tang_pos = first_viewgrams.get_min_tangential_pos_num(); tang_pos <= first_viewgrams.get_max_tangential_pos_num();
+           ++tang_pos)
+        for (int ax_pos = first_viewgrams.get_min_axial_pos_num(); ax_pos <= first_viewgrams.get_max_axial_pos_num(); ++ax_pos)
+          {
+            values.fill(0.F);
+            for (const auto& viewgrams : viewgrams_all_timing_positions)
+              {
+                const Viewgram<float>& viewgram = *(viewgrams.begin() + v);
+                values[viewgram.get_timing_pos_num()] = viewgram[ax_pos][tang_pos];
+              }
+            const Bin bin(first_viewgram.get_segment_num(), first_viewgram.get_view_num(), ax_pos, tang_pos, 0, 0.F);
+            proj_matrix_ptr->back_project_all_timing_positions(image, proj_matrix_row, bin, values);
+          }
+    }
+}
+
 BackProjectorByBinUsingProjMatrixByBin*
 BackProjectorByBinUsingProjMatrixByBin::clone() const
 {
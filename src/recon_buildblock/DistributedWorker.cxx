@@ -36,6 +36,8 @@
 #include "stir/error.h"
 #include <boost/format.hpp>
 #include "stir/recon_buildblock/PoissonLogLikelihoodWithLinearModelForMeanAndProjData.h" // needed for RPC functions
+#include "stir/recon_buildblock/ProjectorByBinPairUsingProjMatrixByBin.h"
+#include "stir/recon_buildblock/ProjMatrixByBin.h"
 #include <exception>
 
 #include "stir/recon_buildblock/distributable_main.h"
@@ -59,7 +61,9 @@ main(int argc, char** argv)
       // length of the processor-name
       int namelength;
 
-      MPI_Init(&argc, &argv);                                      /*Initializes the start up for MPI*/
+      // list-mode computations use OpenMP threads, but only the main thread calls MPI
+      int thread_support_level;
+      MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support_level); /*Initializes the start up for MPI*/
       MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);                     /*Gets the rank of the Processor*/
       MPI_Comm_size(MPI_COMM_WORLD, &distributed::num_processors); /*Finds the number of processes being used*/
       MPI_Get_processor_name(processor_name, &namelength);
@@ -168,6 +172,17 @@ DistributedWorker<TargetT>::start()
             break;
           }
 
+          case task_setup_distributable_LM_computation: {
+            this->setup_distributable_LM_computation();
+            break;
+          }
+          case task_do_distributable_LM_gradient_computation:
+          case task_do_distributable_LM_loglikelihood_computation:
+          case task_do_distributable_LM_Hessian_computation: {
+            this->distributable_LM_computation(task_id);
+            break;
+          }
+
           /*
             case task_do_distributable_sensitivity_computation;break;
           */
@@ -231,6 +246,97 @@ DistributedWorker<TargetT>::setup_distributable_computation()
   this->mult_proj_data_sptr.reset();
 } // set_up
 
+template <typename TargetT>
+void
+DistributedWorker<TargetT>::setup_distributable_LM_computation()
+{
+  // receive target image pointer
+  distributed::receive_and_set_image_parameters(this->LM_target_sptr, this->LM_image_buffer_size, -1, 0);
+  distributed::receive_image_values_and_fill_image_ptr(this->LM_target_sptr, this->LM_image_buffer_size, 0);
+
+  distributed::receive_and_construct_exam_and_proj_data_info_ptr(this->LM_exam_info_sptr, this->LM_proj_data_info_sptr, 0);
+
+  // the projection matrix is sent as a projector pair
+  shared_ptr<ProjectorByBinPair> proj_pair_sptr;
+  distributed::receive_and_initialize_projectors(proj_pair_sptr, 0);
+  auto PM_proj_pair_sptr = dynamic_pointer_cast<ProjectorByBinPairUsingProjMatrixByBin>(proj_pair_sptr);
+  if (is_null_ptr(PM_proj_pair_sptr))
+    error("DistributedWorker: expected a ProjectorByBinPairUsingProjMatrixByBin for the list-mode computation");
+  this->PM_sptr = PM_proj_pair_sptr->get_proj_matrix_sptr();
+  this->PM_sptr->set_up(this->LM_proj_data_info_sptr->create_shared_clone(), this->LM_target_sptr);
+}
+
+template <typename TargetT>
+void
+DistributedWorker<TargetT>::distributable_LM_computation(const int task_id)
+{
+  shared_ptr<TargetT> input_image_sptr = this->LM_target_sptr; // use the LM_target_sptr member as we don't need its values anyway
+  distributed::receive_image_values_and_fill_image_ptr(input_image_sptr, this->LM_image_buffer_size, 0);
+  shared_ptr<TargetT> rhs_sptr;
+  if (task_id == task_do_distributable_LM_Hessian_computation)
+    {
+      rhs_sptr.reset(this->LM_target_sptr->get_empty_copy());
+      distributed::receive_image_values_and_fill_image_ptr(rhs_sptr, this->LM_image_buffer_size, 0);
+    }
+
+  int parameters[3];
+  distributed::receive_int_values(parameters, 3, distributed::STIR_MPI_CONF_TAG);
+  const int subset_num = parameters[0];
+  const int num_subsets = parameters[1];
+  const bool has_add = parameters[2] != 0;
+
+  shared_ptr<TargetT> output_image_sptr;
+  if (task_id != task_do_distributable_LM_loglikelihood_computation)
+    output_image_sptr.reset(this->LM_target_sptr->get_empty_copy());
+  double value = 0.;
+
+  shared_ptr<ProjDataInfo> proj_data_info_sptr = this->LM_proj_data_info_sptr->create_shared_clone();
+  while (distributed::receive_listmode_events(this->record_cache, 0))
+    {
+      switch (task_id)
+        {
+          case task_do_distributable_LM_gradient_computation:
+            LM_gradient_distributable_computation(this->PM_sptr,
+                                                  proj_data_info_sptr,
+                                                  output_image_sptr.get(),
+                                                  input_image_sptr.get(),
+                                                  this->record_cache,
+                                                  subset_num,
+                                                  num_subsets,
+                                                  has_add,
+                                                  /* accumulate = */ true,
+                                                  nullptr);
+            break;
+          case task_do_distributable_LM_loglikelihood_computation:
+            LM_value_distributable_computation(this->PM_sptr,
+                                               proj_data_info_sptr,
+                                               input_image_sptr.get(),
+                                               this->record_cache,
+                                               subset_num,
+                                               num_subsets,
+                                               has_add,
+                                               &value);
+            break;
+          case task_do_distributable_LM_Hessian_computation:
+            LM_Hessian_distributable_computation(this->PM_sptr,
+                                                 proj_data_info_sptr,
+                                                 output_image_sptr.get(),
+                                                 input_image_sptr.get(),
+                                                 rhs_sptr.get(),
+                                                 this->record_cache,
+                                                 subset_num,
+                                                 num_subsets,
+                                                 has_add,
+                                                 /* accumulate = */ true);
+            break;
+        }
+    }
+
+  distributed::reduce_image_and_value(output_image_sptr.get(),
+                                      task_id == task_do_distributable_LM_loglikelihood_computation ? &value : nullptr,
+                                      0);
+}
+
 template <typename TargetT>
 void
 DistributedWorker<TargetT>::distributable_computation(RPC_process_related_viewgrams_type* RPC_process_related_viewgrams)
@@ -275,7 +381,8 @@ DistributedWorker<TargetT>::distributable_computation(RPC_process_related_viewgr
         // output_image_ptr->fill(0.F);
       }
 
-    proj_pair_sptr->get_forward_projector_sptr()->set_input(*this->target_sptr);
+    if (!is_null_ptr(proj_pair_sptr->get_forward_projector_sptr()))
+      proj_pair_sptr->get_forward_projector_sptr()->set_input(*this->target_sptr);
     if (!is_null_ptr(output_image_ptr))
       proj_pair_sptr->get_back_projector_sptr()->start_accumulating_in_new_target();
 
@@ -17,7 +17,7 @@
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000-2011 Hammersmith Imanet Ltd
     Copyright (C) 2013 Kris Thielemans
-    Copyright (C) 2015, 2018-2019, University College London
+    Copyright (C) 2015, 2018-2019, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -30,6 +30,9 @@
 #include "stir/RelatedViewgrams.h"
 #include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/ProjData.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataSparse.h"
+#include "stir/RelatedViewgramsWriteBehind.h"
 #include "stir/DiscretisedDensity.h"
 #include "stir/Succeeded.h"
 #include "stir/info.h"
@@ -37,6 +40,7 @@
 #include "stir/warning.h"
 #include "stir/DataProcessor.h"
 #include "stir/is_null_ptr.h"
+#include "stir/num_threads.h"
 #include <boost/format.hpp>
 #include <iostream>
 
@@ -195,6 +199,52 @@ ForwardProjectorByBin::forward_project(ProjData& proj_data, int subset_num, int
                                              proj_data.get_max_segment_num(),
                                              subset_num,
                                              num_subsets);
+  // Projection data that are not in memory are written in a background thread, such that writing
+  // overlaps with the computation
+  shared_ptr<RelatedViewgramsWriteBehind> write_behind_sptr;
+  if (!dynamic_cast<const ProjDataInMemory*>(&proj_data) && !dynamic_cast<const ProjDataSparse*>(&proj_data))
+    write_behind_sptr
+        = std::make_shared<RelatedViewgramsWriteBehind>(proj_data, 2 * static_cast<std::size_t>(get_max_num_threads()));
+  auto store_viewgrams = [&](const RelatedViewgrams<float>& viewgrams) {
+    if (write_behind_sptr)
+      write_behind_sptr->set_related_viewgrams(viewgrams);
+    else
+      {
+#ifdef STIR_OPENMP
+#  pragma omp critical(FORWARDPROJ_SETVIEWGRAMS)
+#endif
+        {
+          if (!(proj_data.set_related_viewgrams(viewgrams) == Succeeded::yes))
+            error("Error set_related_viewgrams in forward projecting");
+        }
+      }
+  };
+
+  if (proj_data.get_proj_data_info_sptr()->is_tof_data() && this->can_fuse_timing_positions())
+    {
+      // handle all TOF bins of a view/segment at once, such that the geometric part can be shared
+#ifdef STIR_OPENMP
+#  pragma omp parallel for shared(proj_data, symmetries_sptr) schedule(dynamic)
+#endif
+      for (int i = 0; i < static_cast<int>(vs_nums_to_process.size()); ++i)
+        {
+          const ViewSegmentNumbers vs = vs_nums_to_process[i];
+          info(boost::format("Processing view %1% of segment %2% for all TOF bins") % vs.view_num() % vs.segment_num(), 3);
+          std::vector<RelatedViewgrams<float>> viewgrams_all_timing_positions;
+          for (int k = proj_data.get_min_tof_pos_num(); k <= proj_data.get_max_tof_pos_num(); ++k)
+            {
+              viewgrams_all_timing_positions.push_back(proj_data.get_empty_related_viewgrams(vs, symmetries_sptr, false, k));
+              check_related_viewgrams(viewgrams_all_timing_positions.back());
+            }
+          actual_forward_project_all_timing_positions(viewgrams_all_timing_positions);
+          for (const auto& viewgrams : viewgrams_all_timing_positions)
+            store_viewgrams(viewgrams);
+        }
+      if (write_behind_sptr)
+        write_behind_sptr->flush();
+      return;
+    }
+
 #ifdef STIR_OPENMP
 #  if _OPENMP < 201107
 #    pragma omp parallel for shared(proj_data, symmetries_sptr) schedule(dynamic)
@@ -217,15 +267,11 @@ ForwardProjectorByBin::forward_project(ProjData& proj_data, int subset_num, int
             info(boost::format("Processing view %1% of segment %2%") % vs.view_num() % vs.segment_num(), 3);
           RelatedViewgrams<float> viewgrams = proj_data.get_empty_related_viewgrams(vs, symmetries_sptr, false, k);
           forward_project(viewgrams);
-#ifdef STIR_OPENMP
-#  pragma omp critical(FORWARDPROJ_SETVIEWGRAMS)
-#endif
-          {
-            if (!(proj_data.set_related_viewgrams(viewgrams) == Succeeded::yes))
-              error("Error set_related_viewgrams in forward projecting");
-          }
+          store_viewgrams(viewgrams);
         }
     }
+  if (write_behind_sptr)
+    write_behind_sptr->flush();
 }
 
 void
@@ -262,6 +308,13 @@ ForwardProjectorByBin::forward_project(RelatedViewgrams<float>& viewgrams,
   if (!_density_sptr)
     error("You need to call set_input() forward_project()");
 
+  check_related_viewgrams(viewgrams);
+  actual_forward_project(viewgrams, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num);
+}
+
+void
+ForwardProjectorByBin::check_related_viewgrams(const RelatedViewgrams<float>& viewgrams) const
+{
   check(*viewgrams.get_proj_data_info_sptr());
 
   // first check symmetries
@@ -281,7 +334,6 @@ ForwardProjectorByBin::forward_project(RelatedViewgrams<float>& viewgrams,
           error("ForwardProjectByBin: forward_project called with incorrect related_viewgrams. Problem with symmetries!\n");
       }
   }
-  actual_forward_project(viewgrams, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num);
 }
 
 void
@@ -302,6 +354,20 @@ ForwardProjectorByBin::actual_forward_project(RelatedViewgrams<float>& viewgrams
       viewgrams, *_density_sptr, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num);
 }
 
+bool
+ForwardProjectorByBin::can_fuse_timing_positions() const
+{
+  return false;
+}
+
+void
+ForwardProjectorByBin::actual_forward_project_all_timing_positions(
+    std::vector<RelatedViewgrams<float>>& viewgrams_all_timing_positions)
+{
+  for (auto& viewgrams : viewgrams_all_timing_positions)
+    forward_project(viewgrams);
+}
+
 void
 ForwardProjectorByBin::set_input(const DiscretisedDensity<3, float>& density)
 {
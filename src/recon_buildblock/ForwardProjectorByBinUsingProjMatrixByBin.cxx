@@ -14,6 +14,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2011, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -22,9 +23,12 @@
 */
 
 #include "stir/recon_buildblock/ForwardProjectorByBinUsingProjMatrixByBin.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinPacked.h"
 #include "stir/Viewgram.h"
 #include "stir/RelatedViewgrams.h"
 #include "stir/IndexRange2D.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/VectorWithOffset.h"
 #include "stir/is_null_ptr.h"
 #include "stir/warning.h"
 #include "stir/error.h"
@@ -143,7 +147,10 @@ ForwardProjectorByBinUsingProjMatrixByBin::actual_forward_project(RelatedViewgra
       // but of only basic bins.
 
       ProjMatrixElemsForOneBin proj_matrix_row;
-      ProjMatrixElemsForOneBin proj_matrix_row_copy;
+      // use the "packed" version of the row, such that symmetries and projection can be vectorised
+      ProjMatrixElemsForOneBinPacked packed_proj_matrix_row;
+      ProjMatrixElemsForOneBinPacked packed_proj_matrix_row_copy;
+      const ProjMatrixElemsForOneBinPacked::DensityInfo density_info(image);
       const DataSymmetriesForBins* symmetries = proj_matrix_ptr->get_symmetries_ptr();
 
       Array<2, int> already_processed(
@@ -163,6 +170,7 @@ ForwardProjectorByBinUsingProjMatrixByBin::actual_forward_project(RelatedViewgra
             symmetries->find_basic_bin(basic_bin);
 
             proj_matrix_ptr->get_proj_matrix_elems_for_one_bin(proj_matrix_row, basic_bin);
+            packed_proj_matrix_row.set_from(proj_matrix_row);
 
             vector<AxTangPosNumbers> r_ax_poss;
             symmetries->get_related_bins_factorised(
@@ -184,7 +192,7 @@ ForwardProjectorByBinUsingProjMatrixByBin::actual_forward_project(RelatedViewgra
                      ++viewgram_iter)
                   {
                     Viewgram<float>& viewgram = *viewgram_iter;
-                    proj_matrix_row_copy = proj_matrix_row;
+                    packed_proj_matrix_row_copy = packed_proj_matrix_row;
                     Bin bin(viewgram_iter->get_segment_num(),
                             viewgram_iter->get_view_num(),
                             axial_pos_tmp,
@@ -194,8 +202,8 @@ ForwardProjectorByBinUsingProjMatrixByBin::actual_forward_project(RelatedViewgra
                     unique_ptr<SymmetryOperation> symm_op_ptr = symmetries->find_symmetry_operation_from_basic_bin(bin);
                     assert(bin == basic_bin);
 
-                    symm_op_ptr->transform_proj_matrix_elems_for_one_bin(proj_matrix_row_copy);
-                    proj_matrix_row_copy.forward_project(bin, image);
+                    symm_op_ptr->transform_packed_proj_matrix_elems_for_one_bin(packed_proj_matrix_row_copy);
+                    packed_proj_matrix_row_copy.forward_project(bin, image, density_info);
 
                     viewgram[axial_pos_tmp][tang_pos_tmp] = bin.get_bin_value();
                   }
@@ -206,6 +214,43 @@ ForwardProjectorByBinUsingProjMatrixByBin::actual_forward_project(RelatedViewgra
     }
 }
 
+bool
+ForwardProjectorByBinUsingProjMatrixByBin::can_fuse_timing_positions() const
+{
+  // as for the "straightforward" version in actual_forward_project(), we rely on ProjMatrixByBin
+  // to sort out all symmetries
+  return proj_matrix_ptr->is_cache_enabled();
+}
+
+void
+ForwardProjectorByBinUsingProjMatrixByBin::actual_forward_project_all_timing_positions(
+    std::vector<RelatedViewgrams<float>>& viewgrams_all_timing_positions)
+{
+  if (viewgrams_all_timing_positions.empty())
+    return;
+
+  const RelatedViewgrams<float>& first_viewgrams = viewgrams_all_timing_positions.front();
+  ProjMatrixElemsForOneBin proj_matrix_row;
+  VectorWithOffset<float> values(_proj_data_info_sptr->get_min_tof_pos_num(), _proj_data_info_sptr->get_max_tof_pos_num());
+
+  for (int v = 0; v < first_viewgrams.get_num_viewgrams(); ++v)
+    {
+      const Viewgram<float>& first_viewgram = *(first_viewgrams.begin() + v);
+      for (int tang_pos = first_viewgrams.get_min_tangential_pos_num(); tang_pos <= first_viewgrams.get_max_tangential_pos_num();
+           ++tang_pos)
+        for (int ax_pos = first_viewgrams.get_min_axial_pos_num(); ax_pos <= first_viewgrams.get_max_axial_pos_num(); ++ax_pos)
+          {
+            const Bin bin(first_viewgram.get_segment_num(), first_viewgram.get_view_num(), ax_pos, tang_pos, 0, 0.F);
+            proj_matrix_ptr->forward_project_all_timing_positions(values, proj_matrix_row, bin, *_density_sptr);
+            for (auto& viewgrams : viewgrams_all_timing_positions)
+              {
+                Viewgram<float>& viewgram = *(viewgrams.begin() + v);
+                viewgram[ax_pos][tang_pos] = values[viewgram.get_timing_pos_num()];
+              }
+          }
+    }
+}
+
 #if 0 // disabled as currently not used. needs to be written in the new style anyway
 void
 ForwardProjectorByBinUsingProjMatrixByBin::
@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2001- 2008, Hammersmith Imanet Ltd
-    Copyright (C) 2019-2020, 2022, University College London
+    Copyright (C) 2019-2020, 2022, 2026, University College London
     Copyright (C) 2016-2017, PETsys Electronics
     Copyright (C) 2021, Gefei Chen
     This file is part of STIR.
@@ -28,6 +28,10 @@
 #include "stir/info.h"
 #include "stir/warning.h"
 #include "stir/ProjData.h"
+#include "stir/Succeeded.h"
+#include "stir/error.h"
+#include "stir/listmode/ListModeData.h"
+#include "stir/listmode/ListRecord.h"
 #include <boost/format.hpp>
 #include <fstream>
 #include <string>
@@ -35,42 +39,73 @@
 
 START_NAMESPACE_STIR
 
-void
-ML_estimate_component_based_normalisation(const std::string& out_filename_prefix,
-                                          const ProjData& measured_data,
-                                          const ProjData& model_data,
-                                          int num_eff_iterations,
-                                          int num_iterations,
-                                          bool do_geo,
-                                          bool do_block,
-                                          bool do_symmetry_per_block,
-                                          bool do_KL,
-                                          bool do_display)
+//! Construct fan data from list mode data, using all prompts
+static void
+make_fan_data_remove_gaps(FanProjData& fan_data, ListModeData& list_mode_data)
+{
+  // we need a span 1 proj_data_info without TOF to find the detector pair of every event
+  shared_ptr<const ProjDataInfo> proj_data_info_sptr = list_mode_data.get_proj_data_info_sptr()->create_non_tof_clone();
+  FanProjDataAccumulator accumulator(fan_data, *proj_data_info_sptr);
+
+  shared_ptr<ListRecord> record_sptr = list_mode_data.get_empty_record_sptr();
+  ListRecord& record = *record_sptr;
+  if (list_mode_data.reset() == Succeeded::no)
+    error("ML_estimate_component_based_normalisation: could not reset list mode data");
+
+  Bin bin;
+  long num_events_used = 0;
+  while (list_mode_data.get_next_record(record) == Succeeded::yes)
+    {
+      if (!record.is_event() || !record.event().is_prompt())
+        continue;
+      record.event().get_bin(bin, *proj_data_info_sptr);
+      // bins outside of the range have a value <= 0
+      if (bin.get_bin_value() <= 0)
+        continue;
+      accumulator.add(bin, 1.F);
+      ++num_events_used;
+    }
+  info(boost::format("ML_estimate_component_based_normalisation: used %1% prompts from the list mode data") % num_events_used);
+}
+
+// measured_fan_data will be modified
+static void
+ML_estimate_component_based_normalisation_help(const std::string& out_filename_prefix,
+                                               const ProjDataInfo& measured_proj_data_info,
+                                               FanProjData& measured_fan_data,
+                                               const ProjData& model_data,
+                                               int num_eff_iterations,
+                                               int num_iterations,
+                                               bool do_geo,
+                                               bool do_block,
+                                               bool do_symmetry_per_block,
+                                               bool do_KL,
+                                               bool do_display)
 {
 
-  const int num_transaxial_blocks = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_transaxial_blocks();
-  const int num_axial_blocks = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_axial_blocks();
+  const int num_transaxial_blocks = measured_proj_data_info.get_scanner_sptr()->get_num_transaxial_blocks();
+  const int num_axial_blocks = measured_proj_data_info.get_scanner_sptr()->get_num_axial_blocks();
   const int virtual_axial_crystals
-      = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_virtual_axial_crystals_per_block();
+      = measured_proj_data_info.get_scanner_sptr()->get_num_virtual_axial_crystals_per_block();
   const int virtual_transaxial_crystals
-      = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_virtual_transaxial_crystals_per_block();
-  const int num_physical_rings = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_rings()
+      = measured_proj_data_info.get_scanner_sptr()->get_num_virtual_transaxial_crystals_per_block();
+  const int num_physical_rings = measured_proj_data_info.get_scanner_sptr()->get_num_rings()
                                  - (num_axial_blocks - 1) * virtual_axial_crystals;
   const int num_physical_detectors_per_ring
-      = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_detectors_per_ring()
+      = measured_proj_data_info.get_scanner_sptr()->get_num_detectors_per_ring()
         - num_transaxial_blocks * virtual_transaxial_crystals;
-  const int num_transaxial_buckets = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_transaxial_buckets();
-  const int num_axial_buckets = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_axial_buckets();
+  const int num_transaxial_buckets = measured_proj_data_info.get_scanner_sptr()->get_num_transaxial_buckets();
+  const int num_axial_buckets = measured_proj_data_info.get_scanner_sptr()->get_num_axial_buckets();
   const int num_transaxial_blocks_per_bucket
-      = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_transaxial_blocks_per_bucket();
+      = measured_proj_data_info.get_scanner_sptr()->get_num_transaxial_blocks_per_bucket();
   const int num_axial_blocks_per_bucket
-      = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_axial_blocks_per_bucket();
+      = measured_proj_data_info.get_scanner_sptr()->get_num_axial_blocks_per_bucket();
 
   int num_physical_transaxial_crystals_per_basic_unit
-      = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_transaxial_crystals_per_block()
+      = measured_proj_data_info.get_scanner_sptr()->get_num_transaxial_crystals_per_block()
         - virtual_transaxial_crystals;
   int num_physical_axial_crystals_per_basic_unit
-      = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_axial_crystals_per_block() - virtual_axial_crystals;
+      = measured_proj_data_info.get_scanner_sptr()->get_num_axial_crystals_per_block() - virtual_axial_crystals;
   // If there are multiple buckets, we increase the symmetry size to a bucket. Otherwise, we use a block.
   if (do_symmetry_per_block == false)
     {
@@ -103,14 +138,13 @@ ML_estimate_component_based_normalisation(const std::string& out_filename_prefix
 
   make_fan_data_remove_gaps(model_fan_data, model_data);
   {
-    // next could be local if KL is not computed below
-    FanProjData measured_fan_data;
     float threshold_for_KL;
     // compute factors dependent on the data
     {
-      make_fan_data_remove_gaps(measured_fan_data, measured_data);
-
       /* TEMP FIX */
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
       for (int ra = model_fan_data.get_min_ra(); ra <= model_fan_data.get_max_ra(); ++ra)
         {
           for (int a = model_fan_data.get_min_a(); a <= model_fan_data.get_max_a(); ++a)
@@ -305,4 +339,58 @@ ML_estimate_component_based_normalisation(const std::string& out_filename_prefix
   }
 }
 
+void
+ML_estimate_component_based_normalisation(const std::string& out_filename_prefix,
+                                          const ProjData& measured_data,
+                                          const ProjData& model_data,
+                                          int num_eff_iterations,
+                                          int num_iterations,
+                                          bool do_geo,
+                                          bool do_block,
+                                          bool do_symmetry_per_block,
+                                          bool do_KL,
+                                          bool do_display)
+{
+  FanProjData measured_fan_data;
+  make_fan_data_remove_gaps(measured_fan_data, measured_data);
+  ML_estimate_component_based_normalisation_help(out_filename_prefix,
+                                                 *measured_data.get_proj_data_info_sptr(),
+                                                 measured_fan_data,
+                                                 model_data,
+                                                 num_eff_iterations,
+                                                 num_iterations,
+                                                 do_geo,
+                                                 do_block,
+                                                 do_symmetry_per_block,
+                                                 do_KL,
+                                                 do_display);
+}
+
+void
+ML_estimate_component_based_normalisation(const std::string& out_filename_prefix,
+                                          ListModeData& measured_data,
+                                          const ProjData& model_data,
+                                          int num_eff_iterations,
+                                          int num_iterations,
+                                          bool do_geo,
+                                          bool do_block,
+                                          bool do_symmetry_per_block,
+                                          bool do_KL,
+                                          bool do_display)
+{
+  FanProjData measured_fan_data;
+  make_fan_data_remove_gaps(measured_fan_data, measured_data);
+  ML_estimate_component_based_normalisation_help(out_filename_prefix,
+                                                 *measured_data.get_proj_data_info_sptr(),
+                                                 measured_fan_data,
+                                                 model_data,
+                                                 num_eff_iterations,
+                                                 num_iterations,
+                                                 do_geo,
+                                                 do_block,
+                                                 do_symmetry_per_block,
+                                                 do_KL,
+                                                 do_display);
+}
+
 END_NAMESPACE_STIR
@@ -317,6 +317,9 @@ PLSPrior<elemT>::compute_image_gradient_element(DiscretisedDensity<3, elemT>& im
   const int min_z = image.get_min_index();
   const int max_z = image.get_max_index();
 
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int z = min_z; z <= max_z; z++)
     {
 
@@ -367,6 +370,9 @@ PLSPrior<elemT>::compute_normalisation_anatomical_gradient(DiscretisedDensity<3,
   const int min_z = image_grad_x.get_min_index();
   const int max_z = image_grad_x.get_max_index();
 
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int z = min_z; z <= max_z; z++)
     {
 
@@ -413,7 +419,12 @@ PLSPrior<elemT>::compute_inner_product_and_penalty(DiscretisedDensity<3, elemT>&
 
   const int min_z = pet_image.get_min_index();
   const int max_z = pet_image.get_max_index();
+  // avoid copying the shared_ptr for every voxel (which is slow when using multiple threads)
+  const DiscretisedDensity<3, elemT>& norm = *this->get_norm_sptr();
 
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int z = min_z; z <= max_z; z++)
     {
 
@@ -431,8 +442,8 @@ PLSPrior<elemT>::compute_inner_product_and_penalty(DiscretisedDensity<3, elemT>&
               if (only_2D)
                 {
                   inner_product[z][y][x]
-                      = ((pet_im_grad_y[z][y][x] * (*anatomical_grad_y_sptr)[z][y][x] / (*get_norm_sptr())[z][y][x])
-                         + (pet_im_grad_x[z][y][x] * (*anatomical_grad_x_sptr)[z][y][x] / (*get_norm_sptr())[z][y][x]));
+                      = ((pet_im_grad_y[z][y][x] * (*anatomical_grad_y_sptr)[z][y][x] / norm[z][y][x])
+                         + (pet_im_grad_x[z][y][x] * (*anatomical_grad_x_sptr)[z][y][x] / norm[z][y][x]));
 
                   penalty[z][y][x] = sqrt(square(this->alpha) + square(pet_im_grad_y[z][y][x]) + square(pet_im_grad_x[z][y][x])
                                           - square(inner_product[z][y][x]));
@@ -442,7 +453,7 @@ PLSPrior<elemT>::compute_inner_product_and_penalty(DiscretisedDensity<3, elemT>&
                   inner_product[z][y][x] = (pet_im_grad_z[z][y][x] * (*anatomical_grad_z_sptr)[z][y][x]
                                             + pet_im_grad_y[z][y][x] * (*anatomical_grad_y_sptr)[z][y][x]
                                             + pet_im_grad_x[z][y][x] * (*anatomical_grad_x_sptr)[z][y][x])
-                                           / (*get_norm_sptr())[z][y][x];
+                                           / norm[z][y][x];
 
                   penalty[z][y][x] = sqrt(square(this->alpha) + square(pet_im_grad_z[z][y][x]) + square(pet_im_grad_y[z][y][x])
                                           + square(pet_im_grad_x[z][y][x]) - square(inner_product[z][y][x]));
@@ -481,6 +492,9 @@ PLSPrior<elemT>::compute_value(const DiscretisedDensity<3, elemT>& current_image
   double result = 0.;
   const int min_z = current_image_estimate.get_min_index();
   const int max_z = current_image_estimate.get_max_index();
+#ifdef STIR_OPENMP
+#  pragma omp parallel for reduction(+ : result) schedule(dynamic)
+#endif
   for (int z = min_z; z <= max_z; z++)
     {
 
@@ -550,10 +564,14 @@ PLSPrior<elemT>::compute_gradient(DiscretisedDensity<3, elemT>& prior_gradient,
 
   const bool do_kappa = !is_null_ptr(kappa_ptr);
   shared_ptr<DiscretisedDensity<3, elemT>> gradient_sptr(this->anatomical_sptr->get_empty_copy());
+  const DiscretisedDensity<3, elemT>& norm = *this->get_norm_sptr();
 
   const int min_z = current_image_estimate.get_min_index();
   const int max_z = current_image_estimate.get_max_index();
 
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int z = min_z; z <= max_z; z++)
     {
 
@@ -583,19 +601,19 @@ PLSPrior<elemT>::compute_gradient(DiscretisedDensity<3, elemT>& prior_gradient,
                   (*gradientx_sptr)[z][y][x + 1]
                       = (((*pet_im_grad_x_sptr)[z][y][x + 1]
                           - (*anatomical_grad_x_sptr)[z][y][x + 1] * (*inner_product_sptr)[z][y][x + 1]
-                                / (*get_norm_sptr())[z][y][x + 1])
+                                / norm[z][y][x + 1])
                              / (*penalty_sptr)[z][y][x + 1]
                          - (((*pet_im_grad_x_sptr)[z][y][x]
-                             - (*anatomical_grad_x_sptr)[z][y][x] * (*inner_product_sptr)[z][y][x] / (*get_norm_sptr())[z][y][x])
+                             - (*anatomical_grad_x_sptr)[z][y][x] * (*inner_product_sptr)[z][y][x] / norm[z][y][x])
                             / (*penalty_sptr)[z][y][x]));
 
                   (*gradienty_sptr)[z][y + 1][x]
                       = (((*pet_im_grad_y_sptr)[z][y + 1][x]
                           - (*anatomical_grad_y_sptr)[z][y + 1][x] * (*inner_product_sptr)[z][y + 1][x]
-                                / (*get_norm_sptr())[z][y + 1][x])
+                                / norm[z][y + 1][x])
                              / (*penalty_sptr)[z][y + 1][x]
                          - (((*pet_im_grad_y_sptr)[z][y][x]
-                             - (*anatomical_grad_y_sptr)[z][y][x] * (*inner_product_sptr)[z][y][x] / (*get_norm_sptr())[z][y][x])
+                             - (*anatomical_grad_y_sptr)[z][y][x] * (*inner_product_sptr)[z][y][x] / norm[z][y][x])
                             / (*penalty_sptr)[z][y][x]));
                 }
               else
@@ -604,34 +622,37 @@ PLSPrior<elemT>::compute_gradient(DiscretisedDensity<3, elemT>& prior_gradient,
                   (*gradientx_sptr)[z][y][x + 1]
                       = (((*pet_im_grad_x_sptr)[z][y][x + 1]
                           - (*anatomical_grad_x_sptr)[z][y][x + 1] * (*inner_product_sptr)[z][y][x + 1]
-                                / (*get_norm_sptr())[z][y][x + 1])
+                                / norm[z][y][x + 1])
                              / (*penalty_sptr)[z][y][x + 1]
                          - ((*pet_im_grad_x_sptr)[z][y][x]
-                            - (*anatomical_grad_x_sptr)[z][y][x] * (*inner_product_sptr)[z][y][x] / (*get_norm_sptr())[z][y][x])
+                            - (*anatomical_grad_x_sptr)[z][y][x] * (*inner_product_sptr)[z][y][x] / norm[z][y][x])
                                / (*penalty_sptr)[z][y][x]);
 
                   (*gradienty_sptr)[z][y + 1][x]
                       = (((*pet_im_grad_y_sptr)[z][y + 1][x]
                           - (*anatomical_grad_y_sptr)[z][y + 1][x] * (*inner_product_sptr)[z][y + 1][x]
-                                / (*get_norm_sptr())[z][y + 1][x])
+                                / norm[z][y + 1][x])
                              / (*penalty_sptr)[z][y + 1][x]
                          - (((*pet_im_grad_y_sptr)[z][y][x]
-                             - (*anatomical_grad_y_sptr)[z][y][x] * (*inner_product_sptr)[z][y][x] / (*get_norm_sptr())[z][y][x])
+                             - (*anatomical_grad_y_sptr)[z][y][x] * (*inner_product_sptr)[z][y][x] / norm[z][y][x])
                             / (*penalty_sptr)[z][y][x]));
 
                   (*gradientz_sptr)[z + 1][y][x]
                       = (((*pet_im_grad_z_sptr)[z + 1][y][x]
                           - (*anatomical_grad_z_sptr)[z + 1][y][x] * (*inner_product_sptr)[z + 1][y][x]
-                                / (*get_norm_sptr())[z + 1][y][x])
+                                / norm[z + 1][y][x])
                              / (*penalty_sptr)[z + 1][y][x]
                          - (((*pet_im_grad_z_sptr)[z][y][x]
-                             - (*anatomical_grad_z_sptr)[z][y][x] * (*inner_product_sptr)[z][y][x] / (*get_norm_sptr())[z][y][x])
+                             - (*anatomical_grad_z_sptr)[z][y][x] * (*inner_product_sptr)[z][y][x] / norm[z][y][x])
                             / (*penalty_sptr)[z][y][x]));
                 }
             }
         }
     }
 
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int z = min_z; z <= max_z; z++)
     {
 
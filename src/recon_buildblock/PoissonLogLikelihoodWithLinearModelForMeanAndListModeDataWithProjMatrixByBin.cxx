@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2003- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2014, 2016, 2018, 2022, 2024 University College London
+    Copyright (C) 2014, 2016, 2018, 2022, 2024, 2026 University College London
     Copyright (C) 2016, University of Hull
     Copyright (C) 2021, University of Pennsylvania
     This file is part of STIR.
@@ -37,6 +37,8 @@
 #include "stir/ViewSegmentNumbers.h"
 #include "stir/recon_array_functions.h"
 #include "stir/FilePath.h"
+#include "stir/VectorWithOffset.h"
+#include "stir/num_threads.h"
 #include <iostream>
 #include <algorithm>
 #include <functional>
@@ -53,6 +55,7 @@
 #include "stir/recon_buildblock/ProjMatrixByBinUsingRayTracing.h"
 #include "stir/recon_buildblock/ProjectorByBinPairUsingSeparateProjectors.h"
 #include "stir/recon_buildblock/BinNormalisationWithCalibration.h"
+#include "stir/recon_buildblock/PoissonLogLikelihoodWithLinearModelForMeanAndProjData.h" // for distributable_sensitivity_computation
 
 #include "stir/recon_buildblock/PresmoothingForwardProjectorByBin.h"
 #include "stir/recon_buildblock/PostsmoothingBackProjectorByBin.h"
@@ -66,6 +69,13 @@
 #endif
 
 #include <vector>
+#include <future>
+#include <numeric>
+#include <tuple>
+#include <cstring>
+#include <cstdint>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 START_NAMESPACE_STIR
 
 template <typename TargetT>
@@ -75,10 +85,18 @@ const char* const PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithP
 template <typename TargetT>
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<
     TargetT>::PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin()
+    : next_batch_num(0)
 {
   this->set_defaults();
 }
 
+template <typename TargetT>
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<
+    TargetT>::~PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin()
+{
+  end_distributable_computation();
+}
+
 template <typename TargetT>
 void
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::set_defaults()
@@ -91,6 +109,9 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
 
   this->use_tofsens = false;
   skip_balanced_subsets = false;
+  this->sort_batches = false;
+  this->use_event_tof_kernel = false;
+  this->sensitivity_distributable_computation_already_setup = false;
 }
 
 template <typename TargetT>
@@ -108,6 +129,8 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
 
   this->parser.add_key("num_events_to_use", &this->num_events_to_use);
   this->parser.add_key("skip checking balanced subsets", &skip_balanced_subsets);
+  this->parser.add_key("sort events in batches", &this->sort_batches);
+  this->parser.add_key("use event-driven TOF kernel", &this->use_event_tof_kernel);
 }
 
 template <typename TargetT>
@@ -155,6 +178,35 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
   skip_balanced_subsets = arg;
 }
 
+template <typename TargetT>
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::set_sort_batches(const bool arg)
+{
+  this->sort_batches = arg;
+}
+
+template <typename TargetT>
+bool
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::get_sort_batches() const
+{
+  return this->sort_batches;
+}
+
+template <typename TargetT>
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::set_use_event_tof_kernel(const bool arg)
+{
+  this->already_set_up = this->already_set_up && (this->use_event_tof_kernel == arg);
+  this->use_event_tof_kernel = arg;
+}
+
+template <typename TargetT>
+bool
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::get_use_event_tof_kernel() const
+{
+  return this->use_event_tof_kernel;
+}
+
 #if STIR_VERSION < 060000
 template <typename TargetT>
 void
@@ -256,12 +308,18 @@ Succeeded
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::set_up_before_sensitivity(
     shared_ptr<const TargetT> const& target_sptr)
 {
+  // make sure that no batch is still being read in the background
+  if (this->next_batch_future.valid())
+    {
+      this->next_batch_future.wait();
+      this->next_batch_future = std::shared_future<bool>();
+    }
+
   if (base_type::set_up_before_sensitivity(target_sptr) != Succeeded::yes)
     return Succeeded::no;
-#ifdef STIR_MPI
-  // broadcast objective_function (100=PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin)
-  distributed::send_int_value(100, -1);
-#endif
+
+  this->sensitivity_distributable_computation_already_setup = false;
+  this->sens_proj_data_sptr.reset();
 
   if (is_null_ptr(this->PM_sptr))
     {
@@ -270,6 +328,25 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
 
   // set projector to be used for the calculations
   this->PM_sptr->set_up(this->proj_data_info_sptr->create_shared_clone(), target_sptr);
+  if (this->use_event_tof_kernel && this->proj_data_info_sptr->is_tof_data())
+    {
+      // find the bins of the events without TOF mashing, and use a separate matrix that only caches geometric rows
+      this->event_proj_data_info_sptr = this->proj_data_info_sptr->create_shared_clone();
+      this->event_proj_data_info_sptr->set_tof_mash_factor(1);
+      this->event_PM_sptr.reset(this->PM_sptr->clone());
+      this->event_PM_sptr->store_tof_rows_in_cache(false);
+      this->event_PM_sptr->set_up(this->event_proj_data_info_sptr->create_shared_clone(), target_sptr);
+      info(boost::format("Using event-driven TOF kernel with %1% timing positions (instead of %2%)")
+               % this->event_proj_data_info_sptr->get_num_tof_poss() % this->proj_data_info_sptr->get_num_tof_poss(),
+           2);
+    }
+  else
+    {
+      this->event_proj_data_info_sptr = this->proj_data_info_sptr;
+      this->event_PM_sptr = this->PM_sptr;
+    }
+  setup_distributable_LM_computation(
+      this->event_PM_sptr, this->list_mode_data_sptr->get_exam_info_sptr(), this->event_proj_data_info_sptr, target_sptr);
 
   shared_ptr<ForwardProjectorByBin> forward_projector_ptr(new ForwardProjectorByBinUsingProjMatrixByBin(this->PM_sptr));
   shared_ptr<BackProjectorByBin> back_projector_ptr(new BackProjectorByBinUsingProjMatrixByBin(this->PM_sptr));
@@ -360,56 +437,326 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
   return false;
 }
 
-template <typename TargetT>
+namespace
+{
+/* Helper functions for the list-mode cache files
+
+   Layout of the (version 2) binary file:
+   - header (see ListModeCacheFileHeader)
+   - for every subset (as used when writing the file), the index of its first event (num_subsets+1 uint64,
+     the last one is the number of events)
+   - for every event, the packed bin (bytes_per_event bytes, little-endian). The bin coordinates
+     (segment, view, axial position, tangential position, timing position) are stored relative to their minimum,
+     each using the number of bits in the header.
+   - padding to 4 bytes
+   - if there is an additive term, for every event a float
+
+   Events are sorted on subset (keeping their order otherwise), such that every subset is a contiguous range.
+   The file is memory-mapped when reading it.
+
+   Files without the header are assumed to be in the old format (a Bin per event, with the bin value set to
+   the additive term).
+*/
+const char listmode_cache_file_magic[8] = { 'S', 'T', 'I', 'R', 'L', 'M', 'C', '\0' };
+const std::uint32_t listmode_cache_file_byte_order_check = 0x01020304;
+const std::uint32_t listmode_cache_file_version = 2;
+
+struct ListModeCacheFileHeader
+{
+  char magic[8];
+  std::uint32_t byte_order_check;
+  std::uint32_t version;
+  std::int32_t min_coords[5];
+  std::uint32_t num_bits[5];
+  std::uint32_t bytes_per_event;
+  std::uint32_t has_additive_term;
+  std::uint32_t frame_num;
+  std::uint32_t num_subsets;
+  std::uint64_t num_events;
+};
+
+inline void
+get_coords(std::int32_t coords[5], const Bin& bin)
+{
+  coords[0] = bin.segment_num();
+  coords[1] = bin.view_num();
+  coords[2] = bin.axial_pos_num();
+  coords[3] = bin.tangential_pos_num();
+  coords[4] = bin.timing_pos_num();
+}
+
+inline int
+get_num_bits(std::uint64_t max_value)
+{
+  int num_bits = 0;
+  while (max_value > 0)
+    {
+      ++num_bits;
+      max_value >>= 1;
+    }
+  return num_bits;
+}
+
+//! set the ranges, number of bits and bytes_per_event in the header. Returns \c false if the bin does not fit in 64 bits
 bool
-PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::load_listmode_cache_file(
-    unsigned int file_id) const
+set_packing_info(ListModeCacheFileHeader& header, const ProjDataInfo& proj_data_info)
 {
-  FilePath icache(this->get_cache_filename(file_id), false);
+  int min_axial_pos_num = proj_data_info.get_min_axial_pos_num(0);
+  int max_axial_pos_num = proj_data_info.get_max_axial_pos_num(0);
+  for (int segment_num = proj_data_info.get_min_segment_num(); segment_num <= proj_data_info.get_max_segment_num();
+       ++segment_num)
+    {
+      min_axial_pos_num = std::min(min_axial_pos_num, proj_data_info.get_min_axial_pos_num(segment_num));
+      max_axial_pos_num = std::max(max_axial_pos_num, proj_data_info.get_max_axial_pos_num(segment_num));
+    }
+  const int min_coords[5] = { proj_data_info.get_min_segment_num(),
+                              proj_data_info.get_min_view_num(),
+                              min_axial_pos_num,
+                              proj_data_info.get_min_tangential_pos_num(),
+                              proj_data_info.get_min_tof_pos_num() };
+  const int max_coords[5] = { proj_data_info.get_max_segment_num(),
+                              proj_data_info.get_max_view_num(),
+                              max_axial_pos_num,
+                              proj_data_info.get_max_tangential_pos_num(),
+                              proj_data_info.get_max_tof_pos_num() };
+  std::uint32_t total_num_bits = 0;
+  for (int d = 0; d < 5; ++d)
+    {
+      header.min_coords[d] = min_coords[d];
+      header.num_bits[d] = get_num_bits(static_cast<std::uint64_t>(max_coords[d] - min_coords[d]));
+      total_num_bits += header.num_bits[d];
+    }
+  header.bytes_per_event = std::max(1U, (total_num_bits + 7) / 8);
+  return total_num_bits <= 64;
+}
 
-  record_cache.clear();
+inline void
+pack_bin(unsigned char* ptr, const Bin& bin, const ListModeCacheFileHeader& header)
+{
+  std::int32_t coords[5];
+  get_coords(coords, bin);
+  std::uint64_t packed = 0;
+  for (int d = 4; d >= 0; --d)
+    packed = (packed << header.num_bits[d]) | static_cast<std::uint64_t>(coords[d] - header.min_coords[d]);
+  for (std::uint32_t b = 0; b < header.bytes_per_event; ++b, packed >>= 8)
+    ptr[b] = static_cast<unsigned char>(packed & 0xFF);
+}
 
-  if (icache.is_regular_file())
+inline void
+unpack_bin(Bin& bin, const unsigned char* ptr, const ListModeCacheFileHeader& header)
+{
+  std::uint64_t packed = 0;
+  for (int b = static_cast<int>(header.bytes_per_event) - 1; b >= 0; --b)
+    packed = (packed << 8) | ptr[b];
+  std::int32_t coords[5];
+  for (int d = 0; d < 5; ++d)
     {
-      info(boost::format("Loading Listmode cache from disk %1%") % icache.get_as_string());
-      std::ifstream fin(icache.get_as_string(), std::ios::in | std::ios::binary | std::ios::ate);
+      const std::uint64_t mask = header.num_bits[d] == 0 ? 0 : (~std::uint64_t(0) >> (64 - header.num_bits[d]));
+      coords[d] = static_cast<std::int32_t>(packed & mask) + header.min_coords[d];
+      packed = header.num_bits[d] == 64 ? 0 : packed >> header.num_bits[d];
+    }
+  bin.segment_num() = coords[0];
+  bin.view_num() = coords[1];
+  bin.axial_pos_num() = coords[2];
+  bin.tangential_pos_num() = coords[3];
+  bin.timing_pos_num() = coords[4];
+}
 
-      const std::size_t num_records = fin.tellg() / sizeof(Bin);
-      try
-        {
-          record_cache.reserve(num_records + 1); // add 1 to avoid reallocation when overruning (see below)
-        }
-      catch (...)
-        {
-          error("Listmode: cannot allocate cache for " + std::to_string(num_records + 1) + " records");
-        }
-      if (!fin)
-        error("Error opening cache file \"" + icache.get_as_string() + "\" for reading.");
+inline std::size_t
+get_offset_of_additive_terms(const ListModeCacheFileHeader& header)
+{
+  const std::size_t offset = sizeof(header) + (header.num_subsets + 1) * sizeof(std::uint64_t)
+                             + static_cast<std::size_t>(header.num_events) * header.bytes_per_event;
+  return (offset + 3) / 4 * 4;
+}
 
-      fin.clear();
-      fin.seekg(0);
+//! check the header and subset offsets of a cache file in the new format (of size \a data_size)
+/*! Returns an empty string if there is no problem, or a description of the problem otherwise.
+    All checks are written such that corrupt values cannot cause an overflow.
+*/
+std::string
+check_listmode_cache_file(const unsigned char* const data_ptr, const std::size_t data_size)
+{
+  ListModeCacheFileHeader header;
+  if (data_size < sizeof(header))
+    return "is too small";
+  std::memcpy(&header, data_ptr, sizeof(header));
+  if (header.byte_order_check != listmode_cache_file_byte_order_check)
+    return "was written on a machine with different byte order";
+  if (header.version != listmode_cache_file_version)
+    return "has unsupported version " + std::to_string(header.version);
+  std::uint32_t total_num_bits = 0;
+  for (int d = 0; d < 5; ++d)
+    {
+      if (header.num_bits[d] > 32)
+        return "has an invalid number of bits";
+      total_num_bits += header.num_bits[d];
+    }
+  if (header.bytes_per_event == 0 || header.bytes_per_event > 8 || total_num_bits > 8 * header.bytes_per_event)
+    return "has an invalid number of bytes per event";
+  if (header.num_subsets >= (data_size - sizeof(header)) / sizeof(std::uint64_t)
+      || header.num_events > data_size / header.bytes_per_event)
+    return "is too small";
+  if ((header.has_additive_term ? get_offset_of_additive_terms(header) + header.num_events * sizeof(float)
+                                : get_offset_of_additive_terms(header))
+      > data_size)
+    return "is too small";
+
+  std::vector<std::uint64_t> subset_offsets(header.num_subsets + 1);
+  std::memcpy(subset_offsets.data(), data_ptr + sizeof(header), subset_offsets.size() * sizeof(std::uint64_t));
+  if (subset_offsets.front() != 0 || subset_offsets.back() != header.num_events
+      || !std::is_sorted(subset_offsets.begin(), subset_offsets.end()))
+    return "has inconsistent subset offsets";
+  return std::string();
+}
+
+//! check a cache file (see above). Files in the old format are not checked.
+std::string
+check_listmode_cache_file(const std::string& filename)
+{
+  try
+    {
+      boost::interprocess::file_mapping mapping(filename.c_str(), boost::interprocess::read_only);
+      boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+      const unsigned char* const data_ptr = static_cast<const unsigned char*>(region.get_address());
+      const std::size_t data_size = region.get_size();
+      if (data_size < sizeof(listmode_cache_file_magic)
+          || std::memcmp(data_ptr, listmode_cache_file_magic, sizeof(listmode_cache_file_magic)) != 0)
+        return std::string();
+      return check_listmode_cache_file(data_ptr, data_size);
+    }
+  catch (boost::interprocess::interprocess_exception& e)
+    {
+      return std::string("cannot be mapped: ") + e.what();
+    }
+}
 
-      while (!fin.eof())
+//! read a cache file in the old format (without header), appending to \a cache
+void
+read_old_listmode_cache_file(std::vector<BinAndCorr>& cache, const std::string& filename, const bool has_add)
+{
+  std::ifstream fin(filename, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!fin)
+    error("Error opening cache file \"" + filename + "\" for reading.");
+  const std::size_t num_records = fin.tellg() / sizeof(Bin);
+  try
+    {
+      cache.reserve(num_records);
+    }
+  catch (...)
+    {
+      error("Listmode: cannot allocate cache for " + std::to_string(num_records) + " records");
+    }
+  fin.seekg(0);
+  for (std::size_t ie = 0; ie < num_records; ++ie)
+    {
+      BinAndCorr tmp;
+      fin.read((char*)&tmp, sizeof(Bin));
+      if (has_add)
         {
-          BinAndCorr tmp;
-          fin.read((char*)&tmp, sizeof(Bin));
-          if (this->has_add)
-            {
-              tmp.my_corr = tmp.my_bin.get_bin_value();
-              tmp.my_bin.set_bin_value(1);
-            }
-          record_cache.push_back(tmp);
+          tmp.my_corr = tmp.my_bin.get_bin_value();
+          tmp.my_bin.set_bin_value(1);
         }
-      // The while will push one junk record
-      record_cache.pop_back();
-      fin.close();
+      cache.push_back(tmp);
     }
-  else
+  if (!fin)
+    error("Error reading cache file \"" + filename + "\".");
+}
+} // namespace
+
+template <typename TargetT>
+bool
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::load_listmode_cache_file(
+    unsigned int file_id, const int subset_num) const
+{
+  const std::string filename = this->get_cache_filename(file_id);
+  FilePath icache(filename, false);
+
+  record_cache.clear();
+
+  if (!icache.is_regular_file())
     {
       error("Cannot find Listmode cache on disk. Please recompute it or do not set the  max cache size. Abort.");
       return true; // need to return something to avoid compiler warning
     }
 
+  info(boost::format("Loading Listmode cache from disk %1%") % icache.get_as_string());
+  shared_ptr<boost::interprocess::mapped_region> mapped_region_sptr;
+  try
+    {
+      boost::interprocess::file_mapping mapping(filename.c_str(), boost::interprocess::read_only);
+      mapped_region_sptr.reset(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_only));
+    }
+  catch (boost::interprocess::interprocess_exception& e)
+    {
+      error("Error mapping cache file \"" + filename + "\": " + e.what());
+    }
+  const unsigned char* const data_ptr = static_cast<const unsigned char*>(mapped_region_sptr->get_address());
+  const std::size_t data_size = mapped_region_sptr->get_size();
+
+  ListModeCacheFileHeader header;
+  if (data_size < sizeof(header) || std::memcmp(data_ptr, listmode_cache_file_magic, sizeof(listmode_cache_file_magic)) != 0)
+    {
+      mapped_region_sptr.reset();
+      read_old_listmode_cache_file(record_cache, filename, this->has_add);
+      info(boost::format("Cached Events: %1% ") % record_cache.size(), 2);
+      return (file_id + 1) == this->num_cache_files;
+    }
+
+  {
+    // normally already checked in cache_listmode_file(), but the file might have changed since then
+    const std::string problem = check_listmode_cache_file(data_ptr, data_size);
+    if (!problem.empty())
+      error("Cache file \"" + filename + "\" " + problem + ". Please recompute it.");
+  }
+  std::memcpy(&header, data_ptr, sizeof(header));
+  if (header.frame_num != this->current_frame_num)
+    error("Cache file \"" + filename + "\" was written for frame " + std::to_string(header.frame_num)
+          + ", but we need frame " + std::to_string(this->current_frame_num) + ". Please recompute it.");
+  if (this->has_add && !header.has_additive_term)
+    error("Cache file \"" + filename + "\" does not contain the additive term. Please recompute it.");
+  if (header.min_coords[4] != this->event_proj_data_info_sptr->get_min_tof_pos_num())
+    error("Cache file \"" + filename + "\" was written with different timing positions (check \"use event-driven TOF kernel\"). "
+          + "Please recompute it.");
+
+  std::vector<std::uint64_t> subset_offsets(header.num_subsets + 1);
+  std::memcpy(subset_offsets.data(), data_ptr + sizeof(header), subset_offsets.size() * sizeof(std::uint64_t));
+
+  // find range of events to read. If the subsets are the same as when the file was written, we only need
+  // to read the events of the current subset (as the others would be ignored anyway).
+  std::uint64_t first_event = 0;
+  std::uint64_t end_event = header.num_events;
+  if (subset_num >= 0 && static_cast<int>(header.num_subsets) == this->num_subsets && this->num_subsets > 1)
+    {
+      first_event = subset_offsets[subset_num];
+      end_event = subset_offsets[subset_num + 1];
+    }
+  const long int num_events = static_cast<long int>(end_event - first_event);
+  try
+    {
+      record_cache.resize(num_events);
+    }
+  catch (...)
+    {
+      error("Listmode: cannot allocate cache for " + std::to_string(num_events) + " records");
+    }
+
+  const unsigned char* const events_ptr
+      = data_ptr + sizeof(header) + subset_offsets.size() * sizeof(std::uint64_t) + first_event * header.bytes_per_event;
+  const float* const additive_terms_ptr
+      = reinterpret_cast<const float*>(data_ptr + get_offset_of_additive_terms(header)) + first_event;
+  const bool has_add = this->has_add;
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(static)
+#endif
+  for (long int ie = 0; ie < num_events; ++ie)
+    {
+      BinAndCorr& event = record_cache[ie];
+      unpack_bin(event.my_bin, events_ptr + ie * header.bytes_per_event, header);
+      event.my_bin.set_bin_value(1);
+      event.my_corr = has_add ? additive_terms_ptr[ie] : 0.F;
+    }
+
   info(boost::format("Cached Events: %1% ") % record_cache.size(), 2);
   return (file_id + 1) == this->num_cache_files;
 }
@@ -422,6 +769,53 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
   const auto cache_filename = this->get_cache_filename(file_id);
   const bool with_add = !is_null_ptr(this->additive_proj_data_sptr);
 
+  ListModeCacheFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, listmode_cache_file_magic, sizeof(listmode_cache_file_magic));
+  header.byte_order_check = listmode_cache_file_byte_order_check;
+  header.version = listmode_cache_file_version;
+  if (!set_packing_info(header, *this->event_proj_data_info_sptr))
+    error("Listmode cache: bin coordinates do not fit in 64 bits");
+  header.has_additive_term = with_add ? 1 : 0;
+  header.frame_num = this->current_frame_num;
+  header.num_subsets = static_cast<std::uint32_t>(std::max(this->num_subsets, 1));
+  header.num_events = record_cache.size();
+
+  // sort events on subset (with a counting sort, keeping the order within a subset)
+  const long int num_events = static_cast<long int>(record_cache.size());
+  std::vector<int> subset_nums(num_events, 0);
+  if (header.num_subsets > 1)
+    {
+      const DataSymmetriesForBins& symmetries = *this->event_PM_sptr->get_symmetries_ptr();
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(static)
+#endif
+      for (long int ie = 0; ie < num_events; ++ie)
+        {
+          Bin basic_bin = record_cache[ie].my_bin;
+          if (!symmetries.is_basic(basic_bin))
+            symmetries.find_basic_bin(basic_bin);
+          subset_nums[ie] = basic_bin.view_num() % static_cast<int>(header.num_subsets);
+        }
+    }
+  std::vector<std::uint64_t> subset_offsets(header.num_subsets + 1, 0);
+  for (const int subset_num : subset_nums)
+    ++subset_offsets[subset_num + 1];
+  std::partial_sum(subset_offsets.begin(), subset_offsets.end(), subset_offsets.begin());
+
+  std::vector<unsigned char> packed_events(static_cast<std::size_t>(num_events) * header.bytes_per_event);
+  std::vector<float> additive_terms(with_add ? num_events : 0);
+  {
+    std::vector<std::uint64_t> current_offsets(subset_offsets.begin(), subset_offsets.end() - 1);
+    for (long int ie = 0; ie < num_events; ++ie)
+      {
+        const std::uint64_t new_ie = current_offsets[subset_nums[ie]]++;
+        pack_bin(&packed_events[new_ie * header.bytes_per_event], record_cache[ie].my_bin, header);
+        if (with_add)
+          additive_terms[new_ie] = record_cache[ie].my_corr;
+      }
+  }
+
   {
     info("Storing Listmode cache to file \"" + cache_filename + "\".");
     // open the file, overwriting whatever was there before
@@ -429,12 +823,15 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
     if (!fout)
       error("Error opening cache file \"" + cache_filename + "\" for writing.");
 
-    for (unsigned long int ie = 0; ie < record_cache.size(); ++ie)
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(reinterpret_cast<const char*>(subset_offsets.data()), subset_offsets.size() * sizeof(std::uint64_t));
+    fout.write(reinterpret_cast<const char*>(packed_events.data()), packed_events.size());
+    if (with_add)
       {
-        Bin tmp = record_cache[ie].my_bin;
-        if (with_add)
-          tmp.set_bin_value(record_cache[ie].my_corr);
-        fout.write((char*)&tmp, sizeof(Bin));
+        const std::size_t offset = sizeof(header) + subset_offsets.size() * sizeof(std::uint64_t) + packed_events.size();
+        const char padding[4] = { 0, 0, 0, 0 };
+        fout.write(padding, get_offset_of_additive_terms(header) - offset);
+        fout.write(reinterpret_cast<const char*>(additive_terms.data()), additive_terms.size() * sizeof(float));
       }
     if (!fout)
       error("Error writing to cache file \"" + cache_filename + "\".");
@@ -445,10 +842,134 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
   return Succeeded::yes;
 }
 
+namespace
+{
+//! find the timing position in the (mashed) projection data for every timing position of the events
+/*! As in SSRB(), the timing position of an event is assigned to the timing position of \a proj_data_info
+    whose TOF bin contains the centre (in \c k) of the TOF bin of the event.
+    For an even TOF mashing factor, some of these centres are on the boundary between 2 TOF bins.
+    They are assigned to the higher one (as in SSRB()), using a margin of a quarter of the sampling of the
+    events to avoid rounding errors.
+    Timing positions of the events that are outside all TOF bins of \a proj_data_info get
+    <tt>proj_data_info.get_max_tof_pos_num()+1</tt>, such that those events are rejected.
+*/
+VectorWithOffset<int>
+get_mashed_timing_pos_nums(const ProjDataInfo& proj_data_info, const ProjDataInfo& event_proj_data_info)
+{
+  VectorWithOffset<int> mashed_timing_pos_nums(event_proj_data_info.get_min_tof_pos_num(),
+                                               event_proj_data_info.get_max_tof_pos_num());
+  if (!proj_data_info.is_tof_data())
+    {
+      mashed_timing_pos_nums.fill(0);
+      return mashed_timing_pos_nums;
+    }
+  for (int timing_pos_num = event_proj_data_info.get_min_tof_pos_num();
+       timing_pos_num <= event_proj_data_info.get_max_tof_pos_num();
+       ++timing_pos_num)
+    {
+      const Bin event_bin(0, 0, 0, 0, timing_pos_num);
+      const float k = event_proj_data_info.get_k(event_bin);
+      const float margin = event_proj_data_info.get_sampling_in_k(event_bin) / 4;
+      mashed_timing_pos_nums[timing_pos_num] = proj_data_info.get_max_tof_pos_num() + 1;
+      for (int mashed_timing_pos_num = proj_data_info.get_min_tof_pos_num();
+           mashed_timing_pos_num <= proj_data_info.get_max_tof_pos_num();
+           ++mashed_timing_pos_num)
+        {
+          const Bin mashed_bin(0, 0, 0, 0, mashed_timing_pos_num);
+          const float lower_k = proj_data_info.get_k(mashed_bin) - proj_data_info.get_sampling_in_k(mashed_bin) / 2;
+          const float higher_k = proj_data_info.get_k(mashed_bin) + proj_data_info.get_sampling_in_k(mashed_bin) / 2;
+          if (k >= lower_k - margin && k < higher_k - margin)
+            {
+              mashed_timing_pos_nums[timing_pos_num] = mashed_timing_pos_num;
+              break;
+            }
+        }
+    }
+  return mashed_timing_pos_nums;
+}
+
+//! Number of list-mode records that are read and decoded in one go in read_listmode_batch()
+const std::size_t listmode_decoding_block_size = 16384;
+//! Number of records passed to ListModeData::get_bins_for_records() in one go when decoding in parallel
+const std::size_t listmode_decoding_chunk_size = 1024;
+
+//! Read at most \a max_num_records records into \a records, returning the number of records read
+inline std::size_t
+read_listmode_block(const ListModeData& list_mode_data,
+                    const std::vector<shared_ptr<ListRecord>>& records,
+                    const std::size_t max_num_records)
+{
+  assert(max_num_records <= records.size());
+  std::size_t num_records = 0;
+  while (num_records < max_num_records && list_mode_data.get_next_record(*records[num_records]) == Succeeded::yes)
+    ++num_records;
+  return num_records;
+}
+
+//! Order on view, segment, axial and tangential position, and timing position
+inline bool
+is_before_in_sorted_batch(const BinAndCorr& a, const BinAndCorr& b)
+{
+  const Bin& bin_a = a.my_bin;
+  const Bin& bin_b = b.my_bin;
+  return std::make_tuple(
+             bin_a.view_num(), bin_a.segment_num(), bin_a.axial_pos_num(), bin_a.tangential_pos_num(), bin_a.timing_pos_num())
+         < std::make_tuple(
+             bin_b.view_num(), bin_b.segment_num(), bin_b.axial_pos_num(), bin_b.tangential_pos_num(), bin_b.timing_pos_num());
+}
+
+//! Sort the events (in parallel) and merge events in the same bin, adding their bin values
+void
+sort_and_merge_events(std::vector<BinAndCorr>& events)
+{
+  // sort chunks in parallel, and then merge them pairwise
+#ifdef STIR_OPENMP
+  const int num_chunks = static_cast<int>(std::min(static_cast<std::size_t>(get_max_num_threads()), events.size() / 10000 + 1));
+#else
+  const int num_chunks = 1;
+#endif
+  std::vector<std::size_t> chunk_starts(num_chunks + 1);
+  for (int c = 0; c <= num_chunks; ++c)
+    chunk_starts[c] = events.size() / num_chunks * c + std::min(events.size() % num_chunks, static_cast<std::size_t>(c));
+
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(static)
+#endif
+  for (int c = 0; c < num_chunks; ++c)
+    std::sort(events.begin() + chunk_starts[c], events.begin() + chunk_starts[c + 1], is_before_in_sorted_batch);
+
+  for (int width = 1; width < num_chunks; width *= 2)
+    {
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+      for (int c = 0; c < num_chunks - width; c += 2 * width)
+        std::inplace_merge(events.begin() + chunk_starts[c],
+                           events.begin() + chunk_starts[c + width],
+                           events.begin() + chunk_starts[std::min(c + 2 * width, num_chunks)],
+                           is_before_in_sorted_batch);
+    }
+
+  // merge events in the same bin. Their additive term is the same.
+  std::size_t num_unique_events = 0;
+  for (std::size_t ie = 0; ie < events.size(); ++ie)
+    {
+      if (num_unique_events > 0 && !is_before_in_sorted_batch(events[num_unique_events - 1], events[ie]))
+        {
+          Bin& bin = events[num_unique_events - 1].my_bin;
+          bin.set_bin_value(bin.get_bin_value() + events[ie].my_bin.get_bin_value());
+        }
+      else
+        events[num_unique_events++] = events[ie];
+    }
+  events.resize(num_unique_events);
+}
+} // namespace
+
 template <typename TargetT>
 bool
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::read_listmode_batch(
-    unsigned int ibatch) const
+    unsigned int ibatch, std::vector<BinAndCorr>& cache) const
 {
   double current_time = 0.;
   if (ibatch == 0)
@@ -456,83 +977,189 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
   else
     current_time = this->end_time_per_batch[ibatch - 1];
 
-  record_cache.clear();
+  cache.clear();
   try
     {
-      record_cache.reserve(this->cache_size);
+      cache.reserve(this->cache_size);
     }
   catch (...)
     {
       error("Listmode: cannot allocate cache for " + std::to_string(this->cache_size) + " records. Reduce cache size.");
     }
 
-  const shared_ptr<ListRecord> record_sptr = this->list_mode_data_sptr->get_empty_record_sptr();
+  // We use 2 blocks of records: while the events in one block are being decoded in parallel,
+  // the next block is read from the list-mode data by another thread.
+  // The list-mode data therefore do not need to read ahead themselves.
+  this->list_mode_data_sptr->set_read_ahead(false);
+  const std::size_t block_size = listmode_decoding_block_size;
+  std::vector<shared_ptr<ListRecord>> blocks[2];
+  std::vector<const ListRecord*> record_ptrs[2];
+  for (int b = 0; b < 2; ++b)
+    {
+      blocks[b].resize(block_size);
+      for (auto& record_sptr : blocks[b])
+        {
+          record_sptr = this->list_mode_data_sptr->get_empty_record_sptr();
+          record_ptrs[b].push_back(record_sptr.get());
+        }
+    }
+  std::vector<Bin> bins(block_size);
+  std::vector<BinAndCorr> decoded_events(block_size);
+  std::vector<char> is_valid_event(block_size);
 
   const double start_time = this->frame_defs.get_start_time(this->current_frame_num);
   const double end_time = this->frame_defs.get_end_time(this->current_frame_num);
   unsigned long int cached_events = 0;
 
+  const ProjDataInfo& proj_data_info = *this->proj_data_info_sptr;
+  const ProjDataInfo& event_proj_data_info = *this->event_proj_data_info_sptr;
+  // timing position in the projection data for every timing position of the events
+  const VectorWithOffset<int> mashed_timing_pos_nums = get_mashed_timing_pos_nums(proj_data_info, event_proj_data_info);
+
+  // Maximum number of records that can still be read without going past the end of this batch.
+  // As every record gives at most 1 event, we cannot fill the cache (or reach num_events_to_use) before this.
+  auto get_max_num_records_to_read = [&]() -> std::size_t {
+    std::size_t max_num_records = this->cache_size - cache.size();
+    if (this->num_events_to_use > 0)
+      max_num_records = std::min(max_num_records, static_cast<std::size_t>(this->num_events_to_use) - cached_events);
+    return max_num_records;
+  };
+
+  // only decode in parallel if the list-mode data supports it
+  const bool decode_in_parallel = this->list_mode_data_sptr->can_decode_records_in_parallel();
+
   bool stop_caching = false;
+  int current_block = 0;
+  std::size_t num_records_requested = std::min(block_size, get_max_num_records_to_read());
+  std::size_t num_records = read_listmode_block(*this->list_mode_data_sptr, blocks[current_block], num_records_requested);
 
   while (true) // Start for the current cache
     {
-      if (this->list_mode_data_sptr->get_next_record(*record_sptr) == Succeeded::no)
+      const bool end_of_data = num_records < num_records_requested;
+      const std::vector<shared_ptr<ListRecord>>& records = blocks[current_block];
+
+      // start reading the next block, making sure we do not read past the end of the batch
+      std::size_t num_next_records_requested = 0;
+      std::future<std::size_t> next_block_future;
+      if (!end_of_data && get_max_num_records_to_read() > num_records)
         {
-          stop_caching = true;
-          break;
+          num_next_records_requested = std::min(block_size, get_max_num_records_to_read() - num_records);
+          next_block_future = std::async(std::launch::async,
+                                         read_listmode_block,
+                                         std::cref(*this->list_mode_data_sptr),
+                                         std::cref(blocks[1 - current_block]),
+                                         num_next_records_requested);
         }
-      if (record_sptr->is_time())
+
+      // decode the events in the current block, passing chunks of records to the list-mode data
+      const long int num_chunks
+          = static_cast<long int>((num_records + listmode_decoding_chunk_size - 1) / listmode_decoding_chunk_size);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(static) if (decode_in_parallel)
+#endif
+      for (long int chunk_num = 0; chunk_num < num_chunks; ++chunk_num)
         {
-          current_time = record_sptr->time().get_time_in_secs();
-          if (this->do_time_frame && current_time >= end_time)
+          const std::size_t first_record = chunk_num * listmode_decoding_chunk_size;
+          const std::size_t end_record = std::min(first_record + listmode_decoding_chunk_size, num_records);
+          for (std::size_t i = first_record; i < end_record; ++i)
+            bins[i].set_bin_value(1.0);
+          this->list_mode_data_sptr->get_bins_for_records(&bins[first_record],
+                                                          record_ptrs[current_block].data() + first_record,
+                                                          end_record - first_record,
+                                                          event_proj_data_info);
+          for (std::size_t i = first_record; i < end_record; ++i)
             {
-              stop_caching = true;
-              break; // get out of while loop
+              is_valid_event[i] = false;
+              const ListRecord& record = *records[i];
+              if (!record.is_event() || !record.event().is_prompt())
+                continue;
+              const Bin& bin = bins[i];
+              // check the timing position in the projection data, such that we use the same events for any tof_mash_factor
+              const int timing_pos_num = (bin.timing_pos_num() >= mashed_timing_pos_nums.get_min_index()
+                                          && bin.timing_pos_num() <= mashed_timing_pos_nums.get_max_index())
+                                             ? mashed_timing_pos_nums[bin.timing_pos_num()]
+                                             : proj_data_info.get_max_tof_pos_num() + 1;
+              is_valid_event[i] = !(bin.get_bin_value() != 1.0f || bin.segment_num() < proj_data_info.get_min_segment_num()
+                                    || bin.segment_num() > proj_data_info.get_max_segment_num()
+                                    || bin.tangential_pos_num() < proj_data_info.get_min_tangential_pos_num()
+                                    || bin.tangential_pos_num() > proj_data_info.get_max_tangential_pos_num()
+                                    || bin.axial_pos_num() < proj_data_info.get_min_axial_pos_num(bin.segment_num())
+                                    || bin.axial_pos_num() > proj_data_info.get_max_axial_pos_num(bin.segment_num())
+                                    || timing_pos_num < proj_data_info.get_min_tof_pos_num()
+                                    || timing_pos_num > proj_data_info.get_max_tof_pos_num());
+              if (is_valid_event[i])
+                decoded_events[i].my_bin = bin;
             }
         }
-      if (current_time < start_time)
-        continue; // skip
-      if (record_sptr->is_event() && record_sptr->event().is_prompt())
+
+      // add the events to the cache, in the order in which they occur in the list-mode data
+      bool batch_done = false;
+      for (std::size_t i = 0; i < num_records; ++i)
         {
-          BinAndCorr tmp;
-          tmp.my_bin.set_bin_value(1.0);
-          record_sptr->event().get_bin(tmp.my_bin, *this->proj_data_info_sptr);
-
-          if (tmp.my_bin.get_bin_value() != 1.0f || tmp.my_bin.segment_num() < this->proj_data_info_sptr->get_min_segment_num()
-              || tmp.my_bin.segment_num() > this->proj_data_info_sptr->get_max_segment_num()
-              || tmp.my_bin.tangential_pos_num() < this->proj_data_info_sptr->get_min_tangential_pos_num()
-              || tmp.my_bin.tangential_pos_num() > this->proj_data_info_sptr->get_max_tangential_pos_num()
-              || tmp.my_bin.axial_pos_num() < this->proj_data_info_sptr->get_min_axial_pos_num(tmp.my_bin.segment_num())
-              || tmp.my_bin.axial_pos_num() > this->proj_data_info_sptr->get_max_axial_pos_num(tmp.my_bin.segment_num())
-              || tmp.my_bin.timing_pos_num() < this->proj_data_info_sptr->get_min_tof_pos_num()
-              || tmp.my_bin.timing_pos_num() > this->proj_data_info_sptr->get_max_tof_pos_num())
+          const ListRecord& record = *records[i];
+          if (record.is_time())
             {
-              continue;
+              current_time = record.time().get_time_in_secs();
+              if (this->do_time_frame && current_time >= end_time)
+                {
+                  stop_caching = true;
+                  batch_done = true;
+                  break; // get out of for loop
+                }
             }
+          if (current_time < start_time)
+            continue; // skip
+          if (!is_valid_event[i])
+            continue;
           try
             {
-              record_cache.push_back(tmp);
+              cache.push_back(decoded_events[i]);
               ++cached_events;
             }
           catch (...)
             {
               // should never get here due to `reserve` statement above, but best to check...
-              error("Listmode: running out of memory for cache. Current size: " + std::to_string(this->record_cache.size())
-                    + " records");
+              error("Listmode: running out of memory for cache. Current size: " + std::to_string(cache.size()) + " records");
             }
 
-          if (record_cache.size() > 1 && record_cache.size() % 500000L == 0)
-            info(boost::format("Read Prompt Events (this batch): %1% ") % record_cache.size(), 3);
+          if (cache.size() > 1 && cache.size() % 500000L == 0)
+            info(boost::format("Read Prompt Events (this batch): %1% ") % cache.size(), 3);
 
           if (this->num_events_to_use > 0)
             if (cached_events >= static_cast<std::size_t>(this->num_events_to_use))
               {
                 stop_caching = true;
+                batch_done = true;
                 break;
               }
 
-          if (record_cache.size() == this->cache_size)
-            break; // cache is full.
+          if (cache.size() == this->cache_size)
+            {
+              batch_done = true;
+              break; // cache is full.
+            }
+        }
+
+      // always wait for the reading thread, as it might otherwise still use the blocks
+      const std::size_t num_next_records = next_block_future.valid() ? next_block_future.get() : 0;
+      if (batch_done)
+        break;
+      if (end_of_data)
+        {
+          stop_caching = true;
+          break;
+        }
+      if (num_next_records_requested > 0)
+        {
+          current_block = 1 - current_block;
+          num_records_requested = num_next_records_requested;
+          num_records = num_next_records;
+        }
+      else
+        {
+          // we could not read ahead, as we might have gone past the end of the batch
+          num_records_requested = std::min(block_size, get_max_num_records_to_read());
+          num_records = read_listmode_block(*this->list_mode_data_sptr, blocks[current_block], num_records_requested);
         }
     }
   if (this->end_time_per_batch.size() < (ibatch + 1))
@@ -551,7 +1178,13 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
   // add additive term to current cache
   if (this->has_add)
     {
-      info(boost::format("Caching Additive corrections for : %1% events.") % record_cache.size(), 2);
+      info(boost::format("Caching Additive corrections for : %1% events.") % cache.size(), 2);
+
+      // number of timing positions of the events in every timing position of the projection data
+      VectorWithOffset<int> num_event_timing_poss(proj_data_info.get_min_tof_pos_num(), proj_data_info.get_max_tof_pos_num() + 1);
+      num_event_timing_poss.fill(0);
+      for (int timing_pos_num : mashed_timing_pos_nums)
+        ++num_event_timing_poss[timing_pos_num];
 
 #ifdef STIR_OPENMP
 #  pragma omp parallel
@@ -579,19 +1212,16 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
           {
             const auto segment(this->additive_proj_data_sptr->get_segment_by_view(seg, timing_pos_num));
 
-            for (BinAndCorr& cur_bin : record_cache)
+            // every event is handled by only one (seg, timing_pos_num) iteration, so no need for synchronisation
+            for (BinAndCorr& cur_bin : cache)
               {
-                if (cur_bin.my_bin.segment_num() == seg)
+                if (cur_bin.my_bin.segment_num() == seg
+                    && mashed_timing_pos_nums[cur_bin.my_bin.timing_pos_num()] == timing_pos_num)
                   {
-#ifdef STIR_OPENMP
-#  if _OPENMP >= 201012
-#    pragma omp atomic write
-#  else
-#    pragma omp critical(PLogLikListModePMBAddSinoCaching)
-#  endif
-#endif
+                    // the additive term is spread over the timing positions of the events in the mashed bin
                     cur_bin.my_corr
-                        = segment[cur_bin.my_bin.view_num()][cur_bin.my_bin.axial_pos_num()][cur_bin.my_bin.tangential_pos_num()];
+                        = segment[cur_bin.my_bin.view_num()][cur_bin.my_bin.axial_pos_num()][cur_bin.my_bin.tangential_pos_num()]
+                          / num_event_timing_poss[timing_pos_num];
                   }
               }
           }
@@ -602,16 +1232,56 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
 template <typename TargetT>
 bool
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::load_listmode_batch(
-    unsigned int ibatch) const
+    unsigned int ibatch, const int subset_num) const
 {
+  const bool sort_batches = this->sort_batches;
   if (this->cache_lm_file)
     {
-      return this->load_listmode_cache_file(ibatch);
+      const bool stop = this->load_listmode_cache_file(ibatch, subset_num);
+      if (sort_batches)
+        sort_and_merge_events(this->record_cache);
+      return stop;
+    }
+
+  const auto read_and_sort_batch = [this, sort_batches](unsigned int batch_num, std::vector<BinAndCorr>& cache) {
+    const bool stop = this->read_listmode_batch(batch_num, cache);
+    if (sort_batches)
+      sort_and_merge_events(cache);
+    return stop;
+  };
+
+  bool stop;
+  if (this->next_batch_future.valid())
+    {
+      // a batch has been read in the background. Use it if it is the one we need.
+      const bool next_batch_stop = this->next_batch_future.get();
+      this->next_batch_future = std::shared_future<bool>();
+      if (this->next_batch_num == ibatch)
+        {
+          std::swap(this->record_cache, this->next_record_cache);
+          stop = next_batch_stop;
+        }
+      else
+        stop = read_and_sort_batch(ibatch, this->record_cache);
     }
   else
+    stop = read_and_sort_batch(ibatch, this->record_cache);
+
+  if (!stop)
     {
-      return this->read_listmode_batch(ibatch);
+      // start reading the next batch while the current one is being used
+      this->next_batch_num = ibatch + 1;
+      this->next_batch_future = std::async(std::launch::async, [this, ibatch, read_and_sort_batch]() {
+                                  // The current batch is processed with all threads while this one is read.
+                                  // Use only 1 OpenMP thread here (this only affects the current thread) to avoid
+                                  // oversubscription.
+#ifdef STIR_OPENMP
+                                  omp_set_num_threads(1);
+#endif
+                                  return read_and_sort_batch(ibatch + 1, this->next_record_cache);
+                                }).share();
     }
+  return stop;
 }
 
 template <typename TargetT>
@@ -632,7 +1302,22 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
         }
       if (!this->num_cache_files)
         error("No cache files found.");
-      return Succeeded::yes; // Stop here!!!
+      // check the files, and recompute the cache if there is a problem
+      bool cache_files_ok = true;
+      for (unsigned int file_id = 0; file_id < this->num_cache_files && cache_files_ok; ++file_id)
+        {
+          const std::string problem = check_listmode_cache_file(this->get_cache_filename(file_id));
+          if (!problem.empty())
+            {
+              if (this->skip_lm_input_file)
+                error("Cache file \"" + this->get_cache_filename(file_id) + "\" " + problem
+                      + ". It cannot be recomputed as we are skipping the list-mode data.");
+              warning("Cache file \"" + this->get_cache_filename(file_id) + "\" " + problem + ". Recomputing the cache.");
+              cache_files_ok = false;
+            }
+        }
+      if (cache_files_ok)
+        return Succeeded::yes; // Stop here!!!
     }
 
   assert(this->cache_lm_file);
@@ -643,7 +1328,7 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
     {
       info("Listmode reconstruction: Creating cache...", 2);
 
-      bool stop_caching = this->read_listmode_batch(this->num_cache_files);
+      bool stop_caching = this->read_listmode_batch(this->num_cache_files, this->record_cache);
 
       if (write_listmode_cache_file(this->num_cache_files) == Succeeded::no)
         {
@@ -662,8 +1347,6 @@ void
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::add_subset_sensitivity(
     TargetT& sensitivity, const int subset_num) const
 {
-  // TODO replace with call to distributable function
-
   const int min_segment_num = this->proj_data_info_sptr->get_min_segment_num();
   const int max_segment_num = this->proj_data_info_sptr->get_max_segment_num();
 
@@ -674,50 +1357,59 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
   if (min_timing_pos_num < 0 || max_timing_pos_num > 0)
     error("TOF code for sensitivity needs work");
 
-  this->sens_backprojector_sptr->start_accumulating_in_new_target();
-
-  // warning: has to be same as subset scheme used as in distributable_computation
-#ifdef STIR_OPENMP
-#  if _OPENMP < 201107
-#    pragma omp parallel for schedule(dynamic)
-#  else
-#    pragma omp parallel for collapse(2) schedule(dynamic)
-#  endif
-#endif
-  for (int segment_num = min_segment_num; segment_num <= max_segment_num; ++segment_num)
+  // use distributable_computation() (i.e. OpenMP and/or MPI) with projection data filled with 1,
+  // as in PoissonLogLikelihoodWithLinearModelForMeanAndProjData
+  if (!this->sensitivity_distributable_computation_already_setup)
     {
-      for (int view = this->sens_proj_data_info_sptr->get_min_view_num() + subset_num;
-           view <= this->sens_proj_data_info_sptr->get_max_view_num();
-           view += this->num_subsets)
-        {
-          const ViewSegmentNumbers view_segment_num(view, segment_num);
-
-          if (!this->sens_backprojector_sptr->get_symmetries_used()->is_basic(view_segment_num))
-            continue;
-          // for (int timing_pos_num = min_timing_pos_num; timing_pos_num <= max_timing_pos_num; ++timing_pos_num)
-          {
-            shared_ptr<DataSymmetriesForViewSegmentNumbers> symmetries_used(
-                this->sens_backprojector_sptr->get_symmetries_used()->clone());
-
-            RelatedViewgrams<float> viewgrams = this->sens_proj_data_info_sptr->get_empty_related_viewgrams(
-                view_segment_num, symmetries_used, false); //, timing_pos_num);
-
-            viewgrams.fill(1.F);
-            // find efficiencies
-            {
-              this->normalisation_sptr->undo(viewgrams);
-            }
-            // backproject
-            {
-              const int min_ax_pos_num = viewgrams.get_min_axial_pos_num();
-              const int max_ax_pos_num = viewgrams.get_max_axial_pos_num();
-
-              this->sens_backprojector_sptr->back_project(viewgrams, min_ax_pos_num, max_ax_pos_num);
-            }
-          }
-        }
+      // the forward projector is not used, but is needed by the MPI workers to construct the pair
+      auto sens_projector_pair_sptr = std::make_shared<ProjectorByBinPairUsingSeparateProjectors>(
+          this->projector_pair_sptr->get_forward_projector_sptr(), this->sens_backprojector_sptr);
+      setup_distributable_computation(sens_projector_pair_sptr,
+                                      this->list_mode_data_sptr->get_exam_info_sptr(),
+                                      this->sens_proj_data_info_sptr,
+                                      std::shared_ptr<TargetT>(sensitivity.clone()),
+                                      /* zero_seg0_end_planes = */ false,
+                                      /* distributed_cache_enabled = */ false);
+      this->sensitivity_distributable_computation_already_setup = true;
     }
-  this->sens_backprojector_sptr->get_output(sensitivity);
+  // the projection data are the same for every subset, so allocate them only once
+  if (is_null_ptr(this->sens_proj_data_sptr))
+    {
+      this->sens_proj_data_sptr
+          = std::make_shared<ProjDataInMemory>(this->list_mode_data_sptr->get_exam_info_sptr(), this->sens_proj_data_info_sptr);
+      this->sens_proj_data_sptr->fill(1.F);
+    }
+  shared_ptr<DataSymmetriesForViewSegmentNumbers> symmetries_sptr(
+      this->sens_backprojector_sptr->get_symmetries_used()->clone());
+
+  shared_ptr<TargetT> sensitivity_this_subset_sptr(sensitivity.get_empty_copy());
+  distributable_sensitivity_computation(this->sens_backprojector_sptr,
+                                        symmetries_sptr,
+                                        *sensitivity_this_subset_sptr,
+                                        sensitivity,
+                                        this->sens_proj_data_sptr,
+                                        subset_num,
+                                        this->num_subsets,
+                                        min_segment_num,
+                                        max_segment_num,
+                                        /* zero_seg0_end_planes = */ false,
+                                        NULL,
+                                        shared_ptr<ProjData>(),
+                                        this->normalisation_sptr,
+                                        this->frame_defs.get_start_time(this->current_frame_num),
+                                        this->frame_defs.get_end_time(this->current_frame_num),
+                                        NULL,
+                                        min_timing_pos_num,
+                                        max_timing_pos_num);
+
+  std::transform(sensitivity.begin_all(),
+                 sensitivity.end_all(),
+                 sensitivity_this_subset_sptr->begin_all(),
+                 sensitivity.begin_all(),
+                 std::plus<typename TargetT::full_value_type>());
+  // subsets are handled in order, so we do not need the projection data anymore after the last one
+  if (subset_num == this->num_subsets - 1)
+    this->sens_proj_data_sptr.reset();
 }
 
 template <typename TargetT>
@@ -843,6 +1535,29 @@ LM_gradient_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
                                LM_gradient_and_value<true, false>);
 }
 
+void
+LM_value_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
+                                   const shared_ptr<ProjDataInfo>& proj_data_info_sptr,
+                                   const DiscretisedDensity<3, float>* input_image_ptr,
+                                   const std::vector<BinAndCorr>& record_ptr,
+                                   const int subset_num,
+                                   const int num_subsets,
+                                   const bool has_add,
+                                   double* value_ptr)
+{
+  LM_distributable_computation(PM_sptr,
+                               proj_data_info_sptr,
+                               nullptr,
+                               input_image_ptr,
+                               record_ptr,
+                               subset_num,
+                               num_subsets,
+                               has_add,
+                               /* accumulate = */ true,
+                               value_ptr,
+                               LM_gradient_and_value<false, true>);
+}
+
 void
 LM_Hessian_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
                                      const shared_ptr<ProjDataInfo>& proj_data_info_sptr,
@@ -883,25 +1598,30 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<
           "use_subset_sensitivities is false. This will result in an error in the gradient computation.");
 
   double accum = 0.;
+  start_distributable_LM_computation(task_do_distributable_LM_loglikelihood_computation,
+                                     &current_estimate,
+                                     nullptr,
+                                     subset_num,
+                                     this->num_subsets,
+                                     this->has_add);
   unsigned int icache = 0;
   while (true)
     {
-      bool stop = this->load_listmode_batch(icache);
-      LM_distributable_computation(this->PM_sptr,
-                                   this->proj_data_info_sptr,
-                                   nullptr,
-                                   &current_estimate,
-                                   record_cache,
-                                   subset_num,
-                                   this->num_subsets,
-                                   this->has_add,
-                                   /* accumulate */ true,
-                                   &accum,
-                                   LM_gradient_and_value<false, true>);
+      bool stop = this->load_listmode_batch(icache, subset_num);
+      distribute_LM_events(record_cache);
+      LM_value_distributable_computation(this->event_PM_sptr,
+                                         this->event_proj_data_info_sptr,
+                                         &current_estimate,
+                                         record_cache,
+                                         subset_num,
+                                         this->num_subsets,
+                                         this->has_add,
+                                         &accum);
       ++icache;
       if (stop)
         break;
     }
+  end_distributable_LM_computation(nullptr, &accum);
   std::inner_product(current_estimate.begin_all_const(),
                      current_estimate.end_all_const(),
                      this->get_subset_sensitivity(subset_num).begin_all_const(),
@@ -924,12 +1644,19 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<
           "actual_compute_subset_gradient_without_penalty(): cannot subtract subset sensitivity because "
           "use_subset_sensitivities is false. This will result in an error in the gradient computation.");
 
+  start_distributable_LM_computation(task_do_distributable_LM_gradient_computation,
+                                     &current_estimate,
+                                     nullptr,
+                                     subset_num,
+                                     this->num_subsets,
+                                     this->has_add);
   unsigned int icache = 0;
   while (true)
     {
-      bool stop = this->load_listmode_batch(icache);
-      LM_gradient_distributable_computation(this->PM_sptr,
-                                            this->proj_data_info_sptr,
+      bool stop = this->load_listmode_batch(icache, subset_num);
+      distribute_LM_events(record_cache);
+      LM_gradient_distributable_computation(this->event_PM_sptr,
+                                            this->event_proj_data_info_sptr,
                                             &gradient,
                                             &current_estimate,
                                             record_cache,
@@ -942,6 +1669,7 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<
       if (stop)
         break;
     }
+  end_distributable_LM_computation(&gradient, nullptr);
 
   if (!add_sensitivity)
     {
@@ -982,12 +1710,15 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<
   assert(subset_num >= 0);
   assert(subset_num < this->num_subsets);
 
+  start_distributable_LM_computation(
+      task_do_distributable_LM_Hessian_computation, &current_estimate, &rhs, subset_num, this->num_subsets, this->has_add);
   unsigned int icache = 0;
   while (true)
     {
-      bool stop = this->load_listmode_batch(icache);
-      LM_Hessian_distributable_computation(this->PM_sptr,
-                                           this->proj_data_info_sptr,
+      bool stop = this->load_listmode_batch(icache, subset_num);
+      distribute_LM_events(record_cache);
+      LM_Hessian_distributable_computation(this->event_PM_sptr,
+                                           this->event_proj_data_info_sptr,
                                            &output,
                                            &current_estimate,
                                            &rhs,
@@ -1000,6 +1731,7 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<
       if (stop)
         break;
     }
+  end_distributable_LM_computation(&output, nullptr);
   return Succeeded::yes;
 }
 
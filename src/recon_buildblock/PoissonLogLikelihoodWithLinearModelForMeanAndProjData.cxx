@@ -1410,8 +1410,6 @@ RPC_process_related_viewgrams_gradient(const shared_ptr<ForwardProjectorByBin>&
 {
   assert(measured_viewgrams_ptr != NULL);
 
-  RelatedViewgrams<float> estimated_viewgrams = measured_viewgrams_ptr->get_empty_copy();
-
   /*if (distributed::first_iteration)
     {
         stir::RelatedViewgrams<float>::iterator viewgrams_iter = measured_viewgrams_ptr->begin();
@@ -1430,13 +1428,29 @@ RPC_process_related_viewgrams_gradient(const shared_ptr<ForwardProjectorByBin>&
                 }
     }
 */
-  forward_projector_sptr->forward_project(estimated_viewgrams);
 
-  if (additive_binwise_correction_ptr != NULL)
-    estimated_viewgrams += (*additive_binwise_correction_ptr);
+  // If there are no (positive) counts, divide_and_truncate() sets all bins to zero, and the
+  // log-likelihood terms are zero as well. This happens a lot for low-count (e.g. TOF) data,
+  // so we skip the forward projection in this case.
+  const bool no_counts = measured_viewgrams_ptr->find_max() <= 0;
+  if (no_counts)
+    {
+      if (add_sensitivity)
+        return; // back projection of zeros
+      measured_viewgrams_ptr->fill(0.F);
+    }
+  else
+    {
+      RelatedViewgrams<float> estimated_viewgrams = measured_viewgrams_ptr->get_empty_copy();
+
+      forward_projector_sptr->forward_project(estimated_viewgrams);
 
-  // for sinogram division
-  divide_and_truncate(*measured_viewgrams_ptr, estimated_viewgrams, rim_truncation_sino, count, count2, log_likelihood_ptr);
+      if (additive_binwise_correction_ptr != NULL)
+        estimated_viewgrams += (*additive_binwise_correction_ptr);
+
+      // for sinogram division
+      divide_and_truncate(*measured_viewgrams_ptr, estimated_viewgrams, rim_truncation_sino, count, count2, log_likelihood_ptr);
+    }
 
   // adding the sensitivity:  backproj[y/ybar] *
   // not adding the sensitivity computes the gradient:  backproj[y/ybar - 1] *
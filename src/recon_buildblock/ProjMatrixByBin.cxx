@@ -14,7 +14,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000-2009, Hammersmith Imanet Ltd
-    Copyright (C) 2013, 2015, 2022 University College London
+    Copyright (C) 2013, 2015, 2022, 2026 University College London
     Copyright (C) 2016, University of Hull
 
     This file is part of STIR.
@@ -26,7 +26,13 @@
 
 #include "stir/recon_buildblock/ProjMatrixByBin.h"
 #include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/recon_buildblock/SymmetryOperation.h"
 #include "stir/TOF_conversions.h"
+#include "stir/LORCoordinates.h"
+#include "stir/warning.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
 
 START_NAMESPACE_STIR
 
@@ -35,8 +41,11 @@ ProjMatrixByBin::set_defaults()
 {
   cache_disabled = false;
   cache_stores_only_basic_bins = true;
+  cache_stores_tof_rows = true;
+  set_maximum_cache_size(0);
   gauss_sigma_in_mm = 0.f;
   r_sqrt2_gauss_sigma = 0.f;
+  tof_kernel_cut_off_in_sigma = 4.f * static_cast<float>(sqrt(2.0));
 }
 
 void
@@ -44,11 +53,25 @@ ProjMatrixByBin::initialise_keymap()
 {
   parser.add_key("disable caching", &cache_disabled);
   parser.add_key("store_only_basic_bins_in_cache", &cache_stores_only_basic_bins);
+  parser.add_key("maximum cache size in MB", &max_cache_size_in_MB);
+  parser.add_key("TOF kernel cut-off (in sigma)", &tof_kernel_cut_off_in_sigma);
+  parser.add_key("store TOF rows in cache", &cache_stores_tof_rows);
 }
 
 bool
 ProjMatrixByBin::post_processing()
 {
+  if (max_cache_size_in_MB < 0)
+    {
+      warning("ProjMatrixByBin: maximum cache size in MB has to be non-negative");
+      return true;
+    }
+  if (tof_kernel_cut_off_in_sigma <= 0)
+    {
+      warning("ProjMatrixByBin: TOF kernel cut-off has to be positive");
+      return true;
+    }
+  set_maximum_cache_size(static_cast<std::size_t>(std::round(max_cache_size_in_MB * 1024 * 1024)));
   return false;
 }
 
@@ -71,15 +94,36 @@ ProjMatrixByBin::enable_tof(const shared_ptr<const ProjDataInfo>& _proj_data_inf
       tof_enabled = true;
       gauss_sigma_in_mm = tof_delta_time_to_mm(proj_data_info_sptr->get_scanner_ptr()->get_timing_resolution()) / 2.355f;
       r_sqrt2_gauss_sigma = 1.0f / (gauss_sigma_in_mm * static_cast<float>(sqrt(2.0)));
+      tof_kernel_cut_off_for_erf = tof_kernel_cut_off_in_sigma / static_cast<float>(sqrt(2.0));
     }
 }
 
+void
+ProjMatrixByBin::set_tof_kernel_cut_off(const float num_sigmas)
+{
+  if (num_sigmas <= 0)
+    error("ProjMatrixByBin: TOF kernel cut-off has to be positive");
+  tof_kernel_cut_off_in_sigma = num_sigmas;
+}
+
+float
+ProjMatrixByBin::get_tof_kernel_cut_off() const
+{
+  return tof_kernel_cut_off_in_sigma;
+}
+
 void
 ProjMatrixByBin::store_only_basic_bins_in_cache(const bool v)
 {
   cache_stores_only_basic_bins = v;
 }
 
+void
+ProjMatrixByBin::store_tof_rows_in_cache(const bool v)
+{
+  cache_stores_tof_rows = v;
+}
+
 bool
 ProjMatrixByBin::is_cache_enabled() const
 {
@@ -92,19 +136,53 @@ ProjMatrixByBin::does_cache_store_only_basic_bins() const
   return cache_stores_only_basic_bins;
 }
 
+bool
+ProjMatrixByBin::does_cache_store_tof_rows() const
+{
+  return cache_stores_tof_rows;
+}
+
+void
+ProjMatrixByBin::set_maximum_cache_size(const std::size_t size_in_bytes)
+{
+  max_cache_size_in_MB = static_cast<double>(size_in_bytes) / (1024 * 1024);
+  this->cache.set_max_size_in_bytes(size_in_bytes);
+}
+
+std::size_t
+ProjMatrixByBin::get_maximum_cache_size() const
+{
+  return this->cache.get_max_size_in_bytes();
+}
+
 void
 ProjMatrixByBin::clear_cache() const
 {
-#ifdef STIR_OPENMP
-#  pragma omp critical(PROJMATRIXBYBINCLEARCACHE)
-#endif
-  for (int i = this->cache_collection.get_min_index(); i <= this->cache_collection.get_max_index(); ++i)
-    {
-      for (int j = this->cache_collection[i].get_min_index(); j <= this->cache_collection[i].get_max_index(); ++j)
-        {
-          this->cache_collection[i][j].clear();
-        }
-    }
+  this->cache.clear();
+}
+
+std::size_t
+ProjMatrixByBin::get_cache_size_in_bytes() const
+{
+  return this->cache.get_size_in_bytes();
+}
+
+std::uint64_t
+ProjMatrixByBin::get_num_cache_hits() const
+{
+  return this->cache.get_num_hits();
+}
+
+std::uint64_t
+ProjMatrixByBin::get_num_cache_misses() const
+{
+  return this->cache.get_num_misses();
+}
+
+std::uint64_t
+ProjMatrixByBin::get_num_cache_evictions() const
+{
+  return this->cache.get_num_evictions();
 }
 
 /*
@@ -154,22 +232,10 @@ ProjMatrixByBin::set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_spt
       tof_enabled = false;
     }
 
-  this->cache_collection.recycle();
-  this->cache_collection.resize(min_view_num, max_view_num);
-#ifdef STIR_OPENMP
-  this->cache_locks.recycle();
-  this->cache_locks.resize(min_view_num, max_view_num);
-#endif
-
-  for (int view_num = min_view_num; view_num <= max_view_num; ++view_num)
-    {
-      this->cache_collection[view_num].resize(min_segment_num, max_segment_num);
-#ifdef STIR_OPENMP
-      this->cache_locks[view_num].resize(min_segment_num, max_segment_num);
-      for (int seg_num = min_segment_num; seg_num <= max_segment_num; ++seg_num)
-        omp_init_lock(&this->cache_locks[view_num][seg_num]);
-#endif
-    }
+  this->cache_min_view_num = min_view_num;
+  this->cache_min_segment_num = min_segment_num;
+  this->cache_num_segments = max_segment_num - min_segment_num + 1;
+  this->cache.set_up(static_cast<std::size_t>(max_view_num - min_view_num + 1) * this->cache_num_segments);
 
   // Setup the custom erf code
   erf_interpolation.set_num_samples(200000); // 200,000 =~12.8MB
@@ -198,6 +264,16 @@ ProjMatrixByBin::cache_key(const Bin& bin) const
       | (static_cast<CacheKey>(abs(bin.timing_pos_num()))));
 }
 
+std::size_t
+ProjMatrixByBin::cache_shard_index(const Bin& bin) const
+{
+  assert(bin.view_num() >= cache_min_view_num);
+  assert(bin.segment_num() >= cache_min_segment_num);
+  assert(bin.segment_num() < cache_min_segment_num + cache_num_segments);
+  return static_cast<std::size_t>(bin.view_num() - cache_min_view_num) * cache_num_segments
+         + static_cast<std::size_t>(bin.segment_num() - cache_min_segment_num);
+}
+
 void
 ProjMatrixByBin::cache_proj_matrix_elems_for_one_bin(const ProjMatrixElemsForOneBin& probabilities) const
 {
@@ -207,18 +283,12 @@ ProjMatrixByBin::cache_proj_matrix_elems_for_one_bin(const ProjMatrixElemsForOne
   // std::cerr << "cached lor size " << probabilities.size() << " capacity " << probabilities.capacity() << std::endl;
   //  insert probabilities into the collection
   const Bin bin = probabilities.get_bin();
-#ifdef STIR_OPENMP
-  omp_set_lock(&this->cache_locks[bin.view_num()][bin.segment_num()]);
-#endif
-  cache_collection[bin.view_num()][bin.segment_num()].insert(
-      MapProjMatrixElemsForOneBin::value_type(cache_key(bin), probabilities));
-#ifdef STIR_OPENMP
-  omp_unset_lock(&this->cache_locks[bin.view_num()][bin.segment_num()]);
-#endif
+  this->cache.insert(probabilities, cache_shard_index(bin), cache_key(bin));
 }
 
 Succeeded
-ProjMatrixByBin::get_cached_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& probabilities) const
+ProjMatrixByBin::get_cached_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& probabilities,
+                                                         const bool update_statistics) const
 {
   if (cache_disabled)
     return Succeeded::no;
@@ -234,32 +304,210 @@ ProjMatrixByBin::get_cached_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneB
     }
 #endif
 
-  bool found = false;
-#ifdef STIR_OPENMP
-  omp_set_lock(&this->cache_locks[bin.view_num()][bin.segment_num()]);
-#endif
+  return this->cache.get(probabilities, cache_shard_index(bin), cache_key(bin), update_statistics);
+}
 
-  {
-    const_MapProjMatrixElemsForOneBinIterator pos = cache_collection[bin.view_num()][bin.segment_num()].find(cache_key(bin));
-
-    if (pos != cache_collection[bin.view_num()][bin.segment_num()].end())
-      {
-        // cout << Key << " =========>> entry found in cache " <<  endl;
-        probabilities = pos->second;
-        // note: cannot return from inside an OPENMP critical section
-        // return Succeeded::yes;
-        found = true;
-      }
-  }
-#ifdef STIR_OPENMP
-  omp_unset_lock(&this->cache_locks[bin.view_num()][bin.segment_num()]);
+void
+ProjMatrixByBin::get_proj_matrix_elems_for_one_basic_bin_without_tof(ProjMatrixElemsForOneBin& probabilities) const
+{
+  const Bin bin = probabilities.get_bin();
+  // the geometric row does not depend on the timing position, so use the same one for all of them
+  Bin bin_without_tof = bin;
+  bin_without_tof.timing_pos_num() = 0;
+  probabilities.set_bin(bin_without_tof);
+  const CacheKey key = cache_key(bin_without_tof) | without_tof_key_bit;
+  if (cache_disabled || this->cache.get(probabilities, cache_shard_index(bin_without_tof), key) == Succeeded::no)
+    {
+      calculate_proj_matrix_elems_for_one_bin(probabilities);
+#ifndef NDEBUG
+      probabilities.check_state();
 #endif
-  if (found)
-    return Succeeded::yes;
-  else
+      if (!cache_disabled)
+        this->cache.insert(probabilities, cache_shard_index(bin_without_tof), key);
+    }
+  probabilities.set_bin(bin);
+}
+
+void
+ProjMatrixByBin::get_proj_matrix_elems_for_one_bin_without_tof(ProjMatrixElemsForOneBin& probabilities, const Bin& bin) const
+{
+  if (!(proj_data_info_sptr->is_tof_data() && this->tof_enabled))
+    {
+      get_proj_matrix_elems_for_one_bin(probabilities, bin);
+      return;
+    }
+
+  probabilities.erase();
+  Bin basic_bin = bin;
+  basic_bin.timing_pos_num() = 0;
+  unique_ptr<SymmetryOperation> symm_ptr = symmetries_sptr->find_symmetry_operation_from_basic_bin(basic_bin);
+  probabilities.set_bin(basic_bin);
+  get_proj_matrix_elems_for_one_basic_bin_without_tof(probabilities);
+  symm_ptr->transform_proj_matrix_elems_for_one_bin(probabilities);
+}
+
+void
+ProjMatrixByBin::get_tof_geometry(CartesianCoordinate3D<float>& middle,
+                                  CartesianCoordinate3D<float>& diff_unit_vector,
+                                  const Bin& bin) const
+{
+  LORInAxialAndNoArcCorrSinogramCoordinates<float> lor;
+  proj_data_info_sptr->get_LOR(lor, bin);
+  const LORAs2Points<float> lor2(lor);
+  const CartesianCoordinate3D<float> point1 = lor2.p1();
+  const CartesianCoordinate3D<float> point2 = lor2.p2();
+
+  // The direction can be from 1 -> 2 depending on the bin sign.
+  middle = (point1 + point2) * 0.5f;
+  const CartesianCoordinate3D<float> diff = point2 - middle;
+  diff_unit_vector = diff / static_cast<float>(norm(diff));
+}
+
+void
+ProjMatrixByBin::get_tof_range(int& min_timing_pos_num, int& max_timing_pos_num, const float d2) const
+{
+  min_timing_pos_num = proj_data_info_sptr->get_min_tof_pos_num();
+  max_timing_pos_num = proj_data_info_sptr->get_max_tof_pos_num();
+  // TOF bins are all of the same size, so we can find the range directly.
+  // We add a margin of 1 bin to cope with rounding errors, as get_tof_value() checks the cut-off anyway.
+  const float low_lim = proj_data_info_sptr->tof_bin_boundaries_mm[min_timing_pos_num].low_lim;
+  const float bin_size = proj_data_info_sptr->tof_bin_boundaries_mm[min_timing_pos_num].high_lim - low_lim;
+  if (bin_size <= 0)
+    return;
+  const float cut_off_in_mm = tof_kernel_cut_off_for_erf / r_sqrt2_gauss_sigma;
+  const float first = std::floor((d2 - cut_off_in_mm - low_lim) / bin_size) - 1;
+  const float last = std::ceil((d2 + cut_off_in_mm - low_lim) / bin_size) + 1;
+  const int num_timing_poss = max_timing_pos_num - min_timing_pos_num + 1;
+  max_timing_pos_num = min_timing_pos_num + static_cast<int>(std::min(last, static_cast<float>(num_timing_poss - 1)));
+  min_timing_pos_num += static_cast<int>(std::max(first, 0.F));
+}
+
+void
+ProjMatrixByBin::get_tof_distance_coefficients(float& offset, BasicCoordinate<3, float>& steps, const Bin& bin) const
+{
+  CartesianCoordinate3D<float> middle;
+  CartesianCoordinate3D<float> diff_unit_vector;
+  get_tof_geometry(middle, diff_unit_vector, bin);
+  // the physical coordinates are an affine function of the indices
+  const CartesianCoordinate3D<float> origin = image_info_sptr->get_physical_coordinates_for_indices(Coordinate3D<int>(0, 0, 0));
+  offset = -inner_product(origin - middle, diff_unit_vector);
+  for (int d = 1; d <= 3; ++d)
+    {
+      Coordinate3D<int> indices(0, 0, 0);
+      indices[d] = 1;
+      steps[d] = -inner_product(image_info_sptr->get_physical_coordinates_for_indices(indices) - origin, diff_unit_vector);
+    }
+}
+
+void
+ProjMatrixByBin::get_tof_values(VectorWithOffset<float>& tof_values,
+                                int& min_timing_pos_num,
+                                int& max_timing_pos_num,
+                                const float d2) const
+{
+  get_tof_range(min_timing_pos_num, max_timing_pos_num, d2);
+  if (min_timing_pos_num > max_timing_pos_num)
+    return;
+  // TOF bins are contiguous, so we can reuse the value at the upper boundary of a bin for the next one
+  const auto& tof_bin_boundaries_mm = proj_data_info_sptr->tof_bin_boundaries_mm;
+  float low_n = (tof_bin_boundaries_mm[min_timing_pos_num].low_lim - d2) * r_sqrt2_gauss_sigma;
+  double low_erf = erf_interpolation(low_n);
+  for (int k = min_timing_pos_num; k <= max_timing_pos_num; ++k)
+    {
+      const float high_n = (tof_bin_boundaries_mm[k].high_lim - d2) * r_sqrt2_gauss_sigma;
+      const double high_erf = erf_interpolation(high_n);
+      // same cut-off as in get_tof_value()
+      if ((low_n >= tof_kernel_cut_off_for_erf && high_n >= tof_kernel_cut_off_for_erf)
+          || (low_n <= -tof_kernel_cut_off_for_erf && high_n <= -tof_kernel_cut_off_for_erf))
+        tof_values[k] = 0.F;
+      else
+        tof_values[k] = static_cast<float>(0.5 * (high_erf - low_erf));
+      low_n = high_n;
+      low_erf = high_erf;
+    }
+}
+
+void
+ProjMatrixByBin::forward_project_all_timing_positions(VectorWithOffset<float>& values,
+                                                      ProjMatrixElemsForOneBin& row,
+                                                      const Bin& bin,
+                                                      const DiscretisedDensity<3, float>& density) const
+{
+  values.fill(0.F);
+  get_proj_matrix_elems_for_one_bin_without_tof(row, bin);
+
+  if (!(proj_data_info_sptr->is_tof_data() && this->tof_enabled))
+    {
+      Bin bin_without_tof = bin;
+      bin_without_tof.timing_pos_num() = 0;
+      bin_without_tof.set_bin_value(0.F);
+      row.forward_project(bin_without_tof, density);
+      values.fill(bin_without_tof.get_bin_value());
+      return;
+    }
+
+  float offset;
+  BasicCoordinate<3, float> steps;
+  get_tof_distance_coefficients(offset, steps, bin);
+  VectorWithOffset<float> tof_values(values.get_min_index(), values.get_max_index());
+
+  for (ProjMatrixElemsForOneBin::const_iterator element_ptr = row.begin(); element_ptr != row.end(); ++element_ptr)
+    {
+      const int z = element_ptr->coord1();
+      if (z < density.get_min_index() || z > density.get_max_index())
+        continue;
+      const int y = element_ptr->coord2();
+      const int x = element_ptr->coord3();
+      const float value = density[z][y][x] * element_ptr->get_value();
+      if (value == 0)
+        continue;
+      const float d2 = offset + z * steps[1] + y * steps[2] + x * steps[3];
+      int min_timing_pos_num, max_timing_pos_num;
+      get_tof_values(tof_values, min_timing_pos_num, max_timing_pos_num, d2);
+      for (int k = min_timing_pos_num; k <= max_timing_pos_num; ++k)
+        values[k] += value * tof_values[k];
+    }
+}
+
+void
+ProjMatrixByBin::back_project_all_timing_positions(DiscretisedDensity<3, float>& density,
+                                                   ProjMatrixElemsForOneBin& row,
+                                                   const Bin& bin,
+                                                   const VectorWithOffset<float>& values) const
+{
+  if (std::all_of(values.begin(), values.end(), [](const float v) { return v == 0; }))
+    return;
+
+  get_proj_matrix_elems_for_one_bin_without_tof(row, bin);
+
+  if (!(proj_data_info_sptr->is_tof_data() && this->tof_enabled))
+    {
+      Bin bin_without_tof = bin;
+      bin_without_tof.timing_pos_num() = 0;
+      bin_without_tof.set_bin_value(std::accumulate(values.begin(), values.end(), 0.F));
+      row.back_project(density, bin_without_tof);
+      return;
+    }
+
+  float offset;
+  BasicCoordinate<3, float> steps;
+  get_tof_distance_coefficients(offset, steps, bin);
+  VectorWithOffset<float> tof_values(values.get_min_index(), values.get_max_index());
+
+  for (ProjMatrixElemsForOneBin::const_iterator element_ptr = row.begin(); element_ptr != row.end(); ++element_ptr)
     {
-      // cout << " This entry  is not in the cache :" << Key << endl;
-      return Succeeded::no;
+      const int z = element_ptr->coord1();
+      if (z < density.get_min_index() || z > density.get_max_index())
+        continue;
+      const int y = element_ptr->coord2();
+      const int x = element_ptr->coord3();
+      const float d2 = offset + z * steps[1] + y * steps[2] + x * steps[3];
+      int min_timing_pos_num, max_timing_pos_num;
+      get_tof_values(tof_values, min_timing_pos_num, max_timing_pos_num, d2);
+      float sum = 0.F;
+      for (int k = min_timing_pos_num; k <= max_timing_pos_num; ++k)
+        sum += values[k] * tof_values[k];
+      density[z][y][x] += element_ptr->get_value() * sum;
     }
 }
 
@@ -1,7 +1,7 @@
 /*
     Copyright (C) 2004 - 2008, Hammersmith Imanet Ltd
     Copyright (C) 2011 - 2012, Kris Thielemans
-    Copyright (C) 2014, University College London
+    Copyright (C) 2014, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -38,8 +38,14 @@
 #include "boost/scoped_ptr.hpp"
 #include "stir/warning.h"
 #include "stir/error.h"
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <fstream>
 #include <algorithm>
+#include <cstring>
+#include <limits>
+#include <tuple>
+#include <vector>
 
 using std::string;
 
@@ -90,6 +96,10 @@ ProjMatrixByBinFromFile::set_defaults()
   do_symmetry_swap_segment = true;
   do_symmetry_swap_s = true;
   do_symmetry_shift_z = true;
+
+  mapped_data_sptr.reset();
+  num_lors_in_index = 0;
+  index_ptr = 0;
 }
 
 bool
@@ -98,9 +108,9 @@ ProjMatrixByBinFromFile::post_processing()
   if (ProjMatrixByBin::post_processing() == true)
     return true;
 
-  if (this->parsed_version != "1.0")
+  if (this->parsed_version != "1.0" && this->parsed_version != "2.0")
     {
-      warning("version has to be 1.0");
+      warning("version has to be 1.0 or 2.0");
       return true;
     }
   this->symmetries_type = standardise_interfile_keyword(this->symmetries_type);
@@ -195,8 +205,18 @@ ProjMatrixByBinFromFile::set_up(const shared_ptr<const ProjDataInfo>& proj_data_
   // every LOR that's in the file in the cache
   ProjMatrixByBin::set_up(this->proj_data_info_ptr, density_info_ptr);
 
-  if (read_data() == Succeeded::no)
-    error("Something wrong reading the matrix from file. Exiting.");
+  if (this->parsed_version == "2.0")
+    {
+      if (map_compressed_data() == Succeeded::no)
+        error("Something wrong reading the matrix from file. Exiting.");
+    }
+  else
+    {
+      if (!this->is_cache_enabled() || this->get_maximum_cache_size() > 0)
+        error("ProjMatrixByBinFromFile: caching cannot be disabled or limited in size for version 1.0 files");
+      if (read_data() == Succeeded::no)
+        error("Something wrong reading the matrix from file. Exiting.");
+    }
 }
 
 ProjMatrixByBinFromFile*
@@ -327,14 +347,218 @@ read_lor(std::istream& fst, ProjMatrixElemsForOneBin& lor)
     }
   return readReturnType::ok;
 }
+
+/* Helper functions for the compressed format (version 2.0)
+
+   Layout of the binary file:
+   - header (see CompressedFileHeader)
+   - for every LOR
+     - number of elements (varint)
+     - scale factor (float)
+     - for every element: difference with the previous linear voxel index (zigzag varint),
+       followed by the quantised value (uint16). value = quantised_value * scale factor.
+       The linear index is negative or larger than the number of voxels for voxels outside
+       the image in z (these occur for the basic bins of the ray tracing matrix, and are
+       moved inside the image by the symmetries).
+   - padding to 8 bytes
+   - index: for every LOR, sorted on (segment, view, axial_pos, tangential_pos)
+     4 int32 bin coordinates and an uint64 offset of the LOR in the file
+*/
+const char compressed_file_magic[8] = { 'S', 'T', 'I', 'R', 'P', 'M', '2', '\0' };
+const std::uint32_t compressed_file_byte_order_check = 0x01020304;
+
+struct CompressedFileHeader
+{
+  char magic[8];
+  std::uint32_t byte_order_check;
+  std::uint32_t reserved;
+  std::int32_t min_indices[3];
+  std::int32_t max_indices[3];
+  std::uint64_t num_lors;
+  std::uint64_t index_offset;
+};
+
+struct CompressedFileIndexEntry
+{
+  std::int32_t segment_num;
+  std::int32_t view_num;
+  std::int32_t axial_pos_num;
+  std::int32_t tangential_pos_num;
+  std::uint64_t offset;
+
+  bool operator<(const CompressedFileIndexEntry& e) const
+  {
+    return std::tie(segment_num, view_num, axial_pos_num, tangential_pos_num)
+           < std::tie(e.segment_num, e.view_num, e.axial_pos_num, e.tangential_pos_num);
+  }
+};
+
+static void
+append_varint(std::string& buffer, std::uint64_t v)
+{
+  while (v >= 0x80)
+    {
+      buffer.push_back(static_cast<char>((v & 0x7F) | 0x80));
+      v >>= 7;
+    }
+  buffer.push_back(static_cast<char>(v));
+}
+
+// decode a varint, never reading at or beyond \a end
+static std::uint64_t
+decode_varint(const unsigned char*& ptr, const unsigned char* const end)
+{
+  std::uint64_t v = 0;
+  int shift = 0;
+  while (ptr < end && (*ptr & 0x80))
+    {
+      if (shift > 63 - 7)
+        error("ProjMatrixByBinFromFile: corrupt data file (varint too long)");
+      v |= static_cast<std::uint64_t>(*ptr++ & 0x7F) << shift;
+      shift += 7;
+    }
+  if (ptr >= end)
+    error("ProjMatrixByBinFromFile: corrupt data file (LOR extends beyond the end of the data)");
+  v |= static_cast<std::uint64_t>(*ptr++) << shift;
+  return v;
+}
+
+static inline std::uint64_t
+zigzag_encode(const std::int64_t v)
+{
+  return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+static inline std::int64_t
+zigzag_decode(const std::uint64_t v)
+{
+  return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+}
+
+// static (i.e. private) function to encode an LOR in the compressed format
+static Succeeded
+encode_lor(std::string& buffer,
+           const ProjMatrixElemsForOneBin& lor,
+           const BasicCoordinate<3, int>& min_indices,
+           const BasicCoordinate<3, int>& max_indices)
+{
+  buffer.clear();
+  float max_value = 0.F;
+  for (ProjMatrixElemsForOneBin::const_iterator element_ptr = lor.begin(); element_ptr != lor.end(); ++element_ptr)
+    {
+      if (element_ptr->get_value() < 0)
+        {
+          warning("ProjMatrixByBinFromFile: compressed format does not support negative values");
+          return Succeeded::no;
+        }
+      max_value = std::max(max_value, element_ptr->get_value());
+    }
+  const float scale = max_value / 65535.F;
+
+  append_varint(buffer, lor.size());
+  buffer.append(reinterpret_cast<const char*>(&scale), sizeof(scale));
+
+  const std::int64_t num_y = max_indices[2] - min_indices[2] + 1;
+  const std::int64_t num_x = max_indices[3] - min_indices[3] + 1;
+  std::int64_t previous_index = 0;
+  for (ProjMatrixElemsForOneBin::const_iterator element_ptr = lor.begin(); element_ptr != lor.end(); ++element_ptr)
+    {
+      const BasicCoordinate<3, int> c = element_ptr->get_coords();
+      for (int d = 2; d <= 3; ++d)
+        if (c[d] < min_indices[d] || c[d] > max_indices[d])
+          {
+            warning("ProjMatrixByBinFromFile: compressed format does not support voxels outside the image in x or y");
+            return Succeeded::no;
+          }
+      const std::int64_t index = ((c[1] - min_indices[1]) * num_y + (c[2] - min_indices[2])) * num_x + (c[3] - min_indices[3]);
+      append_varint(buffer, zigzag_encode(index - previous_index));
+      previous_index = index;
+      const std::uint16_t quantised_value
+          = scale > 0 ? static_cast<std::uint16_t>(std::min(65535.F, std::round(element_ptr->get_value() / scale))) : 0;
+      buffer.append(reinterpret_cast<const char*>(&quantised_value), sizeof(quantised_value));
+    }
+  return Succeeded::yes;
+}
+
+// static (i.e. private) function to decode an LOR from the compressed format
+// Calls error() if the data are corrupt, i.e. extend beyond \a end or give voxels outside the image.
+static void
+decode_lor(ProjMatrixElemsForOneBin& lor,
+           const unsigned char* ptr,
+           const unsigned char* const end,
+           const BasicCoordinate<3, int>& min_indices,
+           const BasicCoordinate<3, int>& max_indices)
+{
+  const std::uint64_t count = decode_varint(ptr, end);
+  // every element needs at least 1 byte for the index and 2 for the value
+  if (static_cast<std::uint64_t>(end - ptr) < sizeof(float) || count > static_cast<std::uint64_t>(end - ptr) / 3)
+    error("ProjMatrixByBinFromFile: corrupt data file (LOR extends beyond the end of the data)");
+  float scale;
+  std::memcpy(&scale, ptr, sizeof(scale));
+  ptr += sizeof(scale);
+
+  const std::int64_t num_y = max_indices[2] - min_indices[2] + 1;
+  const std::int64_t num_x = max_indices[3] - min_indices[3] + 1;
+  const std::int64_t num_voxels_in_plane = num_y * num_x;
+  lor.reserve(count);
+  std::int64_t index = 0;
+  for (std::uint64_t i = 0; i < count; ++i)
+    {
+      index += zigzag_decode(decode_varint(ptr, end));
+      // planes outside the image are allowed, but z has to fit in an int
+      std::int64_t plane = index / num_voxels_in_plane;
+      std::int64_t index_in_plane = index % num_voxels_in_plane;
+      if (index_in_plane < 0)
+        {
+          index_in_plane += num_voxels_in_plane;
+          --plane;
+        }
+      if (plane < std::numeric_limits<int>::min() / 2 || plane > std::numeric_limits<int>::max() / 2)
+        error("ProjMatrixByBinFromFile: corrupt data file (voxel far outside the image for bin "
+              + std::to_string(lor.get_bin().segment_num()) + "," + std::to_string(lor.get_bin().view_num()) + ","
+              + std::to_string(lor.get_bin().axial_pos_num()) + "," + std::to_string(lor.get_bin().tangential_pos_num())
+              + ")");
+      if (end - ptr < static_cast<std::ptrdiff_t>(sizeof(std::uint16_t)))
+        error("ProjMatrixByBinFromFile: corrupt data file (LOR extends beyond the end of the data)");
+      std::uint16_t quantised_value;
+      std::memcpy(&quantised_value, ptr, sizeof(quantised_value));
+      ptr += sizeof(quantised_value);
+      const int x = static_cast<int>(index_in_plane % num_x) + min_indices[3];
+      const int y = static_cast<int>(index_in_plane / num_x) + min_indices[2];
+      const int z = static_cast<int>(plane) + min_indices[1];
+      lor.push_back(ProjMatrixElemsForOneBin::value_type(Coordinate3D<int>(z, y, x), quantised_value * scale));
+    }
+}
+
+static CompressedFileIndexEntry
+get_index_entry(const char* index_ptr, const std::uint64_t i)
+{
+  CompressedFileIndexEntry entry;
+  std::memcpy(&entry, index_ptr + i * sizeof(CompressedFileIndexEntry), sizeof(CompressedFileIndexEntry));
+  return entry;
+}
+
 } // end of anonymous namespace
 
 Succeeded
 ProjMatrixByBinFromFile::write_to_file(const std::string& output_filename_prefix,
                                        const ProjMatrixByBin& proj_matrix,
                                        const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
-                                       const DiscretisedDensity<3, float>& template_density)
+                                       const DiscretisedDensity<3, float>& template_density,
+                                       const std::string& format_version)
 {
+  const bool compressed = format_version == "2.0";
+  if (!compressed && format_version != "1.0")
+    {
+      warning("ProjMatrixByBinFromFile::write_to_file: format version has to be 1.0 or 2.0");
+      return Succeeded::no;
+    }
+  BasicCoordinate<3, int> min_indices, max_indices;
+  if (!template_density.get_regular_range(min_indices, max_indices))
+    {
+      warning("ProjMatrixByBinFromFile::write_to_file: template density has to have a regular range");
+      return Succeeded::no;
+    }
 
   string template_density_filename = output_filename_prefix + "_template_density";
   {
@@ -351,6 +575,8 @@ ProjMatrixByBinFromFile::write_to_file(const std::string& output_filename_prefix
     shared_ptr<ExamInfo> exam_info_sptr(new ExamInfo);
     ProjDataInterfile template_projdata(exam_info_sptr, proj_data_info_sptr, template_proj_data_filename);
   }
+  // refer to the header written above
+  replace_extension(template_proj_data_filename, ".hs");
 
   string header_filename = output_filename_prefix;
   replace_extension(header_filename, ".hpm");
@@ -366,7 +592,7 @@ ProjMatrixByBinFromFile::write_to_file(const std::string& output_filename_prefix
       }
 
     header << "Projection Matrix By Bin From File Parameters:=\n"
-           << "Version := 1.0\n";
+           << "Version := " << format_version << "\n";
     // TODO symmetries should not be hard-coded
     if (!is_null_ptr(dynamic_cast<const DataSymmetriesForBins_PET_CartesianGrid* const>(proj_matrix.get_symmetries_ptr())))
       {
@@ -403,6 +629,25 @@ ProjMatrixByBinFromFile::write_to_file(const std::string& output_filename_prefix
   std::ofstream fst;
   open_write_binary(fst, data_filename.c_str());
 
+  CompressedFileHeader compressed_header;
+  std::vector<CompressedFileIndexEntry> compressed_index;
+  std::string compressed_lor;
+  if (compressed)
+    {
+      std::memcpy(compressed_header.magic, compressed_file_magic, sizeof(compressed_file_magic));
+      compressed_header.byte_order_check = compressed_file_byte_order_check;
+      compressed_header.reserved = 0;
+      for (int d = 1; d <= 3; ++d)
+        {
+          compressed_header.min_indices[d - 1] = min_indices[d];
+          compressed_header.max_indices[d - 1] = max_indices[d];
+        }
+      compressed_header.num_lors = 0;
+      compressed_header.index_offset = 0;
+      // will be overwritten at the end
+      fst.write(reinterpret_cast<const char*>(&compressed_header), sizeof(compressed_header));
+    }
+
   // loop over bins
   // the complication here is that we cannot just test if each bin in the range is 'basic'
   // and write only those. The reason is that symmetry operations can construct a
@@ -482,10 +727,37 @@ ProjMatrixByBinFromFile::write_to_file(const std::string& output_filename_prefix
               //   continue;
 
               proj_matrix.get_proj_matrix_elems_for_one_bin(lor, bin);
-              if (write_lor(fst, lor) == Succeeded::no)
+              if (compressed)
+                {
+                  if (encode_lor(compressed_lor, lor, min_indices, max_indices) == Succeeded::no)
+                    return Succeeded::no;
+                  const CompressedFileIndexEntry entry
+                      = { bin.segment_num(), bin.view_num(), bin.axial_pos_num(), bin.tangential_pos_num(),
+                          static_cast<std::uint64_t>(fst.tellp()) };
+                  compressed_index.push_back(entry);
+                  fst.write(compressed_lor.data(), compressed_lor.size());
+                  if (!fst)
+                    return Succeeded::no;
+                }
+              else if (write_lor(fst, lor) == Succeeded::no)
                 return Succeeded::no;
             }
   }
+  if (compressed)
+    {
+      // pad to 8 bytes, such that the index is aligned
+      while (fst.tellp() % 8 != 0)
+        fst.put(0);
+      std::sort(compressed_index.begin(), compressed_index.end());
+      compressed_header.num_lors = compressed_index.size();
+      compressed_header.index_offset = static_cast<std::uint64_t>(fst.tellp());
+      fst.write(reinterpret_cast<const char*>(compressed_index.data()),
+                compressed_index.size() * sizeof(CompressedFileIndexEntry));
+      fst.seekp(0);
+      fst.write(reinterpret_cast<const char*>(&compressed_header), sizeof(compressed_header));
+      if (!fst)
+        return Succeeded::no;
+    }
   return Succeeded::yes;
 }
 
@@ -509,10 +781,118 @@ ProjMatrixByBinFromFile::read_data()
   return Succeeded::yes;
 }
 
+Succeeded
+ProjMatrixByBinFromFile::map_compressed_data()
+{
+  try
+    {
+      boost::interprocess::file_mapping mapping(data_filename.c_str(), boost::interprocess::read_only);
+      this->mapped_data_sptr.reset(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_only));
+    }
+  catch (boost::interprocess::interprocess_exception& e)
+    {
+      warning("ProjMatrixByBinFromFile: error mapping %s: %s", data_filename.c_str(), e.what());
+      return Succeeded::no;
+    }
+  const char* const data_ptr = static_cast<const char*>(this->mapped_data_sptr->get_address());
+  const std::size_t data_size = this->mapped_data_sptr->get_size();
+
+  CompressedFileHeader header;
+  if (data_size < sizeof(header))
+    {
+      warning("ProjMatrixByBinFromFile: file %s is too small", data_filename.c_str());
+      return Succeeded::no;
+    }
+  std::memcpy(&header, data_ptr, sizeof(header));
+  if (std::memcmp(header.magic, compressed_file_magic, sizeof(compressed_file_magic)) != 0)
+    {
+      warning("ProjMatrixByBinFromFile: file %s is not in the compressed (version 2.0) format", data_filename.c_str());
+      return Succeeded::no;
+    }
+  if (header.byte_order_check != compressed_file_byte_order_check)
+    {
+      warning("ProjMatrixByBinFromFile: file %s was written on a machine with different byte order. This is not supported",
+              data_filename.c_str());
+      return Succeeded::no;
+    }
+  BasicCoordinate<3, int> min_indices, max_indices;
+  if (!densel_range.get_regular_range(min_indices, max_indices))
+    {
+      warning("ProjMatrixByBinFromFile: template density has to have a regular range for version 2.0");
+      return Succeeded::no;
+    }
+  for (int d = 1; d <= 3; ++d)
+    {
+      if (header.min_indices[d - 1] != min_indices[d] || header.max_indices[d - 1] != max_indices[d])
+        {
+          warning("ProjMatrixByBinFromFile: image dimensions in %s do not match the template density", data_filename.c_str());
+          return Succeeded::no;
+        }
+    }
+  // check the index (written in such a way to avoid overflow for corrupt values)
+  if (header.index_offset < sizeof(header) || header.index_offset > data_size
+      || header.num_lors > (data_size - header.index_offset) / sizeof(CompressedFileIndexEntry))
+    {
+      warning("ProjMatrixByBinFromFile: file %s is truncated or corrupt", data_filename.c_str());
+      return Succeeded::no;
+    }
+#ifndef NDEBUG
+  // the binary search needs a sorted index. This is guaranteed by write_to_file(), so only check it in debug mode,
+  // as it would need to read the whole index
+  for (std::uint64_t i = 1; i < header.num_lors; ++i)
+    {
+      if (!(get_index_entry(data_ptr + header.index_offset, i - 1) < get_index_entry(data_ptr + header.index_offset, i)))
+        {
+          warning("ProjMatrixByBinFromFile: index in file %s is not sorted", data_filename.c_str());
+          return Succeeded::no;
+        }
+    }
+#endif
+  this->num_lors_in_index = header.num_lors;
+  this->index_ptr = data_ptr + header.index_offset;
+  return Succeeded::yes;
+}
+
 void
 ProjMatrixByBinFromFile::calculate_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const
 {
   // error("ProjMatrixByBinFromFile element not found in cache (and hence file)");
   lor.erase();
+  if (is_null_ptr(this->mapped_data_sptr))
+    return;
+
+  // binary search in the index
+  const Bin bin = lor.get_bin();
+  const CompressedFileIndexEntry wanted
+      = { bin.segment_num(), bin.view_num(), bin.axial_pos_num(), bin.tangential_pos_num(), std::uint64_t(0) };
+  std::uint64_t low = 0;
+  std::uint64_t high = this->num_lors_in_index;
+  while (low < high)
+    {
+      const std::uint64_t middle = low + (high - low) / 2;
+      if (get_index_entry(this->index_ptr, middle) < wanted)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+  if (low == this->num_lors_in_index)
+    return;
+  const CompressedFileIndexEntry entry = get_index_entry(this->index_ptr, low);
+  if (wanted < entry)
+    return;
+
+  // the LOR data are between the header and the index (decode_lor() checks that they do not extend into the index)
+  const std::uint64_t index_offset
+      = static_cast<std::uint64_t>(this->index_ptr - static_cast<const char*>(this->mapped_data_sptr->get_address()));
+  if (entry.offset < sizeof(CompressedFileHeader) || entry.offset >= index_offset)
+    error("ProjMatrixByBinFromFile: file %s has an invalid offset in its index", data_filename.c_str());
+
+  BasicCoordinate<3, int> min_indices, max_indices;
+  this->densel_range.get_regular_range(min_indices, max_indices);
+  decode_lor(lor,
+             static_cast<const unsigned char*>(this->mapped_data_sptr->get_address()) + entry.offset,
+             reinterpret_cast<const unsigned char*>(this->index_ptr),
+             min_indices,
+             max_indices);
 }
 END_NAMESPACE_STIR
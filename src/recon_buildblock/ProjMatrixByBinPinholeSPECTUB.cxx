@@ -934,7 +934,7 @@ ProjMatrixByBinPinholeSPECTUB::delete_PinholeSPECTUB_arrays()
 }
 
 void
-ProjMatrixByBinPinholeSPECTUB::compute_one_subset(const int kOS) const
+ProjMatrixByBinPinholeSPECTUB::compute_one_subset(const int kOS, ProjMatrixElemsForOneBin* lor_ptr) const
 {
   CPUTimer timer;
   timer.start();
@@ -983,6 +983,14 @@ ProjMatrixByBinPinholeSPECTUB::compute_one_subset(const int kOS) const
       delete[] wm.val[j];
       delete[] wm.col[j];
 
+      if (lor_ptr != nullptr && lor_ptr->get_bin().view_num() == bin.view_num()
+          && lor_ptr->get_bin().axial_pos_num() == bin.axial_pos_num()
+          && lor_ptr->get_bin().tangential_pos_num() == bin.tangential_pos_num())
+        {
+          const Bin requested_bin = lor_ptr->get_bin();
+          *lor_ptr = lor;
+          lor_ptr->set_bin(requested_bin);
+        }
       this->cache_proj_matrix_elems_for_one_bin(lor);
     }
 
@@ -994,17 +1002,18 @@ ProjMatrixByBinPinholeSPECTUB::calculate_proj_matrix_elems_for_one_bin(ProjMatri
 {
   const int view_num = lor.get_bin().view_num();
 
+  lor.erase();
 #ifdef STIR_OPENMP
 #  pragma omp critical(PROJMATRIXBYBINUBONEVIEW)
 #endif
+  {
+    if (!this->keep_all_views_in_cache)
+      this->clear_cache();
 
-  if (!this->keep_all_views_in_cache)
-    this->clear_cache();
-
-  info(boost::format("Computing matrix elements for view %1%") % view_num, 2);
-  compute_one_subset(view_num);
-
-  lor.erase();
+    info(boost::format("Computing matrix elements for view %1%") % view_num, 2);
+    // fill lor as well, as it might be evicted from the cache (due to the "maximum cache size") before we get it back
+    compute_one_subset(view_num, &lor);
+  }
 }
 
 END_NAMESPACE_STIR
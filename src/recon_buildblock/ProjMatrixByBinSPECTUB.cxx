@@ -767,7 +767,7 @@ ProjMatrixByBinSPECTUB::delete_UB_SPECT_arrays()
     }
 }
 void
-ProjMatrixByBinSPECTUB::compute_one_subset(const int kOS, const float* Rrad) const
+ProjMatrixByBinSPECTUB::compute_one_subset(const int kOS, const float* Rrad, ProjMatrixElemsForOneBin* lor_ptr) const
 {
 
   CPUTimer timer;
@@ -873,6 +873,14 @@ ProjMatrixByBinSPECTUB::compute_one_subset(const int kOS, const float* Rrad) con
       delete[] this->wm.val[j];
       delete[] this->wm.col[j];
 
+      if (lor_ptr != nullptr && lor_ptr->get_bin().view_num() == bin.view_num()
+          && lor_ptr->get_bin().axial_pos_num() == bin.axial_pos_num()
+          && lor_ptr->get_bin().tangential_pos_num() == bin.tangential_pos_num())
+        {
+          const Bin requested_bin = lor_ptr->get_bin();
+          *lor_ptr = lor;
+          lor_ptr->set_bin(requested_bin);
+        }
       this->cache_proj_matrix_elems_for_one_bin(lor);
     }
 
@@ -892,22 +900,32 @@ ProjMatrixByBinSPECTUB::calculate_proj_matrix_elems_for_one_bin(ProjMatrixElemsF
       if (prj.order[kOS] == view_num)
         break;
     }
+  lor.erase();
 #ifdef STIR_OPENMP
 #  pragma omp critical(PROJMATRIXBYBINUBONEVIEW)
 #endif
-  if (!subset_already_processed[kOS])
-    {
-      if (!this->keep_all_views_in_cache)
-        {
-          this->clear_cache();
-          subset_already_processed.assign(prj.NOS, false);
-        }
-      info(boost::format("Computing matrix elements for view %1%") % view_num,
-           2); // potentially pass a wm, wmh[threadh] not sure if works then in setup we need an array of wmh
-      compute_one_subset(kOS, Rrad);
-      subset_already_processed[kOS] = true;
-    }
-  lor.erase();
+  {
+    // We only get here when the row is not in the cache. If the subset was already processed,
+    // its rows have been evicted (due to the "maximum cache size"), so we need to recompute them.
+    // Otherwise, another thread computed the subset in the mean time. This is not a new lookup, so
+    // do not count it in the cache statistics.
+    if (subset_already_processed[kOS]
+        && this->get_cached_proj_matrix_elems_for_one_bin(lor, /*update_statistics=*/false) == Succeeded::no)
+      subset_already_processed[kOS] = false;
+    if (!subset_already_processed[kOS])
+      {
+        if (!this->keep_all_views_in_cache)
+          {
+            this->clear_cache();
+            subset_already_processed.assign(prj.NOS, false);
+          }
+        info(boost::format("Computing matrix elements for view %1%") % view_num,
+             2); // potentially pass a wm, wmh[threadh] not sure if works then in setup we need an array of wmh
+        // fill lor as well, as it might be evicted from the cache before we get it back
+        compute_one_subset(kOS, Rrad, &lor);
+        subset_already_processed[kOS] = true;
+      }
+  }
 }
 
 END_NAMESPACE_STIR
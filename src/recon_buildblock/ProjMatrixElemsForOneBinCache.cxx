@@ -0,0 +1,253 @@
+/*!
+
+  \file
+  \ingroup projection
+  \brief Implementation of class stir::ProjMatrixElemsForOneBinCache
+*/
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinCache.h"
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+START_NAMESPACE_STIR
+
+ProjMatrixElemsForOneBinCache::Entry::Entry(const ProjMatrixElemsForOneBin& elems_v)
+    : elems(elems_v),
+      size_in_bytes(estimate_size_in_bytes(elems_v)),
+      referenced(false)
+{}
+
+ProjMatrixElemsForOneBinCache::ProjMatrixElemsForOneBinCache()
+    : max_size_in_bytes(0),
+      size_in_bytes(0),
+      num_entries(0),
+      clock_hand(0),
+      num_hits(0),
+      num_misses(0),
+      num_evictions(0)
+{}
+
+ProjMatrixElemsForOneBinCache::ProjMatrixElemsForOneBinCache(const ProjMatrixElemsForOneBinCache& other)
+    : ProjMatrixElemsForOneBinCache()
+{
+  *this = other;
+}
+
+ProjMatrixElemsForOneBinCache&
+ProjMatrixElemsForOneBinCache::operator=(const ProjMatrixElemsForOneBinCache& other)
+{
+  if (this == &other)
+    return *this;
+
+  this->max_size_in_bytes = other.max_size_in_bytes;
+  this->set_up(other.shards.size());
+  for (std::size_t shard_index = 0; shard_index < other.shards.size(); ++shard_index)
+    {
+      const Shard& other_shard = *other.shards[shard_index];
+      std::shared_lock<std::shared_mutex> lock(other_shard.mutex);
+      // copy in insertion order, such that the eviction order is preserved
+      for (const Key key : other_shard.clock)
+        this->insert(other_shard.entries.at(key).elems, shard_index, key);
+    }
+  return *this;
+}
+
+ProjMatrixElemsForOneBinCache::~ProjMatrixElemsForOneBinCache()
+{}
+
+void
+ProjMatrixElemsForOneBinCache::set_up(const std::size_t num_shards)
+{
+  this->shards.clear();
+  this->shards.reserve(num_shards);
+  for (std::size_t i = 0; i < num_shards; ++i)
+    this->shards.push_back(unique_ptr<Shard>(new Shard));
+  this->size_in_bytes = 0;
+  this->num_entries = 0;
+  this->clock_hand = 0;
+  this->reset_statistics();
+}
+
+void
+ProjMatrixElemsForOneBinCache::set_max_size_in_bytes(const std::size_t max_size_in_bytes_v)
+{
+  this->max_size_in_bytes = max_size_in_bytes_v;
+}
+
+std::size_t
+ProjMatrixElemsForOneBinCache::get_max_size_in_bytes() const
+{
+  return this->max_size_in_bytes;
+}
+
+std::size_t
+ProjMatrixElemsForOneBinCache::get_size_in_bytes() const
+{
+  return this->size_in_bytes;
+}
+
+std::size_t
+ProjMatrixElemsForOneBinCache::get_num_entries() const
+{
+  return this->num_entries;
+}
+
+std::size_t
+ProjMatrixElemsForOneBinCache::get_num_shards() const
+{
+  return this->shards.size();
+}
+
+std::uint64_t
+ProjMatrixElemsForOneBinCache::get_num_hits() const
+{
+  return this->num_hits;
+}
+
+std::uint64_t
+ProjMatrixElemsForOneBinCache::get_num_misses() const
+{
+  return this->num_misses;
+}
+
+std::uint64_t
+ProjMatrixElemsForOneBinCache::get_num_evictions() const
+{
+  return this->num_evictions;
+}
+
+void
+ProjMatrixElemsForOneBinCache::reset_statistics()
+{
+  this->num_hits = 0;
+  this->num_misses = 0;
+  this->num_evictions = 0;
+}
+
+std::size_t
+ProjMatrixElemsForOneBinCache::estimate_size_in_bytes(const ProjMatrixElemsForOneBin& elems)
+{
+  // element storage, the object itself, the key, and (roughly) the hash-node and clock overhead
+  return elems.size() * sizeof(ProjMatrixElemsForOneBin::value_type) + sizeof(Entry) + 4 * sizeof(Key);
+}
+
+Succeeded
+ProjMatrixElemsForOneBinCache::get(ProjMatrixElemsForOneBin& elems,
+                                   const std::size_t shard_index,
+                                   const Key key,
+                                   const bool update_statistics) const
+{
+  assert(shard_index < this->shards.size());
+  const Shard& shard = *this->shards[shard_index];
+  {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    const auto pos = shard.entries.find(key);
+    if (pos != shard.entries.end())
+      {
+        elems = pos->second.elems;
+        if (update_statistics)
+          {
+            pos->second.referenced.store(true, std::memory_order_relaxed);
+            this->num_hits.fetch_add(1, std::memory_order_relaxed);
+          }
+        return Succeeded::yes;
+      }
+  }
+  if (update_statistics)
+    this->num_misses.fetch_add(1, std::memory_order_relaxed);
+  return Succeeded::no;
+}
+
+void
+ProjMatrixElemsForOneBinCache::insert(const ProjMatrixElemsForOneBin& elems, const std::size_t shard_index, const Key key)
+{
+  assert(shard_index < this->shards.size());
+  const std::size_t entry_size = estimate_size_in_bytes(elems);
+  if (this->max_size_in_bytes > 0)
+    {
+      if (entry_size > this->max_size_in_bytes)
+        return;
+      // note: done before taking the lock on the shard, as make_room locks (other) shards
+      this->make_room(entry_size);
+    }
+
+  Shard& shard = *this->shards[shard_index];
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  const auto result = shard.entries.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(elems));
+  if (result.second)
+    {
+      shard.clock.push_back(key);
+      this->size_in_bytes += result.first->second.size_in_bytes;
+      ++this->num_entries;
+    }
+}
+
+Succeeded
+ProjMatrixElemsForOneBinCache::evict_one_entry(Shard& shard)
+{
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  // every entry gets at most one "second chance", so we need at most 2 passes
+  std::size_t num_tries = 2 * shard.clock.size();
+  while (!shard.clock.empty() && num_tries-- > 0)
+    {
+      const Key key = shard.clock.front();
+      shard.clock.pop_front();
+      const auto pos = shard.entries.find(key);
+      assert(pos != shard.entries.end());
+      if (pos->second.referenced.exchange(false, std::memory_order_relaxed))
+        {
+          shard.clock.push_back(key);
+          continue;
+        }
+      this->size_in_bytes -= pos->second.size_in_bytes;
+      --this->num_entries;
+      shard.entries.erase(pos);
+      ++this->num_evictions;
+      return Succeeded::yes;
+    }
+  return Succeeded::no;
+}
+
+void
+ProjMatrixElemsForOneBinCache::make_room(const std::size_t num_bytes)
+{
+  const std::size_t num_shards = this->shards.size();
+  std::size_t num_failures = 0;
+  while (this->size_in_bytes + num_bytes > this->max_size_in_bytes)
+    {
+      // move the (shared) clock hand over the shards, evicting one entry from each
+      const std::size_t shard_index = this->clock_hand.fetch_add(1, std::memory_order_relaxed) % num_shards;
+      if (this->evict_one_entry(*this->shards[shard_index]) == Succeeded::no)
+        {
+          if (++num_failures > num_shards)
+            return; // nothing left to evict
+        }
+      else
+        num_failures = 0;
+    }
+}
+
+void
+ProjMatrixElemsForOneBinCache::clear()
+{
+  for (auto& shard_uptr : this->shards)
+    {
+      std::unique_lock<std::shared_mutex> lock(shard_uptr->mutex);
+      for (const auto& entry : shard_uptr->entries)
+        this->size_in_bytes -= entry.second.size_in_bytes;
+      this->num_entries -= shard_uptr->entries.size();
+      shard_uptr->entries.clear();
+      shard_uptr->clock.clear();
+    }
+}
+
+END_NAMESPACE_STIR
@@ -0,0 +1,218 @@
+/*!
+
+  \file
+  \ingroup projection
+  \brief non-inline implementations for stir::ProjMatrixElemsForOneBinPacked
+*/
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinPacked.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/DiscretisedDensity.h"
+#include <algorithm>
+
+START_NAMESPACE_STIR
+
+ProjMatrixElemsForOneBinPacked::DensityInfo::DensityInfo(const DiscretisedDensity<3, float>& density)
+    : contiguous_and_regular(false),
+      stride1(0),
+      stride2(0)
+{
+  if (!density.get_regular_range(min_indices, max_indices))
+    return;
+  contiguous_and_regular = density.is_contiguous();
+  stride2 = max_indices[3] - min_indices[3] + 1;
+  stride1 = stride2 * (max_indices[2] - min_indices[2] + 1);
+}
+
+ProjMatrixElemsForOneBinPacked::ProjMatrixElemsForOneBinPacked(const Bin& bin)
+    : bin(bin)
+{}
+
+ProjMatrixElemsForOneBinPacked::ProjMatrixElemsForOneBinPacked(const ProjMatrixElemsForOneBin& lor)
+{
+  set_from(lor);
+}
+
+void
+ProjMatrixElemsForOneBinPacked::set_from(const ProjMatrixElemsForOneBin& lor)
+{
+  bin = lor.get_bin();
+  const size_type num_elems = lor.size();
+  coords1.resize(num_elems);
+  coords2.resize(num_elems);
+  coords3.resize(num_elems);
+  values.resize(num_elems);
+  size_type i = 0;
+  for (ProjMatrixElemsForOneBin::const_iterator element_ptr = lor.begin(); element_ptr != lor.end(); ++element_ptr, ++i)
+    {
+      coords1[i] = static_cast<short>(element_ptr->coord1());
+      coords2[i] = static_cast<short>(element_ptr->coord2());
+      coords3[i] = static_cast<short>(element_ptr->coord3());
+      values[i] = element_ptr->get_value();
+    }
+}
+
+void
+ProjMatrixElemsForOneBinPacked::get_all(ProjMatrixElemsForOneBin& lor) const
+{
+  lor.erase();
+  lor.set_bin(bin);
+  lor.reserve(size());
+  for (size_type i = 0; i < size(); ++i)
+    lor.push_back(get_element(i));
+}
+
+void
+ProjMatrixElemsForOneBinPacked::erase()
+{
+  coords1.resize(0);
+  coords2.resize(0);
+  coords3.resize(0);
+  values.resize(0);
+}
+
+void
+ProjMatrixElemsForOneBinPacked::reserve(size_type max_number)
+{
+  coords1.reserve(max_number);
+  coords2.reserve(max_number);
+  coords3.reserve(max_number);
+  values.reserve(max_number);
+}
+
+namespace
+{
+//! check if all elements of \a coords are in the range [min,max] (written such that it can be vectorised)
+inline bool
+is_in_range(const std::vector<short>& coords, const int min, const int max)
+{
+  short min_coord = coords[0];
+  short max_coord = coords[0];
+  for (auto c : coords)
+    {
+      min_coord = std::min(min_coord, c);
+      max_coord = std::max(max_coord, c);
+    }
+  return min_coord >= min && max_coord <= max;
+}
+} // namespace
+
+bool
+ProjMatrixElemsForOneBinPacked::is_inside(const DensityInfo& info) const
+{
+  if (size() == 0)
+    return true;
+  return is_in_range(coords1, info.min_indices[1], info.max_indices[1])
+         && is_in_range(coords2, info.min_indices[2], info.max_indices[2])
+         && is_in_range(coords3, info.min_indices[3], info.max_indices[3]);
+}
+
+/////////////////// projection  operations //////////////////////////////////
+
+void
+ProjMatrixElemsForOneBinPacked::forward_project(Bin& single,
+                                                const DiscretisedDensity<3, float>& density,
+                                                const DensityInfo& info) const
+{
+  const int num_elems = static_cast<int>(size());
+  if (num_elems == 0)
+    return;
+
+  const short* c1 = coords1.data();
+  const short* c2 = coords2.data();
+  const short* c3 = coords3.data();
+  const float* v = values.data();
+  float sum = 0.F;
+
+  if (info.is_contiguous_and_regular() && is_inside(info))
+    {
+      // fast version: all voxels are in the image, so we can use linear offsets
+      assert(density.get_min_index() == info.min_indices[1]);
+      assert(density.get_max_index() == info.max_indices[1]);
+      const BasicCoordinate<3, int>& min_indices = info.min_indices;
+      const float* data = &density[min_indices[1]][min_indices[2]][min_indices[3]];
+      const int stride1 = info.stride1;
+      const int stride2 = info.stride2;
+      const int offset0 = min_indices[1] * stride1 + min_indices[2] * stride2 + min_indices[3];
+#if defined(STIR_OPENMP) && (_OPENMP >= 201307)
+#  pragma omp simd reduction(+ : sum)
+#endif
+      for (int i = 0; i < num_elems; ++i)
+        sum += data[c1[i] * stride1 + c2[i] * stride2 + c3[i] - offset0] * v[i];
+    }
+  else
+    {
+      // general case, as in ProjMatrixElemsForOneBin::forward_project()
+      const int min_z = density.get_min_index();
+      const int max_z = density.get_max_index();
+      for (int i = 0; i < num_elems; ++i)
+        if (c1[i] >= min_z && c1[i] <= max_z)
+          sum += density[c1[i]][c2[i]][c3[i]] * v[i];
+    }
+  single += sum;
+}
+
+void
+ProjMatrixElemsForOneBinPacked::back_project(DiscretisedDensity<3, float>& density,
+                                             const Bin& single,
+                                             const DensityInfo& info) const
+{
+  const float bin_value = single.get_bin_value();
+  const int num_elems = static_cast<int>(size());
+  if (bin_value == 0 || num_elems == 0)
+    return;
+
+  const short* c1 = coords1.data();
+  const short* c2 = coords2.data();
+  const short* c3 = coords3.data();
+  const float* v = values.data();
+
+  if (info.is_contiguous_and_regular() && is_inside(info))
+    {
+      // fast version: all voxels are in the image, so we can use linear offsets
+      assert(density.get_min_index() == info.min_indices[1]);
+      assert(density.get_max_index() == info.max_indices[1]);
+      const BasicCoordinate<3, int>& min_indices = info.min_indices;
+      float* data = &density[min_indices[1]][min_indices[2]][min_indices[3]];
+      const int stride1 = info.stride1;
+      const int stride2 = info.stride2;
+      const int offset0 = min_indices[1] * stride1 + min_indices[2] * stride2 + min_indices[3];
+      // note: every voxel occurs only once, so there are no conflicts between different elements
+#if defined(STIR_OPENMP) && (_OPENMP >= 201307)
+#  pragma omp simd
+#endif
+      for (int i = 0; i < num_elems; ++i)
+        data[c1[i] * stride1 + c2[i] * stride2 + c3[i] - offset0] += v[i] * bin_value;
+    }
+  else
+    {
+      // general case, as in ProjMatrixElemsForOneBin::back_project()
+      const int min_z = density.get_min_index();
+      const int max_z = density.get_max_index();
+      for (int i = 0; i < num_elems; ++i)
+        if (c1[i] >= min_z && c1[i] <= max_z)
+          density[c1[i]][c2[i]][c3[i]] += v[i] * bin_value;
+    }
+}
+
+void
+ProjMatrixElemsForOneBinPacked::forward_project(Bin& single, const DiscretisedDensity<3, float>& density) const
+{
+  forward_project(single, density, DensityInfo(density));
+}
+
+void
+ProjMatrixElemsForOneBinPacked::back_project(DiscretisedDensity<3, float>& density, const Bin& single) const
+{
+  back_project(density, single, DensityInfo(density));
+}
+
+END_NAMESPACE_STIR
@@ -21,6 +21,7 @@
 
 #include "stir/recon_buildblock/SymmetryOperation.h"
 #include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinPacked.h"
 #include "stir/Coordinate3D.h"
 #include "stir/recon_buildblock/ProjMatrixElemsForOneDensel.h"
 
@@ -43,6 +44,26 @@ SymmetryOperation::transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOne
     }
 }
 
+void
+SymmetryOperation::transform_packed_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBinPacked& lor) const
+{
+  Bin bin = lor.get_bin();
+  transform_bin_coordinates(bin);
+  lor.set_bin(bin);
+
+  short* c1 = lor.get_coords_ptr(1);
+  short* c2 = lor.get_coords_ptr(2);
+  short* c3 = lor.get_coords_ptr(3);
+  for (ProjMatrixElemsForOneBinPacked::size_type i = 0; i < lor.size(); ++i)
+    {
+      Coordinate3D<int> c(c1[i], c2[i], c3[i]);
+      transform_image_coordinates(c);
+      c1[i] = static_cast<short>(c[1]);
+      c2[i] = static_cast<short>(c[2]);
+      c3[i] = static_cast<short>(c[3]);
+    }
+}
+
 void
 SymmetryOperation::transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel& probs) const
 {
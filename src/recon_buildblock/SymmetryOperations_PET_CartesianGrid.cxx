@@ -29,11 +29,42 @@
 */
 #include "stir/recon_buildblock/SymmetryOperations_PET_CartesianGrid.h"
 #include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinPacked.h"
 #include "stir/Coordinate3D.h"
 #include "stir/recon_buildblock/ProjMatrixElemsForOneDensel.h"
 
 START_NAMESPACE_STIR
 
+namespace
+{
+/* Implementation of transform_packed_proj_matrix_elems_for_one_bin for all classes in this file.
+   As explained at the top of this file, the calls to transform_bin_coordinates and transform_image_coordinates
+   are forced to the members of the SymmetryOperationT class, such that the compiler can inline them. As all coordinates
+   are stored in separate arrays, the compiler can then vectorise the loop.
+*/
+template <class SymmetryOperationT>
+inline void
+transform_packed_lor(const SymmetryOperationT& symm_op, ProjMatrixElemsForOneBinPacked& lor)
+{
+  Bin bin = lor.get_bin();
+  symm_op.SymmetryOperationT::transform_bin_coordinates(bin);
+  lor.set_bin(bin);
+
+  short* c1 = lor.get_coords_ptr(1);
+  short* c2 = lor.get_coords_ptr(2);
+  short* c3 = lor.get_coords_ptr(3);
+  const int num_elems = static_cast<int>(lor.size());
+  for (int i = 0; i < num_elems; ++i)
+    {
+      Coordinate3D<int> c(c1[i], c2[i], c3[i]);
+      symm_op.SymmetryOperationT::transform_image_coordinates(c);
+      c1[i] = static_cast<short>(c[1]);
+      c2[i] = static_cast<short>(c[2]);
+      c3[i] = static_cast<short>(c[3]);
+    }
+}
+} // namespace
+
 void
 SymmetryOperation_PET_CartesianGrid_z_shift::transform_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const
 {
@@ -52,6 +83,13 @@ SymmetryOperation_PET_CartesianGrid_z_shift::transform_proj_matrix_elems_for_one
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_z_shift::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_z_shift::transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel& probs) const
 {
@@ -86,6 +124,13 @@ SymmetryOperation_PET_CartesianGrid_swap_xmx_zq::transform_proj_matrix_elems_for
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_xmx_zq::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_xmx_zq::transform_proj_matrix_elems_for_one_densel(
     ProjMatrixElemsForOneDensel& probs) const
@@ -121,6 +166,13 @@ SymmetryOperation_PET_CartesianGrid_swap_xmy_yx_zq::transform_proj_matrix_elems_
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_xmy_yx_zq::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_xmy_yx_zq::transform_proj_matrix_elems_for_one_densel(
     ProjMatrixElemsForOneDensel& probs) const
@@ -156,6 +208,13 @@ SymmetryOperation_PET_CartesianGrid_swap_xy_yx_zq::transform_proj_matrix_elems_f
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_xy_yx_zq::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_xy_yx_zq::transform_proj_matrix_elems_for_one_densel(
     ProjMatrixElemsForOneDensel& probs) const
@@ -191,6 +250,13 @@ SymmetryOperation_PET_CartesianGrid_swap_xmy_yx::transform_proj_matrix_elems_for
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_xmy_yx::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_xmy_yx::transform_proj_matrix_elems_for_one_densel(
     ProjMatrixElemsForOneDensel& probs) const
@@ -226,6 +292,13 @@ SymmetryOperation_PET_CartesianGrid_swap_xy_yx::transform_proj_matrix_elems_for_
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_xy_yx::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_xy_yx::transform_proj_matrix_elems_for_one_densel(
     ProjMatrixElemsForOneDensel& probs) const
@@ -261,6 +334,13 @@ SymmetryOperation_PET_CartesianGrid_swap_xmx::transform_proj_matrix_elems_for_on
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_xmx::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_xmx::transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel& probs) const
 {
@@ -295,6 +375,13 @@ SymmetryOperation_PET_CartesianGrid_swap_ymy::transform_proj_matrix_elems_for_on
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_ymy::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_ymy::transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel& probs) const
 {
@@ -329,6 +416,13 @@ SymmetryOperation_PET_CartesianGrid_swap_zq::transform_proj_matrix_elems_for_one
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_zq::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_zq::transform_proj_matrix_elems_for_one_densel(ProjMatrixElemsForOneDensel& probs) const
 {
@@ -363,6 +457,13 @@ SymmetryOperation_PET_CartesianGrid_swap_xmx_ymy_zq::transform_proj_matrix_elems
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_xmx_ymy_zq::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_xmx_ymy_zq::transform_proj_matrix_elems_for_one_densel(
     ProjMatrixElemsForOneDensel& probs) const
@@ -398,6 +499,13 @@ SymmetryOperation_PET_CartesianGrid_swap_xy_ymx_zq::transform_proj_matrix_elems_
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_xy_ymx_zq::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_xy_ymx_zq::transform_proj_matrix_elems_for_one_densel(
     ProjMatrixElemsForOneDensel& probs) const
@@ -433,6 +541,13 @@ SymmetryOperation_PET_CartesianGrid_swap_xy_ymx::transform_proj_matrix_elems_for
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_xy_ymx::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_xy_ymx::transform_proj_matrix_elems_for_one_densel(
     ProjMatrixElemsForOneDensel& probs) const
@@ -468,6 +583,13 @@ SymmetryOperation_PET_CartesianGrid_swap_xmy_ymx::transform_proj_matrix_elems_fo
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_xmy_ymx::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_xmy_ymx::transform_proj_matrix_elems_for_one_densel(
     ProjMatrixElemsForOneDensel& probs) const
@@ -503,6 +625,13 @@ SymmetryOperation_PET_CartesianGrid_swap_ymy_zq::transform_proj_matrix_elems_for
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_ymy_zq::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_ymy_zq::transform_proj_matrix_elems_for_one_densel(
     ProjMatrixElemsForOneDensel& probs) const
@@ -538,6 +667,13 @@ SymmetryOperation_PET_CartesianGrid_swap_xmx_ymy::transform_proj_matrix_elems_fo
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_xmx_ymy::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_xmx_ymy::transform_proj_matrix_elems_for_one_densel(
     ProjMatrixElemsForOneDensel& probs) const
@@ -573,6 +709,13 @@ SymmetryOperation_PET_CartesianGrid_swap_xmy_ymx_zq::transform_proj_matrix_elems
     }
 }
 
+void
+SymmetryOperation_PET_CartesianGrid_swap_xmy_ymx_zq::transform_packed_proj_matrix_elems_for_one_bin(
+    ProjMatrixElemsForOneBinPacked& lor) const
+{
+  transform_packed_lor(*this, lor);
+}
+
 void
 SymmetryOperation_PET_CartesianGrid_swap_xmy_ymx_zq::transform_proj_matrix_elems_for_one_densel(
     ProjMatrixElemsForOneDensel& probs) const
@@ -39,6 +39,9 @@
 #include "stir/recon_buildblock/distributable.h"
 #include "stir/RelatedViewgrams.h"
 #include "stir/ProjData.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataSparse.h"
+#include "stir/RelatedViewgramsReadAhead.h"
 #include "stir/ExamInfo.h"
 #include "stir/DiscretisedDensity.h"
 #include "stir/ViewSegmentNumbers.h"
@@ -63,11 +66,9 @@
 #  include "stir/recon_buildblock/distributed_functions.h"
 #  include "stir/recon_buildblock/distributed_test_functions.h"
 #  include "stir/recon_buildblock/PoissonLogLikelihoodWithLinearModelForMeanAndProjData.h" // needed for RPC functions
+#  include "stir/recon_buildblock/ProjectorByBinPairUsingProjMatrixByBin.h"
 #endif
 #ifdef STIR_OPENMP
-#  ifdef STIR_MPI
-#    error Cannot use both OPENMP and MP
-#  endif
 #  include <omp.h>
 #endif
 #include "stir/num_threads.h"
@@ -142,6 +143,90 @@ end_distributable_computation()
 #endif
 }
 
+/* WARNING: the sequence of steps here has to match what is on the receiving end
+   in DistributedWorker */
+void
+setup_distributable_LM_computation(const shared_ptr<ProjMatrixByBin>& PM_sptr,
+                                   const shared_ptr<const ExamInfo>& exam_info_sptr,
+                                   const shared_ptr<const ProjDataInfo> proj_data_info_sptr,
+                                   const shared_ptr<const DiscretisedDensity<3, float>>& target_sptr)
+{
+#ifdef STIR_MPI
+  distributed::send_int_value(task_setup_distributable_LM_computation, -1);
+
+  distributed::send_image_parameters(target_sptr.get(), -1, -1);
+  distributed::send_image_estimate(target_sptr.get(), -1);
+
+  distributed::send_exam_and_proj_data_info(*exam_info_sptr, *proj_data_info_sptr, -1);
+
+  // send the projection matrix, wrapped in a projector pair to be able to use the existing functions
+  shared_ptr<ProjectorByBinPair> proj_pair_sptr(new ProjectorByBinPairUsingProjMatrixByBin(PM_sptr));
+  distributed::send_projectors(proj_pair_sptr, -1);
+#endif
+}
+
+void
+start_distributable_LM_computation(const int task_id,
+                                   const DiscretisedDensity<3, float>* input_image_ptr,
+                                   const DiscretisedDensity<3, float>* rhs_ptr,
+                                   const int subset_num,
+                                   const int num_subsets,
+                                   const bool has_add)
+{
+#ifdef STIR_MPI
+  distributed::send_int_value(task_id, -1);
+  distributed::send_image_estimate(input_image_ptr, -1);
+  if (task_id == task_do_distributable_LM_Hessian_computation)
+    distributed::send_image_estimate(rhs_ptr, -1);
+
+  int parameters[3];
+  parameters[0] = subset_num;
+  parameters[1] = num_subsets;
+  parameters[2] = has_add ? 1 : 0;
+  distributed::send_int_values(parameters, 3, distributed::STIR_MPI_CONF_TAG, -1);
+#endif
+}
+
+void
+distribute_LM_events(std::vector<BinAndCorr>& record_cache)
+{
+#ifdef STIR_MPI
+  // Events are distributed in blocks in a round-robin fashion, such that every process gets
+  // events from the whole batch (even if the batch has been sorted).
+  const std::size_t block_size = 1024;
+  const int num_processors = distributed::num_processors;
+  std::vector<std::vector<BinAndCorr>> events_for_workers(num_processors);
+  std::size_t num_events_for_master = 0;
+  for (std::size_t start = 0, block_num = 0; start < record_cache.size(); start += block_size, ++block_num)
+    {
+      const std::size_t end = std::min(start + block_size, record_cache.size());
+      const int processor = static_cast<int>(block_num % num_processors);
+      if (processor == 0)
+        {
+          // keep these, moving them to the start of record_cache
+          std::copy(record_cache.begin() + start, record_cache.begin() + end, record_cache.begin() + num_events_for_master);
+          num_events_for_master += end - start;
+        }
+      else
+        events_for_workers[processor].insert(
+            events_for_workers[processor].end(), record_cache.begin() + start, record_cache.begin() + end);
+    }
+  record_cache.resize(num_events_for_master);
+  for (int processor = 1; processor < num_processors; ++processor)
+    distributed::send_listmode_events(events_for_workers[processor], processor);
+#endif
+}
+
+void
+end_distributable_LM_computation(DiscretisedDensity<3, float>* output_image_ptr, double* double_out_ptr)
+{
+#ifdef STIR_MPI
+  for (int processor = 1; processor < distributed::num_processors; ++processor)
+    distributed::send_end_of_listmode_events(processor);
+  distributed::reduce_image_and_value(output_image_ptr, double_out_ptr, 0);
+#endif
+}
+
 template <class ViewgramsPtr>
 static void
 zero_end_sinograms(ViewgramsPtr viewgrams_ptr)
@@ -159,6 +244,14 @@ zero_end_sinograms(ViewgramsPtr viewgrams_ptr)
     }
 }
 
+//! returns true if reading from \a proj_data does not need any I/O
+static bool
+is_in_memory(const ProjData& proj_data)
+{
+  return dynamic_cast<const ProjDataInMemory*>(&proj_data) != nullptr
+         || dynamic_cast<const ProjDataSparse*>(&proj_data) != nullptr;
+}
+
 static void
 get_viewgrams(shared_ptr<RelatedViewgrams<float>>& y,
               shared_ptr<RelatedViewgrams<float>>& additive_binwise_correction_viewgrams,
@@ -172,24 +265,43 @@ get_viewgrams(shared_ptr<RelatedViewgrams<float>>& y,
               const double end_time_of_frame,
               const shared_ptr<DataSymmetriesForViewSegmentNumbers>& symmetries_ptr,
               const ViewSegmentNumbers& view_segment_num,
-              const int timing_pos_num)
+              const int timing_pos_num,
+              RelatedViewgramsReadAhead* const proj_dat_read_ahead_ptr = nullptr,
+              RelatedViewgramsReadAhead* const binwise_correction_read_ahead_ptr = nullptr)
 {
   if (!is_null_ptr(binwise_correction))
     {
+      if (binwise_correction_read_ahead_ptr)
+        {
+          additive_binwise_correction_viewgrams.reset(new RelatedViewgrams<float>(
+              binwise_correction_read_ahead_ptr->get_related_viewgrams(ViewgramIndices(
+                  view_segment_num.view_num(), view_segment_num.segment_num(), timing_pos_num))));
+        }
+      else
+        {
 #ifdef STIR_OPENMP
 #  pragma omp critical(ADDSINO)
 #endif
-      additive_binwise_correction_viewgrams.reset(new RelatedViewgrams<float>(
-          binwise_correction->get_related_viewgrams(view_segment_num, symmetries_ptr, false, timing_pos_num)));
+          additive_binwise_correction_viewgrams.reset(new RelatedViewgrams<float>(
+              binwise_correction->get_related_viewgrams(view_segment_num, symmetries_ptr, false, timing_pos_num)));
+        }
     }
 
   if (read_from_proj_dat)
     {
+      if (proj_dat_read_ahead_ptr)
+        {
+          y.reset(new RelatedViewgrams<float>(proj_dat_read_ahead_ptr->get_related_viewgrams(
+              ViewgramIndices(view_segment_num.view_num(), view_segment_num.segment_num(), timing_pos_num))));
+        }
+      else
+        {
 #ifdef STIR_OPENMP
 #  pragma omp critical(VIEW)
 #endif
-      y.reset(new RelatedViewgrams<float>(
-          proj_dat_ptr->get_related_viewgrams(view_segment_num, symmetries_ptr, false, timing_pos_num)));
+          y.reset(new RelatedViewgrams<float>(
+              proj_dat_ptr->get_related_viewgrams(view_segment_num, symmetries_ptr, false, timing_pos_num)));
+        }
     }
   else
     {
@@ -395,6 +507,24 @@ distributable_computation(const shared_ptr<ForwardProjectorByBin>& forward_proje
   const std::vector<ViewSegmentNumbers> vs_nums_to_process = detail::find_basic_vs_nums_in_subset(
       *proj_dat_ptr->get_proj_data_info_sptr(), *symmetries_ptr, min_segment_num, max_segment_num, subset_num, num_subsets);
 
+  // Projection data that are not in memory are read in a background thread, in the order of the loop below.
+  // Note that the loop uses schedule(dynamic), such that iterations are started in order.
+  shared_ptr<RelatedViewgramsReadAhead> proj_dat_read_ahead_sptr;
+  shared_ptr<RelatedViewgramsReadAhead> binwise_correction_read_ahead_sptr;
+  {
+    std::vector<ViewgramIndices> sequence;
+    for (int timing_pos_num = min_timing_pos_num; timing_pos_num <= max_timing_pos_num; ++timing_pos_num)
+      for (const auto& vs : vs_nums_to_process)
+        sequence.push_back(ViewgramIndices(vs.view_num(), vs.segment_num(), timing_pos_num));
+    const std::size_t max_num_in_memory = 2 * static_cast<std::size_t>(get_max_num_threads());
+    if (read_from_proj_dat && !is_in_memory(*proj_dat_ptr))
+      proj_dat_read_ahead_sptr
+          = std::make_shared<RelatedViewgramsReadAhead>(proj_dat_ptr, symmetries_ptr, sequence, max_num_in_memory);
+    if (!is_null_ptr(binwise_correction) && !is_in_memory(*binwise_correction))
+      binwise_correction_read_ahead_sptr
+          = std::make_shared<RelatedViewgramsReadAhead>(binwise_correction, symmetries_ptr, sequence, max_num_in_memory);
+  }
+
   int count = 0, count2 = 0;
 
 #ifdef STIR_MPI
@@ -412,7 +542,9 @@ distributable_computation(const shared_ptr<ForwardProjectorByBin>& forward_proje
   if (output_image_ptr && back_projector_ptr)
     back_projector_ptr->start_accumulating_in_new_target();
 
-#ifdef STIR_OPENMP
+  // the master/worker loop for projection data does not support threads when using MPI.
+  // (The list-mode functions use MPI and OpenMP, see LM_distributable_computation()).
+#if defined(STIR_OPENMP) && !defined(STIR_MPI)
   std::vector<double> local_log_likelihoods;
   std::vector<int> local_counts, local_count2s;
 #  pragma omp parallel shared(local_log_likelihoods, local_counts, local_count2s)
@@ -420,7 +552,7 @@ distributable_computation(const shared_ptr<ForwardProjectorByBin>& forward_proje
 
   // start of threaded section if openmp
   {
-#ifdef STIR_OPENMP
+#if defined(STIR_OPENMP) && !defined(STIR_MPI)
 #  pragma omp single
     {
       info(boost::format("Starting loop with %1% threads") % omp_get_num_threads(), 2);
@@ -459,7 +591,9 @@ distributable_computation(const shared_ptr<ForwardProjectorByBin>& forward_proje
                           end_time_of_frame,
                           symmetries_ptr,
                           view_segment_num,
-                          timing_pos_num);
+                          timing_pos_num,
+                          proj_dat_read_ahead_sptr.get(),
+                          binwise_correction_read_ahead_sptr.get());
 #ifdef STIR_MPI
 
             // send viewgrams, the slave will immediatelly start calculation
@@ -520,7 +654,7 @@ distributable_computation(const shared_ptr<ForwardProjectorByBin>& forward_proje
       }     // end of for-loop over timing_pos_num
   }         // end of parallel section of openmp
 
-#ifdef STIR_OPENMP
+#if defined(STIR_OPENMP) && !defined(STIR_MPI)
   // "reduce" data constructed by threads
   {
     if (log_likelihood_ptr != NULL)
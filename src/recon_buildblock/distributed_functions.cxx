@@ -31,6 +31,8 @@
 #include "stir/error.h"
 #include "stir/warning.h"
 #include <boost/shared_array.hpp>
+#include <algorithm>
+#include <vector>
 
 using std::ios;
 
@@ -777,7 +779,7 @@ receive_image_values_and_fill_image_ptr(stir::shared_ptr<stir::DiscretisedDensit
 
 void
 receive_and_construct_exam_and_proj_data_info_ptr(stir::shared_ptr<stir::ExamInfo>& exam_info_sptr,
-                                                  stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_sptr,
+                                                  stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_sptr,
                                                   int source)
 {
   int len;
@@ -811,13 +813,13 @@ receive_and_construct_exam_and_proj_data_info_ptr(stir::shared_ptr<stir::ExamInf
       stir::error("Error receiving projection data info. Text does not seem to be in Interfile format");
     }
   projector_info_ptr_stream.seekg(offset);
-  exam_info_sptr = hdr.get_exam_info_sptr();
+  exam_info_sptr.reset(new stir::ExamInfo(hdr.get_exam_info()));
   if (hdr.get_exam_info().imaging_modality.get_modality() == stir::ImagingModality::NM)
     {
       stir::InterfilePDFSHeaderSPECT hdr;
       if (!hdr.parse(projector_info_ptr_stream))
         stir::error("Error receiving projection data info. Text does not seem to be in Interfile format");
-      proj_data_info_sptr = stir::shared_ptr<stir::ProjDataInfo>(hdr.data_info_sptr->clone());
+      proj_data_info_sptr = hdr.data_info_sptr->create_shared_clone();
     }
   else
     {
@@ -825,13 +827,13 @@ receive_and_construct_exam_and_proj_data_info_ptr(stir::shared_ptr<stir::ExamInf
       if (!hdr.parse(projector_info_ptr_stream))
         stir::error("Error receiving projection data info. Text does not seem to be in Interfile format");
 
-      proj_data_info_sptr = stir::shared_ptr<stir::ProjDataInfo>(hdr.data_info_ptr->clone());
+      proj_data_info_sptr = hdr.data_info_sptr->create_shared_clone();
     }
 }
 
 void
 receive_and_construct_related_viewgrams(stir::RelatedViewgrams<float>*& viewgrams,
-                                        const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr,
+                                        const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr,
                                         const stir::shared_ptr<stir::DataSymmetriesForViewSegmentNumbers> symmetries_sptr,
                                         int source)
 {
@@ -861,7 +863,7 @@ receive_and_construct_related_viewgrams(stir::RelatedViewgrams<float>*& viewgram
 
 void
 receive_and_construct_viewgram(stir::Viewgram<float>*& viewgram_ptr,
-                               const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr,
+                               const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr,
                                int source)
 {
 #ifdef STIR_MPI_TIMINGS
@@ -988,4 +990,80 @@ reduce_output_image(stir::shared_ptr<stir::DiscretisedDensity<3, float>>& output
   delete[] output_buf;
 }
 
+// maximum number of list-mode events per message (the count argument of MPI_Send is an int)
+static const std::size_t max_num_listmode_events_per_message = (std::size_t(1) << 30) / sizeof(stir::BinAndCorr);
+
+void
+send_listmode_events(const std::vector<stir::BinAndCorr>& events, int destination)
+{
+  long long num_events = static_cast<long long>(events.size());
+  MPI_Send(&num_events, 1, MPI_LONG_LONG, destination, LISTMODE_EVENTS_TAG, MPI_COMM_WORLD);
+  for (std::size_t start = 0; start < events.size(); start += max_num_listmode_events_per_message)
+    {
+      const std::size_t num_events_in_message = std::min(max_num_listmode_events_per_message, events.size() - start);
+      const int num_bytes = static_cast<int>(num_events_in_message * sizeof(stir::BinAndCorr));
+      MPI_Send(events.data() + start, num_bytes, MPI_BYTE, destination, LISTMODE_EVENTS_TAG, MPI_COMM_WORLD);
+    }
+}
+
+void
+send_end_of_listmode_events(int destination)
+{
+  long long num_events = -1;
+  MPI_Send(&num_events, 1, MPI_LONG_LONG, destination, LISTMODE_EVENTS_TAG, MPI_COMM_WORLD);
+}
+
+bool
+receive_listmode_events(std::vector<stir::BinAndCorr>& events, int source)
+{
+  long long num_events;
+  MPI_Recv(&num_events, 1, MPI_LONG_LONG, source, LISTMODE_EVENTS_TAG, MPI_COMM_WORLD, &status);
+  if (num_events < 0)
+    return false;
+  events.resize(static_cast<std::size_t>(num_events));
+  for (std::size_t start = 0; start < events.size(); start += max_num_listmode_events_per_message)
+    {
+      const std::size_t num_events_in_message = std::min(max_num_listmode_events_per_message, events.size() - start);
+      const int num_bytes = static_cast<int>(num_events_in_message * sizeof(stir::BinAndCorr));
+      MPI_Recv(events.data() + start, num_bytes, MPI_BYTE, source, LISTMODE_EVENTS_TAG, MPI_COMM_WORLD, &status);
+    }
+  return true;
+}
+
+void
+reduce_image_and_value(stir::DiscretisedDensity<3, float>* image_ptr, double* value_ptr, int destination)
+{
+  int my_rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+  if (image_ptr != 0)
+    {
+      const int buffer_size = static_cast<int>(image_ptr->size_all());
+      // reduce directly on the image data if possible, otherwise use a copy
+      std::vector<float> image_buf;
+      float* data_ptr;
+      if (image_ptr->is_contiguous())
+        data_ptr = image_ptr->get_full_data_ptr();
+      else
+        {
+          image_buf.assign(image_ptr->begin_all_const(), image_ptr->end_all_const());
+          data_ptr = image_buf.data();
+        }
+      if (my_rank == destination)
+        MPI_Reduce(MPI_IN_PLACE, data_ptr, buffer_size, MPI_FLOAT, MPI_SUM, destination, MPI_COMM_WORLD);
+      else
+        MPI_Reduce(data_ptr, 0, buffer_size, MPI_FLOAT, MPI_SUM, destination, MPI_COMM_WORLD);
+      if (image_ptr->is_contiguous())
+        image_ptr->release_full_data_ptr();
+      else if (my_rank == destination)
+        std::copy(image_buf.begin(), image_buf.end(), image_ptr->begin_all());
+    }
+  if (value_ptr != 0)
+    {
+      if (my_rank == destination)
+        MPI_Reduce(MPI_IN_PLACE, value_ptr, 1, MPI_DOUBLE, MPI_SUM, destination, MPI_COMM_WORLD);
+      else
+        MPI_Reduce(value_ptr, 0, 1, MPI_DOUBLE, MPI_SUM, destination, MPI_COMM_WORLD);
+    }
+}
+
 } // namespace distributed
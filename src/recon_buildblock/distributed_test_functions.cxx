@@ -26,7 +26,7 @@
 namespace distributed
 {
 void
-test_viewgram_slave(const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr)
+test_viewgram_slave(const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr)
 {
   printf("\n-----Slave startet Test for sending viewgram----------\n");
 
@@ -39,7 +39,7 @@ test_viewgram_slave(const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_p
 }
 
 void
-test_viewgram_master(stir::Viewgram<float> viewgram, const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr)
+test_viewgram_master(stir::Viewgram<float> viewgram, const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr)
 {
   printf("\n-----Running Test for sending viewgram----------\n");
 
@@ -123,7 +123,7 @@ test_image_estimate_slave()
 }
 
 void
-test_related_viewgrams_master(const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr,
+test_related_viewgrams_master(const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr,
                               const stir::shared_ptr<stir::DataSymmetriesForViewSegmentNumbers> symmetries_sptr,
                               stir::RelatedViewgrams<float>* y,
                               int slave)
@@ -166,7 +166,7 @@ test_related_viewgrams_master(const stir::shared_ptr<stir::ProjDataInfo>& proj_d
 }
 
 void
-test_related_viewgrams_slave(const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr,
+test_related_viewgrams_slave(const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr,
                              const stir::shared_ptr<stir::DataSymmetriesForViewSegmentNumbers> symmetries_sptr)
 {
   printf("\n-----Slave startet Test for sending related viewgrams-----\n");
@@ -0,0 +1,88 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+
+  \file
+  \ingroup test
+
+  \brief Test program for the accumulation of the back projection in stir::BackProjectorByBin
+
+  Checks that limiting the number of images used by OpenMP threads (see
+  stir::BackProjectorByBin::set_maximum_number_of_local_images()) gives the same result.
+*/
+
+#include "stir/recon_buildblock/BackProjectorByBinUsingProjMatrixByBin.h"
+#include "stir/recon_buildblock/ProjMatrixByBinUsingRayTracing.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/RunTests.h"
+#include <iostream>
+
+using std::cerr;
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for BackProjectorByBin
+*/
+class BackProjectorByBinTests : public RunTests
+{
+public:
+  void run_tests() override;
+};
+
+void
+BackProjectorByBinTests::run_tests()
+{
+  cerr << "Tests for BackProjectorByBin\n";
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E953));
+  shared_ptr<const ProjDataInfo> proj_data_info_sptr(ProjDataInfo::ProjDataInfoCTI(scanner_sptr,
+                                                                                   /*span=*/3,
+                                                                                   /*max_delta=*/5,
+                                                                                   /*num_views=*/16,
+                                                                                   /*num_tang_poss=*/32));
+  shared_ptr<ExamInfo> exam_info_sptr(new ExamInfo);
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr);
+  proj_data.fill(1.F);
+  shared_ptr<const VoxelsOnCartesianGrid<float>> image_sptr(new VoxelsOnCartesianGrid<float>(*proj_data_info_sptr));
+
+  shared_ptr<ProjMatrixByBin> proj_matrix_sptr(new ProjMatrixByBinUsingRayTracing);
+  BackProjectorByBinUsingProjMatrixByBin back_projector(proj_matrix_sptr);
+  back_projector.set_up(proj_data_info_sptr, image_sptr);
+
+  shared_ptr<VoxelsOnCartesianGrid<float>> reference_sptr(image_sptr->get_empty_copy());
+  back_projector.back_project(*reference_sptr, proj_data);
+  check(reference_sptr->find_max() > 0, "back projection should not be zero");
+
+  for (int max_num_local_images = 1; max_num_local_images <= 3; ++max_num_local_images)
+    {
+      cerr << "\tTesting with maximum number of local images " << max_num_local_images << '\n';
+      back_projector.set_maximum_number_of_local_images(max_num_local_images);
+      back_projector.set_up(proj_data_info_sptr, image_sptr);
+      shared_ptr<VoxelsOnCartesianGrid<float>> image_to_check_sptr(image_sptr->get_empty_copy());
+      back_projector.back_project(*image_to_check_sptr, proj_data);
+      check_if_equal(*image_to_check_sptr, *reference_sptr, "back projection with limited number of local images");
+    }
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  BackProjectorByBinTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
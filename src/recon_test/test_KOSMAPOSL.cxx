@@ -0,0 +1,195 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+    SPDX-License-Identifier: Apache-2.0
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recon_test
+  \ingroup KOSMAPOSL
+  \brief Test program for KOSMAPOSL
+*/
+
+#include "stir/recon_buildblock/test/PoissonLLReconstructionTests.h"
+#include "stir/KOSMAPOSL/KOSMAPOSLReconstruction.h"
+#include "stir/OSMAPOSL/OSMAPOSLReconstruction.h"
+#include <algorithm>
+#include <cmath>
+
+START_NAMESPACE_STIR
+
+typedef DiscretisedDensity<3, float> target_type;
+/*!
+  \ingroup recon_test
+  \ingroup KOSMAPOSL
+  \brief Test class for KOSMAPOSL
+
+  Checks the selection of the nearest neighbours and writing/reading the kernel matrix:
+  - With <tt>number of nearest neighbours</tt> equal to 1, only the voxel itself is kept (as it has
+    the largest kernel value), such that the kernel is the identity and KOSMAPOSL is equivalent to
+    OSMAPOSL.
+  - Reading the kernel matrix written by a previous reconstruction gives the same result.
+*/
+class TestKOSMAPOSL : public PoissonLLReconstructionTests<target_type>
+{
+private:
+  typedef PoissonLLReconstructionTests<target_type> base_type;
+
+public:
+  //! Constructor that can take some input data to run the test with
+  TestKOSMAPOSL(const std::string& projector_pair_filename = "",
+                const std::string& proj_data_filename = "",
+                const std::string& density_filename = "")
+      : base_type(projector_pair_filename, proj_data_filename, density_filename)
+  {}
+  ~TestKOSMAPOSL() override {}
+
+  //! use smaller data than the default, as we do several reconstructions
+  std::unique_ptr<ProjDataInfo> construct_default_proj_data_info_uptr() const override;
+
+  //! constructs a KOSMAPOSL reconstruction with a 3x3x3 neighbourhood, using the input image as anatomical image
+  void construct_reconstructor() override;
+  KOSMAPOSLReconstruction<target_type>& recon()
+  {
+    return dynamic_cast<KOSMAPOSLReconstruction<target_type>&>(*this->_recon_sptr);
+  }
+
+  void run_tests() override;
+
+private:
+  static const int num_subiterations = 3;
+  //! reconstruct, starting from a uniform image
+  shared_ptr<target_type> reconstruct_from_uniform_image();
+  //! check that the maximum absolute difference is small compared to the maximum of \a reference
+  void compare_images(const target_type& image, const target_type& reference, const std::string& str);
+};
+
+std::unique_ptr<ProjDataInfo>
+TestKOSMAPOSL::construct_default_proj_data_info_uptr() const
+{
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E953));
+  scanner_sptr->set_num_rings(5);
+  std::unique_ptr<ProjDataInfo> proj_data_info_uptr(ProjDataInfo::ProjDataInfoCTI(scanner_sptr,
+                                                                                  /*span=*/3,
+                                                                                  /*max_delta=*/4,
+                                                                                  /*num_views=*/32,
+                                                                                  /*num_tang_poss=*/64));
+  return proj_data_info_uptr;
+}
+
+void
+TestKOSMAPOSL::construct_reconstructor()
+{
+  this->construct_log_likelihood();
+  this->_recon_sptr.reset(new KOSMAPOSLReconstruction<target_type>);
+  this->recon().set_objective_function_sptr(this->_objective_function_sptr);
+  this->recon().set_num_subiterations(num_subiterations);
+  this->recon().set_anatomical_prior_sptr(shared_ptr<target_type>(this->_input_density_sptr->clone()));
+  this->recon().set_sigma_m(1.);
+  this->recon().set_num_neighbours(3);
+}
+
+shared_ptr<target_type>
+TestKOSMAPOSL::reconstruct_from_uniform_image()
+{
+  shared_ptr<target_type> output_sptr(this->_input_density_sptr->get_empty_copy());
+  output_sptr->fill(1.F);
+  this->reconstruct(output_sptr);
+  return output_sptr;
+}
+
+void
+TestKOSMAPOSL::compare_images(const target_type& image, const target_type& reference, const std::string& str)
+{
+  if (!check(image.has_same_characteristics(reference), str + ": images have different characteristics"))
+    return;
+  float max_abs_diff = 0.F;
+  for (target_type::const_full_iterator iter = image.begin_all_const(), ref_iter = reference.begin_all_const();
+       iter != image.end_all_const();
+       ++iter, ++ref_iter)
+    max_abs_diff = std::max(max_abs_diff, std::abs(*iter - *ref_iter));
+  check_if_less(max_abs_diff / reference.find_max(), 1.E-4F, str);
+}
+
+void
+TestKOSMAPOSL::run_tests()
+{
+  std::cerr << "Tests for KOSMAPOSL\n";
+
+  try
+    {
+      this->construct_input_data();
+
+      std::cerr << "\n--- OSMAPOSL (reference)\n";
+      this->construct_log_likelihood();
+      {
+        shared_ptr<OSMAPOSLReconstruction<target_type>> osmaposl_sptr(new OSMAPOSLReconstruction<target_type>);
+        osmaposl_sptr->set_objective_function_sptr(this->_objective_function_sptr);
+        osmaposl_sptr->set_num_subiterations(num_subiterations);
+        this->_recon_sptr = osmaposl_sptr;
+      }
+      const shared_ptr<const target_type> osmaposl_output_sptr = this->reconstruct_from_uniform_image();
+
+      std::cerr << "\n--- KOSMAPOSL keeping only 1 nearest neighbour\n";
+      this->construct_reconstructor();
+      this->recon().set_num_nearest_neighbours(1);
+      const shared_ptr<const target_type> knn1_output_sptr = this->reconstruct_from_uniform_image();
+      compare_images(*knn1_output_sptr, *osmaposl_output_sptr, "KOSMAPOSL with 1 nearest neighbour should be equal to OSMAPOSL");
+
+      const std::string kernel_matrix_filename = "test_KOSMAPOSL_kernel_matrix.bin";
+      std::cerr << "\n--- KOSMAPOSL keeping 8 nearest neighbours, writing the kernel matrix\n";
+      this->construct_reconstructor();
+      this->recon().set_num_nearest_neighbours(8);
+      this->recon().set_kernel_matrix_output_filename(kernel_matrix_filename);
+      const shared_ptr<const target_type> knn8_output_sptr = this->reconstruct_from_uniform_image();
+      // check that the kernel does something, otherwise the test below would be meaningless
+      {
+        shared_ptr<target_type> diff_sptr(knn8_output_sptr->clone());
+        *diff_sptr -= *osmaposl_output_sptr;
+        check(std::max(diff_sptr->find_max(), -diff_sptr->find_min()) > 1.E-3F * osmaposl_output_sptr->find_max(),
+              "KOSMAPOSL with 8 nearest neighbours should be different from OSMAPOSL");
+      }
+
+      std::cerr << "\n--- KOSMAPOSL keeping 8 nearest neighbours, reading the kernel matrix\n";
+      this->construct_reconstructor();
+      this->recon().set_num_nearest_neighbours(8);
+      this->recon().set_kernel_matrix_input_filename(kernel_matrix_filename);
+      const shared_ptr<const target_type> knn8_from_file_output_sptr = this->reconstruct_from_uniform_image();
+      compare_images(*knn8_from_file_output_sptr, *knn8_output_sptr, "KOSMAPOSL with kernel matrix read from file");
+    }
+  catch (const std::exception& error)
+    {
+      std::cerr << "\nHere's the error:\n\t" << error.what() << "\n\n";
+      everything_ok = false;
+    }
+  catch (...)
+    {
+      everything_ok = false;
+    }
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main(int argc, char** argv)
+{
+  if (argc < 1 || argc > 4)
+    {
+      std::cerr << "\nUsage: " << argv[0] << " [projector_pair_filename [template_proj_data [image]]]\n"
+                << "projector_pair_filename (optional) can be used to specify the projectors\n"
+                << "  if set to an empty string, the default ray-tracing matrix will be used.\n"
+                << "template_proj_data (optional) will serve as a template, but is otherwise not used.\n"
+                << "image (optional) has to be compatible with projection data and currently at zoom=1\n";
+      return EXIT_FAILURE;
+    }
+
+  TestKOSMAPOSL test(argc > 1 ? argv[1] : "", argc > 2 ? argv[2] : "", argc > 3 ? argv[3] : "");
+
+  if (test.is_everything_ok())
+    test.run_tests();
+
+  return test.main_return_value();
+}
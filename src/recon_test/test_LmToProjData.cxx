@@ -0,0 +1,244 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+
+  \file
+  \ingroup recon_test
+
+  \brief Test program for stir::LmToProjData
+
+  \par Usage
+
+  <pre>
+  test_LmToProjData lm_data_filename
+  </pre>
+
+  Histograms the list-mode data with different settings and checks that the
+  results are consistent. Files are written in the current directory.
+*/
+
+#include "stir/listmode/LmToProjData.h"
+#include "stir/listmode/ListModeData.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/SegmentBySinogram.h"
+#include "stir/Scanner.h"
+#include "stir/IO/read_from_file.h"
+#include "stir/RunTests.h"
+#include "stir/num_threads.h"
+#include "stir/FilePath.h"
+#include "stir/error.h"
+#include <iostream>
+#include <string>
+
+START_NAMESPACE_STIR
+
+//! LmToProjData that decodes the events one by one, in the order of the list-mode data
+class LmToProjDataWithSerialDecoding : public LmToProjData
+{
+protected:
+  bool can_decode_events_in_parallel() const override { return false; }
+};
+
+//! LmToProjData that ignores all events
+class LmToProjDataIgnoringAllEvents : public LmToProjData
+{
+protected:
+  void get_bin_from_event(Bin& bin, const ListEvent&) const override { bin.set_bin_value(-1.F); }
+  bool get_bin_from_event_is_default() const override { return false; }
+};
+
+/*!
+  \ingroup test
+  \brief Test class for LmToProjData
+
+  Checks that decoding the events in parallel gives the same projection data as decoding them
+  one by one, also when not all segments are kept in memory (such that the events of the other
+  segments are stored in temporary files).
+
+  Also checks that with <tt>store separate prompts and delayeds</tt>, the usual output is equal to
+  the prompts minus the delayeds.
+
+  Finally checks that an overridden LmToProjData::get_bin_from_event() is used.
+*/
+class LmToProjDataTests : public RunTests
+{
+public:
+  explicit LmToProjDataTests(const std::string& lm_data_filename)
+      : lm_data_filename(lm_data_filename)
+  {}
+
+  void run_tests() override;
+
+private:
+  std::string lm_data_filename;
+  shared_ptr<const ExamInfo> exam_info_sptr;
+  shared_ptr<const ProjDataInfo> template_proj_data_info_sptr;
+
+  //! histogram the list-mode data into projection data in memory
+  shared_ptr<ProjData> histogram(LmToProjData& lm_to_projdata, const int num_segments_in_memory);
+  //! compare all bins
+  void check_if_equal_proj_data(const ProjData& proj_data, const ProjData& reference, const std::string& str);
+  //! check the output of LmToProjData::set_store_separate_prompts_and_delayeds()
+  void run_tests_for_separate_prompts_and_delayeds();
+};
+
+shared_ptr<ProjData>
+LmToProjDataTests::histogram(LmToProjData& lm_to_projdata, const int num_segments_in_memory)
+{
+  lm_to_projdata.set_input_data(this->lm_data_filename);
+  lm_to_projdata.set_template_proj_data_info_sptr(this->template_proj_data_info_sptr);
+  // needs to be set, but is not used as we write to proj_data_sptr
+  lm_to_projdata.set_output_filename_prefix("test_LmToProjData_output");
+  lm_to_projdata.set_num_segments_in_memory(num_segments_in_memory);
+  shared_ptr<ProjData> proj_data_sptr(new ProjDataInMemory(this->exam_info_sptr, this->template_proj_data_info_sptr));
+  lm_to_projdata.set_output_projdata_sptr(proj_data_sptr);
+  if (lm_to_projdata.set_up() != Succeeded::yes)
+    error("test_LmToProjData: set-up failed");
+  lm_to_projdata.process_data();
+  return proj_data_sptr;
+}
+
+void
+LmToProjDataTests::check_if_equal_proj_data(const ProjData& proj_data, const ProjData& reference, const std::string& str)
+{
+  for (int timing_pos_num = reference.get_min_tof_pos_num(); timing_pos_num <= reference.get_max_tof_pos_num(); ++timing_pos_num)
+    for (int segment_num = reference.get_min_segment_num(); segment_num <= reference.get_max_segment_num(); ++segment_num)
+      {
+        if (!check_if_equal(proj_data.get_segment_by_sinogram(segment_num, timing_pos_num),
+                            reference.get_segment_by_sinogram(segment_num, timing_pos_num),
+                            str + ", segment " + std::to_string(segment_num)))
+          return;
+      }
+}
+
+void
+LmToProjDataTests::run_tests_for_separate_prompts_and_delayeds()
+{
+  std::cerr << "----- histogramming with separate prompts and delayeds\n";
+  const std::string prefix = "test_LmToProjData_separate";
+  LmToProjData lm_to_projdata;
+  lm_to_projdata.set_input_data(this->lm_data_filename);
+  lm_to_projdata.set_template_proj_data_info_sptr(this->template_proj_data_info_sptr);
+  lm_to_projdata.set_output_filename_prefix(prefix);
+  lm_to_projdata.set_store_separate_prompts_and_delayeds(true);
+  // keep only 1 segment in memory to check that the extra outputs work with temporary files as well
+  lm_to_projdata.set_num_segments_in_memory(1);
+  if (lm_to_projdata.set_up() != Succeeded::yes)
+    error("test_LmToProjData: set-up failed");
+  lm_to_projdata.process_data();
+
+  const shared_ptr<ProjData> proj_data_sptr = ProjData::read_from_file(prefix + "_f1g1d0b0.hs");
+  const shared_ptr<ProjData> prompts_sptr = ProjData::read_from_file(prefix + "_prompts_f1g1d0b0.hs");
+  const shared_ptr<ProjData> delayeds_sptr = ProjData::read_from_file(prefix + "_delayeds_f1g1d0b0.hs");
+  // delayeds are only subtracted if the list-mode data have them
+  const bool subtract_delayeds = lm_to_projdata.get_store_delayeds();
+  for (int segment_num = proj_data_sptr->get_min_segment_num(); segment_num <= proj_data_sptr->get_max_segment_num();
+       ++segment_num)
+    {
+      SegmentBySinogram<float> prompts_minus_delayeds = prompts_sptr->get_segment_by_sinogram(segment_num);
+      if (subtract_delayeds)
+        prompts_minus_delayeds -= delayeds_sptr->get_segment_by_sinogram(segment_num);
+      if (!check_if_equal(proj_data_sptr->get_segment_by_sinogram(segment_num),
+                          prompts_minus_delayeds,
+                          "output should be prompts minus delayeds, segment " + std::to_string(segment_num)))
+        break;
+    }
+  check(prompts_sptr->get_segment_by_sinogram(0).find_max() > 0, "there should be prompts in segment 0");
+
+  // extra outputs are not created when using set_output_projdata_sptr()
+  {
+    const std::string prefix_no_files = "test_LmToProjData_separate_in_memory";
+    LmToProjData lm_to_projdata_in_memory;
+    lm_to_projdata_in_memory.set_store_separate_prompts_and_delayeds(true);
+    lm_to_projdata_in_memory.set_input_data(this->lm_data_filename);
+    lm_to_projdata_in_memory.set_template_proj_data_info_sptr(this->template_proj_data_info_sptr);
+    lm_to_projdata_in_memory.set_output_filename_prefix(prefix_no_files);
+    shared_ptr<ProjData> output_sptr(new ProjDataInMemory(this->exam_info_sptr, this->template_proj_data_info_sptr));
+    lm_to_projdata_in_memory.set_output_projdata_sptr(output_sptr);
+    if (lm_to_projdata_in_memory.set_up() != Succeeded::yes)
+      error("test_LmToProjData: set-up failed");
+    lm_to_projdata_in_memory.process_data();
+    check(!FilePath::exists(prefix_no_files + "_prompts_f1g1d0b0.hs"),
+          "prompts should not be written when using set_output_projdata_sptr()");
+    check_if_equal_proj_data(*output_sptr, *proj_data_sptr, "output in memory with separate prompts and delayeds");
+  }
+}
+
+void
+LmToProjDataTests::run_tests()
+{
+  std::cerr << "Tests for LmToProjData\n";
+  shared_ptr<ListModeData> lm_data_sptr(read_from_file<ListModeData>(this->lm_data_filename));
+  this->exam_info_sptr = lm_data_sptr->get_exam_info_sptr();
+  // use a template with only a few segments and mashed views, such that the projection data are not too large
+  {
+    shared_ptr<Scanner> scanner_sptr(new Scanner(lm_data_sptr->get_scanner()));
+    this->template_proj_data_info_sptr = ProjDataInfo::construct_proj_data_info(scanner_sptr,
+                                                                                /* span */ 11,
+                                                                                /* max_delta */ 16,
+                                                                                scanner_sptr->get_num_detectors_per_ring() / 4,
+                                                                                scanner_sptr->get_max_num_non_arccorrected_bins(),
+                                                                                /* arc_corrected */ false);
+  }
+
+  std::cerr << "----- histogramming with parallel decoding\n";
+  LmToProjData lm_to_projdata;
+  const shared_ptr<ProjData> reference_sptr = histogram(lm_to_projdata, -1);
+  {
+    const SegmentBySinogram<float> segment = reference_sptr->get_segment_by_sinogram(0);
+    if (!check(segment.find_max() > 0, "there should be events in segment 0"))
+      return;
+  }
+
+  std::cerr << "----- histogramming with serial decoding\n";
+  {
+    LmToProjDataWithSerialDecoding lm_to_projdata_serial;
+    check_if_equal_proj_data(*histogram(lm_to_projdata_serial, -1), *reference_sptr, "serial decoding");
+  }
+  std::cerr << "----- histogramming with parallel decoding and 1 segment in memory\n";
+  {
+    LmToProjData lm_to_projdata_1_segment;
+    check_if_equal_proj_data(
+        *histogram(lm_to_projdata_1_segment, 1), *reference_sptr, "parallel decoding, 1 segment in memory");
+  }
+  std::cerr << "----- histogramming with serial decoding and 1 segment in memory\n";
+  {
+    LmToProjDataWithSerialDecoding lm_to_projdata_1_segment;
+    check_if_equal_proj_data(*histogram(lm_to_projdata_1_segment, 1), *reference_sptr, "serial decoding, 1 segment in memory");
+  }
+
+  run_tests_for_separate_prompts_and_delayeds();
+
+  std::cerr << "----- histogramming with overridden get_bin_from_event\n";
+  {
+    LmToProjDataIgnoringAllEvents lm_to_projdata_ignoring_events;
+    const shared_ptr<ProjData> proj_data_sptr = histogram(lm_to_projdata_ignoring_events, -1);
+    check_if_zero(proj_data_sptr->get_segment_by_sinogram(0), "all events should be ignored by get_bin_from_event");
+  }
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main(int argc, char** argv)
+{
+  if (argc != 2)
+    {
+      std::cerr << "Usage: " << argv[0] << " lm_data_filename\n";
+      return EXIT_FAILURE;
+    }
+  set_default_num_threads();
+
+  LmToProjDataTests tests(argv[1]);
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -21,6 +21,16 @@
   </pre>
   where the last arguments are optional. See the class documentation for more info.
 
+  When using MPI, the program can also be used to check that the results do not depend on the number of processes:
+  <pre>
+  mpirun -np 2 test_PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin lm_data_filename \
+     --write-reference prefix
+  mpirun -np 4 test_PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin lm_data_filename \
+     --check-reference prefix
+  </pre>
+  The first run writes the objective function values, gradients and sensitivities for every subset to files
+  starting with \c prefix, the second one compares its own results with those.
+
   \author Kris Thielemans
   \author Robert Twyman Skelly
 */
@@ -45,12 +55,18 @@
 #include "stir/info.h"
 #include "stir/Succeeded.h"
 #include "stir/num_threads.h"
+#include "stir/FilePath.h"
 #include <boost/random/uniform_01.hpp>
 #include <boost/random/normal_distribution.hpp>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/variate_generator.hpp>
 #include <iostream>
+#include <fstream>
+#include <cstdint>
+#include <string>
 #include <memory>
+#include <vector>
+#include <cstdio>
 
 START_NAMESPACE_STIR
 
@@ -92,6 +108,8 @@ public:
   */
   PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests(char const* const lm_data_filename,
                                                                                     char const* const density_filename = 0);
+  //! Only write (or check) reference results, see run_tests_for_reference()
+  void set_reference(const std::string& prefix, const bool write);
   void construct_input_data(shared_ptr<target_type>& density_sptr);
 
   void run_tests() override;
@@ -103,18 +121,36 @@ protected:
   shared_ptr<ProjData> mult_proj_data_sptr;
   shared_ptr<ProjData> add_proj_data_sptr;
   shared_ptr<PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<target_type>> objective_function_sptr;
+  std::string reference_prefix;
+  bool write_reference;
 
   //! run the test
   void run_tests_for_objective_function(objective_function_type& objective_function, target_type& target);
+  //! check that using the cache files gives the same results as reading the list-mode data
+  void run_tests_for_cache(const shared_ptr<target_type>& target_sptr);
+  //! check that sorting the batches gives the same results
+  void run_tests_for_sorted_batches(const target_type& target);
+  //! write or compare values, gradients and sensitivities for every subset
+  /*! This is used to check that the MPI version gives the same results for different numbers of processes. */
+  void run_tests_for_reference(const target_type& target);
 };
 
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests::
     PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests(char const* lm_data_filename,
                                                                                       char const* const density_filename)
     : lm_data_filename(lm_data_filename),
-      density_filename(density_filename)
+      density_filename(density_filename),
+      write_reference(false)
 {}
 
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests::set_reference(const std::string& prefix,
+                                                                                                 const bool write)
+{
+  this->reference_prefix = prefix;
+  this->write_reference = write;
+}
+
 void
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests::run_tests_for_objective_function(
     objective_function_type& objective_function, target_type& target)
@@ -129,6 +165,146 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTest
   test_Hessian("PoissonLLListModeData", objective_function, target, 0.5F);
 }
 
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests::run_tests_for_cache(
+    const shared_ptr<target_type>& target_sptr)
+{
+  std::cerr << "----- testing list-mode cache files\n";
+  auto& objective_function = *this->objective_function_sptr;
+  const int num_subsets = objective_function.get_num_subsets();
+  std::vector<double> values(num_subsets);
+  std::vector<shared_ptr<target_type>> gradient_sptrs(num_subsets);
+  for (int subset_num = 0; subset_num < num_subsets; ++subset_num)
+    {
+      values[subset_num] = objective_function.compute_objective_function_without_penalty(*target_sptr, subset_num);
+      gradient_sptrs[subset_num].reset(target_sptr->get_empty_copy());
+      objective_function.compute_sub_gradient_without_penalty(*gradient_sptrs[subset_num], *target_sptr, subset_num);
+    }
+
+  // use a small cache such that we get several files
+  objective_function.set_cache_max_size(3000);
+  objective_function.set_recompute_cache(true);
+  if (!check(objective_function.set_up(target_sptr) == Succeeded::yes, "set-up of objective function with cache"))
+    return;
+  shared_ptr<target_type> gradient_sptr(target_sptr->get_empty_copy());
+  for (int subset_num = 0; subset_num < num_subsets; ++subset_num)
+    {
+      check_if_equal(objective_function.compute_objective_function_without_penalty(*target_sptr, subset_num),
+                     values[subset_num],
+                     "objective function value with cache");
+      objective_function.compute_sub_gradient_without_penalty(*gradient_sptr, *target_sptr, subset_num);
+      check_if_equal(*gradient_sptr, *gradient_sptrs[subset_num], "gradient with cache");
+    }
+
+  // use the existing cache files (this reads only the events of every subset)
+  objective_function.set_recompute_cache(false);
+  if (!check(objective_function.set_up(target_sptr) == Succeeded::yes, "set-up of objective function with existing cache"))
+    return;
+  for (int subset_num = 0; subset_num < num_subsets; ++subset_num)
+    {
+      check_if_equal(objective_function.compute_objective_function_without_penalty(*target_sptr, subset_num),
+                     values[subset_num],
+                     "objective function value with existing cache");
+      objective_function.compute_sub_gradient_without_penalty(*gradient_sptr, *target_sptr, subset_num);
+      check_if_equal(*gradient_sptr, *gradient_sptrs[subset_num], "gradient with existing cache");
+    }
+
+  // corrupt the subset offsets in the first cache file, such that the cache needs to be recomputed
+  {
+    const std::string filename = objective_function.get_cache_filename(0);
+    std::fstream file(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    // the subset offsets follow the header (of 80 bytes). Make the 2nd one larger than the number of events.
+    const std::uint64_t corrupt_offset = ~std::uint64_t(0);
+    file.seekp(80 + sizeof(std::uint64_t));
+    file.write(reinterpret_cast<const char*>(&corrupt_offset), sizeof(corrupt_offset));
+    check(!file.fail(), "corrupting cache file");
+  }
+  if (!check(objective_function.set_up(target_sptr) == Succeeded::yes, "set-up of objective function with corrupt cache"))
+    return;
+  for (int subset_num = 0; subset_num < num_subsets; ++subset_num)
+    {
+      objective_function.compute_sub_gradient_without_penalty(*gradient_sptr, *target_sptr, subset_num);
+      check_if_equal(*gradient_sptr, *gradient_sptrs[subset_num], "gradient after recomputing corrupt cache");
+    }
+
+  // clean up
+  for (unsigned int file_id = 0; FilePath::exists(objective_function.get_cache_filename(file_id)); ++file_id)
+    std::remove(objective_function.get_cache_filename(file_id).c_str());
+  objective_function.set_cache_max_size(0);
+  objective_function.set_recompute_cache(true);
+  objective_function.set_up(target_sptr);
+}
+
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests::run_tests_for_sorted_batches(
+    const target_type& target)
+{
+  std::cerr << "----- testing sorting of batches\n";
+  auto& objective_function = *this->objective_function_sptr;
+  const double value = objective_function.compute_objective_function_without_penalty(target, 0);
+  shared_ptr<target_type> gradient_sptr(target.get_empty_copy());
+  objective_function.compute_sub_gradient_without_penalty(*gradient_sptr, target, 0);
+
+  objective_function.set_sort_batches(true);
+  check_if_equal(objective_function.compute_objective_function_without_penalty(target, 0),
+                 value,
+                 "objective function value with sorted batches");
+  shared_ptr<target_type> sorted_gradient_sptr(target.get_empty_copy());
+  objective_function.compute_sub_gradient_without_penalty(*sorted_gradient_sptr, target, 0);
+  check_if_equal(*sorted_gradient_sptr, *gradient_sptr, "gradient with sorted batches");
+  objective_function.set_sort_batches(false);
+}
+
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests::run_tests_for_reference(const target_type& target)
+{
+  std::cerr << "----- " << (this->write_reference ? "writing" : "checking") << " reference results in " << this->reference_prefix
+            << "\n";
+  auto& objective_function = *this->objective_function_sptr;
+  const int num_subsets = objective_function.get_num_subsets();
+  const std::string values_filename = this->reference_prefix + "_values.txt";
+  std::vector<double> reference_values(num_subsets);
+  if (!this->write_reference)
+    {
+      std::ifstream values_file(values_filename.c_str());
+      for (int subset_num = 0; subset_num < num_subsets; ++subset_num)
+        values_file >> reference_values[subset_num];
+      if (!check(!values_file.fail(), "reading reference values from " + values_filename))
+        return;
+    }
+
+  // results are accumulated in a different order, so we need a somewhat larger tolerance
+  const double old_tolerance = this->get_tolerance();
+  this->set_tolerance(1E-3);
+  std::ofstream values_file;
+  if (this->write_reference)
+    values_file.open(values_filename.c_str());
+  values_file.precision(17);
+  shared_ptr<target_type> gradient_sptr(target.get_empty_copy());
+  for (int subset_num = 0; subset_num < num_subsets; ++subset_num)
+    {
+      const double value = objective_function.compute_objective_function_without_penalty(target, subset_num);
+      objective_function.compute_sub_gradient_without_penalty(*gradient_sptr, target, subset_num);
+      const std::string gradient_filename = this->reference_prefix + "_gradient_" + std::to_string(subset_num) + ".hv";
+      const std::string sensitivity_filename = this->reference_prefix + "_sensitivity_" + std::to_string(subset_num) + ".hv";
+      if (this->write_reference)
+        {
+          values_file << value << '\n';
+          write_to_file(gradient_filename, *gradient_sptr);
+          write_to_file(sensitivity_filename, objective_function.get_subset_sensitivity(subset_num));
+        }
+      else
+        {
+          check_if_equal(value, reference_values[subset_num], "objective function value compared to reference");
+          check_if_equal(*gradient_sptr, *read_from_file<target_type>(gradient_filename), "gradient compared to reference");
+          check_if_equal(objective_function.get_subset_sensitivity(subset_num),
+                         *read_from_file<target_type>(sensitivity_filename),
+                         "sensitivity compared to reference");
+        }
+    }
+  this->set_tolerance(old_tolerance);
+}
+
 void
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests::construct_input_data(
     shared_ptr<target_type>& density_sptr)
@@ -251,6 +427,14 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTest
 #if 1
   shared_ptr<target_type> density_sptr;
   construct_input_data(density_sptr);
+  if (!this->reference_prefix.empty())
+    {
+      this->run_tests_for_reference(*density_sptr);
+      Verbosity::set(verbosity_default);
+      return;
+    }
+  this->run_tests_for_cache(density_sptr);
+  this->run_tests_for_sorted_batches(*density_sptr);
   this->run_tests_for_objective_function(*this->objective_function_sptr, *density_sptr);
 #else
   // alternative that gets the objective function from an OSMAPOSL .par file
@@ -268,15 +452,25 @@ END_NAMESPACE_STIR
 
 USING_NAMESPACE_STIR
 
+#ifdef STIR_MPI
+int
+stir::distributable_main(int argc, char** argv)
+#else
 int
 main(int argc, char** argv)
+#endif
 {
   if (argc <= 1)
     error("Need to specify a list-mode filename");
 
   set_default_num_threads();
 
-  PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests tests(argv[1], argc > 2 ? argv[2] : 0);
+  const bool reference_mode
+      = argc == 4 && (std::string(argv[2]) == "--write-reference" || std::string(argv[2]) == "--check-reference");
+  PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests tests(
+      argv[1], (argc > 2 && !reference_mode) ? argv[2] : 0);
+  if (reference_mode)
+    tests.set_reference(argv[3], std::string(argv[2]) == "--write-reference");
   tests.run_tests();
   return tests.main_return_value();
 }
@@ -0,0 +1,240 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+
+  \file
+  \ingroup test
+
+  \brief Test program for writing and reading stir::ProjMatrixByBinFromFile
+
+  Writes a stir::ProjMatrixByBinUsingRayTracing to file in both formats, reads it back and
+  compares all rows. It also checks that corrupt version 2.0 files are detected.
+  Files are written in the current directory.
+*/
+
+#include "stir/recon_buildblock/ProjMatrixByBinFromFile.h"
+#include "stir/recon_buildblock/ProjMatrixByBinUsingRayTracing.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/Scanner.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/IO/read_from_file.h"
+#include "stir/RunTests.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+using std::cerr;
+using std::stringstream;
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for ProjMatrixByBinFromFile
+*/
+class ProjMatrixByBinFromFileTests : public RunTests
+{
+public:
+  void run_tests() override;
+
+private:
+  void run_tests_for_1_format(const ProjMatrixByBin& proj_matrix,
+                              const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+                              const shared_ptr<const DiscretisedDensity<3, float>>& density_sptr,
+                              const std::string& format_version,
+                              const bool disable_caching);
+  //! corrupt the file written by run_tests_for_1_format() for version 2.0 and check that this is detected
+  void run_tests_for_corrupt_file(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+                                  const shared_ptr<const DiscretisedDensity<3, float>>& density_sptr);
+};
+
+void
+ProjMatrixByBinFromFileTests::run_tests_for_1_format(const ProjMatrixByBin& proj_matrix,
+                                                     const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+                                                     const shared_ptr<const DiscretisedDensity<3, float>>& density_sptr,
+                                                     const std::string& format_version,
+                                                     const bool disable_caching)
+{
+  cerr << "\tTesting version " << format_version << (disable_caching ? " without caching\n" : "\n");
+  // avoid a '.' in the prefix, as write_to_file() would see it as an extension
+  std::string prefix = "test_ProjMatrixByBinFromFile_" + format_version;
+  std::replace(prefix.begin(), prefix.end(), '.', '_');
+  if (!check(ProjMatrixByBinFromFile::write_to_file(prefix, proj_matrix, proj_data_info_sptr, *density_sptr, format_version)
+                 == Succeeded::yes,
+             "writing matrix"))
+    return;
+
+  ProjMatrixByBinFromFile proj_matrix_from_file;
+  if (!check(proj_matrix_from_file.parse((prefix + ".hpm").c_str()), "parsing header"))
+    return;
+  proj_matrix_from_file.enable_cache(!disable_caching);
+  // use the template density as written, as set_up() checks that the voxel sizes are identical
+  shared_ptr<const DiscretisedDensity<3, float>> density_from_file_sptr(
+      read_from_file<DiscretisedDensity<3, float>>(prefix + "_template_density.hv"));
+  proj_matrix_from_file.set_up(proj_data_info_sptr, density_from_file_sptr);
+
+  ProjMatrixElemsForOneBin row, row_from_file;
+  for (int segment_num = proj_data_info_sptr->get_min_segment_num(); segment_num <= proj_data_info_sptr->get_max_segment_num();
+       ++segment_num)
+    for (int view_num = proj_data_info_sptr->get_min_view_num(); view_num <= proj_data_info_sptr->get_max_view_num(); ++view_num)
+      for (int axial_pos_num = proj_data_info_sptr->get_min_axial_pos_num(segment_num);
+           axial_pos_num <= proj_data_info_sptr->get_max_axial_pos_num(segment_num);
+           ++axial_pos_num)
+        for (int tang_pos_num = proj_data_info_sptr->get_min_tangential_pos_num();
+             tang_pos_num <= proj_data_info_sptr->get_max_tangential_pos_num();
+             ++tang_pos_num)
+          {
+            const Bin bin(segment_num, view_num, axial_pos_num, tang_pos_num);
+            proj_matrix.get_proj_matrix_elems_for_one_bin(row, bin);
+            proj_matrix_from_file.get_proj_matrix_elems_for_one_bin(row_from_file, bin);
+            if (!check(row.size() == row_from_file.size() && row == row_from_file, "comparing rows"))
+              {
+                cerr << "Problem at bin " << segment_num << ',' << view_num << ',' << axial_pos_num << ',' << tang_pos_num
+                     << '\n';
+                return;
+              }
+          }
+}
+
+void
+ProjMatrixByBinFromFileTests::run_tests_for_corrupt_file(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+                                                         const shared_ptr<const DiscretisedDensity<3, float>>& density_sptr)
+{
+  cerr << "\tTesting corrupt version 2.0 files\n";
+  const std::string prefix = "test_ProjMatrixByBinFromFile_2_0";
+  const std::string data_filename = prefix + ".pm";
+  std::string data;
+  {
+    std::ifstream file(data_filename.c_str(), std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  // the header (ending with the offset of the index) is followed by the LOR data, the index is at the end
+  const std::size_t header_size = 56;
+  if (!check(data.size() > 2 * header_size, "size of version 2.0 file"))
+    return;
+
+  auto set_up_and_get_rows = [&](const std::string& corrupt_data) {
+    {
+      std::ofstream file(data_filename.c_str(), std::ios::binary | std::ios::trunc);
+      file.write(corrupt_data.data(), corrupt_data.size());
+    }
+    ProjMatrixByBinFromFile proj_matrix_from_file;
+    if (!proj_matrix_from_file.parse((prefix + ".hpm").c_str()))
+      return;
+    proj_matrix_from_file.enable_cache(false);
+    proj_matrix_from_file.set_up(proj_data_info_sptr, read_from_file<DiscretisedDensity<3, float>>(prefix + "_template_density.hv"));
+    ProjMatrixElemsForOneBin row;
+    for (int view_num = proj_data_info_sptr->get_min_view_num(); view_num <= proj_data_info_sptr->get_max_view_num(); ++view_num)
+      proj_matrix_from_file.get_proj_matrix_elems_for_one_bin(row, Bin(0, view_num, 0, 0));
+  };
+
+  {
+    // truncate, such that the index is incomplete
+    bool detected = false;
+    try
+      {
+        set_up_and_get_rows(data.substr(0, data.size() - 8));
+      }
+    catch (...)
+      {
+        detected = true;
+      }
+    check(detected, "truncated file should be detected");
+  }
+  {
+    // overwrite all LOR data (up to the index) with continuation bytes, such that varints never end
+    std::string corrupt_data = data;
+    std::uint64_t index_offset;
+    std::memcpy(&index_offset, data.data() + header_size - sizeof(index_offset), sizeof(index_offset));
+    if (!check(index_offset > header_size && index_offset < data.size(), "index offset of version 2.0 file"))
+      return;
+    std::fill(corrupt_data.begin() + header_size, corrupt_data.begin() + index_offset, static_cast<char>(0xFF));
+    bool detected = false;
+    try
+      {
+        set_up_and_get_rows(corrupt_data);
+      }
+    catch (...)
+      {
+        detected = true;
+      }
+    check(detected, "corrupt LOR data should be detected");
+  }
+  {
+    // let every entry in the index point to the index itself (only detected when the LOR is needed)
+    std::string corrupt_data = data;
+    std::uint64_t index_offset;
+    std::memcpy(&index_offset, data.data() + header_size - sizeof(index_offset), sizeof(index_offset));
+    // every entry consists of 4 bin coordinates and the offset
+    const std::size_t entry_size = 4 * sizeof(std::int32_t) + sizeof(std::uint64_t);
+    for (std::size_t pos = index_offset; pos + entry_size <= data.size(); pos += entry_size)
+      std::memcpy(&corrupt_data[pos + entry_size - sizeof(index_offset)], &index_offset, sizeof(index_offset));
+    bool detected = false;
+    try
+      {
+        set_up_and_get_rows(corrupt_data);
+      }
+    catch (...)
+      {
+        detected = true;
+      }
+    check(detected, "invalid offset in the index should be detected");
+  }
+  // restore the original file
+  {
+    std::ofstream file(data_filename.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(data.data(), data.size());
+  }
+}
+
+void
+ProjMatrixByBinFromFileTests::run_tests()
+{
+  cerr << "Tests for ProjMatrixByBinFromFile\n";
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E953));
+  shared_ptr<const ProjDataInfo> proj_data_info_sptr(ProjDataInfo::ProjDataInfoCTI(scanner_sptr,
+                                                                                   /*span=*/1,
+                                                                                   /*max_delta=*/2,
+                                                                                   /*num_views=*/8,
+                                                                                   /*num_tang_poss=*/16));
+  shared_ptr<const DiscretisedDensity<3, float>> density_sptr(new VoxelsOnCartesianGrid<float>(*proj_data_info_sptr));
+
+  ProjMatrixByBinUsingRayTracing proj_matrix;
+  {
+    stringstream str;
+    str << "Ray Tracing Matrix Parameters :=\n"
+           "number of rays in tangential direction to trace for each bin := 2\n"
+           "End Ray Tracing Matrix Parameters :=\n";
+    if (!check(proj_matrix.parse(str), "parsing projection matrix parameters"))
+      return;
+  }
+  proj_matrix.set_up(proj_data_info_sptr, density_sptr);
+
+  run_tests_for_1_format(proj_matrix, proj_data_info_sptr, density_sptr, "1.0", false);
+  run_tests_for_1_format(proj_matrix, proj_data_info_sptr, density_sptr, "2.0", false);
+  run_tests_for_1_format(proj_matrix, proj_data_info_sptr, density_sptr, "2.0", true);
+  run_tests_for_corrupt_file(proj_data_info_sptr, density_sptr);
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  ProjMatrixByBinFromFileTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -0,0 +1,327 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+
+  \file
+  \ingroup test
+
+  \brief Test program for stir::ProjMatrixElemsForOneBinCache and the caching in stir::ProjMatrixByBin
+*/
+
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinCache.h"
+#include "stir/recon_buildblock/ProjMatrixByBinUsingRayTracing.h"
+#include "stir/recon_buildblock/ProjMatrixByBinSPECTUB.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/ProjDataInfoCylindricalArcCorr.h"
+#include "stir/Scanner.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/IndexRange3D.h"
+#include "stir/Coordinate3D.h"
+#include "stir/RunTests.h"
+#include <iostream>
+#include <sstream>
+
+using std::cerr;
+using std::stringstream;
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for ProjMatrixElemsForOneBinCache
+
+  Checks lookups, statistics, the memory limit and eviction order, concurrent access,
+  and that a ProjMatrixByBin with a (small) cache size limit returns the same rows as
+  one with an unlimited cache. The latter is checked for ray tracing and for SPECTUB, as
+  SPECTUB computes the rows of a whole view at once.
+*/
+class ProjMatrixElemsForOneBinCacheTests : public RunTests
+{
+public:
+  void run_tests() override;
+
+private:
+  //! creates a row with \a num_elems elements with values depending on \a key
+  static ProjMatrixElemsForOneBin create_row(const int key, const int num_elems);
+  void run_tests_basic();
+  void run_tests_eviction();
+  void run_tests_concurrency();
+  void run_tests_proj_matrix();
+  void run_tests_SPECTUB();
+  //! loops twice over some bins and compares the rows of both matrices
+  void compare_rows(const ProjMatrixByBin& proj_matrix_unlimited,
+                    const ProjMatrixByBin& proj_matrix_limited,
+                    const ProjDataInfo& proj_data_info,
+                    const bool check_non_empty);
+};
+
+ProjMatrixElemsForOneBin
+ProjMatrixElemsForOneBinCacheTests::create_row(const int key, const int num_elems)
+{
+  ProjMatrixElemsForOneBin row(Bin(0, 0, key, 0));
+  for (int i = 0; i < num_elems; ++i)
+    row.push_back(ProjMatrixElemsForOneBin::value_type(Coordinate3D<int>(key % 100, i, 0), static_cast<float>(key + i)));
+  return row;
+}
+
+void
+ProjMatrixElemsForOneBinCacheTests::run_tests_basic()
+{
+  cerr << "\tTesting lookups\n";
+  ProjMatrixElemsForOneBinCache cache;
+  cache.set_up(3);
+  check_if_equal(cache.get_num_shards(), std::size_t(3), "number of shards");
+
+  const ProjMatrixElemsForOneBin row = create_row(5, 10);
+  cache.insert(row, 1, 5);
+  ProjMatrixElemsForOneBin result;
+  check(cache.get(result, 1, 5) == Succeeded::yes, "entry should be found");
+  check(result == row, "entry should be identical to what was inserted");
+  check(cache.get(result, 0, 5) == Succeeded::no, "entry should not be found in another shard");
+  check(cache.get(result, 1, 6) == Succeeded::no, "entry should not be found with another key");
+  check_if_equal(cache.get_num_hits(), std::uint64_t(1), "number of hits");
+  check_if_equal(cache.get_num_misses(), std::uint64_t(2), "number of misses");
+  check(cache.get(result, 1, 5, /*update_statistics=*/false) == Succeeded::yes, "entry should be found without statistics");
+  check(cache.get(result, 1, 6, /*update_statistics=*/false) == Succeeded::no,
+        "entry should not be found with another key without statistics");
+  check_if_equal(cache.get_num_hits(), std::uint64_t(1), "number of hits after lookups without statistics");
+  check_if_equal(cache.get_num_misses(), std::uint64_t(2), "number of misses after lookups without statistics");
+  check_if_equal(cache.get_num_entries(), std::size_t(1), "number of entries");
+  check_if_equal(
+      cache.get_size_in_bytes(), ProjMatrixElemsForOneBinCache::estimate_size_in_bytes(row), "size of cache with 1 entry");
+
+  {
+    const ProjMatrixElemsForOneBinCache copy_of_cache(cache);
+    check(copy_of_cache.get(result, 1, 5) == Succeeded::yes, "entry should be found in copy");
+    check(result == row, "entry in copy should be identical to what was inserted");
+  }
+
+  cache.clear();
+  check_if_equal(cache.get_num_entries(), std::size_t(0), "number of entries after clear()");
+  check_if_equal(cache.get_size_in_bytes(), std::size_t(0), "size after clear()");
+  check(cache.get(result, 1, 5) == Succeeded::no, "entry should not be found after clear()");
+}
+
+void
+ProjMatrixElemsForOneBinCacheTests::run_tests_eviction()
+{
+  cerr << "\tTesting memory limit\n";
+  const int num_elems = 20;
+  const std::size_t entry_size = ProjMatrixElemsForOneBinCache::estimate_size_in_bytes(create_row(0, num_elems));
+  ProjMatrixElemsForOneBinCache cache;
+  cache.set_up(2);
+  cache.set_max_size_in_bytes(4 * entry_size);
+
+  for (int key = 0; key < 4; ++key)
+    cache.insert(create_row(key, num_elems), 0, key);
+  check_if_equal(cache.get_num_evictions(), std::uint64_t(0), "no evictions when within budget");
+
+  // use entry 0, such that it gets a second chance
+  ProjMatrixElemsForOneBin result;
+  check(cache.get(result, 0, 0) == Succeeded::yes, "entry 0 should be present");
+  cache.insert(create_row(4, num_elems), 0, 4);
+  check_if_equal(cache.get_num_evictions(), std::uint64_t(1), "1 eviction when inserting beyond budget");
+  check(cache.get_size_in_bytes() <= cache.get_max_size_in_bytes(), "cache size should be within budget");
+  check(cache.get(result, 0, 0) == Succeeded::yes, "recently used entry 0 should not have been evicted");
+  check(cache.get(result, 0, 1) == Succeeded::no, "oldest unused entry 1 should have been evicted");
+  check(cache.get(result, 0, 4) == Succeeded::yes, "new entry 4 should be present");
+
+  // insertion in another shard should evict from the first one
+  for (int key = 10; key < 20; ++key)
+    cache.insert(create_row(key, num_elems), 1, key);
+  check_if_equal(cache.get_num_entries(), std::size_t(4), "number of entries should be limited by budget");
+  check(cache.get_size_in_bytes() <= cache.get_max_size_in_bytes(), "cache size should be within budget after many insertions");
+  check(cache.get(result, 1, 19) == Succeeded::yes, "last entry should be present");
+
+  // entries that are too large are not stored
+  cache.insert(create_row(100, 10 * num_elems), 0, 100);
+  check(cache.get(result, 0, 100) == Succeeded::no, "entry larger than budget should not be stored");
+}
+
+void
+ProjMatrixElemsForOneBinCacheTests::run_tests_concurrency()
+{
+  cerr << "\tTesting concurrent access\n";
+  const int num_shards = 4;
+  const int num_keys = 2000;
+  const int num_elems = 7;
+  ProjMatrixElemsForOneBinCache cache;
+  cache.set_up(num_shards);
+  cache.set_max_size_in_bytes(num_keys / 4 * ProjMatrixElemsForOneBinCache::estimate_size_in_bytes(create_row(0, num_elems)));
+
+  int num_errors = 0;
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic) reduction(+ : num_errors)
+#endif
+  for (int i = 0; i < 4 * num_keys; ++i)
+    {
+      const int key = (i * 7919) % num_keys;
+      const std::size_t shard_index = static_cast<std::size_t>(key % num_shards);
+      ProjMatrixElemsForOneBin result;
+      if (cache.get(result, shard_index, key) == Succeeded::yes)
+        {
+          if (result != create_row(key, num_elems))
+            ++num_errors;
+        }
+      else
+        cache.insert(create_row(key, num_elems), shard_index, key);
+    }
+  check_if_equal(num_errors, 0, "entries found during concurrent access should be correct");
+  check_if_equal(cache.get_num_hits() + cache.get_num_misses(), std::uint64_t(4 * num_keys), "number of lookups");
+  check(cache.get_num_evictions() > 0, "there should be evictions");
+  // note: the budget is only approximately enforced with concurrent insertions, so we don't check the size here
+}
+
+void
+ProjMatrixElemsForOneBinCacheTests::compare_rows(const ProjMatrixByBin& proj_matrix_unlimited,
+                                                 const ProjMatrixByBin& proj_matrix_limited,
+                                                 const ProjDataInfo& proj_data_info,
+                                                 const bool check_non_empty)
+{
+  ProjMatrixElemsForOneBin row_unlimited, row_limited;
+  // loop twice such that we test rows that were evicted and recomputed
+  for (int loop = 0; loop < 2; ++loop)
+    for (int segment_num = proj_data_info.get_min_segment_num(); segment_num <= proj_data_info.get_max_segment_num();
+         ++segment_num)
+      for (int view_num = proj_data_info.get_min_view_num(); view_num <= proj_data_info.get_max_view_num(); ++view_num)
+        for (int axial_pos_num = proj_data_info.get_min_axial_pos_num(segment_num);
+             axial_pos_num <= proj_data_info.get_max_axial_pos_num(segment_num);
+             axial_pos_num += 3)
+          {
+            const Bin bin(segment_num, view_num, axial_pos_num, 1);
+            proj_matrix_unlimited.get_proj_matrix_elems_for_one_bin(row_unlimited, bin);
+            proj_matrix_limited.get_proj_matrix_elems_for_one_bin(row_limited, bin);
+            if (check_non_empty && !check(row_limited.size() > 0, "row should not be empty"))
+              return;
+            if (!check(row_unlimited == row_limited, "rows should be identical for limited and unlimited cache"))
+              return;
+          }
+}
+
+void
+ProjMatrixElemsForOneBinCacheTests::run_tests_proj_matrix()
+{
+  cerr << "\tTesting ProjMatrixByBin with limited cache size\n";
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E953));
+  shared_ptr<ProjDataInfo> proj_data_info_sptr(ProjDataInfo::ProjDataInfoCTI(scanner_sptr,
+                                                                             /*span=*/1,
+                                                                             /*max_delta=*/3,
+                                                                             /*num_views=*/8,
+                                                                             /*num_tang_poss=*/16));
+  shared_ptr<DiscretisedDensity<3, float>> density_sptr(new VoxelsOnCartesianGrid<float>(*proj_data_info_sptr));
+
+  ProjMatrixByBinUsingRayTracing proj_matrix_unlimited;
+  ProjMatrixByBinUsingRayTracing proj_matrix_limited;
+  {
+    stringstream str;
+    str << "Ray Tracing Matrix Parameters :=\n"
+           "maximum cache size in MB := 0.01\n"
+           "End Ray Tracing Matrix Parameters :=\n";
+    if (!check(proj_matrix_limited.parse(str), "parsing projection matrix parameters"))
+      return;
+  }
+  check_if_equal(proj_matrix_limited.get_maximum_cache_size(), std::size_t(10486), "maximum cache size from parsing");
+  proj_matrix_unlimited.set_up(proj_data_info_sptr, density_sptr);
+  proj_matrix_limited.set_up(proj_data_info_sptr, density_sptr);
+
+  compare_rows(proj_matrix_unlimited, proj_matrix_limited, *proj_data_info_sptr, /*check_non_empty=*/false);
+  check(proj_matrix_limited.get_num_cache_evictions() > 0, "there should be evictions in the limited cache");
+  check(proj_matrix_limited.get_cache_size_in_bytes() <= proj_matrix_limited.get_maximum_cache_size(),
+        "cache size should be within budget");
+  check_if_equal(proj_matrix_unlimited.get_num_cache_evictions(), std::uint64_t(0), "no evictions in the unlimited cache");
+  check(proj_matrix_unlimited.get_num_cache_hits() > 0, "there should be hits in the unlimited cache");
+}
+
+void
+ProjMatrixElemsForOneBinCacheTests::run_tests_SPECTUB()
+{
+  cerr << "\tTesting ProjMatrixByBinSPECTUB with limited cache size\n";
+  // construct SPECT data in the same way as InterfilePDFSHeaderSPECT
+  const int num_views = 8;
+  const int num_tang_poss = 16;
+  const int num_axial_poss = 4;
+  const float bin_size = 4.F;
+  const float radius = 80.F;
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::Unknown_scanner,
+                                               "SPECT test",
+                                               /*num_detectors_per_ring=*/-1,
+                                               num_axial_poss,
+                                               num_tang_poss,
+                                               num_tang_poss,
+                                               radius,
+                                               /*average_depth_of_interaction=*/0.F,
+                                               /*ring_spacing=*/bin_size,
+                                               bin_size,
+                                               /*intrinsic_tilt=*/0.F,
+                                               -1,
+                                               -1,
+                                               -1,
+                                               -1,
+                                               -1,
+                                               -1,
+                                               /*num_detector_layers=*/1,
+                                               /*energy_resolution=*/-1.F,
+                                               /*reference_energy=*/-1.F,
+                                               /*max_num_of_timing_poss=*/1,
+                                               /*size_timing_pos=*/-1.F,
+                                               /*timing_resolution=*/-1.F));
+  VectorWithOffset<int> num_axial_poss_per_segment(0, 0);
+  VectorWithOffset<int> min_ring_diff(0, 0);
+  VectorWithOffset<int> max_ring_diff(0, 0);
+  num_axial_poss_per_segment[0] = num_axial_poss;
+  min_ring_diff[0] = 0;
+  max_ring_diff[0] = 0;
+  shared_ptr<ProjDataInfoCylindricalArcCorr> proj_data_info_sptr(new ProjDataInfoCylindricalArcCorr(
+      scanner_sptr, bin_size, num_axial_poss_per_segment, min_ring_diff, max_ring_diff, num_views, num_tang_poss));
+  VectorWithOffset<float> radii(0, num_views - 1);
+  radii.fill(radius);
+  proj_data_info_sptr->set_ring_radii_for_all_views(radii);
+  proj_data_info_sptr->set_azimuthal_angle_sampling(static_cast<float>(2 * _PI / num_views));
+
+  shared_ptr<DiscretisedDensity<3, float>> density_sptr(
+      new VoxelsOnCartesianGrid<float>(IndexRange3D(0, num_axial_poss - 1, -8, 7, -8, 7),
+                                       CartesianCoordinate3D<float>(0.F, 0.F, 0.F),
+                                       CartesianCoordinate3D<float>(bin_size, bin_size, bin_size)));
+
+  ProjMatrixByBinSPECTUB proj_matrix_unlimited;
+  ProjMatrixByBinSPECTUB proj_matrix_limited;
+  proj_matrix_unlimited.set_keep_all_views_in_cache(true);
+  proj_matrix_limited.set_keep_all_views_in_cache(true);
+  // set the budget to less than the rows of a single view, such that rows of processed views are evicted
+  proj_matrix_limited.set_maximum_cache_size(
+      ProjMatrixElemsForOneBinCache::estimate_size_in_bytes(ProjMatrixElemsForOneBin()) * num_tang_poss * num_axial_poss);
+  proj_matrix_unlimited.set_up(proj_data_info_sptr, density_sptr);
+  proj_matrix_limited.set_up(proj_data_info_sptr, density_sptr);
+
+  compare_rows(proj_matrix_unlimited, proj_matrix_limited, *proj_data_info_sptr, /*check_non_empty=*/true);
+  check(proj_matrix_limited.get_num_cache_evictions() > 0, "there should be evictions in the limited SPECTUB cache");
+}
+
+void
+ProjMatrixElemsForOneBinCacheTests::run_tests()
+{
+  cerr << "Tests for ProjMatrixElemsForOneBinCache\n";
+  run_tests_basic();
+  run_tests_eviction();
+  run_tests_concurrency();
+  run_tests_proj_matrix();
+  run_tests_SPECTUB();
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  ProjMatrixElemsForOneBinCacheTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -0,0 +1,183 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+
+  \file
+  \ingroup test
+
+  \brief Test program for stir::ProjMatrixElemsForOneBinPacked
+
+  Compares symmetry operations, forward and back projection with the results obtained with
+  stir::ProjMatrixElemsForOneBin.
+*/
+
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinPacked.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/recon_buildblock/ProjMatrixByBinUsingRayTracing.h"
+#include "stir/recon_buildblock/DataSymmetriesForBins.h"
+#include "stir/recon_buildblock/SymmetryOperation.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/Scanner.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/IndexRange3D.h"
+#include "stir/RunTests.h"
+#include <iostream>
+#include <vector>
+
+using std::cerr;
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for ProjMatrixElemsForOneBinPacked
+*/
+class ProjMatrixElemsForOneBinPackedTests : public RunTests
+{
+public:
+  void run_tests() override;
+
+private:
+  void run_tests_conversion();
+  void run_tests_for_1_image(const ProjMatrixByBin& proj_matrix,
+                             const ProjDataInfo& proj_data_info,
+                             const VoxelsOnCartesianGrid<float>& image);
+};
+
+void
+ProjMatrixElemsForOneBinPackedTests::run_tests_conversion()
+{
+  cerr << "\tTesting conversion\n";
+  ProjMatrixElemsForOneBin row(Bin(1, 2, 3, 4));
+  for (int i = 0; i < 10; ++i)
+    row.push_back(ProjMatrixElemsForOneBin::value_type(Coordinate3D<int>(i, -i, 2 * i), static_cast<float>(i + 1)));
+  const ProjMatrixElemsForOneBinPacked packed_row(row);
+  check_if_equal(packed_row.size(), row.size(), "size after conversion");
+  check_if_equal(packed_row.get_bin(), row.get_bin(), "bin after conversion");
+  check_if_equal(static_cast<int>(packed_row.get_coords_ptr(2)[3]), -3, "coordinate after conversion");
+  check_if_equal(packed_row.get_values_ptr()[3], 4.F, "value after conversion");
+  ProjMatrixElemsForOneBin row_copy;
+  packed_row.get_all(row_copy);
+  check(row_copy == row, "conversion back to ProjMatrixElemsForOneBin");
+  check_if_equal(row_copy.get_bin(), row.get_bin(), "bin after conversion back to ProjMatrixElemsForOneBin");
+}
+
+void
+ProjMatrixElemsForOneBinPackedTests::run_tests_for_1_image(const ProjMatrixByBin& proj_matrix,
+                                                           const ProjDataInfo& proj_data_info,
+                                                           const VoxelsOnCartesianGrid<float>& image)
+{
+  const DataSymmetriesForBins& symmetries = *proj_matrix.get_symmetries_ptr();
+  const ProjMatrixElemsForOneBinPacked::DensityInfo density_info(image);
+  shared_ptr<VoxelsOnCartesianGrid<float>> back_projection_sptr(image.get_empty_copy());
+  shared_ptr<VoxelsOnCartesianGrid<float>> packed_back_projection_sptr(image.get_empty_copy());
+
+  ProjMatrixElemsForOneBin row, row_copy, row_from_packed;
+  ProjMatrixElemsForOneBinPacked packed_row, packed_row_copy;
+  std::vector<Bin> related_bins;
+  for (int segment_num = proj_data_info.get_min_segment_num(); segment_num <= proj_data_info.get_max_segment_num();
+       ++segment_num)
+    for (int view_num = proj_data_info.get_min_view_num(); view_num <= proj_data_info.get_max_view_num(); ++view_num)
+      for (int axial_pos_num = proj_data_info.get_min_axial_pos_num(segment_num);
+           axial_pos_num <= proj_data_info.get_max_axial_pos_num(segment_num);
+           ++axial_pos_num)
+        for (int tang_pos_num = proj_data_info.get_min_tangential_pos_num();
+             tang_pos_num <= proj_data_info.get_max_tangential_pos_num();
+             ++tang_pos_num)
+          {
+            Bin basic_bin(segment_num, view_num, axial_pos_num, tang_pos_num);
+            if (symmetries.find_basic_bin(basic_bin))
+              continue; // not a basic bin, handled via its related bins
+
+            proj_matrix.get_proj_matrix_elems_for_one_bin(row, basic_bin);
+            packed_row.set_from(row);
+            symmetries.get_related_bins(related_bins, basic_bin);
+            for (const Bin& related_bin : related_bins)
+              {
+                Bin bin = related_bin;
+                unique_ptr<SymmetryOperation> symm_op_ptr = symmetries.find_symmetry_operation_from_basic_bin(bin);
+                row_copy = row;
+                symm_op_ptr->transform_proj_matrix_elems_for_one_bin(row_copy);
+                packed_row_copy = packed_row;
+                symm_op_ptr->transform_packed_proj_matrix_elems_for_one_bin(packed_row_copy);
+                packed_row_copy.get_all(row_from_packed);
+                if (!check(row_from_packed == row_copy, "symmetry operation on packed row")
+                    || !check_if_equal(packed_row_copy.get_bin(), row_copy.get_bin(), "bin after symmetry operation"))
+                  {
+                    cerr << "Problem at bin " << related_bin.segment_num() << ',' << related_bin.view_num() << ','
+                         << related_bin.axial_pos_num() << ',' << related_bin.tangential_pos_num() << '\n';
+                    return;
+                  }
+
+                Bin fwd_bin = related_bin;
+                fwd_bin.set_bin_value(0.F);
+                Bin packed_fwd_bin = fwd_bin;
+                row_copy.forward_project(fwd_bin, image);
+                packed_row_copy.forward_project(packed_fwd_bin, image, density_info);
+                if (!check_if_equal(packed_fwd_bin.get_bin_value(), fwd_bin.get_bin_value(), "forward projection"))
+                  return;
+
+                Bin back_bin = related_bin;
+                back_bin.set_bin_value(1.F + related_bin.tangential_pos_num() % 3);
+                row_copy.back_project(*back_projection_sptr, back_bin);
+                packed_row_copy.back_project(*packed_back_projection_sptr, back_bin, density_info);
+              }
+          }
+  check_if_equal(*packed_back_projection_sptr, *back_projection_sptr, "back projection");
+}
+
+void
+ProjMatrixElemsForOneBinPackedTests::run_tests()
+{
+  cerr << "Tests for ProjMatrixElemsForOneBinPacked\n";
+  run_tests_conversion();
+
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E953));
+  shared_ptr<const ProjDataInfo> proj_data_info_sptr(ProjDataInfo::ProjDataInfoCTI(scanner_sptr,
+                                                                                   /*span=*/1,
+                                                                                   /*max_delta=*/2,
+                                                                                   /*num_views=*/8,
+                                                                                   /*num_tang_poss=*/16));
+  shared_ptr<VoxelsOnCartesianGrid<float>> image_sptr(new VoxelsOnCartesianGrid<float>(*proj_data_info_sptr));
+  for (int z = image_sptr->get_min_z(); z <= image_sptr->get_max_z(); ++z)
+    for (int y = image_sptr->get_min_y(); y <= image_sptr->get_max_y(); ++y)
+      for (int x = image_sptr->get_min_x(); x <= image_sptr->get_max_x(); ++x)
+        (*image_sptr)[z][y][x] = 1.F + (7 * z + 3 * y + x + 100) % 11;
+
+  ProjMatrixByBinUsingRayTracing proj_matrix;
+  proj_matrix.set_up(proj_data_info_sptr, image_sptr);
+
+  set_tolerance(1E-4);
+  cerr << "\tTesting symmetries and projection for a contiguous image\n";
+  run_tests_for_1_image(proj_matrix, *proj_data_info_sptr, *image_sptr);
+
+  // remove the first and last plane, such that some voxels are outside of the image,
+  // and the image is no longer contiguous
+  cerr << "\tTesting symmetries and projection for an image with fewer planes\n";
+  VoxelsOnCartesianGrid<float> small_image(*image_sptr);
+  small_image.resize(IndexRange3D(image_sptr->get_min_z() + 1,
+                                  image_sptr->get_max_z() - 1,
+                                  image_sptr->get_min_y(),
+                                  image_sptr->get_max_y(),
+                                  image_sptr->get_min_x(),
+                                  image_sptr->get_max_x()));
+  run_tests_for_1_image(proj_matrix, *proj_data_info_sptr, small_image);
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  ProjMatrixElemsForOneBinPackedTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
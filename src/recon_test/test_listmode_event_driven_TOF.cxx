@@ -0,0 +1,352 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recon_test
+
+  \brief Test program for list-mode TOF reconstruction with the event-driven TOF kernel of
+  stir::PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin
+*/
+
+#include "stir/recon_buildblock/PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin.h"
+#include "stir/recon_buildblock/PoissonLogLikelihoodWithLinearModelForMeanAndProjData.h"
+#include "stir/recon_buildblock/ProjMatrixByBinUsingRayTracing.h"
+#include "stir/recon_buildblock/ProjectorByBinPairUsingProjMatrixByBin.h"
+#include "stir/recon_buildblock/TrivialBinNormalisation.h"
+#include "stir/OSMAPOSL/OSMAPOSLReconstruction.h"
+#include "stir/listmode/ListModeData.h"
+#include "stir/listmode/CListRecord.h"
+#include "stir/LORCoordinates.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
+#include "stir/Bin.h"
+#include "stir/RunTests.h"
+#include "stir/num_threads.h"
+#include "stir/is_null_ptr.h"
+#include "stir/Succeeded.h"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+START_NAMESPACE_STIR
+
+//! Event with a given bin and TOF time difference
+/*! get_bin() keeps the bin, but finds the timing position from the time difference,
+    such that the event can be used with any TOF mashing factor. */
+class CListEventWithTOFForTests : public CListEvent
+{
+public:
+  CListEventWithTOFForTests() = default;
+  CListEventWithTOFForTests(const Bin& bin, const ProjDataInfo& proj_data_info)
+      : bin(bin),
+        delta_time(proj_data_info.get_tof_delta_time(bin))
+  {
+    LORInAxialAndNoArcCorrSinogramCoordinates<float> lor;
+    proj_data_info.get_LOR(lor, bin);
+    lor.get_intersections_with_cylinder(this->lor_points, lor.radius());
+  }
+
+  bool is_prompt() const override { return true; }
+  LORAs2Points<float> get_LOR() const override { return this->lor_points; }
+  void get_bin(Bin& bin, const ProjDataInfo& proj_data_info) const override
+  {
+    bin = this->bin;
+    bin.timing_pos_num() = proj_data_info.get_tof_bin(this->delta_time);
+    bin.set_bin_value(1.F);
+  }
+  bool is_valid_template(const ProjDataInfo&) const override { return true; }
+
+private:
+  Bin bin;
+  double delta_time = 0.;
+  LORAs2Points<float> lor_points;
+};
+
+//! Time record that is never used, as all records are events
+class CListTimeUnusedForTests : public ListTime
+{
+public:
+  unsigned long get_time_in_millisecs() const override { return 0UL; }
+  Succeeded set_time_in_millisecs(const unsigned long) override { return Succeeded::no; }
+};
+
+class CListRecordWithTOFForTests : public CListRecord
+{
+public:
+  CListRecordWithTOFForTests() = default;
+  explicit CListRecordWithTOFForTests(const CListEventWithTOFForTests& event)
+      : event_data(event)
+  {}
+
+  bool is_time() const override { return false; }
+  bool is_event() const override { return true; }
+  CListEventWithTOFForTests& event() override { return this->event_data; }
+  const CListEventWithTOFForTests& event() const override { return this->event_data; }
+  CListTimeUnusedForTests& time() override { return this->time_data; }
+  const CListTimeUnusedForTests& time() const override { return this->time_data; }
+
+private:
+  CListEventWithTOFForTests event_data;
+  CListTimeUnusedForTests time_data;
+};
+
+//! List-mode data with TOF events that are kept in memory
+class CListModeDataWithTOFForTests : public ListModeData
+{
+public:
+  CListModeDataWithTOFForTests(shared_ptr<const ExamInfo> exam_info_sptr,
+                               shared_ptr<const ProjDataInfo> proj_data_info_sptr,
+                               const std::vector<CListRecordWithTOFForTests>& records)
+      : records(records),
+        current_record_num(0)
+  {
+    this->exam_info_sptr = exam_info_sptr;
+    this->proj_data_info_sptr = proj_data_info_sptr;
+  }
+
+  std::string get_name() const override { return "CListModeDataWithTOFForTests"; }
+  Succeeded reset() override
+  {
+    this->current_record_num = 0;
+    return Succeeded::yes;
+  }
+  SavedPosition save_get_position() override
+  {
+    this->saved_record_nums.push_back(this->current_record_num);
+    return static_cast<SavedPosition>(this->saved_record_nums.size() - 1);
+  }
+  Succeeded set_get_position(const SavedPosition& pos) override
+  {
+    if (pos >= this->saved_record_nums.size())
+      return Succeeded::no;
+    this->current_record_num = this->saved_record_nums[pos];
+    return Succeeded::yes;
+  }
+  bool has_delayeds() const override { return false; }
+
+protected:
+  shared_ptr<ListRecord> get_empty_record_helper_sptr() const override
+  {
+    return shared_ptr<ListRecord>(new CListRecordWithTOFForTests);
+  }
+  Succeeded get_next(ListRecord& record) const override
+  {
+    if (this->current_record_num >= this->records.size())
+      return Succeeded::no;
+    dynamic_cast<CListRecordWithTOFForTests&>(record) = this->records[this->current_record_num++];
+    return Succeeded::yes;
+  }
+
+private:
+  std::vector<CListRecordWithTOFForTests> records;
+  mutable std::size_t current_record_num;
+  std::vector<std::size_t> saved_record_nums;
+};
+
+/*!
+  \ingroup recon_test
+  \brief Test class for list-mode TOF reconstruction with the event-driven TOF kernel
+
+  Events are generated at the timing resolution of the scanner (i.e. without TOF mashing).
+  List-mode data with a TOF mashing factor are reconstructed with OSMAPOSL and
+  PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin::set_use_event_tof_kernel(),
+  and compared with the reconstruction of the same events histogrammed into projection data without TOF mashing.
+  The additive term of the list-mode reconstruction is given for the mashed TOF bins, and is
+  spread over the unmashed ones for the reconstruction of the projection data.
+
+  This is done for an even and an odd TOF mashing factor, and also without TOF mashing
+  (without the event-driven TOF kernel) to check the comparison itself.
+*/
+class ListModeEventDrivenTOFTests : public RunTests
+{
+public:
+  void run_tests() override;
+
+private:
+  typedef DiscretisedDensity<3, float> target_type;
+
+  //! Reconstructs the list-mode data with the given TOF mashing factor
+  shared_ptr<target_type> reconstruct_list_mode_data(const int tof_mash_factor, const bool use_event_tof_kernel);
+  //! Reconstructs the histogrammed events, with the additive term of the list-mode data with the given TOF mashing factor
+  shared_ptr<target_type> reconstruct_proj_data(const int tof_mash_factor);
+  //! Runs OSMAPOSL with the given objective function and input data
+  shared_ptr<target_type> reconstruct(const shared_ptr<GeneralisedObjectiveFunction<target_type>>& objective_function_sptr,
+                                      const shared_ptr<ExamData>& input_data_sptr);
+
+  shared_ptr<const ExamInfo> exam_info_sptr;
+  //! projection data info without TOF mashing
+  shared_ptr<const ProjDataInfo> proj_data_info_sptr;
+  shared_ptr<const target_type> initial_image_sptr;
+  std::vector<CListRecordWithTOFForTests> records;
+
+  //! value of the additive term in every (mashed) TOF bin of the list-mode data
+  static constexpr float additive_value = .1F;
+  static constexpr int num_subiterations = 3;
+};
+
+shared_ptr<ListModeEventDrivenTOFTests::target_type>
+ListModeEventDrivenTOFTests::reconstruct(const shared_ptr<GeneralisedObjectiveFunction<target_type>>& objective_function_sptr,
+                                         const shared_ptr<ExamData>& input_data_sptr)
+{
+  OSMAPOSLReconstruction<target_type> recon;
+  recon.set_objective_function_sptr(objective_function_sptr);
+  recon.set_input_data(input_data_sptr);
+  recon.set_num_subsets(1);
+  recon.set_num_subiterations(num_subiterations);
+  recon.set_disable_output(true);
+  recon.set_output_filename_prefix("test_listmode_event_driven_TOF");
+  shared_ptr<target_type> image_sptr(this->initial_image_sptr->clone());
+  if (recon.set_up(image_sptr) != Succeeded::yes || recon.reconstruct(image_sptr) != Succeeded::yes)
+    {
+      check(false, "reconstruction failed");
+      return shared_ptr<target_type>();
+    }
+  return image_sptr;
+}
+
+shared_ptr<ListModeEventDrivenTOFTests::target_type>
+ListModeEventDrivenTOFTests::reconstruct_list_mode_data(const int tof_mash_factor, const bool use_event_tof_kernel)
+{
+  shared_ptr<ProjDataInfo> lm_proj_data_info_sptr = this->proj_data_info_sptr->create_shared_clone();
+  lm_proj_data_info_sptr->set_tof_mash_factor(tof_mash_factor);
+  shared_ptr<ListModeData> lm_data_sptr(
+      new CListModeDataWithTOFForTests(this->exam_info_sptr, lm_proj_data_info_sptr, this->records));
+
+  shared_ptr<ProjDataInMemory> add_proj_data_sptr(new ProjDataInMemory(this->exam_info_sptr, lm_proj_data_info_sptr));
+  add_proj_data_sptr->fill(additive_value);
+
+  shared_ptr<PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<target_type>> objective_function_sptr(
+      new PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<target_type>);
+  objective_function_sptr->set_proj_matrix(shared_ptr<ProjMatrixByBin>(new ProjMatrixByBinUsingRayTracing));
+  objective_function_sptr->set_normalisation_sptr(shared_ptr<BinNormalisation>(new TrivialBinNormalisation));
+  objective_function_sptr->set_additive_proj_data_sptr(add_proj_data_sptr);
+  objective_function_sptr->set_use_event_tof_kernel(use_event_tof_kernel);
+  return this->reconstruct(objective_function_sptr, lm_data_sptr);
+}
+
+shared_ptr<ListModeEventDrivenTOFTests::target_type>
+ListModeEventDrivenTOFTests::reconstruct_proj_data(const int tof_mash_factor)
+{
+  shared_ptr<ProjDataInMemory> proj_data_sptr(new ProjDataInMemory(this->exam_info_sptr, this->proj_data_info_sptr));
+  proj_data_sptr->fill(0.F);
+  for (const auto& record : this->records)
+    {
+      Bin bin;
+      record.event().get_bin(bin, *this->proj_data_info_sptr);
+      const float num_counts = proj_data_sptr->get_bin_value(bin);
+      bin.set_bin_value(num_counts + 1);
+      proj_data_sptr->set_bin_value(bin);
+    }
+
+  // every mashed TOF bin contains tof_mash_factor unmashed ones, so this is the additive term used for the events
+  shared_ptr<ProjDataInMemory> add_proj_data_sptr(new ProjDataInMemory(this->exam_info_sptr, this->proj_data_info_sptr));
+  add_proj_data_sptr->fill(additive_value / tof_mash_factor);
+
+  shared_ptr<PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>> objective_function_sptr(
+      new PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>);
+  shared_ptr<ProjMatrixByBin> proj_matrix_sptr(new ProjMatrixByBinUsingRayTracing);
+  objective_function_sptr->set_projector_pair_sptr(
+      shared_ptr<ProjectorByBinPair>(new ProjectorByBinPairUsingProjMatrixByBin(proj_matrix_sptr)));
+  objective_function_sptr->set_normalisation_sptr(shared_ptr<BinNormalisation>(new TrivialBinNormalisation));
+  objective_function_sptr->set_additive_proj_data_sptr(add_proj_data_sptr);
+  return this->reconstruct(objective_function_sptr, proj_data_sptr);
+}
+
+void
+ListModeEventDrivenTOFTests::run_tests()
+{
+  std::cerr << "Tests for list-mode TOF reconstruction with the event-driven TOF kernel\n";
+  // a small TOF scanner, with 55 timing positions, such that the number of mashed timing positions is odd for
+  // TOF mashing factors 2 and 5
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::Discovery690));
+  scanner_sptr->set_num_rings(3);
+  this->proj_data_info_sptr = ProjDataInfo::construct_proj_data_info(scanner_sptr,
+                                                                     /*span=*/1,
+                                                                     /*max_delta=*/0,
+                                                                     /*num_views=*/16,
+                                                                     /*num_tang_poss=*/64,
+                                                                     /* arccorrected=*/false,
+                                                                     /* TOF_mash_factor=*/1);
+  this->exam_info_sptr.reset(new ExamInfo(ImagingModality::PT));
+
+  {
+    const float zoom = 0.5F;
+    shared_ptr<target_type> image_sptr(new VoxelsOnCartesianGrid<float>(
+        this->exam_info_sptr, *this->proj_data_info_sptr, zoom, CartesianCoordinate3D<float>(0, 0, 0)));
+    image_sptr->fill(1.F);
+    this->initial_image_sptr = image_sptr;
+  }
+
+  // random events in the centre of the field of view, and in the central timing positions such that
+  // all events are in the range of the mashed timing positions
+  {
+    std::mt19937 generator(42);
+    const ProjDataInfo& proj_data_info = *this->proj_data_info_sptr;
+    std::uniform_int_distribution<int> view_distribution(proj_data_info.get_min_view_num(), proj_data_info.get_max_view_num());
+    std::uniform_int_distribution<int> axial_pos_distribution(proj_data_info.get_min_axial_pos_num(0),
+                                                              proj_data_info.get_max_axial_pos_num(0));
+    std::uniform_int_distribution<int> tangential_pos_distribution(proj_data_info.get_min_tangential_pos_num() / 2,
+                                                                   proj_data_info.get_max_tangential_pos_num() / 2);
+    std::uniform_int_distribution<int> timing_pos_distribution(proj_data_info.get_min_tof_pos_num() / 2,
+                                                               proj_data_info.get_max_tof_pos_num() / 2);
+    const int num_events = 20000;
+    for (int i = 0; i < num_events; ++i)
+      {
+        const Bin bin(0,
+                      view_distribution(generator),
+                      axial_pos_distribution(generator),
+                      tangential_pos_distribution(generator),
+                      timing_pos_distribution(generator),
+                      1.F);
+        this->records.push_back(CListRecordWithTOFForTests(CListEventWithTOFForTests(bin, proj_data_info)));
+      }
+  }
+
+  // the tolerance is only needed for rounding errors
+  set_tolerance(1E-3);
+
+  std::cerr << "----- without TOF mashing\n";
+  const shared_ptr<target_type> reference_sptr = this->reconstruct_proj_data(1);
+  if (!check(!is_null_ptr(reference_sptr) && reference_sptr->find_max() > 0, "reconstruction of histogrammed events"))
+    return;
+  {
+    const shared_ptr<target_type> image_sptr = this->reconstruct_list_mode_data(1, false);
+    if (check(!is_null_ptr(image_sptr), "list-mode reconstruction without TOF mashing"))
+      check_if_equal(*image_sptr, *reference_sptr, "list-mode reconstruction without TOF mashing");
+  }
+
+  for (const int tof_mash_factor : { 2, 5 })
+    {
+      std::cerr << "----- event-driven TOF kernel for TOF mashing factor " << tof_mash_factor << "\n";
+      const shared_ptr<target_type> image_sptr = this->reconstruct_list_mode_data(tof_mash_factor, true);
+      if (check(!is_null_ptr(image_sptr), "list-mode reconstruction with event-driven TOF kernel"))
+        check_if_equal(*image_sptr,
+                       *this->reconstruct_proj_data(tof_mash_factor),
+                       "list-mode reconstruction with event-driven TOF kernel for TOF mashing factor "
+                           + std::to_string(tof_mash_factor));
+    }
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  set_default_num_threads();
+
+  ListModeEventDrivenTOFTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
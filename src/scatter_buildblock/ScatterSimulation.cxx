@@ -119,6 +119,15 @@ ScatterSimulation::process_data()
   /* ////////////////// end SCATTER ESTIMATION TIME //////////////// */
   float total_scatter = 0;
 
+  this->precompute_cache_for_scattpoint_det_integrals();
+  {
+    wall_clock_timer.stop(); // must be stopped before getting the value
+    info(boost::format("ScatterSimulator: line integrals computed in %1$5.2f secs") % wall_clock_timer.value(), 2);
+    // exclude this time from the estimate of the remaining time
+    previous_timer = wall_clock_timer.value();
+    wall_clock_timer.start();
+  }
+
   info("ScatterSimulator: Initialization finished ...");
   for (vs_num.segment_num() = this->proj_data_info_sptr->get_min_segment_num();
        vs_num.segment_num() <= this->proj_data_info_sptr->get_max_segment_num();
@@ -397,6 +406,7 @@ ScatterSimulation::set_up()
     check_z_to_middle_consistent(*this->density_image_for_scatter_points_sptr, "scatter-point");
   }
 #endif
+  this->initialise_detection_points();
   this->initialise_cache_for_scattpoint_det_integrals_over_attenuation();
   this->initialise_cache_for_scattpoint_det_integrals_over_activity();
 
@@ -742,6 +752,7 @@ ScatterSimulation::set_template_proj_data_info(const ProjDataInfo& arg)
 
   // get rid of any previously stored points
   this->detection_points_vector.clear();
+  this->detection_points_map.clear();
   // reserve space to avoid reallocation, but the actual size will grow dynamically
   this->detection_points_vector.reserve(static_cast<std::size_t>(this->total_detectors));
 
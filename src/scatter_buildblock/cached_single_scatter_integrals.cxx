@@ -14,6 +14,11 @@
   Functions calculate the integral along LOR in an image (attenuation or emission).
   (from scatter point to detector coordinate).
 
+  The integrals are cached. The caches are normally filled for all scatter points and detection points
+  at the start of ScatterSimulation::process_data(), such that the computation of the scatter for every bin
+  only needs to read from the cache. Attenuation integrals are kept until the attenuation image (or the scatter
+  points or detection points) change, i.e. they are reused when only the activity image is updated.
+
   \author Charalampos Tsoumpas
   \author Nikolaos Dikaios
   \author Kris Thielemans
@@ -148,7 +153,7 @@ ScatterSimulation::cached_exp_integral_over_attenuation_image_between_scattpoint
 
 if (this->use_cache && value != cache_init_value)
   {
-    return *location_in_cache;
+    return value;
   }
 else
   {
@@ -171,4 +176,33 @@ return result;
 }
 }
 
+void
+ScatterSimulation::precompute_cache_for_scattpoint_det_integrals()
+{
+  if (!this->use_cache)
+    return;
+
+  const int num_scatter_points = static_cast<int>(this->scatt_points_vector.size());
+  const int num_detection_points = static_cast<int>(this->detection_points_vector.size());
+  // Every thread handles different scatter points, so there are no conflicts when writing to the caches.
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int scatter_point_num = 0; scatter_point_num < num_scatter_points; ++scatter_point_num)
+    {
+      const CartesianCoordinate3D<float>& scatter_point = this->scatt_points_vector[scatter_point_num].coord;
+      Array<1, float>& activity_integrals = this->cached_activity_integral_scattpoint_det[scatter_point_num];
+      Array<1, float>& attenuation_integrals = this->cached_attenuation_integral_scattpoint_det[scatter_point_num];
+      for (int det_num = 0; det_num < num_detection_points; ++det_num)
+        {
+          const CartesianCoordinate3D<float>& detector_coord = this->detection_points_vector[det_num];
+          if (activity_integrals[det_num] == cache_init_value)
+            activity_integrals[det_num] = integral_over_activity_image_between_scattpoint_det(scatter_point, detector_coord);
+          if (attenuation_integrals[det_num] == cache_init_value)
+            attenuation_integrals[det_num]
+                = exp_integral_over_attenuation_image_between_scattpoint_det(scatter_point, detector_coord);
+        }
+    }
+}
+
 END_NAMESPACE_STIR
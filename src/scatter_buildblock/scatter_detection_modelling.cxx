@@ -32,39 +32,56 @@ START_NAMESPACE_STIR
 unsigned
 ScatterSimulation::find_in_detection_points_vector(const CartesianCoordinate3D<float>& coord) const
 {
-#ifndef NDEBUG
-  if (!this->_already_set_up)
-    error("ScatterSimulation::find_detectors: need to call set_up() first");
-#endif
-  unsigned int ret_value = 0;
-#pragma omp critical(SCATTERESTIMATIONFINDDETECTIONPOINTS)
-  {
-    std::vector<CartesianCoordinate3D<float>>::const_iterator iter
-        = std::find(detection_points_vector.begin(), detection_points_vector.end(), coord);
-    if (iter != detection_points_vector.end())
-      {
-        ret_value = iter - detection_points_vector.begin();
-      }
-    else
-      {
-        if (detection_points_vector.size() == static_cast<std::size_t>(this->total_detectors))
-          error("More detection points than we think there are!\n");
-
-        detection_points_vector.push_back(coord);
-        ret_value = detection_points_vector.size() - 1;
-      }
-  }
-  return ret_value;
+  // Note: detection_points_map is filled by initialise_detection_points() (called by set_up()), so it is not modified
+  // here. This means that no locking is needed when called from multiple threads.
+  const auto iter = this->detection_points_map.find(coord);
+  if (iter == this->detection_points_map.end())
+    error("ScatterSimulation::find_in_detection_points_vector: detection point not found. Did you call set_up()?");
+  return iter->second;
 }
 
 void
-ScatterSimulation::find_detectors(unsigned& det_num_A, unsigned& det_num_B, const Bin& bin) const
+ScatterSimulation::initialise_detection_points()
 {
-#ifndef NDEBUG
-  if (!this->_already_set_up)
-    error("ScatterSimulation::find_detectors: need to call set_up() first");
-#endif
+  if (!this->detection_points_map.empty())
+    return;
+
+  this->detection_points_vector.clear();
+  // go through all bins in a fixed order, such that the detection points are always numbered in the same way
+  Bin bin;
   CartesianCoordinate3D<float> detector_coord_A, detector_coord_B;
+  for (bin.segment_num() = this->proj_data_info_sptr->get_min_segment_num();
+       bin.segment_num() <= this->proj_data_info_sptr->get_max_segment_num();
+       ++bin.segment_num())
+    for (bin.view_num() = this->proj_data_info_sptr->get_min_view_num();
+         bin.view_num() <= this->proj_data_info_sptr->get_max_view_num();
+         ++bin.view_num())
+      for (bin.axial_pos_num() = this->proj_data_info_sptr->get_min_axial_pos_num(bin.segment_num());
+           bin.axial_pos_num() <= this->proj_data_info_sptr->get_max_axial_pos_num(bin.segment_num());
+           ++bin.axial_pos_num())
+        for (bin.tangential_pos_num() = this->proj_data_info_sptr->get_min_tangential_pos_num();
+             bin.tangential_pos_num() <= this->proj_data_info_sptr->get_max_tangential_pos_num();
+             ++bin.tangential_pos_num())
+          {
+            this->find_cartesian_coordinates_of_detection(detector_coord_A, detector_coord_B, bin);
+            for (const auto& coord : { detector_coord_A, detector_coord_B })
+              {
+                const CartesianCoordinate3D<float> shifted_coord = coord + this->shift_detector_coordinates_to_origin;
+                if (this->detection_points_map.count(shifted_coord) > 0)
+                  continue;
+                if (this->detection_points_vector.size() == static_cast<std::size_t>(this->total_detectors))
+                  error("More detection points than we think there are!\n");
+                this->detection_points_map[shifted_coord] = static_cast<unsigned>(this->detection_points_vector.size());
+                this->detection_points_vector.push_back(shifted_coord);
+              }
+          }
+}
+
+void
+ScatterSimulation::find_cartesian_coordinates_of_detection(CartesianCoordinate3D<float>& detector_coord_A,
+                                                           CartesianCoordinate3D<float>& detector_coord_B,
+                                                           const Bin& bin) const
+{
   auto ptr = dynamic_cast<ProjDataInfoBlocksOnCylindricalNoArcCorr*>(proj_data_info_sptr.get());
   if (ptr)
     {
@@ -82,6 +99,17 @@ ScatterSimulation::find_detectors(unsigned& det_num_A, unsigned& det_num_B, cons
           error("wrong type of projection data for scatter simulation");
         }
     }
+}
+
+void
+ScatterSimulation::find_detectors(unsigned& det_num_A, unsigned& det_num_B, const Bin& bin) const
+{
+#ifndef NDEBUG
+  if (!this->_already_set_up)
+    error("ScatterSimulation::find_detectors: need to call set_up() first");
+#endif
+  CartesianCoordinate3D<float> detector_coord_A, detector_coord_B;
+  this->find_cartesian_coordinates_of_detection(detector_coord_A, detector_coord_B, bin);
   det_num_A = this->find_in_detection_points_vector(detector_coord_A + this->shift_detector_coordinates_to_origin);
   det_num_B = this->find_in_detection_points_vector(detector_coord_B + this->shift_detector_coordinates_to_origin);
 }
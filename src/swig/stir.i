@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2011-07-01 - 2012, Kris Thielemans
-    Copyright (C) 2013, 2014, 2015, 2018 - 2023 University College London
+    Copyright (C) 2013, 2014, 2015, 2018 - 2023, 2026 University College London
     Copyright (C) 2022 National Physical Laboratory
     Copyright (C) 2022 Positrigo
     This file is part of STIR.
@@ -715,6 +715,144 @@ namespace std {
     return new SwigPyForwardIteratorClosed_T<OutIter>(current, begin, end, seq);
   }
 
+  // numpy support
+
+  // numpy type number for a C++ type
+  template <typename elemT> inline int numpy_type_num();
+  template <> inline int numpy_type_num<float>() { return NPY_FLOAT; }
+  template <> inline int numpy_type_num<double>() { return NPY_DOUBLE; }
+  template <> inline int numpy_type_num<int>() { return NPY_INT; }
+
+  // find the numpy dimensions for a regular STIR array
+  template <int num_dimensions, typename elemT>
+    void get_numpy_dims(npy_intp * dims, const stir::Array<num_dimensions, elemT>& array)
+  {
+    stir::BasicCoordinate<num_dimensions,int> minind,maxind;
+    if (!array.get_regular_range(minind, maxind))
+      throw std::range_error("conversion to numpy called on irregular array");
+    for (int d=1; d<=num_dimensions; ++d)
+      dims[d-1] = static_cast<npy_intp>(maxind[d]-minind[d]+1);
+  }
+
+  // create a numpy array that uses existing data (no copy)
+  // The numpy array keeps a reference to owner, which therefore stays alive while the numpy array exists.
+  template <typename elemT>
+    PyObject * numpy_view_of_data(const int num_dimensions, npy_intp * dims, elemT * data_ptr, PyObject * owner)
+  {
+    PyObject * np = PyArray_SimpleNewFromData(num_dimensions, dims, numpy_type_num<elemT>(), data_ptr);
+    if (np == NULL)
+      throw std::runtime_error("Error creating numpy array");
+    Py_INCREF(owner);
+    // note: this steals the reference to owner, even on failure
+    if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject *>(np), owner) != 0)
+      {
+        Py_DECREF(np);
+        throw std::runtime_error("Error setting base of numpy array");
+      }
+    return np;
+  }
+
+  // create a numpy array that uses the memory of a contiguous STIR array (no copy)
+  template <int num_dimensions, typename elemT>
+    PyObject * numpy_view_of_Array(stir::Array<num_dimensions, elemT>& array, PyObject * owner)
+  {
+    if (!array.is_contiguous())
+      throw std::runtime_error("as_numpy() called on an array that is not contiguous in memory. Use to_numpy() instead.");
+    npy_intp dims[num_dimensions];
+    get_numpy_dims(dims, array);
+    elemT * data_ptr = array.get_full_data_ptr();
+    array.release_full_data_ptr();
+    return numpy_view_of_data(num_dimensions, dims, data_ptr, owner);
+  }
+
+  // create a numpy array with a copy of a STIR array
+  // This avoids iterating in Python, and uses a single memory copy if the STIR array is contiguous.
+  template <int num_dimensions, typename elemT>
+    PyObject * numpy_copy_of_Array(const stir::Array<num_dimensions, elemT>& array)
+  {
+    npy_intp dims[num_dimensions];
+    get_numpy_dims(dims, array);
+    PyObject * np = PyArray_SimpleNew(num_dimensions, dims, numpy_type_num<elemT>());
+    if (np == NULL)
+      throw std::runtime_error("Error creating numpy array");
+    stir::copy_to(array, static_cast<elemT *>(PyArray_DATA(reinterpret_cast<PyArrayObject *>(np))));
+    return np;
+  }
+
+  // numpy dimensions for projection data, see create_array_for_proj_data
+  inline void get_numpy_dims(npy_intp * dims, const ProjData& proj_data)
+  {
+    dims[0] = proj_data.get_num_tof_poss();
+    dims[1] = proj_data.get_num_non_tof_sinograms();
+    dims[2] = proj_data.get_num_views();
+    dims[3] = proj_data.get_num_tangential_poss();
+  }
+
+  // create a numpy array that uses the memory of the projection data (no copy)
+  // The order of the elements is the same as for ProjData::copy_to()
+  inline PyObject * numpy_view_of_ProjDataInMemory(ProjDataInMemory& proj_data, PyObject * owner)
+  {
+    npy_intp dims[4];
+    get_numpy_dims(dims, proj_data);
+    float * data_ptr = proj_data.get_data_ptr();
+    proj_data.release_data_ptr();
+    return numpy_view_of_data(4, dims, data_ptr, owner);
+  }
+
+  // create a 4D numpy array with a copy of the projection data (without an intermediate stir::Array)
+  inline PyObject * numpy_copy_of_ProjData(const ProjData& proj_data)
+  {
+    npy_intp dims[4];
+    get_numpy_dims(dims, proj_data);
+    PyObject * np = PyArray_SimpleNew(4, dims, NPY_FLOAT);
+    if (np == NULL)
+      throw std::runtime_error("Error creating numpy array");
+    stir::copy_to(proj_data, static_cast<float *>(PyArray_DATA(reinterpret_cast<PyArrayObject *>(np))));
+    return np;
+  }
+
+  // fill a STIR object from a Python object that supports the buffer protocol (e.g. a numpy array) in a single copy
+  // returns false if arg does not provide a C-contiguous buffer, such that the caller can try something else
+  template <typename STIRObjectT>
+    bool fill_from_Python_buffer(STIRObjectT& stir_object, const std::size_t size_all, PyObject * const arg)
+  {
+    if (!PyObject_CheckBuffer(arg))
+      return false;
+    Py_buffer view;
+    if (PyObject_GetBuffer(arg, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0)
+      {
+        // for instance not contiguous
+        PyErr_Clear();
+        return false;
+      }
+    std::string format(view.format ? view.format : "B");
+    // remove native byte-order/alignment characters
+    if (format.size() == 2 && (format[0] == '@' || format[0] == '='))
+      format = format.substr(1);
+    const std::size_t num_elements = view.itemsize > 0 ? static_cast<std::size_t>(view.len / view.itemsize) : 0;
+    if (num_elements != size_all)
+      {
+        PyBuffer_Release(&view);
+        throw std::runtime_error("fill() called with a buffer with an incorrect number of elements");
+      }
+    if (format == "f" && view.itemsize == sizeof(float))
+      {
+        const float * data_ptr = static_cast<const float *>(view.buf);
+        stir::fill_from(stir_object, data_ptr, data_ptr + num_elements);
+      }
+    else if (format == "d" && view.itemsize == sizeof(double))
+      {
+        const double * data_ptr = static_cast<const double *>(view.buf);
+        stir::fill_from(stir_object, data_ptr, data_ptr + num_elements);
+      }
+    else
+      {
+        PyBuffer_Release(&view);
+        return false;
+      }
+    PyBuffer_Release(&view);
+    return true;
+  }
 
 #endif
   static Array<4,float> create_array_for_proj_data(const ProjData& proj_data)
@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2011-07-01 - 2012, Kris Thielemans
-    Copyright (C) 2013, 2014, 2015, 2018 - 2022 University College London
+    Copyright (C) 2013, 2014, 2015, 2018 - 2022, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -143,10 +143,28 @@ namespace stir
       return swigstir::tuple_from_coord(sizes);
     }
 
-    %feature("autodoc", "fill from a Python iterator, e.g. array.fill(numpyarray.flat)") fill;
+    %feature("autodoc", "return a numpy array that shares memory with this (contiguous) array, e.g. array.as_numpy(). "
+             "Changes to one will be visible in the other. Do not resize the array while the numpy array is in use.") as_numpy;
+    PyObject* as_numpy(PyObject **PYTHON_SELF)
+    {
+      return swigstir::numpy_view_of_Array(*$self, *PYTHON_SELF);
+    }
+
+    %feature("autodoc", "return a copy of the array as a numpy array, e.g. array.to_numpy()") to_numpy;
+    PyObject* to_numpy()
+    {
+      return swigstir::numpy_copy_of_Array(*$self);
+    }
+
+    %feature("autodoc", "fill from a numpy array (or other object supporting the buffer protocol) or a Python iterator, "
+             "e.g. array.fill(numpyarray) or array.fill(numpyarray.flat)") fill;
     void fill(PyObject* const arg)
     {
-      if (PyIter_Check(arg))
+      if (swigstir::fill_from_Python_buffer(*$self, $self->size_all(), arg))
+      {
+        // done
+      }
+      else if (PyIter_Check(arg))
       {
 	swigstir::fill_Array_from_Python_iterator($self, arg);
       }
@@ -161,6 +179,24 @@ namespace stir
   }
 #endif
 
+#ifdef SWIGPYTHON
+  // repeat the numpy conversions for 1D due to template (partial) specialisation
+  %extend Array<1,float> {
+    %feature("autodoc", "return a numpy array that shares memory with this array, e.g. array.as_numpy(). "
+             "Changes to one will be visible in the other. Do not resize the array while the numpy array is in use.") as_numpy;
+    PyObject* as_numpy(PyObject **PYTHON_SELF)
+    {
+      return swigstir::numpy_view_of_Array(*$self, *PYTHON_SELF);
+    }
+
+    %feature("autodoc", "return a copy of the array as a numpy array, e.g. array.to_numpy()") to_numpy;
+    PyObject* to_numpy()
+    {
+      return swigstir::numpy_copy_of_Array(*$self);
+    }
+  }
+#endif
+
   %extend Array{
     %feature("autodoc", "return number of dimensions in the array") get_num_dimensions;
     int get_num_dimensions()
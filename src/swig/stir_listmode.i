@@ -27,6 +27,8 @@
 %include "stir/listmode/CListRecord.h" // currently also contains CListEvent
 
 %rename (get_empty_record) *::get_empty_record_sptr;
+// uses C arrays of records and bins
+%ignore *::get_bins_for_records;
 
 %rename (set_template_proj_data_info) *::set_template_proj_data_info_sptr;
 %shared_ptr(stir::LmToProjData);
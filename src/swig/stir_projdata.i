@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2011-07-01 - 2012, Kris Thielemans
-    Copyright (C) 2013, 2014, 2015, 2018 - 2022, 2023 University College London
+    Copyright (C) 2013, 2014, 2015, 2018 - 2023, 2026 University College London
     Copyright (C) 2022 National Physical Laboratory
     This file is part of STIR.
 
@@ -154,10 +154,22 @@ namespace stir {
       return array;
     }
 
-    %feature("autodoc", "fill from a Python iterator, e.g. proj_data.fill(numpyarray.flat)") fill;
+    %feature("autodoc", "return a copy of the projection data as a 4D numpy array (TOF, sinogram, view, tangential position), "
+             "in the same order as to_array()") to_numpy;
+    PyObject* to_numpy()
+    {
+      return swigstir::numpy_copy_of_ProjData(*$self);
+    }
+
+    %feature("autodoc", "fill from a numpy array (or other object supporting the buffer protocol) or a Python iterator, "
+             "e.g. proj_data.fill(numpyarray) or proj_data.fill(numpyarray.flat)") fill;
     void fill(PyObject* const arg)
     {
-      if (PyIter_Check(arg))
+      if (swigstir::fill_from_Python_buffer(*$self, $self->size_all(), arg))
+      {
+        // done
+      }
+      else if (PyIter_Check(arg))
       {
         // TODO avoid need for copy to Array
         Array<4,float> array = swigstir::create_array_for_proj_data(*$self);
@@ -195,10 +207,22 @@ namespace stir {
 %extend ProjDataInMemory
   {
 #ifdef SWIGPYTHON
-    %feature("autodoc", "fill from a Python iterator, e.g. proj_data.fill(numpyarray.flat)") fill;
+    %feature("autodoc", "return a 4D numpy array that shares memory with the projection data, e.g. proj_data.as_numpy(). "
+             "The shape and order are as for to_numpy(). Changes to one will be visible in the other.") as_numpy;
+    PyObject* as_numpy(PyObject **PYTHON_SELF)
+    {
+      return swigstir::numpy_view_of_ProjDataInMemory(*$self, *PYTHON_SELF);
+    }
+
+    %feature("autodoc", "fill from a numpy array (or other object supporting the buffer protocol) or a Python iterator, "
+             "e.g. proj_data.fill(numpyarray) or proj_data.fill(numpyarray.flat)") fill;
     void fill(PyObject* const arg)
     {
-      if (PyIter_Check(arg))
+      if (swigstir::fill_from_Python_buffer(*$self, $self->size_all(), arg))
+      {
+        // done
+      }
+      else if (PyIter_Check(arg))
       {
         Array<4,float> array = swigstir::create_array_for_proj_data(*$self);
 	swigstir::fill_Array_from_Python_iterator(&array, arg);
@@ -4,7 +4,7 @@
 #     py.test test_numpy.py
 
 
-#    Copyright (C) 2013, 2015 University College London
+#    Copyright (C) 2013, 2015, 2026 University College London
 #    This file is part of STIR.
 #
 #    SPDX-License-Identifier: Apache-2.0
@@ -79,3 +79,37 @@ def test_ProjData():
     seg0=stirextra.to_numpy(projdata.get_segment_by_sinogram(0))
     assert(seg0.max() == 2)
 
+def test_Array3D_as_numpy():
+    minind=Int3BasicCoordinate((3,3,5));
+    a=FloatArray3D(IndexRange3D(minind, Int3BasicCoordinate((9,8,7))))
+    a.fill(2);
+    np=a.as_numpy()
+    assert np.shape==a.shape()
+    # np shares memory with a
+    np[(0,0,1)]=5
+    ind=Int3BasicCoordinate((3,3,6));
+    assert a[ind]==5
+    a[ind]=6
+    assert np[(0,0,1)]==6
+    # to_numpy makes a copy
+    npcopy=a.to_numpy()
+    npcopy+=1
+    assert a[ind]==6
+    # fill from numpy array (float32 and float64)
+    a.fill(npcopy)
+    assert a[ind]==7
+    a.fill(npcopy.astype('float64')*2)
+    assert a[ind]==14
+
+def test_ProjDataInMemory_as_numpy():
+    s=Scanner.get_scanner_from_name("ECAT 962")
+    projdatainfo=ProjDataInfo.construct_proj_data_info(s,3,9,8,6)
+    projdata=ProjDataInMemory(ExamInfo(), projdatainfo)
+    np=projdata.as_numpy()
+    np+=2
+    seg0=stirextra.to_numpy(projdata.get_segment_by_sinogram(0))
+    assert(seg0.max() == 2)
+    npcopy=projdata.to_numpy()
+    assert (npcopy==np).all()
+    projdata.fill(npcopy*3)
+    assert(np.max() == 6)
@@ -27,6 +27,7 @@
 #include "stir/numerics/fourier.h"
 #include <iostream>
 #include <algorithm>
+#include <vector>
 
 using std::cin;
 using std::cout;
@@ -67,6 +68,27 @@ public:
 private:
   template <int num_dimensions>
   void test_single_dimension(const IndexRange<num_dimensions>& index_range);
+  //! check that set_fourier_backend() changes the implementation used
+  void test_backend();
+};
+
+//! A (slow) backend that computes the DFT directly from its definition
+class FourierBackendUsingDefinition : public FourierBackend
+{
+public:
+  FourierBackendUsingDefinition()
+      : num_calls(0)
+  {}
+  void fourier_1d(std::complex<float>* c, const int length, const int sign) const override
+  {
+    ++num_calls;
+    std::vector<std::complex<double>> result(length);
+    for (int s = 0; s < length; ++s)
+      for (int r = 0; r < length; ++r)
+        result[s] += std::complex<double>(c[r]) * std::polar(1., sign * 2 * _PI * r * s / length);
+    std::copy(result.begin(), result.end(), c);
+  }
+  mutable int num_calls;
 };
 
 template <int num_dimensions>
@@ -119,6 +141,30 @@ FourierTests::test_single_dimension(const IndexRange<num_dimensions>& index_rang
        << norm(complex_array.begin_all(), complex_array.end_all()) / norm(array_copy.begin_all(), array_copy.end_all());
 }
 
+void
+FourierTests::test_backend()
+{
+  ArrayC2 array(IndexRange2D(8, 16));
+  for (ArrayC2::full_iterator iter = array.begin_all(); iter != array.end_all(); ++iter)
+    *iter = std::complex<float>(rand1(), rand1());
+  ArrayC2 array_using_definition(array);
+  fourier(array);
+
+  const shared_ptr<FourierBackendUsingDefinition> backend_sptr(new FourierBackendUsingDefinition);
+  set_fourier_backend(backend_sptr);
+  check(&get_fourier_backend() == backend_sptr.get(), "get_fourier_backend() after set_fourier_backend()");
+  fourier(array_using_definition);
+  set_fourier_backend(shared_ptr<const FourierBackend>());
+  check(&get_fourier_backend() != backend_sptr.get(), "get_fourier_backend() after resetting the backend");
+
+  // the backend is used for the inner dimension only
+  check_if_equal(backend_sptr->num_calls, array.get_length(), "number of calls to the backend");
+  array_using_definition -= array;
+  check_if_zero(norm(array_using_definition.begin_all(), array_using_definition.end_all())
+                    / norm(array.begin_all(), array.end_all()),
+                "comparing DFT using the definition with the FFT");
+}
+
 void
 FourierTests::run_tests()
 {
@@ -130,6 +176,8 @@ FourierTests::run_tests()
   test_single_dimension(IndexRange2D(128, 256));
   std::cerr << "... Testing 3D\n";
   test_single_dimension(IndexRange3D(128, 256, 16));
+  std::cerr << "... Testing the backend\n";
+  test_backend();
 }
 
 END_NAMESPACE_STIR
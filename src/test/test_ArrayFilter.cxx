@@ -33,6 +33,7 @@
 #include "stir/stream.h" //XXX
 #include <iostream>
 #include <algorithm>
+#include <vector>
 #include <boost/static_assert.hpp>
 
 #ifdef DO_TIMINGS
@@ -202,6 +203,22 @@ ArrayFilterTests::run_tests()
       std::cerr << "Comparing DFT and Convolution with input positive offset\n";
       compare_results_2arg(DFT_filter, conv_filter, test_pos_offset);
       compare_results_1arg(DFT_filter, conv_filter, test_pos_offset);
+
+      std::cerr << "Comparing DFT apply_to_each with filtering every row\n";
+      {
+        Array<2, float> rows(IndexRange2D(-1, 1, test_neg_offset.get_min_index(), test_neg_offset.get_max_index()));
+        for (int r = rows.get_min_index(); r <= rows.get_max_index(); ++r)
+          {
+            rows[r] = test_neg_offset;
+            rows[r] *= static_cast<float>(r + 2);
+          }
+        Array<2, float> filtered_rows = rows;
+        for (int r = rows.get_min_index(); r <= rows.get_max_index(); ++r)
+          DFT_filter(filtered_rows[r]);
+        DFT_filter.apply_to_each(rows);
+        set_tolerance(test.find_max() * kernel_for_conv.sum() * 3.E-6);
+        check_if_equal(rows, filtered_rows, "apply_to_each should give the same result as filtering every row");
+      }
     }
     {
       const int kernel_half_length = 30;
@@ -359,6 +376,18 @@ ArrayFilterTests::run_tests()
       std::cerr << "Comparing DFT and Convolution with input positive offset\n";
       compare_results_2arg(DFT_filter, conv_filter, test_pos_offset);
       compare_results_1arg(DFT_filter, conv_filter, test_pos_offset);
+
+      std::cerr << "Comparing DFT apply_to_each on a range of arrays with Convolution\n";
+      {
+        std::vector<Array<2, float>> arrays{ test, test_neg_offset, test_pos_offset };
+        std::vector<Array<2, float>> conv_arrays = arrays;
+        DFT_filter.apply_to_each(arrays.begin(), arrays.end());
+        for (std::size_t i = 0; i < arrays.size(); ++i)
+          {
+            conv_filter(conv_arrays[i]);
+            check_if_equal(arrays[i], conv_arrays[i], "apply_to_each on range, array " + std::to_string(i));
+          }
+      }
     }
   }
   std::cerr << "\nTesting 3D\n";
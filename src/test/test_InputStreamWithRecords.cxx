@@ -0,0 +1,194 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup test
+  \ingroup IO
+
+  \brief Test program for stir::InputStreamWithRecords
+*/
+
+#include "stir/IO/InputStreamWithRecords.h"
+#include "stir/RunTests.h"
+#include "stir/Succeeded.h"
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+START_NAMESPACE_STIR
+
+//! A record where the first byte gives the size of the record
+class TestRecordWithSize
+{
+public:
+  std::size_t size_of_record_at_ptr(const char* const buffer, const std::size_t, const bool) const
+  {
+    return static_cast<unsigned char>(buffer[0]);
+  }
+
+  Succeeded init_from_data_ptr(const char* const buffer, const std::size_t size_of_record, const bool)
+  {
+    data.assign(buffer, buffer + size_of_record);
+    return Succeeded::yes;
+  }
+
+  std::string data;
+};
+
+/*!
+  \ingroup test
+  \brief Test class for InputStreamWithRecords
+
+  Writes records of different sizes to a stream, and checks that they are read back correctly,
+  for several sizes of the blocks that are read from the stream (such that records span 2 blocks).
+*/
+class InputStreamWithRecordsTests : public RunTests
+{
+public:
+  void run_tests() override;
+
+private:
+  typedef InputStreamWithRecords<TestRecordWithSize, bool> InputStreamT;
+
+  static constexpr std::size_t max_size_of_record = 10;
+  //! garbage at the start of the stream, which should be skipped
+  static constexpr std::size_t size_of_header = 3;
+
+  std::vector<std::string> records;
+  //! position of every record in the stream
+  std::vector<std::streamoff> offsets;
+  std::string stream_contents;
+
+  void create_records();
+  void run_tests_for_buffer_size(const std::size_t buffer_size, const bool read_ahead);
+  shared_ptr<InputStreamT> create_input_stream(const std::string& contents) const;
+};
+
+void
+InputStreamWithRecordsTests::create_records()
+{
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> size_distribution(1, static_cast<int>(max_size_of_record));
+  stream_contents = std::string(size_of_header, 'h');
+  for (int i = 0; i < 1000; ++i)
+    {
+      const int size_of_record = size_distribution(generator);
+      std::string record(1, static_cast<char>(size_of_record));
+      for (int j = 1; j < size_of_record; ++j)
+        record += static_cast<char>(i + j);
+      offsets.push_back(static_cast<std::streamoff>(stream_contents.size()));
+      records.push_back(record);
+      stream_contents += record;
+    }
+}
+
+shared_ptr<InputStreamWithRecordsTests::InputStreamT>
+InputStreamWithRecordsTests::create_input_stream(const std::string& contents) const
+{
+  shared_ptr<std::istream> stream_sptr(new std::istringstream(contents, std::ios::in | std::ios::binary));
+  stream_sptr->seekg(size_of_header);
+  return std::make_shared<InputStreamT>(stream_sptr, 1, max_size_of_record, false);
+}
+
+void
+InputStreamWithRecordsTests::run_tests_for_buffer_size(const std::size_t buffer_size, const bool read_ahead)
+{
+  const std::string str
+      = "buffer size " + std::to_string(buffer_size) + (read_ahead ? ", with read-ahead" : ", without read-ahead") + ": ";
+  shared_ptr<InputStreamT> input_sptr = create_input_stream(stream_contents);
+  input_sptr->set_buffer_size(buffer_size);
+  input_sptr->set_read_ahead(read_ahead);
+  TestRecordWithSize record;
+
+  // read all records, saving some positions
+  std::vector<InputStreamT::SavedPosition> saved_positions;
+  std::vector<std::size_t> record_nums_at_saved_positions;
+  for (std::size_t i = 0; i < records.size(); ++i)
+    {
+      // switching read-ahead on or off should not change the records
+      if (i == records.size() / 2)
+        input_sptr->set_read_ahead(!read_ahead);
+      if (i == 3 * records.size() / 4)
+        input_sptr->set_read_ahead(read_ahead);
+      if (i % 97 == 0)
+        {
+          saved_positions.push_back(input_sptr->save_get_position());
+          record_nums_at_saved_positions.push_back(i);
+        }
+      if (!check(input_sptr->get_next_record(record) == Succeeded::yes, str + "get_next_record")
+          || !check_if_equal(record.data, records[i], str + "record " + std::to_string(i)))
+        return;
+    }
+  check(input_sptr->get_next_record(record) == Succeeded::no, str + "get_next_record at the end of the stream");
+  const InputStreamT::SavedPosition eof_position = input_sptr->save_get_position();
+
+  // saved positions should be positions in the stream
+  {
+    const std::vector<std::streampos> positions = input_sptr->get_saved_get_positions();
+    for (std::size_t p = 0; p < record_nums_at_saved_positions.size(); ++p)
+      check_if_equal(std::streamoff(positions[saved_positions[p]]),
+                     offsets[record_nums_at_saved_positions[p]],
+                     str + "saved position");
+    check_if_equal(std::streamoff(positions[eof_position]), std::streamoff(-1), str + "saved position at the end of the stream");
+  }
+
+  // go back to the saved positions in reverse order
+  for (std::size_t p = saved_positions.size(); p-- > 0;)
+    {
+      check(input_sptr->set_get_position(saved_positions[p]) == Succeeded::yes, str + "set_get_position");
+      const std::size_t end_record_num = std::min(record_nums_at_saved_positions[p] + 150, records.size());
+      for (std::size_t i = record_nums_at_saved_positions[p]; i < end_record_num; ++i)
+        {
+          if (!check(input_sptr->get_next_record(record) == Succeeded::yes, str + "get_next_record after set_get_position")
+              || !check_if_equal(record.data, records[i], str + "record after set_get_position"))
+            return;
+        }
+    }
+
+  check(input_sptr->set_get_position(eof_position) == Succeeded::yes, str + "set_get_position at the end of the stream");
+  check(input_sptr->get_next_record(record) == Succeeded::no, str + "get_next_record after set_get_position at the end");
+
+  check(input_sptr->reset() == Succeeded::yes, str + "reset");
+  check(input_sptr->get_next_record(record) == Succeeded::yes, str + "get_next_record after reset");
+  check_if_equal(record.data, records[0], str + "first record after reset");
+
+  // the last record is incomplete
+  {
+    shared_ptr<InputStreamT> truncated_input_sptr = create_input_stream(stream_contents.substr(0, stream_contents.size() - 1));
+    truncated_input_sptr->set_buffer_size(buffer_size);
+    truncated_input_sptr->set_read_ahead(read_ahead);
+    std::size_t num_records_read = 0;
+    while (truncated_input_sptr->get_next_record(record) == Succeeded::yes)
+      ++num_records_read;
+    check_if_equal(num_records_read, records.size() - 1, str + "number of records in truncated stream");
+  }
+}
+
+void
+InputStreamWithRecordsTests::run_tests()
+{
+  create_records();
+  for (const bool read_ahead : { true, false })
+    for (const std::size_t buffer_size : { std::size_t(1), std::size_t(7), std::size_t(64), InputStreamT::default_buffer_size })
+      run_tests_for_buffer_size(buffer_size, read_ahead);
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  InputStreamWithRecordsTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
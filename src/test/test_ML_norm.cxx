@@ -11,7 +11,7 @@
   \author daniel deidda
 */
 /*
-    Copyright (C) 2021, University College London
+    Copyright (C) 2021, 2026, University College London
     Copyright (C) 2022, National Physical Laboratory
     This file is part of STIR.
 
@@ -122,6 +122,42 @@ ML_normTests::test_proj_data_info(shared_ptr<TProjDataInfo> proj_data_info_sptr)
 
   FanProjData fan_data;
   make_fan_data_remove_gaps(fan_data, proj_data);
+  {
+    // test FanProjDataAccumulator, using bins with different values
+    ProjDataInMemory varied_proj_data(proj_data);
+    const int half_fan_size
+        = std::min(proj_data_info_sptr->get_max_tangential_pos_num(), -proj_data_info_sptr->get_min_tangential_pos_num());
+    FanProjData accumulated_fan_data;
+    FanProjDataAccumulator accumulator(accumulated_fan_data, *proj_data_info_sptr);
+    Bin bin;
+    for (bin.segment_num() = proj_data.get_min_segment_num(); bin.segment_num() <= proj_data.get_max_segment_num();
+         ++bin.segment_num())
+      for (bin.axial_pos_num() = proj_data.get_min_axial_pos_num(bin.segment_num());
+           bin.axial_pos_num() <= proj_data.get_max_axial_pos_num(bin.segment_num());
+           ++bin.axial_pos_num())
+        for (bin.view_num() = proj_data.get_min_view_num(); bin.view_num() <= proj_data.get_max_view_num(); ++bin.view_num())
+          for (bin.tangential_pos_num() = -half_fan_size; bin.tangential_pos_num() <= half_fan_size; ++bin.tangential_pos_num())
+            {
+              bin.set_bin_value(static_cast<float>(1 + bin.view_num() + 3 * bin.tangential_pos_num() + 7 * bin.axial_pos_num()
+                                                   + 11 * bin.segment_num()));
+              varied_proj_data.set_bin_value(bin);
+              accumulator.add(bin, bin.get_bin_value());
+            }
+    FanProjData varied_fan_data;
+    make_fan_data_remove_gaps(varied_fan_data, varied_proj_data);
+    check_if_equal(accumulated_fan_data.get_num_rings(), varied_fan_data.get_num_rings(), "FanProjDataAccumulator: num_rings");
+    check_if_equal(accumulated_fan_data.get_num_detectors_per_ring(),
+                   varied_fan_data.get_num_detectors_per_ring(),
+                   "FanProjDataAccumulator: num_detectors_per_ring");
+    double sum_of_squared_differences = 0;
+    for (int ra = varied_fan_data.get_min_ra(); ra <= varied_fan_data.get_max_ra(); ++ra)
+      for (int a = varied_fan_data.get_min_a(); a <= varied_fan_data.get_max_a(); ++a)
+        for (int rb = varied_fan_data.get_min_rb(ra); rb <= varied_fan_data.get_max_rb(ra); ++rb)
+          for (int b = varied_fan_data.get_min_b(a); b <= varied_fan_data.get_max_b(a); ++b)
+            sum_of_squared_differences
+                += square(static_cast<double>(accumulated_fan_data(ra, a, rb, b) - varied_fan_data(ra, a, rb, b)));
+    check_if_zero(sum_of_squared_differences, "FanProjDataAccumulator vs make_fan_data_remove_gaps");
+  }
   {
     ProjDataInMemory proj_data2(proj_data);
     proj_data2.fill(0.F);
@@ -0,0 +1,219 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup test
+
+  \brief Test program for ListModeData::get_bins_for_records() and the decoders of the list-mode records
+*/
+
+#include "stir/listmode/CListRecordECAT8_32bit.h"
+#include "stir/listmode/CListRecordSAFIR.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/Scanner.h"
+#include "stir/Bin.h"
+#include "stir/RunTests.h"
+#include <boost/format.hpp>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for finding the bins of many list-mode records in one go
+
+  Creates records with random (raw) data, and checks that the batched decoders used by
+  ListModeData::get_bins_for_records() give the same bins as ListEvent::get_bin() for every event,
+  and leave the bins of records that are not events untouched.
+*/
+class ListModeGetBinsTests : public RunTests
+{
+public:
+  void run_tests() override;
+
+private:
+  void test_ECAT8_32bit();
+  void test_SAFIR();
+
+  //! Compare with ListEvent::get_bin() for every record
+  void check_bins(const std::vector<shared_ptr<CListRecord>>& records,
+                  const std::vector<Bin>& bins,
+                  const ProjDataInfo& proj_data_info,
+                  const std::string& str);
+  //! Fills the bins with a value that the decoders do not use
+  static std::vector<Bin> get_initial_bins(const std::size_t num_records);
+  static std::vector<const ListRecord*> get_record_ptrs(const std::vector<shared_ptr<CListRecord>>& records);
+
+  std::mt19937 generator;
+};
+
+std::vector<Bin>
+ListModeGetBinsTests::get_initial_bins(const std::size_t num_records)
+{
+  return std::vector<Bin>(num_records, Bin(0, 0, 0, 0, 0, 123.F));
+}
+
+std::vector<const ListRecord*>
+ListModeGetBinsTests::get_record_ptrs(const std::vector<shared_ptr<CListRecord>>& records)
+{
+  std::vector<const ListRecord*> record_ptrs;
+  for (const auto& record_sptr : records)
+    record_ptrs.push_back(record_sptr.get());
+  return record_ptrs;
+}
+
+void
+ListModeGetBinsTests::check_bins(const std::vector<shared_ptr<CListRecord>>& records,
+                                 const std::vector<Bin>& bins,
+                                 const ProjDataInfo& proj_data_info,
+                                 const std::string& str)
+{
+  int num_events = 0;
+  int num_events_in_range = 0;
+  for (std::size_t i = 0; i < records.size(); ++i)
+    {
+      const ListRecord& record = *records[i];
+      if (!record.is_event())
+        {
+          check_if_equal(bins[i].get_bin_value(), 123.F, str + ": bin of record that is not an event should not be modified");
+          continue;
+        }
+      ++num_events;
+      Bin bin;
+      record.event().get_bin(bin, proj_data_info);
+      if (!check_if_equal(bins[i].get_bin_value(), bin.get_bin_value(), str + ": bin value"))
+        break;
+      if (bin.get_bin_value() <= 0)
+        continue;
+      ++num_events_in_range;
+      check_if_equal(bins[i].segment_num(), bin.segment_num(), str + ": segment");
+      check_if_equal(bins[i].view_num(), bin.view_num(), str + ": view");
+      check_if_equal(bins[i].axial_pos_num(), bin.axial_pos_num(), str + ": axial position");
+      check_if_equal(bins[i].tangential_pos_num(), bin.tangential_pos_num(), str + ": tangential position");
+      check_if_equal(bins[i].timing_pos_num(), bin.timing_pos_num(), str + ": timing position");
+      if (!is_everything_ok())
+        break;
+    }
+  check(num_events > 0, str + ": there should be events");
+  check(num_events_in_range > 0, str + ": there should be events in the projection data");
+}
+
+void
+ListModeGetBinsTests::test_ECAT8_32bit()
+{
+  std::cerr << "Testing ECAT8_32bit records\n";
+  auto scanner_sptr = std::make_shared<Scanner>(Scanner::Siemens_mMR);
+  shared_ptr<const ProjDataInfo> lm_proj_data_info_sptr(
+      ProjDataInfo::construct_proj_data_info(scanner_sptr,
+                                             1,
+                                             scanner_sptr->get_num_rings() - 1,
+                                             scanner_sptr->get_num_detectors_per_ring() / 2,
+                                             scanner_sptr->get_max_num_non_arccorrected_bins(),
+                                             /* arc_correction */ false));
+  const std::uint32_t num_offsets = static_cast<std::uint32_t>(lm_proj_data_info_sptr->size_all());
+
+  const std::size_t num_records = 10000;
+  std::uniform_int_distribution<std::uint32_t> offset_distribution(0, num_offsets - 1);
+  // copy the records from one prototype, such that they share their (uncompressed) projection data info
+  const ecat::CListRecordECAT8_32bit prototype_record(lm_proj_data_info_sptr);
+  std::vector<shared_ptr<CListRecord>> records(num_records);
+  for (std::size_t i = 0; i < num_records; ++i)
+    {
+      // every 10th record is a time record, and every other event a delayed
+      const std::uint32_t raw = i % 10 == 0 ? (1U << 31) | static_cast<std::uint32_t>(i)
+                                            : offset_distribution(generator) | static_cast<std::uint32_t>(i % 2) << 30;
+      char data[4];
+      std::memcpy(data, &raw, 4);
+      auto record_sptr = std::make_shared<ecat::CListRecordECAT8_32bit>(prototype_record);
+      record_sptr->init_from_data_ptr(data, 4, false);
+      records[i] = record_sptr;
+    }
+  const std::vector<const ListRecord*> record_ptrs = get_record_ptrs(records);
+
+  // also test with compressed projection data
+  shared_ptr<const ProjDataInfo> compressed_proj_data_info_sptr(
+      ProjDataInfo::construct_proj_data_info(scanner_sptr,
+                                             11,
+                                             scanner_sptr->get_num_rings() - 1,
+                                             scanner_sptr->get_num_detectors_per_ring() / 4,
+                                             scanner_sptr->get_max_num_non_arccorrected_bins() - 20,
+                                             /* arc_correction */ false));
+  for (const auto& proj_data_info_sptr : { lm_proj_data_info_sptr, compressed_proj_data_info_sptr })
+    {
+      const std::string str
+          = proj_data_info_sptr == lm_proj_data_info_sptr ? "ECAT8_32bit, uncompressed" : "ECAT8_32bit, compressed";
+      std::vector<Bin> bins = get_initial_bins(num_records);
+      CListEventCylindricalScannerWithDiscreteDetectors::get_bins_for_records<ecat::CListRecordECAT8_32bit,
+                                                                              ecat::CListEventECAT8_32bit>(
+          bins.data(), record_ptrs.data(), num_records, *proj_data_info_sptr);
+      check_bins(records, bins, *proj_data_info_sptr, str);
+    }
+}
+
+void
+ListModeGetBinsTests::test_SAFIR()
+{
+  std::cerr << "Testing SAFIR records\n";
+  typedef CListRecordSAFIR<CListEventDataSAFIR> RecordT;
+  auto scanner_sptr = std::make_shared<Scanner>(Scanner::SAFIRDualRingPrototype);
+  scanner_sptr->set_scanner_geometry("BlocksOnCylindrical");
+  scanner_sptr->set_up();
+  shared_ptr<const ProjDataInfo> proj_data_info_sptr(
+      ProjDataInfo::construct_proj_data_info(scanner_sptr,
+                                             1,
+                                             scanner_sptr->get_num_rings() - 1,
+                                             scanner_sptr->get_num_detectors_per_ring() / 2,
+                                             scanner_sptr->get_max_num_non_arccorrected_bins(),
+                                             /* arc_correction */ false));
+
+  const std::size_t num_records = 10000;
+  std::uniform_int_distribution<std::uint64_t> ring_distribution(0, scanner_sptr->get_num_rings() - 1);
+  std::uniform_int_distribution<std::uint64_t> det_distribution(0, scanner_sptr->get_num_detectors_per_ring() - 1);
+  std::vector<shared_ptr<CListRecord>> records(num_records);
+  for (std::size_t i = 0; i < num_records; ++i)
+    {
+      // every 10th record is a time record
+      const std::uint64_t raw = i % 10 == 0 ? (std::uint64_t(1) << 63) | static_cast<std::uint64_t>(i)
+                                            : ring_distribution(generator) | ring_distribution(generator) << 8
+                                                  | det_distribution(generator) << 16 | det_distribution(generator) << 32;
+      char data[8];
+      std::memcpy(data, &raw, 8);
+      auto record_sptr = std::make_shared<RecordT>();
+      record_sptr->event_SAFIR().set_scanner_sptr(scanner_sptr);
+      record_sptr->init_from_data_ptr(data, 8, false);
+      records[i] = record_sptr;
+    }
+  const std::vector<const ListRecord*> record_ptrs = get_record_ptrs(records);
+
+  std::vector<Bin> bins = get_initial_bins(num_records);
+  RecordT::get_bins_for_records(bins.data(), record_ptrs.data(), num_records, *proj_data_info_sptr);
+  check_bins(records, bins, *proj_data_info_sptr, "SAFIR");
+}
+
+void
+ListModeGetBinsTests::run_tests()
+{
+  test_ECAT8_32bit();
+  test_SAFIR();
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  ListModeGetBinsTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -4,14 +4,14 @@
   \ingroup test
   \ingroup projdata
 
-  \brief Test program for stir::ProjData and stir::ProjDataInMemory
+  \brief Test program for stir::ProjData, stir::ProjDataInMemory and stir::ProjDataSparse
 
   \author Kris Thielemans
   \author Daniel Deidda
 
 */
 /*
-    Copyright (C) 2015, 2020, 2022, 2024 University College London
+    Copyright (C) 2015, 2020, 2022, 2024, 2026 University College London
     Copyright (C) 2020, National Physical Laboratory
     This file is part of STIR.
 
@@ -21,12 +21,17 @@
 */
 
 #include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataSparse.h"
 #include "stir/ProjDataInterfile.h"
 #include "stir/ExamInfo.h"
 #include "stir/ProjDataInfo.h"
 #include "stir/ProjDataInfoCylindricalArcCorr.h"
 #include "stir/Sinogram.h"
 #include "stir/Viewgram.h"
+#include "stir/RelatedViewgrams.h"
+#include "stir/RelatedViewgramsReadAhead.h"
+#include "stir/RelatedViewgramsWriteBehind.h"
+#include "stir/TrivialDataSymmetriesForViewSegmentNumbers.h"
 #include "stir/Succeeded.h"
 #include "stir/RunTests.h"
 #include "stir/Scanner.h"
@@ -36,6 +41,7 @@
 #include "stir/CPUTimer.h"
 #include <algorithm>
 #include <numeric>
+#include <thread>
 
 START_NAMESPACE_STIR
 
@@ -51,6 +57,14 @@ public:
 private:
   void run_tests_on_proj_data(ProjData&);
   void run_tests_in_memory_only(ProjDataInMemory&);
+  void run_tests_sparse_only(ProjDataSparse&);
+  //! write and read viewgrams from multiple threads
+  void run_tests_concurrent_access(ProjData&);
+  //! write and read single bins from multiple threads
+  void run_tests_concurrent_bin_access(ProjDataFromStream&);
+  //! read viewgrams from many threads that exit immediately, checking that their streams are closed
+  void run_tests_short_lived_threads(ProjDataFromStream&);
+  void run_tests_read_ahead_and_write_behind(const shared_ptr<ProjData>&);
 };
 
 void
@@ -403,6 +417,214 @@ ProjDataTests::run_tests_in_memory_only(ProjDataInMemory& proj_data)
   }
 }
 
+void
+ProjDataTests::run_tests_sparse_only(ProjDataSparse& proj_data)
+{
+  std::cerr << "\ntest ProjDataSparse with only a few non-zero bins\n";
+  proj_data.fill(0.F);
+  check_if_equal(proj_data.get_num_non_zeros(), std::size_t(0), "ProjDataSparse::fill(0) should remove all bins");
+
+  const int timing_pos_num = proj_data.get_max_tof_pos_num();
+  const int segment_num = proj_data.get_max_segment_num();
+  const int view_num = proj_data.get_max_view_num() / 2;
+  const int axial_pos_num = proj_data.get_max_axial_pos_num(segment_num) / 2;
+  {
+    Viewgram<float> viewgram = proj_data.get_empty_viewgram(view_num, segment_num, false, timing_pos_num);
+    viewgram[axial_pos_num][0] = 3.F;
+    viewgram[axial_pos_num][1] = -1.F;
+    viewgram[proj_data.get_min_axial_pos_num(segment_num)][proj_data.get_max_tangential_pos_num()] = 2.F;
+    check(proj_data.set_viewgram(viewgram) == Succeeded::yes, "ProjDataSparse::set_viewgram succeeded");
+  }
+  check_if_equal(proj_data.get_num_non_zeros(), std::size_t(3), "ProjDataSparse::get_num_non_zeros after set_viewgram");
+  check_if_equal(proj_data.sum(), 4.F, "ProjDataSparse::sum");
+  check_if_equal(proj_data.find_max(), 3.F, "ProjDataSparse::find_max");
+  check_if_equal(proj_data.find_min(), -1.F, "ProjDataSparse::find_min");
+  check_if_equal(proj_data.norm_squared(), 14., "ProjDataSparse::norm_squared");
+  check_if_equal(proj_data.get_bin_value(Bin(segment_num, view_num, axial_pos_num, 0, timing_pos_num)),
+                 3.F,
+                 "ProjDataSparse::get_bin_value of non-zero bin");
+  check_if_equal(proj_data.get_bin_value(Bin(segment_num, view_num, axial_pos_num, 2, timing_pos_num)),
+                 0.F,
+                 "ProjDataSparse::get_bin_value of zero bin");
+  {
+    float sum = 0.F;
+    int num_bins = 0;
+    proj_data.for_each_non_zero([&](const Bin& bin) {
+      sum += bin.get_bin_value();
+      ++num_bins;
+      check_if_equal(proj_data.get_bin_value(bin), bin.get_bin_value(), "ProjDataSparse::for_each_non_zero bin value");
+    });
+    check_if_equal(num_bins, 3, "ProjDataSparse::for_each_non_zero number of bins");
+    check_if_equal(sum, 4.F, "ProjDataSparse::for_each_non_zero sum");
+  }
+
+  std::cerr << "\ntest ProjDataSparse::set_sinogram\n";
+  {
+    Sinogram<float> sinogram = proj_data.get_sinogram(axial_pos_num, segment_num, false, timing_pos_num);
+    check_if_equal(sinogram[view_num][0], 3.F, "ProjDataSparse::get_sinogram");
+    // overwrite the bin at tangential_pos_num 0 and add another one
+    sinogram[view_num][0] = 0.F;
+    sinogram[proj_data.get_min_view_num()][0] = 5.F;
+    check(proj_data.set_sinogram(sinogram) == Succeeded::yes, "ProjDataSparse::set_sinogram succeeded");
+    check_if_equal(proj_data.get_num_non_zeros(), std::size_t(3), "ProjDataSparse::get_num_non_zeros after set_sinogram");
+    check_if_equal(proj_data.sum(), 6.F, "ProjDataSparse::sum after set_sinogram");
+    const Viewgram<float> viewgram = proj_data.get_viewgram(view_num, segment_num, false, timing_pos_num);
+    check_if_equal(viewgram[axial_pos_num][1], -1.F, "ProjDataSparse::set_sinogram should keep other bins");
+    check_if_equal(viewgram[proj_data.get_min_axial_pos_num(segment_num)][proj_data.get_max_tangential_pos_num()],
+                   2.F,
+                   "ProjDataSparse::set_sinogram should keep other axial positions");
+  }
+
+  std::cerr << "\ntest ProjDataSparse copy constructor\n";
+  {
+    ProjDataInMemory proj_data_in_memory(proj_data);
+    ProjDataSparse proj_data2(proj_data_in_memory);
+    check_if_equal(proj_data2.get_num_non_zeros(), proj_data.get_num_non_zeros(), "ProjDataSparse copy: number of bins");
+    check_if_equal(proj_data2.norm_squared(), proj_data_in_memory.norm_squared(), "ProjDataSparse copy: norm");
+  }
+}
+
+void
+ProjDataTests::run_tests_concurrent_access(ProjData& proj_data)
+{
+  std::cerr << "\ntest concurrent set_viewgram and get_viewgram\n";
+  const int min_view_num = proj_data.get_min_view_num();
+  const int num_views = proj_data.get_num_views();
+  bool all_succeeded = true;
+  for (int segment_num = proj_data.get_min_segment_num(); segment_num <= proj_data.get_max_segment_num(); ++segment_num)
+    {
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic) reduction(&& : all_succeeded)
+#endif
+      for (int view_num = min_view_num; view_num < min_view_num + num_views; ++view_num)
+        {
+          Viewgram<float> viewgram = proj_data.get_empty_viewgram(view_num, segment_num);
+          viewgram.fill(static_cast<float>(1000 * segment_num + view_num));
+          all_succeeded = all_succeeded && proj_data.set_viewgram(viewgram) == Succeeded::yes;
+        }
+    }
+  check(all_succeeded, "test concurrent set_viewgram succeeded");
+
+  for (int segment_num = proj_data.get_min_segment_num(); segment_num <= proj_data.get_max_segment_num(); ++segment_num)
+    {
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic) reduction(&& : all_succeeded)
+#endif
+      for (int view_num = min_view_num; view_num < min_view_num + num_views; ++view_num)
+        {
+          const Viewgram<float> viewgram = proj_data.get_viewgram(view_num, segment_num);
+          const float value = static_cast<float>(1000 * segment_num + view_num);
+          all_succeeded = all_succeeded && viewgram.find_min() == value && viewgram.find_max() == value;
+        }
+    }
+  check(all_succeeded, "test concurrent get_viewgram after concurrent set_viewgram");
+}
+
+void
+ProjDataTests::run_tests_concurrent_bin_access(ProjDataFromStream& proj_data)
+{
+  std::cerr << "\ntest concurrent set_bin_value and get_bin_value\n";
+  const int min_view_num = proj_data.get_min_view_num();
+  const int num_views = proj_data.get_num_views();
+  const int segment_num = 0;
+  const int axial_pos_num = proj_data.get_min_axial_pos_num(segment_num);
+  const int tangential_pos_num = proj_data.get_min_tangential_pos_num();
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int view_num = min_view_num; view_num < min_view_num + num_views; ++view_num)
+    {
+      Bin bin(segment_num, view_num, axial_pos_num, tangential_pos_num);
+      bin.set_bin_value(static_cast<float>(-view_num));
+      proj_data.set_bin_value(bin);
+    }
+  bool all_succeeded = true;
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic) reduction(&& : all_succeeded)
+#endif
+  for (int view_num = min_view_num; view_num < min_view_num + num_views; ++view_num)
+    {
+      const Bin bin(segment_num, view_num, axial_pos_num, tangential_pos_num);
+      all_succeeded = all_succeeded && proj_data.get_bin_value(bin) == static_cast<float>(-view_num);
+    }
+  check(all_succeeded, "test concurrent get_bin_value after concurrent set_bin_value");
+}
+
+void
+ProjDataTests::run_tests_short_lived_threads(ProjDataFromStream& proj_data)
+{
+  std::cerr << "\ntest get_viewgram from many short-lived threads\n";
+  const Viewgram<float> reference = proj_data.get_viewgram(proj_data.get_min_view_num(), 0);
+  const std::size_t num_streams_at_start = proj_data.get_num_streams_for_concurrent_access();
+  bool all_succeeded = true;
+  // more threads than the usual limit on the number of open files
+  for (int i = 0; i < 2000; ++i)
+    {
+      std::thread thread([&]() {
+        const Viewgram<float> viewgram = proj_data.get_viewgram(proj_data.get_min_view_num(), 0);
+        all_succeeded = all_succeeded && viewgram == reference;
+      });
+      thread.join();
+    }
+  check(all_succeeded, "test get_viewgram from short-lived threads");
+  check_if_equal(proj_data.get_num_streams_for_concurrent_access(),
+                 num_streams_at_start,
+                 "streams of threads that have exited should be closed");
+}
+
+void
+ProjDataTests::run_tests_read_ahead_and_write_behind(const shared_ptr<ProjData>& proj_data_sptr)
+{
+  std::cerr << "\ntest RelatedViewgramsWriteBehind and RelatedViewgramsReadAhead\n";
+  shared_ptr<DataSymmetriesForViewSegmentNumbers> symmetries_sptr(new TrivialDataSymmetriesForViewSegmentNumbers);
+  std::vector<ViewgramIndices> sequence;
+  for (int segment_num = proj_data_sptr->get_min_segment_num(); segment_num <= proj_data_sptr->get_max_segment_num();
+       ++segment_num)
+    for (int view_num = proj_data_sptr->get_min_view_num(); view_num <= proj_data_sptr->get_max_view_num(); ++view_num)
+      sequence.push_back(ViewgramIndices(view_num, segment_num));
+  const int num_viewgrams = static_cast<int>(sequence.size());
+  const auto value_for_indices
+      = [](const ViewgramIndices& ind) { return static_cast<float>(2000 * ind.segment_num() + ind.view_num() + 1); };
+
+  {
+    RelatedViewgramsWriteBehind write_behind(*proj_data_sptr, 3);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < num_viewgrams; ++i)
+      {
+        RelatedViewgrams<float> viewgrams = proj_data_sptr->get_empty_related_viewgrams(sequence[i], symmetries_sptr);
+        viewgrams.fill(value_for_indices(sequence[i]));
+        write_behind.set_related_viewgrams(viewgrams);
+      }
+    write_behind.flush();
+  }
+
+  bool all_succeeded = true;
+  {
+    RelatedViewgramsReadAhead read_ahead(proj_data_sptr, symmetries_sptr, sequence, 3);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic) reduction(&& : all_succeeded)
+#endif
+    for (int i = 0; i < num_viewgrams; ++i)
+      {
+        const RelatedViewgrams<float> viewgrams = read_ahead.get_related_viewgrams(sequence[i]);
+        const float value = value_for_indices(sequence[i]);
+        all_succeeded = all_succeeded && viewgrams.get_basic_view_num() == sequence[i].view_num()
+                        && viewgrams.get_basic_segment_num() == sequence[i].segment_num() && viewgrams.find_min() == value
+                        && viewgrams.find_max() == value;
+      }
+  }
+  check(all_succeeded, "test RelatedViewgramsReadAhead after RelatedViewgramsWriteBehind");
+
+  {
+    // stop reading before the end of the sequence
+    RelatedViewgramsReadAhead read_ahead(proj_data_sptr, symmetries_sptr, sequence, 2);
+    const RelatedViewgrams<float> viewgrams = read_ahead.get_related_viewgrams(sequence[0]);
+    check_if_equal(viewgrams.find_max(), value_for_indices(sequence[0]), "test RelatedViewgramsReadAhead first element");
+  }
+}
+
 void
 ProjDataTests::run_tests()
 {
@@ -471,6 +693,26 @@ ProjDataTests::run_tests()
     ProjDataInterfile proj_data_interfile(
         exam_info_sptr, proj_data_info_sptr, "test_proj_data.hs", std::ios::in | std::ios::out | std::ios::trunc);
     run_tests_on_proj_data(proj_data_interfile);
+    run_tests_concurrent_access(proj_data_interfile);
+    run_tests_concurrent_bin_access(proj_data_interfile);
+    run_tests_short_lived_threads(proj_data_interfile);
+
+    std::cerr << "\n-----------------Repeating tests but now with ProjDataSparse\n";
+    {
+      ProjDataSparse proj_data_sparse(exam_info_sptr, proj_data_info_sptr);
+      run_tests_on_proj_data(proj_data_sparse);
+      run_tests_concurrent_access(proj_data_sparse);
+      run_tests_sparse_only(proj_data_sparse);
+    }
+
+    std::cerr << "\n-----------------Repeating concurrent tests with reading the interfile data\n";
+    {
+      shared_ptr<ProjData> proj_data_sptr = ProjData::read_from_file("test_proj_data.hs", std::ios::in | std::ios::out);
+      run_tests_concurrent_access(*proj_data_sptr);
+      if (auto proj_data_from_stream_ptr = dynamic_cast<ProjDataFromStream*>(proj_data_sptr.get()))
+        run_tests_concurrent_bin_access(*proj_data_from_stream_ptr);
+      run_tests_read_ahead_and_write_behind(proj_data_sptr);
+    }
   }
 }
 END_NAMESPACE_STIR
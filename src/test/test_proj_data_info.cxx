@@ -17,7 +17,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2018, 2021, 2022, University College London
+    Copyright (C) 2018, 2021, 2022, 2026, University College London
     Copyright (C) 2018, University of Leeds
     Copyright (C) 2021, National Physical Laboratory
     This file is part of STIR.
@@ -107,6 +107,8 @@ protected:
   void run_coordinate_test_for_realistic_scanner();
   void run_Blocks_DOI_test();
   void run_lor_get_s_test();
+  //! check ProjDataInfoGenericNoArcCorr::find_cartesian_coordinates_of_detection() with and without table of LOR end-points
+  void run_LOR_table_test();
 };
 
 /*! The following is a function to allow a projdata_info blocksONCylindrical to be created from the scanner.
@@ -896,6 +898,76 @@ ProjDataInfoTests::run_coordinate_test_for_realistic_scanner()
   std::cerr << "-- CPU Time " << timer.value() << '\n';
 }
 
+void
+ProjDataInfoTests::run_LOR_table_test()
+{
+  auto scanner_sptr = std::make_shared<Scanner>(Scanner::SAFIRDualRingPrototype);
+  scanner_sptr->set_scanner_geometry("BlocksOnCylindrical");
+  scanner_sptr->set_up();
+
+  auto proj_data_info_sptr = set_blocks_projdata_info<ProjDataInfoBlocksOnCylindricalNoArcCorr>(scanner_sptr);
+  check_if_equal(proj_data_info_sptr->get_LOR_table_size_in_bytes(), std::size_t(0), "LOR table should not be built yet");
+  // copy which only stores the coordinates of the detectors
+  auto proj_data_info_no_LORs_sptr = std::make_shared<ProjDataInfoBlocksOnCylindricalNoArcCorr>(*proj_data_info_sptr);
+  proj_data_info_no_LORs_sptr->set_max_LOR_table_size(0);
+
+  const float z_shift = scanner_sptr->get_coordinate_for_det_pos(DetectionPosition<>(0, 0, 0)).z();
+  Bin bin;
+  for (bin.segment_num() = proj_data_info_sptr->get_min_segment_num();
+       bin.segment_num() <= proj_data_info_sptr->get_max_segment_num();
+       ++bin.segment_num())
+    for (bin.axial_pos_num() = proj_data_info_sptr->get_min_axial_pos_num(bin.segment_num());
+         bin.axial_pos_num() <= proj_data_info_sptr->get_max_axial_pos_num(bin.segment_num());
+         ++bin.axial_pos_num())
+      for (bin.view_num() = proj_data_info_sptr->get_min_view_num(); bin.view_num() <= proj_data_info_sptr->get_max_view_num();
+           ++bin.view_num())
+        for (bin.tangential_pos_num() = proj_data_info_sptr->get_min_tangential_pos_num();
+             bin.tangential_pos_num() <= proj_data_info_sptr->get_max_tangential_pos_num();
+             ++bin.tangential_pos_num())
+          {
+            int det1, ring1, det2, ring2;
+            proj_data_info_sptr->get_det_pair_for_bin(det1, ring1, det2, ring2, bin);
+            CartesianCoordinate3D<float> expected_coord_1
+                = scanner_sptr->get_coordinate_for_det_pos(DetectionPosition<>(det1, ring1, 0));
+            CartesianCoordinate3D<float> expected_coord_2
+                = scanner_sptr->get_coordinate_for_det_pos(DetectionPosition<>(det2, ring2, 0));
+            expected_coord_1.z() -= z_shift;
+            expected_coord_2.z() -= z_shift;
+
+            CartesianCoordinate3D<float> coord_1, coord_2;
+            proj_data_info_sptr->find_cartesian_coordinates_of_detection(coord_1, coord_2, bin);
+            CartesianCoordinate3D<float> coord_1_no_LORs, coord_2_no_LORs;
+            proj_data_info_no_LORs_sptr->find_cartesian_coordinates_of_detection(coord_1_no_LORs, coord_2_no_LORs, bin);
+            if (!check_if_equal(coord_1, expected_coord_1, "first end-point from LOR table")
+                || !check_if_equal(coord_2, expected_coord_2, "second end-point from LOR table")
+                || !check_if_equal(coord_1_no_LORs, expected_coord_1, "first end-point from detector table")
+                || !check_if_equal(coord_2_no_LORs, expected_coord_2, "second end-point from detector table"))
+              {
+                std::cerr << "for bin " << bin.segment_num() << ',' << bin.axial_pos_num() << ',' << bin.view_num() << ','
+                          << bin.tangential_pos_num() << '\n';
+                return;
+              }
+          }
+
+  check(proj_data_info_no_LORs_sptr->get_LOR_table_size_in_bytes() > 0, "detector table should be built");
+  check(proj_data_info_sptr->get_LOR_table_size_in_bytes() > proj_data_info_no_LORs_sptr->get_LOR_table_size_in_bytes(),
+        "LOR table should be larger than the detector table");
+
+  // copies share the table, which has to remain valid when reducing the number of segments
+  auto proj_data_info_copy_sptr = std::make_shared<ProjDataInfoBlocksOnCylindricalNoArcCorr>(*proj_data_info_sptr);
+  check_if_equal(proj_data_info_copy_sptr->get_LOR_table_size_in_bytes(),
+                 proj_data_info_sptr->get_LOR_table_size_in_bytes(),
+                 "copy should have the same LOR table");
+  const int segment_num = proj_data_info_sptr->get_max_segment_num();
+  bin = Bin(segment_num, 1, proj_data_info_sptr->get_max_axial_pos_num(segment_num), 2);
+  proj_data_info_copy_sptr->reduce_segment_range(bin.segment_num(), bin.segment_num());
+  CartesianCoordinate3D<float> coord_1, coord_2, coord_1_copy, coord_2_copy;
+  proj_data_info_sptr->find_cartesian_coordinates_of_detection(coord_1, coord_2, bin);
+  proj_data_info_copy_sptr->find_cartesian_coordinates_of_detection(coord_1_copy, coord_2_copy, bin);
+  check_if_equal(coord_1_copy, coord_1, "first end-point after reduce_segment_range");
+  check_if_equal(coord_2_copy, coord_2, "second end-point after reduce_segment_range");
+}
+
 /*!
   The following tests the function get_s() for the BlockOnCylindrical case. the first test
   checks that all lines passing for the center provide s=0. The second test checks that
@@ -1029,6 +1101,7 @@ ProjDataInfoCylindricalArcCorrTests::run_tests()
   run_lor_get_s_test();
   run_coordinate_test();
   run_coordinate_test_for_realistic_scanner();
+  run_LOR_table_test();
 
   cerr << "-------- Testing ProjDataInfoCylindricalArcCorr --------\n";
   {
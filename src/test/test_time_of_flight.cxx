@@ -1,5 +1,5 @@
 /*
-    Copyright (C) 2016, 2022, UCL
+    Copyright (C) 2016, 2022, 2026, UCL
     Copyright (C) 2016, University of Hull
     This file is part of STIR.
 
@@ -35,13 +35,16 @@
 #include "stir/shared_ptr.h"
 #include "stir/RunTests.h"
 #include "stir/Scanner.h"
+#include "stir/VectorWithOffset.h"
 #include "boost/lexical_cast.hpp"
+#include "boost/format.hpp"
 #ifdef HAVE_CERN_ROOT
 #  include "stir/listmode/CListRecordROOT.h"
 #endif
 #include "stir/info.h"
 #include "stir/warning.h"
 #include <cmath>
+#include <numeric>
 
 START_NAMESPACE_STIR
 
@@ -92,6 +95,16 @@ private:
   //! of the TOF bins is equal to the non-TOF LOR.
   void test_tof_kernel_application(bool export_to_file);
 
+  //! Checks that ProjMatrixByBin::forward_project_all_timing_positions() and
+  //! ProjMatrixByBin::back_project_all_timing_positions() give the same result
+  //! as using get_proj_matrix_elems_for_one_bin() for every TOF bin.
+  void test_tof_fused_projection();
+
+  //! Checks that a matrix that does not store TOF rows in its cache only caches the geometric row,
+  //! and that the sum of the rows of the unmashed timing positions is equal to the row of the mashed one.
+  /*! The unmashed timing positions of a mashed one are found from the TOF bin boundaries. */
+  void test_tof_rows_not_in_cache(const int tof_mash_factor);
+
   //! Exports the nonTOF LOR to a file indicated by the current_id value
   //! in the filename.
   void export_lor(ProjMatrixElemsForOneBin& probabilities,
@@ -164,6 +177,12 @@ TOF_Tests::run_tests()
 
   // Switch to true in order to export the LORs at files in the current directory
   test_tof_kernel_application(false);
+
+  test_tof_fused_projection();
+
+  test_tof_rows_not_in_cache(test_tof_mashing_factor);
+  test_tof_rows_not_in_cache(2);
+  test_tof_rows_not_in_cache(4);
 }
 
 void
@@ -460,6 +479,154 @@ TOF_Tests::test_tof_kernel_application(bool print_to_file)
   std::cerr << std::endl;
 }
 
+void
+TOF_Tests::test_tof_fused_projection()
+{
+  shared_ptr<DiscretisedDensity<3, float>> image_sptr(test_discretised_density_sptr->get_empty_copy());
+  {
+    // fill with a non-uniform pattern
+    float value = 1.F;
+    for (auto iter = image_sptr->begin_all(); iter != image_sptr->end_all(); ++iter)
+      {
+        *iter = value;
+        value = value > 10.F ? 1.F : value + .7F;
+      }
+  }
+
+  const int min_timing_pos_num = test_proj_data_info_sptr->get_min_tof_pos_num();
+  const int max_timing_pos_num = test_proj_data_info_sptr->get_max_tof_pos_num();
+  VectorWithOffset<float> fused_values(min_timing_pos_num, max_timing_pos_num);
+  VectorWithOffset<float> values(min_timing_pos_num, max_timing_pos_num);
+  VectorWithOffset<float> back_values(min_timing_pos_num, max_timing_pos_num);
+  for (int k = min_timing_pos_num; k <= max_timing_pos_num; ++k)
+    back_values[k] = 1.5F + k - min_timing_pos_num;
+
+  ProjMatrixElemsForOneBin proj_matrix_row;
+  ProjMatrixElemsForOneBin tof_proj_matrix_row;
+  // include a negative segment and non-basic views
+  const std::vector<Bin> bins{ Bin(0, 0, 0, 0, 0, 0.F),
+                               Bin(1, 5, 3, -10, 0, 0.F),
+                               Bin(-1, 5, 3, 10, 0, 0.F),
+                               Bin(0, test_proj_data_info_sptr->get_num_views() / 2 + 3, 20, 30, 0, 0.F) };
+  for (const Bin& bin : bins)
+    {
+      const std::string str = boost::str(boost::format(" for segment %1%, view %2%, axial pos %3%, tangential pos %4%")
+                                         % bin.segment_num() % bin.view_num() % bin.axial_pos_num() % bin.tangential_pos_num());
+      test_proj_matrix_sptr->forward_project_all_timing_positions(fused_values, proj_matrix_row, bin, *image_sptr);
+      shared_ptr<DiscretisedDensity<3, float>> fused_back_sptr(image_sptr->get_empty_copy());
+      test_proj_matrix_sptr->back_project_all_timing_positions(*fused_back_sptr, proj_matrix_row, bin, back_values);
+
+      shared_ptr<DiscretisedDensity<3, float>> back_sptr(image_sptr->get_empty_copy());
+      for (int k = min_timing_pos_num; k <= max_timing_pos_num; ++k)
+        {
+          Bin tof_bin(bin.segment_num(), bin.view_num(), bin.axial_pos_num(), bin.tangential_pos_num(), k, 0.F);
+          test_proj_matrix_sptr->get_proj_matrix_elems_for_one_bin(tof_proj_matrix_row, tof_bin);
+          tof_proj_matrix_row.forward_project(tof_bin, *image_sptr);
+          values[k] = tof_bin.get_bin_value();
+          tof_bin.set_bin_value(back_values[k]);
+          tof_proj_matrix_row.back_project(*back_sptr, tof_bin);
+        }
+      check(std::accumulate(values.begin(), values.end(), 0.F) > 0, "forward projection should be non-zero" + str);
+      check_if_equal(values, fused_values, "fused TOF forward projection" + str);
+      check_if_equal(*back_sptr, *fused_back_sptr, "fused TOF back projection" + str);
+    }
+}
+
+void
+TOF_Tests::test_tof_rows_not_in_cache(const int tof_mash_factor)
+{
+  std::cerr << "\tTesting rows of unmashed timing positions for TOF mashing factor " << tof_mash_factor << "\n";
+  // use a number of unmashed timing positions such that the number of timing positions is odd, with and without mashing
+  shared_ptr<Scanner> scanner_sptr(new Scanner(*test_scanner_sptr));
+  {
+    int num_timing_poss = ((test_scanner_sptr->get_max_num_timing_poss() / tof_mash_factor) | 1) * tof_mash_factor;
+    if (num_timing_poss % 2 == 0)
+      ++num_timing_poss;
+    scanner_sptr->set_max_num_timing_poss(num_timing_poss);
+  }
+  scanner_sptr->set_up();
+  shared_ptr<ProjDataInfo> proj_data_info_sptr(ProjDataInfo::ProjDataInfoCTI(scanner_sptr,
+                                                                             1,
+                                                                             scanner_sptr->get_num_rings() - 1,
+                                                                             scanner_sptr->get_num_detectors_per_ring() / 2,
+                                                                             scanner_sptr->get_max_num_non_arccorrected_bins(),
+                                                                             /* arc_correction*/ false));
+  shared_ptr<ProjDataInfo> unmashed_proj_data_info_sptr = proj_data_info_sptr->create_shared_clone();
+  proj_data_info_sptr->set_tof_mash_factor(tof_mash_factor);
+  unmashed_proj_data_info_sptr->set_tof_mash_factor(1);
+
+  shared_ptr<ProjMatrixByBin> mashed_proj_matrix_sptr(test_proj_matrix_sptr->clone());
+  mashed_proj_matrix_sptr->set_up(proj_data_info_sptr, test_discretised_density_sptr);
+  shared_ptr<ProjMatrixByBin> proj_matrix_sptr(test_proj_matrix_sptr->clone());
+  proj_matrix_sptr->store_tof_rows_in_cache(false);
+  check(!proj_matrix_sptr->does_cache_store_tof_rows(), "store_tof_rows_in_cache(false)");
+  proj_matrix_sptr->set_up(unmashed_proj_data_info_sptr, test_discretised_density_sptr);
+
+  shared_ptr<DiscretisedDensity<3, float>> image_sptr(test_discretised_density_sptr->get_empty_copy());
+  image_sptr->fill(1.F);
+
+  ProjMatrixElemsForOneBin proj_matrix_row;
+  const std::vector<Bin> bins{ Bin(0, 0, 0, 0, 0, 0.F), Bin(1, 5, 3, -10, 0, 0.F) };
+  for (const Bin& bin : bins)
+    {
+      const std::string str = boost::str(boost::format(" for TOF mashing factor %1%, segment %2%, view %3%, axial pos %4%, "
+                                                       "tangential pos %5%")
+                                         % tof_mash_factor % bin.segment_num() % bin.view_num() % bin.axial_pos_num()
+                                         % bin.tangential_pos_num());
+      std::size_t cache_size = 0;
+      float total_value = 0.F;
+      float total_unmashed_value = 0.F;
+      for (int k = proj_data_info_sptr->get_min_tof_pos_num(); k <= proj_data_info_sptr->get_max_tof_pos_num(); ++k)
+        {
+          Bin tof_bin(bin.segment_num(), bin.view_num(), bin.axial_pos_num(), bin.tangential_pos_num(), k, 0.F);
+          mashed_proj_matrix_sptr->get_proj_matrix_elems_for_one_bin(proj_matrix_row, tof_bin);
+          proj_matrix_row.forward_project(tof_bin, *image_sptr);
+          total_value += tof_bin.get_bin_value();
+          // For an even mashing factor, some unmashed centres are on the boundary between 2 mashed TOF bins, and belong to
+          // the higher one. We shift the boundaries by a quarter of the unmashed sampling to avoid rounding errors.
+          const float half_sampling_in_k = proj_data_info_sptr->get_sampling_in_k(tof_bin) / 2;
+          const float margin = unmashed_proj_data_info_sptr->get_sampling_in_k(tof_bin) / 4;
+          const float min_k = proj_data_info_sptr->get_k(tof_bin) - half_sampling_in_k - margin;
+          const float max_k = proj_data_info_sptr->get_k(tof_bin) + half_sampling_in_k - margin;
+
+          Bin sum_bin = tof_bin;
+          sum_bin.set_bin_value(0.F);
+          int num_unmashed_timing_poss = 0;
+          for (int j = unmashed_proj_data_info_sptr->get_min_tof_pos_num();
+               j <= unmashed_proj_data_info_sptr->get_max_tof_pos_num();
+               ++j)
+            {
+              Bin unmashed_bin = tof_bin;
+              unmashed_bin.timing_pos_num() = j;
+              unmashed_bin.set_bin_value(0.F);
+              const float unmashed_k = unmashed_proj_data_info_sptr->get_k(unmashed_bin);
+              if (unmashed_k < min_k || unmashed_k >= max_k)
+                continue;
+              ++num_unmashed_timing_poss;
+              proj_matrix_sptr->get_proj_matrix_elems_for_one_bin(proj_matrix_row, unmashed_bin);
+              proj_matrix_row.forward_project(unmashed_bin, *image_sptr);
+              sum_bin.set_bin_value(sum_bin.get_bin_value() + unmashed_bin.get_bin_value());
+              total_unmashed_value += unmashed_bin.get_bin_value();
+              // after the first row, only the geometric row is in the cache
+              if (cache_size == 0)
+                cache_size = proj_matrix_sptr->get_cache_size_in_bytes();
+            }
+          check_if_equal(num_unmashed_timing_poss,
+                         tof_mash_factor,
+                         "number of unmashed timing positions in timing position " + std::to_string(k) + str);
+          // for an even mashing factor, the TOF bins of the unmashed timing positions are shifted by half a bin
+          if (tof_mash_factor % 2 == 1)
+            check_if_equal(tof_bin.get_bin_value(),
+                           sum_bin.get_bin_value(),
+                           "sum of unmashed timing positions " + std::to_string(k) + str);
+        }
+      check_if_equal(total_value, total_unmashed_value, "sum over all timing positions" + str);
+      check(cache_size > 0, "geometric row should be in the cache" + str);
+      check_if_equal(proj_matrix_sptr->get_cache_size_in_bytes(), cache_size, "cache should not contain TOF rows" + str);
+      proj_matrix_sptr->clear_cache();
+    }
+}
+
 void
 TOF_Tests::export_lor(ProjMatrixElemsForOneBin& probabilities,
                       const CartesianCoordinate3D<float>& point1,
@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2002, Hammersmith Imanet Ltd
-    Copyright (C) 2020, 2022 University College London
+    Copyright (C) 2020, 2022, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -21,6 +21,8 @@
 #include "stir/CPUTimer.h"
 #include "stir/info.h"
 #include "stir/ProjData.h"
+#include "stir/listmode/ListModeData.h"
+#include "stir/IO/read_from_file.h"
 #include <boost/format.hpp>
 #include <iostream>
 #include <string>
@@ -29,9 +31,10 @@ static void
 print_usage_and_exit(const std::string& program_name)
 {
   std::cerr << "Usage: " << program_name
-            << " [--display | --print-KL | --include-block-timing-model | --for-symmetry-per-block] \\\n"
+            << " [--display | --print-KL | --include-block-timing-model | --for-symmetry-per-block | --list-mode] \\\n"
             << " out_filename_prefix measured_data model num_iterations num_eff_iterations\n"
-            << " set num_iterations to 0 to do only efficiencies\n";
+            << " set num_iterations to 0 to do only efficiencies\n"
+            << " With --list-mode, measured_data has to be a list mode file (the prompts will be used).\n";
   exit(EXIT_FAILURE);
 }
 
@@ -50,6 +53,7 @@ main(int argc, char** argv)
   bool do_geo = true;
   bool do_block = false;
   bool do_symmetry_per_block = false;
+  bool measured_is_list_mode = false;
 
   // first process command line options
   while (argc > 0 && argv[0][0] == '-' && argc >= 1)
@@ -84,6 +88,12 @@ main(int argc, char** argv)
           --argc;
           ++argv;
         }
+      else if (strcmp(argv[0], "--list-mode") == 0)
+        {
+          measured_is_list_mode = true;
+          --argc;
+          ++argv;
+        }
       else
         print_usage_and_exit(program_name);
     }
@@ -99,22 +109,39 @@ main(int argc, char** argv)
   const int num_eff_iterations = atoi(argv[5]);
   const int num_iterations = atoi(argv[4]);
   shared_ptr<ProjData> model_data = ProjData::read_from_file(argv[3]);
-  shared_ptr<ProjData> measured_data = ProjData::read_from_file(argv[2]);
   const std::string out_filename_prefix = argv[1];
 
   CPUTimer timer;
   timer.start();
 
-  ML_estimate_component_based_normalisation(out_filename_prefix,
-                                            *measured_data,
-                                            *model_data,
-                                            num_eff_iterations,
-                                            num_iterations,
-                                            do_geo,
-                                            do_block,
-                                            do_symmetry_per_block,
-                                            do_KL,
-                                            do_display);
+  if (measured_is_list_mode)
+    {
+      shared_ptr<ListModeData> measured_data = read_from_file<ListModeData>(argv[2]);
+      ML_estimate_component_based_normalisation(out_filename_prefix,
+                                                *measured_data,
+                                                *model_data,
+                                                num_eff_iterations,
+                                                num_iterations,
+                                                do_geo,
+                                                do_block,
+                                                do_symmetry_per_block,
+                                                do_KL,
+                                                do_display);
+    }
+  else
+    {
+      shared_ptr<ProjData> measured_data = ProjData::read_from_file(argv[2]);
+      ML_estimate_component_based_normalisation(out_filename_prefix,
+                                                *measured_data,
+                                                *model_data,
+                                                num_eff_iterations,
+                                                num_iterations,
+                                                do_geo,
+                                                do_block,
+                                                do_symmetry_per_block,
+                                                do_KL,
+                                                do_display);
+    }
 
   timer.stop();
   info(boost::format("CPU time %1% secs") % timer.value());
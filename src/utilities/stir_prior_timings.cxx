@@ -1,136 +1,160 @@
 /*
-  A minimal utility to profile CPU and CUDA relative difference priors in STIR.
-  Author: Modified from stir_timings by ChatGPT for profiling priors only.
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup utilities
+
+  \brief Perform timings of the value and gradient computation of priors
+
+  Times stir::QuadraticPrior, stir::RelativeDifferencePrior, stir::LogcoshPrior and
+  stir::PLSPrior (using the input image as anatomical image). Run without arguments
+  for usage information.
+
+  Timings are reported to stdout in the same format as \c stir_timings.
 */
 
 #include "stir/DiscretisedDensity.h"
 #include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/IO/read_from_file.h"
 #include "stir/Succeeded.h"
-#include "stir/warning.h"
 #include "stir/error.h"
 #include "stir/Verbosity.h"
 #include "stir/num_threads.h"
-#include "/usr/local/cuda/include/cuda_profiler_api.h"
-#include <nvToolsExt.h>
-#include "stir/cuda_utilities.h"
-#include <cuda_runtime.h>
+#include "stir/CPUTimer.h"
+#include "stir/HighResWallClockTimer.h"
 #include "stir/recon_buildblock/QuadraticPrior.h"
-#include "stir/recon_buildblock/GibbsQuadraticPrior.h"
-
+#include "stir/recon_buildblock/RelativeDifferencePrior.h"
+#include "stir/recon_buildblock/LogcoshPrior.h"
+#include "stir/recon_buildblock/PLSPrior.h"
 #ifdef STIR_WITH_CUDA
-#include "stir/recon_buildblock/CUDA/CudaRelativeDifferencePrior.h"
+#  include "stir/recon_buildblock/CUDA/CudaRelativeDifferencePrior.h"
+#  include <cuda_runtime.h>
 #endif
 
 #include <iostream>
 #include <string>
-#include <chrono>
-#include <ctime>
 #include <cstdlib>
 #include <cstring>
 
-START_NAMESPACE_STIR
+static void
+print_usage_and_exit()
+{
+  std::cerr << "\nUsage:\nstir_prior_timings --image image_filename [--runs num_runs] [--threads num_threads]"
+            << " [--name some_string]\n\n"
+            << "Timings are reported to stdout as:\n"
+            << "name\ttiming_name\tCPU_time_in_ms\twall-clock_time_in_ms\n";
+  std::exit(EXIT_FAILURE);
+}
 
-using stir::DiscretisedDensity;
-using stir::VoxelsOnCartesianGrid;
-using stir::RelativeDifferencePrior;
-using stir::QuadraticPrior;
-using stir::GibbsQuadraticPrior;
+START_NAMESPACE_STIR
 
-void print_usage_and_exit()
+//! time compute_value() and compute_gradient() of \a prior, reporting the average time per call
+static void
+run_timings(const std::string& name,
+            const std::string& prior_name,
+            GeneralisedPrior<DiscretisedDensity<3, float>>& prior,
+            const shared_ptr<const DiscretisedDensity<3, float>>& image_sptr,
+            const int num_runs)
 {
-  std::cerr << "\nUsage:\nstir_prior_timings --image image.hv [--runs N] [--threads T] [--name label]\n";
-  std::cerr << "This program times CPU and CUDA relative difference prior computations.\n";
-  std::exit(EXIT_FAILURE);
+  if (prior.set_up(image_sptr) != Succeeded::yes)
+    error("set_up of prior " + prior_name + " failed");
+  shared_ptr<DiscretisedDensity<3, float>> gradient_sptr(image_sptr->get_empty_copy());
+
+  const auto report = [&](const std::string& timing_name, const auto& func) {
+    // call once to avoid including any initialisation
+    func();
+#ifdef STIR_WITH_CUDA
+    cudaDeviceSynchronize();
+#endif
+    CPUTimer cpu_timer;
+    HighResWallClockTimer wall_clock_timer;
+    cpu_timer.start();
+    wall_clock_timer.start();
+    for (int run = 0; run < num_runs; ++run)
+      func();
+#ifdef STIR_WITH_CUDA
+    cudaDeviceSynchronize();
+#endif
+    cpu_timer.stop();
+    wall_clock_timer.stop();
+    std::cout << name << '\t' << prior_name + "_" + timing_name << '\t' << cpu_timer.value() * 1000 / num_runs << '\t'
+              << wall_clock_timer.value() * 1000 / num_runs << '\n';
+  };
+
+  double value = 0.;
+  report("value", [&]() { value = prior.compute_value(*image_sptr); });
+  report("gradient", [&]() { prior.compute_gradient(*gradient_sptr, *image_sptr); });
+  std::cerr << prior_name << " value: " << value << '\n';
 }
 
 END_NAMESPACE_STIR
 
-int main(int argc, char** argv)
+int
+main(int argc, char** argv)
 {
-  using namespace stir;
+  USING_NAMESPACE_STIR
   Verbosity::set(0);
 
   std::string image_filename;
   std::string name;
-  int runs = 1;
+  int num_runs = 10;
+  int num_threads = get_default_num_threads();
 
-  // --- Parse command-line arguments ---
-  ++argv; --argc;
+  ++argv;
+  --argc;
   while (argc > 1)
-  {
-    if (!strcmp(argv[0], "--image"))
-      image_filename = argv[1];
-    else if (!strcmp(argv[0], "--runs"))
-      runs = std::atoi(argv[1]);
-    // else if (!strcmp(argv[0], "--threads"))
-    //   threads = std::atoi(argv[1]);
-    else if (!strcmp(argv[0], "--name"))
-      name = argv[1];
-    else
-      print_usage_and_exit();
-    argv += 2;
-    argc -= 2;
-  }
-
-  if (argc > 0 || image_filename.empty())
+    {
+      if (!strcmp(argv[0], "--image"))
+        image_filename = argv[1];
+      else if (!strcmp(argv[0], "--runs"))
+        num_runs = std::atoi(argv[1]);
+      else if (!strcmp(argv[0], "--threads"))
+        num_threads = std::atoi(argv[1]);
+      else if (!strcmp(argv[0], "--name"))
+        name = argv[1];
+      else
+        print_usage_and_exit();
+      argv += 2;
+      argc -= 2;
+    }
+
+  if (argc > 0 || image_filename.empty() || num_runs < 1)
     print_usage_and_exit();
 
-  // set_num_threads(threads);
-  // std::cerr << "Using " << threads << " threads.\n";
-
-  // --- Load data ---
-
-  shared_ptr<VoxelsOnCartesianGrid<float>> image_sptr;
-  image_sptr = read_from_file<VoxelsOnCartesianGrid<float>>(image_filename);
-  auto quadratic_prior = std::make_shared<stir::QuadraticPrior<float>>(false, 1.F);
-  auto gibbs_quadratic_prior = std::make_shared<stir::GibbsQuadraticPrior<float>>(false, 1.F);
-
-  quadratic_prior->set_up(image_sptr);
-  gibbs_quadratic_prior->set_up(image_sptr);
-  // auto im = image_sptr->clone(); // 'im' is not needed for compute_value(*image_sptr)
-  nvtxRangePushA("compute_value");
-
-  double val       = quadratic_prior->compute_value(*image_sptr); 
-  double gibbs_val = gibbs_quadratic_prior->compute_value(*image_sptr); 
-  std::cout<< "Value_quad_prior: " << val << std::endl;
-  std::cout<< "Gibbs_Value_quad_prior: " << gibbs_val << std::endl;
-  
-  nvtxRangePop();
-  
-
-// #ifdef STIR_WITH_CUDA
-//   // --- CUDA RelativeDifferencePrior ---
-//   {
-//     // auto quadratic_prior = std::make_shared<QuadraticPrior<float>>(false, 1.F);
-//     auto cuda_prior = std::make_shared<CudaRelativeDifferencePrior<float>>(false, 1.F, 2.F, 0.1F);
-//     cuda_prior->set_up(image_sptr);
-//     // quadratic_prior->set_up(image_sptr);
-//     auto im = image_sptr->clone();
-
-//     for (int i = 0; i < 5; ++i)
-//       cuda_prior->compute_gradient(*im, *image_sptr);
-//     cudaDeviceSynchronize();
-
-//     cudaProfilerStart();
-//     nvtxRangePushA("compute_gradient");
-//     for (int i = 0; i < runs; ++i) {
-//       cuda_prior->compute_gradient(*im, *image_sptr);
-//       cudaDeviceSynchronize();
-//     }
-//     nvtxRangePop();
-
-//     nvtxRangePushA("compute_value");
-//     for (int i = 0; i < runs; ++i) {
-//       (void)cuda_prior->compute_value(*image_sptr);
-//       cudaDeviceSynchronize();
-//     }
-//     nvtxRangePop();
-//     cudaProfilerStop();
-
-//     delete im;
-//   }
-// #endif
+  set_num_threads(num_threads);
+  std::cerr << "Using " << num_threads << " threads.\n";
+
+  shared_ptr<const DiscretisedDensity<3, float>> image_sptr(read_from_file<DiscretisedDensity<3, float>>(image_filename));
+
+  {
+    QuadraticPrior<float> prior(false, 1.F);
+    run_timings(name, "Quadratic", prior, image_sptr, num_runs);
+  }
+  {
+    RelativeDifferencePrior<float> prior(false, 1.F, 2.F, 0.1F);
+    run_timings(name, "RDP", prior, image_sptr, num_runs);
+  }
+  {
+    LogcoshPrior<float> prior(false, 1.F, 1.F);
+    run_timings(name, "Logcosh", prior, image_sptr, num_runs);
+  }
+  {
+    PLSPrior<float> prior(false, 1.F);
+    prior.set_anatomical_image_sptr(image_sptr);
+    run_timings(name, "PLS", prior, image_sptr, num_runs);
+  }
+#ifdef STIR_WITH_CUDA
+  {
+    CudaRelativeDifferencePrior<float> prior(false, 1.F, 2.F, 0.1F);
+    run_timings(name, "CudaRDP", prior, image_sptr, num_runs);
+  }
+#endif
 
   return EXIT_SUCCESS;
 }
@@ -7,6 +7,9 @@
 
   \brief Program that writes a projection matrix by bin to file
 
+  Use the \c --compress option to write the matrix in the compressed (version 2.0) format,
+  see stir::ProjMatrixByBinFromFile.
+
   \author Kris Thielemans
 
 */
@@ -39,10 +42,19 @@ int
 main(int argc, char** argv)
 {
   USING_NAMESPACE_STIR
+  const char* const program_name = argv[0];
+  std::string format_version = "1.0";
+  if (argc > 1 && std::string(argv[1]) == "--compress")
+    {
+      format_version = "2.0";
+      --argc;
+      ++argv;
+    }
   if (argc == 1 || argc > 5)
     {
-      cerr << "Usage: " << argv[0] << " \\\n"
-           << "\toutput-filename [proj_data_file [projmatrixbybin-parfile [template-image]]]\n";
+      cerr << "Usage: " << program_name << " \\\n"
+           << "\t[--compress] output-filename [proj_data_file [projmatrixbybin-parfile [template-image]]]\n"
+           << "Use --compress to write the compressed (version 2.0) format.\n";
       exit(EXIT_FAILURE);
     }
   const std::string output_filename_prefix = argc > 1 ? argv[1] : ask_string("Output filename prefix");
@@ -98,7 +110,8 @@ main(int argc, char** argv)
 
   proj_matrix_sptr->set_up(proj_data_info_sptr, image_sptr);
 
-  return ProjMatrixByBinFromFile::write_to_file(output_filename_prefix, *proj_matrix_sptr, proj_data_info_sptr, *image_sptr)
+  return ProjMatrixByBinFromFile::write_to_file(
+             output_filename_prefix, *proj_matrix_sptr, proj_data_info_sptr, *image_sptr, format_version)
                  == Succeeded::yes
              ? EXIT_SUCCESS
              : EXIT_FAILURE;